@@ -0,0 +1,266 @@
+#include <ostream>
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include <MiniLua/MiniLua.hpp>
+#include <catch2/catch.hpp>
+
+TEST_CASE("Interpreter setup") {
+    minilua::Interpreter interpreter;
+    REQUIRE(interpreter.parse(""));
+
+    // NOTE: the first run creates the stdlib snapshot
+    interpreter.evaluate();
+
+    BENCHMARK("evaluate empty program (stdlib snapshot)") { return interpreter.evaluate(); };
+
+    // the tree walker still executes the whole stdlib for every run
+    interpreter.config().engine = minilua::Engine::TREE_WALKER;
+
+    BENCHMARK("evaluate empty program (executing stdlib)") { return interpreter.evaluate(); };
+}
+
+TEST_CASE("Interpreter node tracing") {
+    minilua::Interpreter interpreter;
+    // NOTE: only the tree walker traces the individual AST nodes
+    interpreter.config().engine = minilua::Engine::TREE_WALKER;
+    REQUIRE(interpreter.parse(R"-(
+local sum = 0
+for i = 1, 1000 do
+    sum = sum + i * 2
+end
+return sum
+)-"));
+
+    BENCHMARK("tree walker loop (tracing disabled)") { return interpreter.evaluate(); };
+
+    // discard the output so we mostly measure the formatting
+    std::ostream null_stream(nullptr);
+    interpreter.config().trace_nodes = true;
+    interpreter.config().target = &null_stream;
+
+    BENCHMARK("tree walker loop (tracing enabled)") { return interpreter.evaluate(); };
+}
+
+TEST_CASE("Interpreter local variables") {
+    minilua::Interpreter interpreter;
+    REQUIRE(interpreter.parse(R"-(
+local a1, a2, a3, a4, a5, a6, a7, a8, a9, a10 = 1, 2, 3, 4, 5, 6, 7, 8, 9, 10
+local b1, b2, b3, b4, b5, b6, b7, b8, b9, b10 = 1, 2, 3, 4, 5, 6, 7, 8, 9, 10
+local sum = 0
+for i = 1, 1000 do
+    local x = i
+    if x > 0 then
+        sum = sum + x + a1 + b10
+    end
+end
+return sum
+)-"));
+
+    // every block used to copy all visible local variables
+    BENCHMARK("loop with many visible locals (bytecode)") { return interpreter.evaluate(); };
+
+    interpreter.config().engine = minilua::Engine::TREE_WALKER;
+
+    BENCHMARK("loop with many visible locals (tree walker)") { return interpreter.evaluate(); };
+}
+
+TEST_CASE("Interpreter tables") {
+    minilua::Interpreter interpreter;
+    REQUIRE(interpreter.parse(R"-(
+local t = {}
+for i = 1, 1000 do
+    t[#t + 1] = i
+end
+local sum = 0
+for i = 1, #t do
+    sum = sum + t[i]
+end
+table.remove(t)
+return sum + #table.concat(t, ",")
+)-"));
+
+    BENCHMARK("append to and index a list") { return interpreter.evaluate(); };
+}
+
+TEST_CASE("Interpreter fields") {
+    minilua::Interpreter interpreter;
+    REQUIRE(interpreter.parse(R"-(
+local point = {x = 0, y = 0, name = "point"}
+for i = 1, 1000 do
+    point.x = point.x + 1
+    point.y = point.x
+    counter = (counter or 0) + 1
+end
+return point.x + point.y + counter
+)-"));
+
+    BENCHMARK("read and write fields and globals") { return interpreter.evaluate(); };
+}
+
+TEST_CASE("Interpreter arithmetic") {
+    minilua::Interpreter interpreter;
+    // like luaprograms/LottaLaps.lua but without reading the input
+    REQUIRE(interpreter.parse(R"-(
+local sum = 0.0
+local n = 0
+for i = 1, 1000 do
+    local speed = i % 97 + 1
+    if speed >= 50 then
+        sum = sum + 1 / speed
+        n = n + 1
+    end
+end
+return n / sum
+)-"));
+
+    BENCHMARK("numeric loop (bytecode)") { return interpreter.evaluate(); };
+
+    interpreter.config().engine = minilua::Engine::TREE_WALKER;
+
+    BENCHMARK("numeric loop (tree walker)") { return interpreter.evaluate(); };
+}
+
+TEST_CASE("Interpreter method calls") {
+    minilua::Interpreter interpreter;
+    // the class pattern of luaprograms/FragmeentedFurniture.lua
+    REQUIRE(interpreter.parse(R"-(
+local Base = {}
+Base.__index = Base
+function Base:count() return self.n end
+
+local Counter = setmetatable({}, Base)
+Counter.__index = Counter
+function Counter:increment() self.n = self.n + 1 end
+
+local counter = setmetatable({n = 0}, Counter)
+for i = 1, 1000 do
+    counter:increment()
+end
+return counter:count()
+)-"));
+
+    BENCHMARK("method calls through __index tables") { return interpreter.evaluate(); };
+}
+
+TEST_CASE("Interpreter table indexing") {
+    minilua::Interpreter interpreter;
+    REQUIRE(interpreter.parse(R"-(
+local list = {}
+for i = 1, 1000 do
+    list[i] = i
+end
+local sum = 0
+for i = 1, 1000 do
+    sum = sum + list[i]
+    list[i] = sum
+end
+local default = setmetatable({}, {__index = function() return 1 end})
+for i = 1, 100 do
+    sum = sum + default[i]
+end
+return sum
+)-"));
+
+    BENCHMARK("read and write table entries (bytecode)") { return interpreter.evaluate(); };
+
+    interpreter.config().engine = minilua::Engine::TREE_WALKER;
+
+    BENCHMARK("read and write table entries (tree walker)") { return interpreter.evaluate(); };
+}
+
+TEST_CASE("Interpreter string building") {
+    minilua::Interpreter interpreter;
+    // builds a 10MB string from 10000 lines
+    REQUIRE(interpreter.parse(R"-(
+local chunk = string.rep("x", 1000)
+local lines = {}
+for i = 1, 10000 do
+    lines[i] = "[" .. i .. "] " .. chunk .. " (" .. #chunk .. ")\n"
+end
+return #table.concat(lines)
+)-"));
+
+    BENCHMARK("concatenation chains and table.concat (bytecode)") {
+        return interpreter.evaluate();
+    };
+
+    interpreter.config().engine = minilua::Engine::TREE_WALKER;
+
+    BENCHMARK("concatenation chains and table.concat (tree walker)") {
+        return interpreter.evaluate();
+    };
+
+    interpreter.config().engine = minilua::Engine::BYTECODE;
+    interpreter.config().origin_tracking = minilua::OriginTracking::OFF;
+
+    BENCHMARK("concatenation chains and table.concat (without origin tracking)") {
+        return interpreter.evaluate();
+    };
+}
+
+TEST_CASE("Interpreter recursion") {
+    minilua::Interpreter interpreter;
+    interpreter.config().origin_tracking = minilua::OriginTracking::OFF;
+
+    // ~250000 calls
+    REQUIRE(interpreter.parse(R"-(
+local function fib(n)
+    if n < 2 then
+        return n
+    end
+    return fib(n - 1) + fib(n - 2)
+end
+return fib(25)
+)-"));
+
+    BENCHMARK("fib(25) (bytecode)") { return interpreter.evaluate(); };
+
+    interpreter.config().engine = minilua::Engine::TREE_WALKER;
+
+    BENCHMARK("fib(25) (tree walker)") { return interpreter.evaluate(); };
+
+    // ~10000 calls with a call depth up to 125
+    REQUIRE(interpreter.parse(R"-(
+local function ack(m, n)
+    if m == 0 then
+        return n + 1
+    elseif n == 0 then
+        return ack(m - 1, 1)
+    end
+    return ack(m - 1, ack(m, n - 1))
+end
+return ack(3, 4)
+)-"));
+
+    interpreter.config().engine = minilua::Engine::BYTECODE;
+
+    BENCHMARK("ackermann(3, 4) (bytecode)") { return interpreter.evaluate(); };
+
+    interpreter.config().engine = minilua::Engine::TREE_WALKER;
+
+    BENCHMARK("ackermann(3, 4) (tree walker)") { return interpreter.evaluate(); };
+}
+
+TEST_CASE("Interpreter table traversal") {
+    minilua::Interpreter interpreter;
+    REQUIRE(interpreter.parse(R"-(
+local t = {}
+for i = 1, 1000 do
+    t[i] = i
+    t["key" .. i] = i
+end
+local sum = 0
+for k, v in pairs(t) do
+    sum = sum + v
+end
+for i, v in ipairs(t) do
+    sum = sum + v
+end
+return sum
+)-"));
+
+    BENCHMARK("pairs and ipairs (bytecode)") { return interpreter.evaluate(); };
+
+    interpreter.config().engine = minilua::Engine::TREE_WALKER;
+
+    BENCHMARK("pairs and ipairs (tree walker)") { return interpreter.evaluate(); };
+}
@@ -0,0 +1,460 @@
+// Runs the programs in luaprograms/ through minilua::Interpreter and reports
+// parse time, evaluation time and allocator statistics as JSON.
+//
+// Usage:
+//
+//   MiniLua-bench-programs [--runs <n>] [--output <results.json>] [--no-timings]
+//                          [--compare <baseline.json>] [--threshold <fraction>]
+//                          [--origin-tracking <off|lazy|full>] [<program.lua>...]
+//
+// Without explicit programs all `*.lua` files directly in luaprograms/ are
+// run. If a file `<program>.in` exists next to a program it is used as the
+// input of the program (`io.read`). All output of the programs is discarded.
+//
+// `--origin-tracking` sets InterpreterConfig::origin_tracking (defaults to
+// full) to compare the cost of the origin tracking modes. Only compare
+// results recorded with the same mode.
+//
+// With `--compare` the results are compared against a baseline written by an
+// earlier run (e.g. bench/baseline.json). Timings are flagged if they are
+// slower than the baseline by more than the threshold (defaults to 0.1). The
+// allocator statistics are deterministic so every increase is flagged.
+// Programs that are missing from the baseline are flagged too, so an
+// outdated baseline can't pass. The exit code is 1 if there was a regression
+// and 2 if the baseline is empty.
+//
+// The timings depend on the machine. Records in the baseline without
+// `parse_ns` and `evaluate_ns` (e.g. written with `--no-timings`) only check
+// the status and the allocator statistics.
+
+#include <MiniLua/MiniLua.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <dirent.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std::string_literals;
+
+#ifndef MINILUA_LUAPROGRAMS_DIR
+#define MINILUA_LUAPROGRAMS_DIR "../luaprograms"
+#endif
+
+static const int DEFAULT_RUNS = 10;
+static const double DEFAULT_THRESHOLD = 0.1;
+
+struct ProgramResult {
+    std::string name;
+    bool ok = true;
+    bool has_timings = true;
+    long parse_ns = 0;
+    long evaluate_ns = 0;
+    long peak_objects = 0;
+    long allocations = 0;
+};
+
+static auto median(std::vector<long> values) -> long {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+static auto read_optional_file(const std::string& path) -> std::optional<std::string> {
+    std::ifstream ifs(path);
+    if (!ifs) {
+        return std::nullopt;
+    }
+    return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+static auto file_exists(const std::string& path) -> bool { return std::ifstream(path).good(); }
+
+static auto program_name(const std::string& path) -> std::string {
+    auto start = path.find_last_of('/');
+    start = start == std::string::npos ? 0 : start + 1;
+    auto end = path.rfind(".lua");
+    if (end == std::string::npos || end < start) {
+        end = path.size();
+    }
+    return path.substr(start, end - start);
+}
+
+static auto find_programs(const std::string& dir) -> std::vector<std::string> {
+    std::vector<std::string> programs;
+
+    DIR* handle = opendir(dir.c_str());
+    if (handle == nullptr) {
+        throw std::runtime_error("could not open directory " + dir);
+    }
+    while (const dirent* entry = readdir(handle)) {
+        std::string filename = entry->d_name;
+        if (filename.size() > 4 && filename.compare(filename.size() - 4, 4, ".lua") == 0) {
+            programs.push_back(dir + "/" + filename);
+        }
+    }
+    closedir(handle);
+
+    std::sort(programs.begin(), programs.end());
+    return programs;
+}
+
+static auto parse_origin_tracking(const std::string& name)
+    -> std::optional<minilua::OriginTracking> {
+    if (name == "off") {
+        return minilua::OriginTracking::OFF;
+    } else if (name == "lazy") {
+        return minilua::OriginTracking::LAZY;
+    } else if (name == "full") {
+        return minilua::OriginTracking::FULL;
+    }
+    return std::nullopt;
+}
+
+static auto run_program(const std::string& path, int runs, minilua::OriginTracking origin_tracking)
+    -> ProgramResult {
+    auto source = read_optional_file(path);
+    if (!source) {
+        throw std::runtime_error("could not read " + path);
+    }
+
+    // redirect the io library to the input file and discard the output
+    //
+    // NOTE: the prefix does not contain a newline so the line numbers in
+    // error messages still match the original file
+    auto input_path = path.substr(0, path.size() - 4) + ".in";
+    if (!file_exists(input_path)) {
+        input_path = "/dev/null";
+    }
+    std::string program = "io.input([==[" + input_path + "]==]) io.output(\"/dev/null\") " +
+                          source.value();
+
+    std::ostream null_stream(nullptr);
+
+    minilua::Interpreter interpreter;
+    interpreter.config().origin_tracking = origin_tracking;
+    interpreter.environment().set_stdout(&null_stream);
+    interpreter.environment().set_stderr(&null_stream);
+    auto* allocator = interpreter.environment().allocator();
+
+    ProgramResult result;
+    result.name = program_name(path);
+
+    std::vector<long> parse_times;
+    std::vector<long> evaluate_times;
+
+    // NOTE: the first run is only a warmup (it also creates the stdlib snapshot)
+    for (int run = 0; run <= runs; ++run) {
+        auto parse_result = interpreter.parse(program);
+        if (!parse_result) {
+            throw std::runtime_error("could not parse " + path);
+        }
+
+        allocator->reset_statistics();
+
+        auto t_start = std::chrono::steady_clock::now();
+        bool ok = true;
+        try {
+            interpreter.evaluate();
+        } catch (const minilua::InterpreterException&) {
+            ok = false;
+        } catch (const std::exception&) {
+            ok = false;
+        }
+        auto t_end = std::chrono::steady_clock::now();
+
+        if (run == 0) {
+            continue;
+        }
+
+        parse_times.push_back(parse_result.elapsed_time);
+        evaluate_times.push_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(t_end - t_start).count());
+        result.ok = result.ok && ok;
+        result.peak_objects = static_cast<long>(allocator->peak_objects());
+        result.allocations = static_cast<long>(allocator->num_allocations());
+    }
+
+    result.parse_ns = median(parse_times);
+    result.evaluate_ns = median(evaluate_times);
+    return result;
+}
+
+static void write_json(
+    std::ostream& o, const std::vector<ProgramResult>& results, int runs, bool timings) {
+    o << "{\n";
+    o << "  \"runs\": " << runs << ",\n";
+    o << "  \"programs\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const auto& result = results[i];
+        o << "    {\"name\": \"" << result.name << "\", \"status\": \""
+          << (result.ok ? "ok" : "error") << "\"";
+        if (timings) {
+            o << ", \"parse_ns\": " << result.parse_ns
+              << ", \"evaluate_ns\": " << result.evaluate_ns;
+        }
+        o << ", \"peak_objects\": " << result.peak_objects
+          << ", \"allocations\": " << result.allocations << "}";
+        o << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    o << "  ]\n";
+    o << "}\n";
+}
+
+// Minimal reader for the JSON written by write_json.
+//
+// It supports objects, arrays, strings without escapes and integers. That is
+// enough for the baseline files but not for arbitrary JSON.
+class JsonReader {
+    const std::string& json;
+    std::size_t pos = 0;
+
+    void skip_whitespace() {
+        while (pos < json.size() && std::isspace(static_cast<unsigned char>(json[pos]))) {
+            ++pos;
+        }
+    }
+    auto peek() -> char {
+        skip_whitespace();
+        if (pos >= json.size()) {
+            throw std::runtime_error("unexpected end of baseline file");
+        }
+        return json[pos];
+    }
+    void expect(char c) {
+        if (peek() != c) {
+            throw std::runtime_error(
+                "expected '"s + c + "' at offset " + std::to_string(pos) + " of baseline file");
+        }
+        ++pos;
+    }
+
+public:
+    JsonReader(const std::string& json) : json(json) {}
+
+    auto read_string() -> std::string {
+        expect('"');
+        auto end = json.find('"', pos);
+        if (end == std::string::npos) {
+            throw std::runtime_error("unterminated string in baseline file");
+        }
+        auto str = json.substr(pos, end - pos);
+        pos = end + 1;
+        return str;
+    }
+
+    // reads a flat object of string and integer members
+    auto read_record() -> std::map<std::string, std::string> {
+        std::map<std::string, std::string> record;
+        expect('{');
+        while (peek() != '}') {
+            auto key = this->read_string();
+            expect(':');
+            if (peek() == '"') {
+                record[key] = this->read_string();
+            } else {
+                auto start = pos;
+                while (pos < json.size() && (std::isdigit(static_cast<unsigned char>(json[pos])) ||
+                                             json[pos] == '-')) {
+                    ++pos;
+                }
+                record[key] = json.substr(start, pos - start);
+            }
+            if (peek() == ',') {
+                ++pos;
+            }
+        }
+        expect('}');
+        return record;
+    }
+
+    auto read_results() -> std::map<std::string, ProgramResult> {
+        std::map<std::string, ProgramResult> results;
+        expect('{');
+        while (peek() != '}') {
+            auto key = this->read_string();
+            expect(':');
+            if (key == "programs") {
+                expect('[');
+                while (peek() != ']') {
+                    auto record = this->read_record();
+                    ProgramResult result;
+                    result.name = record["name"];
+                    result.ok = record["status"] == "ok";
+                    result.has_timings =
+                        record.count("parse_ns") != 0 && record.count("evaluate_ns") != 0;
+                    result.parse_ns = std::atol(record["parse_ns"].c_str());
+                    result.evaluate_ns = std::atol(record["evaluate_ns"].c_str());
+                    result.peak_objects = std::atol(record["peak_objects"].c_str());
+                    result.allocations = std::atol(record["allocations"].c_str());
+                    results[result.name] = result;
+                    if (peek() == ',') {
+                        ++pos;
+                    }
+                }
+                expect(']');
+            } else {
+                // skip scalar members (e.g. "runs")
+                while (peek() != ',' && peek() != '}') {
+                    ++pos;
+                }
+            }
+            if (peek() == ',') {
+                ++pos;
+            }
+        }
+        expect('}');
+        return results;
+    }
+};
+
+// Returns the number of regressions.
+static auto compare(
+    const std::vector<ProgramResult>& results,
+    const std::map<std::string, ProgramResult>& baseline, double threshold) -> int {
+    int regressions = 0;
+
+    auto report = [&regressions](const std::string& name, const std::string& metric, long before,
+                                 long after) {
+        ++regressions;
+        std::cerr << "REGRESSION " << name << ": " << metric << " " << before << " -> " << after
+                  << "\n";
+    };
+    auto check_time = [&](const std::string& name, const std::string& metric, long before,
+                          long after) {
+        if (static_cast<double>(after) > static_cast<double>(before) * (1.0 + threshold)) {
+            report(name, metric, before, after);
+        }
+    };
+
+    for (const auto& result : results) {
+        auto it = baseline.find(result.name);
+        if (it == baseline.end()) {
+            ++regressions;
+            std::cerr << "MISSING " << result.name
+                      << ": not in baseline (record it with --output)\n";
+            continue;
+        }
+        const auto& before = it->second;
+
+        if (before.ok && !result.ok) {
+            report(result.name, "status (0 = error)", 1, 0);
+        }
+        if (before.has_timings) {
+            check_time(result.name, "parse_ns", before.parse_ns, result.parse_ns);
+            check_time(result.name, "evaluate_ns", before.evaluate_ns, result.evaluate_ns);
+        }
+        if (result.peak_objects > before.peak_objects) {
+            report(result.name, "peak_objects", before.peak_objects, result.peak_objects);
+        }
+        if (result.allocations > before.allocations) {
+            report(result.name, "allocations", before.allocations, result.allocations);
+        }
+    }
+
+    return regressions;
+}
+
+auto main(int argc, char* argv[]) -> int {
+    int runs = DEFAULT_RUNS;
+    double threshold = DEFAULT_THRESHOLD;
+    std::optional<std::string> output;
+    std::optional<std::string> baseline_path;
+    bool timings = true;
+    auto origin_tracking = minilua::OriginTracking::FULL;
+    std::vector<std::string> programs;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--runs" && has_value) {
+            runs = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--output" && has_value) {
+            output = argv[++i];
+        } else if (arg == "--compare" && has_value) {
+            baseline_path = argv[++i];
+        } else if (arg == "--threshold" && has_value) {
+            threshold = std::atof(argv[++i]);
+        } else if (arg == "--no-timings") {
+            timings = false;
+        } else if (arg == "--origin-tracking" && has_value && parse_origin_tracking(argv[i + 1])) {
+            origin_tracking = parse_origin_tracking(argv[++i]).value();
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--runs <n>] [--output <results.json>] [--no-timings] "
+                         "[--compare <baseline.json>] [--threshold <fraction>] "
+                         "[--origin-tracking <off|lazy|full>] [<program.lua>...]\n";
+            return 2;
+        } else {
+            programs.push_back(arg);
+        }
+    }
+
+    try {
+        if (programs.empty()) {
+            programs = find_programs(MINILUA_LUAPROGRAMS_DIR);
+        }
+
+        // NOTE: read the baseline first because it might get overwritten by the output
+        std::optional<std::map<std::string, ProgramResult>> baseline;
+        if (baseline_path) {
+            auto baseline_json = read_optional_file(baseline_path.value());
+            if (!baseline_json) {
+                throw std::runtime_error("could not read " + baseline_path.value());
+            }
+            baseline = JsonReader(baseline_json.value()).read_results();
+            if (baseline->empty()) {
+                // NOTE: every program would be reported as missing
+                throw std::runtime_error(
+                    baseline_path.value() +
+                    " has no records, record it with "
+                    "`./scripts/bench_programs.sh --no-timings --output bench/baseline.json`");
+            }
+        }
+
+        std::vector<ProgramResult> results;
+        for (const auto& program : programs) {
+            results.push_back(run_program(program, runs, origin_tracking));
+
+            const auto& result = results.back();
+            std::cerr << std::left << std::setw(40) << result.name << std::right
+                      << (result.ok ? "     ok" : "  error") << "  parse " << std::setw(10)
+                      << result.parse_ns << "ns  evaluate " << std::setw(12) << result.evaluate_ns
+                      << "ns  peak " << std::setw(6) << result.peak_objects << "  allocations "
+                      << std::setw(8) << result.allocations << "\n";
+        }
+
+        if (output) {
+            std::ofstream ofs(output.value());
+            write_json(ofs, results, runs, timings);
+        } else {
+            write_json(std::cout, results, runs, timings);
+        }
+
+        if (baseline) {
+            int regressions = compare(results, baseline.value(), threshold);
+            if (regressions != 0) {
+                std::cerr << regressions << " regression(s) compared to " << baseline_path.value()
+                          << "\n";
+                return 1;
+            }
+            std::cerr << "No regressions compared to " << baseline_path.value() << "\n";
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "error: " << e.what() << "\n";
+        return 2;
+    }
+
+    return 0;
+}
@@ -0,0 +1,209 @@
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include <MiniLua/MiniLua.hpp>
+#include <MiniLua/table_functions.hpp>
+#include <catch2/catch.hpp>
+
+#include <random>
+#include <string>
+#include <vector>
+
+// NOTE: every benchmark copies 1000 values so the reported time divided by
+// 1000 is the time of a single copy
+static const int NUM_COPIES = 1000;
+
+TEST_CASE("Value copies") {
+    minilua::MemoryAllocator allocator;
+    minilua::Value number = 42; // NOLINT
+    minilua::Value string = "a string that is not stored inline";
+    minilua::Value table = minilua::Table(&allocator);
+    minilua::Value with_origin = minilua::Value(42).with_origin(minilua::LiteralOrigin{}); // NOLINT
+    minilua::Vallist vallist{number, string, table};
+
+    std::vector<minilua::Value> target(NUM_COPIES);
+
+    BENCHMARK("copy number") {
+        for (auto& value : target) {
+            value = number;
+        }
+        return target.size();
+    };
+    BENCHMARK("copy table") {
+        for (auto& value : target) {
+            value = table;
+        }
+        return target.size();
+    };
+    BENCHMARK("copy string") {
+        for (auto& value : target) {
+            value = string;
+        }
+        return target.size();
+    };
+    BENCHMARK("copy number with origin") {
+        for (auto& value : target) {
+            value = with_origin;
+        }
+        return target.size();
+    };
+    BENCHMARK("Vallist::get") {
+        for (auto& value : target) {
+            value = vallist.get(0);
+        }
+        return target.size();
+    };
+}
+
+TEST_CASE("tonumber") {
+    // a mix of all kinds of numerals (and some strings that are no numbers)
+    const std::vector<std::string> numerals{
+        "42",    "-17",   "  123456789  ", "0xff",   "0x1p4",  "3.14159",
+        "2.5e10", ".5",   "1e-3",          "hello",  "12abc",  "9223372036854775808"};
+    // NOTE: every benchmark converts a million strings
+    const int num_strings = 1000000;
+
+    std::vector<minilua::Value> strings;
+    strings.reserve(num_strings);
+    for (int i = 0; i < num_strings; ++i) {
+        strings.emplace_back(numerals[i % numerals.size()]);
+    }
+
+    BENCHMARK("Value::to_number") {
+        int count = 0;
+        for (const auto& string : strings) {
+            if (string.to_number().is_number()) {
+                count++;
+            }
+        }
+        return count;
+    };
+
+    BENCHMARK("parse_number_literal") {
+        int count = 0;
+        for (std::size_t i = 0; i < num_strings; ++i) {
+            if (minilua::parse_number_literal(numerals[i % numerals.size()]).is_number()) {
+                count++;
+            }
+        }
+        return count;
+    };
+}
+
+TEST_CASE("table.sort") {
+    // NOTE: every benchmark sorts a (new) table with 10000 elements
+    const int num_elements = 10000;
+
+    std::mt19937 rng(42); // NOLINT
+    std::vector<minilua::Value> numbers;
+    std::vector<minilua::Value> strings;
+    for (int i = 0; i < num_elements; ++i) {
+        const auto value = static_cast<minilua::Number::Int>(rng() % num_elements);
+        numbers.emplace_back(value);
+        strings.emplace_back("key" + std::to_string(value));
+    }
+
+    minilua::MemoryAllocator allocator;
+    minilua::Environment env(&allocator);
+    minilua::CallContext ctx(&env);
+
+    auto make_tables = [&allocator](const std::vector<minilua::Value>& values, int count) {
+        std::vector<minilua::Table> tables;
+        for (int i = 0; i < count; ++i) {
+            minilua::Table table(&allocator);
+            for (std::size_t j = 0; j < values.size(); ++j) {
+                table.set(static_cast<minilua::Number::Int>(j + 1), values[j]);
+            }
+            tables.push_back(table);
+        }
+        return tables;
+    };
+
+    BENCHMARK_ADVANCED("numbers")(Catch::Benchmark::Chronometer meter) {
+        auto tables = make_tables(numbers, meter.runs());
+        meter.measure([&](int i) { minilua::table::sort(ctx.make_new({tables[i]})); });
+    };
+
+    BENCHMARK_ADVANCED("strings")(Catch::Benchmark::Chronometer meter) {
+        auto tables = make_tables(strings, meter.runs());
+        meter.measure([&](int i) { minilua::table::sort(ctx.make_new({tables[i]})); });
+    };
+
+    BENCHMARK_ADVANCED("order function")(Catch::Benchmark::Chronometer meter) {
+        minilua::Function greater([](const minilua::CallContext& ctx) {
+            return ctx.arguments().get(1).less_than(ctx.arguments().get(0));
+        });
+        auto tables = make_tables(numbers, meter.runs());
+        meter.measure([&](int i) { minilua::table::sort(ctx.make_new({tables[i], greater})); });
+    };
+}
+
+TEST_CASE("Table keys") {
+    // NOTE: 1000000 keys of mixed types (integers with a stride, floats,
+    // strings and tables)
+    const int num_keys = 1000000;
+
+    minilua::MemoryAllocator allocator;
+
+    std::vector<minilua::Value> keys;
+    keys.reserve(num_keys);
+    for (int i = 0; i < num_keys; ++i) {
+        switch (i % 4) {
+        case 0:
+            keys.emplace_back(static_cast<minilua::Number::Int>(i) * 1024); // NOLINT
+            break;
+        case 1:
+            keys.emplace_back(i + 0.5); // NOLINT
+            break;
+        case 2:
+            keys.emplace_back("key" + std::to_string(i));
+            break;
+        default:
+            keys.emplace_back(minilua::Table(&allocator));
+            break;
+        }
+    }
+
+    BENCHMARK_ADVANCED("insert")(Catch::Benchmark::Chronometer meter) {
+        std::vector<minilua::Table> tables;
+        for (int i = 0; i < meter.runs(); ++i) {
+            tables.emplace_back(&allocator);
+        }
+        meter.measure([&](int i) {
+            for (const auto& key : keys) {
+                tables[i].set(key, true);
+            }
+        });
+    };
+
+    minilua::Table table(&allocator);
+    for (const auto& key : keys) {
+        table.set(key, true);
+    }
+
+    BENCHMARK("lookup") {
+        int found = 0;
+        for (const auto& key : keys) {
+            found += table.get(key).is_bool() ? 1 : 0;
+        }
+        return found;
+    };
+}
+
+TEST_CASE("Table traversal") {
+    const int num_keys = 100000;
+
+    minilua::MemoryAllocator allocator;
+    minilua::Table table(&allocator);
+    for (int i = 0; i < num_keys; ++i) {
+        table.set(i, i);
+        table.set("key" + std::to_string(i), i);
+    }
+
+    BENCHMARK("next") {
+        int count = 0;
+        for (auto entry = table.next(minilua::Nil()); entry.size() != 0;
+             entry = table.next(entry.get(0))) {
+            ++count;
+        }
+        return count;
+    };
+}
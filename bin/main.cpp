@@ -10,13 +10,15 @@ using namespace std::string_literals;
 
 auto main(int argc, char* argv[]) -> int {
     if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " [--quiet][--trace][--time] <program.lua>\n";
+        std::cerr << "Usage: " << argv[0]
+                  << " [--quiet][--trace][--time][--profile <out.folded>] <program.lua>\n";
         return 1;
     }
 
     bool trace = false;
     bool quiet = false;
     bool time = false;
+    const char* profile_path = nullptr;
     size_t index = 1;
 
     if (argv[index] == "--quiet"s) {
@@ -31,9 +33,27 @@ auto main(int argc, char* argv[]) -> int {
         ++index;
         time = true;
     }
+    if (argv[index] == "--profile"s && index + 2 < static_cast<size_t>(argc)) {
+        profile_path = argv[index + 1];
+        index += 2;
+    }
 
     minilua::Interpreter interpreter;
     interpreter.config().all(trace);
+    if (profile_path != nullptr) {
+        interpreter.config().profile_period = std::chrono::milliseconds(1);
+    }
+
+    // the profile is also written if the program fails
+    auto write_profile = [&interpreter, profile_path]() {
+        if (profile_path == nullptr) {
+            return;
+        }
+        std::ofstream out(profile_path);
+        interpreter.profile().write_folded(out);
+        std::cerr << "Wrote " << interpreter.profile().num_samples() << " samples to "
+                  << profile_path << "\n";
+    };
 
     auto parse_result = interpreter.parse_file(argv[index]);
     if (!parse_result) {
@@ -71,9 +91,11 @@ auto main(int argc, char* argv[]) -> int {
                 std::chrono::duration_cast<std::chrono::nanoseconds>(t_end - t_start).count();
             std::cerr << "Interpreting took " << diff << "ns\n";
         }
+        write_profile();
     } catch (const minilua::InterpreterException& e) {
         // std::cerr << "Evaluation failed:\n";
         e.print_stacktrace(std::cerr);
+        write_profile();
         return 4;
     }
 }
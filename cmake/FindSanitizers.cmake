@@ -15,6 +15,12 @@ set(CMAKE_CXX_FLAGS_MSAN
     CACHE STRING "Flags used by the C++ compiler during MemorySanitizer builds."
     FORCE)
 
+# detects data races (e.g. between interpreters running on different threads)
+set(CMAKE_CXX_FLAGS_TSAN
+    "-fsanitize=thread -fno-omit-frame-pointer -g -O1"
+    CACHE STRING "Flags used by the C++ compiler during ThreadSanitizer builds."
+    FORCE)
+
 # detects uses of undefined behaviour (e.g. nullptr dereferencing, accessing unaligned memory)
 set(CMAKE_CXX_FLAGS_UBSAN
     "-fsanitize=undefined"
@@ -3,6 +3,7 @@
 
 #include "environment.hpp"
 #include "interpreter.hpp"
+#include "profile.hpp"
 #include "source_change.hpp"
 #include "utils.hpp"
 #include "values.hpp"
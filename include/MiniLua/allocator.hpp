@@ -1,6 +1,8 @@
 #ifndef MINILUA_ALLOCATOR_H
 #define MINILUA_ALLOCATOR_H
 
+#include <cstddef>
+#include <memory>
 #include <typeindex>
 #include <typeinfo>
 #include <unordered_map>
@@ -10,6 +12,10 @@ namespace minilua {
 
 struct TableImpl;
 
+namespace details {
+class StringTable;
+} // namespace details
+
 // template <typename T> class gc_ptr {
 //     T* ptr;
 //
@@ -39,13 +45,27 @@ struct TableImpl;
  * the global variable `_G` refers to the global environment. And additionally
  * function definitions capture the environment but are also stored in the
  * environment. So they form an indirect cycle.
+ *
+ * While running lua code the interpreter frees unreachable tables using a
+ * tracing garbage collector (see InterpreterConfig::gc_threshold). It marks
+ * all reachable tables and then calls MemoryAllocator::sweep.
+ *
+ * The allocator also owns the table of the short strings that were interned
+ * while an interpreter used it (see String).
  */
 class MemoryAllocator {
     std::vector<TableImpl*> table_memory;
+    std::size_t allocations = 0;
+    std::size_t peak = 0;
+    std::unique_ptr<details::StringTable> strings;
 
 public:
+    MemoryAllocator();
     ~MemoryAllocator();
 
+    MemoryAllocator(const MemoryAllocator&) = delete;
+    auto operator=(const MemoryAllocator&) -> MemoryAllocator& = delete;
+
     /**
      * @brief Allocate an new table implementation object.
      *
@@ -75,10 +95,51 @@ public:
      */
     void free_all();
 
+    /**
+     * @brief Free all tables that were not marked by the garbage collector.
+     *
+     * Only tables allocated after the first `first` tables are considered. The
+     * order of the remaining tables is preserved.
+     *
+     * Returns the number of freed tables.
+     *
+     * \warning This is used internally by the garbage collector. The freed
+     * tables must not be reachable anymore.
+     */
+    auto sweep(std::size_t first = 0) -> std::size_t;
+
     /**
      * @brief The number of allocated objects.
      */
     auto num_objects() -> std::size_t;
+
+    /**
+     * @brief The number of objects allocated since the last call to
+     * MemoryAllocator::reset_statistics.
+     *
+     * This also counts objects that were freed in the meantime.
+     */
+    [[nodiscard]] auto num_allocations() const -> std::size_t;
+
+    /**
+     * @brief The highest number of objects that were alive at the same time
+     * since the last call to MemoryAllocator::reset_statistics.
+     */
+    [[nodiscard]] auto peak_objects() const -> std::size_t;
+
+    /**
+     * @brief Reset the allocation statistics.
+     *
+     * The peak is reset to the current number of objects.
+     */
+    void reset_statistics();
+
+    /**
+     * @brief The table of the interned strings.
+     *
+     * This is used internally in String.
+     */
+    auto string_table() -> details::StringTable&;
 };
 
 /**
@@ -90,6 +151,9 @@ public:
  * This will get freed when the program terminates. You can also manually free
  * it but you need to be **absolutely certain** that none of the values
  * allocated with it are not in use anymore.
+ *
+ * \warning This is not thread safe. The interpreters never allocate tables in
+ * it (they have their own allocators).
  */
 extern MemoryAllocator GLOBAL_ALLOCATOR;
 
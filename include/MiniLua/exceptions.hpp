@@ -5,6 +5,8 @@
 #include <memory>
 #include <ostream>
 #include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 
 namespace minilua {
@@ -86,6 +88,27 @@ auto with_call_stack(Fn f, const std::string& function_name, const StackItem& it
     }
 }
 
+/**
+ * @brief Same as above but the function name and stack item are only created
+ * if an exception is thrown.
+ *
+ * `describe` has to return a `std::pair<std::string, StackItem>` of the
+ * function name and the stack item. This avoids formatting them for every
+ * call when no error occurs.
+ */
+template <typename Fn, typename Describe> auto with_call_stack(Fn f, Describe describe) {
+    try {
+        return f();
+    } catch (const BadArgumentError& e) {
+        auto [function_name, item] = describe();
+        throw e.with(function_name, std::move(item));
+    } catch (const InterpreterException& e) {
+        throw e.with(describe().second);
+    } catch (const std::exception& e) {
+        throw InterpreterException(e.what()).with(describe().second);
+    }
+}
+
 } // namespace minilua
 
 #endif // MINILUA_EXCEPTIONS_HPP
@@ -1,6 +1,8 @@
 #ifndef MINILUA_INTERPRETER_H
 #define MINILUA_INTERPRETER_H
 
+#include <chrono>
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -8,6 +10,7 @@
 
 #include "environment.hpp"
 #include "exceptions.hpp"
+#include "profile.hpp"
 #include "source_change.hpp"
 #include "values.hpp"
 
@@ -56,10 +59,28 @@ struct EvalResult {
 
 auto operator<<(std::ostream&, const EvalResult&) -> std::ostream&;
 
+/**
+ * @brief The engine the Interpreter uses to execute lua code.
+ */
+enum class Engine {
+    /**
+     * @brief Compile the code to bytecode and run it in a virtual machine.
+     *
+     * This is the default.
+     */
+    BYTECODE,
+    /**
+     * @brief Directly walk the syntax tree.
+     *
+     * This is mostly useful as a reference implementation to compare against.
+     */
+    TREE_WALKER,
+};
+
 /**
  * @brief Configuration for the Interpreter.
  *
- * This controls the debug logging.
+ * This controls the debug logging and the used Engine.
  *
  * The target defaults to `std::cerr`.
  */
@@ -72,6 +93,11 @@ struct InterpreterConfig {
     std::ostream* target;
     /**
      * @brief Trace node enter and exit.
+     *
+     * With Engine::BYTECODE this traces the executed instructions instead.
+     *
+     * The nodes are only formatted if this is enabled. So disabled tracing
+     * has (almost) no runtime cost.
      */
     bool trace_nodes;
     /**
@@ -88,6 +114,8 @@ struct InterpreterConfig {
     bool trace_enter_block;
     /**
      * @brief Trace creating expression lists.
+     *
+     * Only supported by Engine::TREE_WALKER.
      */
     bool trace_exprlists;
     /**
@@ -99,6 +127,82 @@ struct InterpreterConfig {
      */
     bool trace_varargs;
 
+    /**
+     * @brief The engine used to execute the code.
+     *
+     * Defaults to Engine::BYTECODE.
+     */
+    Engine engine;
+
+    /**
+     * @brief Number of tables that are allocated before the garbage collector runs.
+     *
+     * The garbage collector waits for at least as many new tables as there
+     * were reachable tables after the last collection. Set this to `0` to
+     * only collect garbage at the end of Interpreter::evaluate.
+     *
+     * Tables that are unreachable from the lua code are freed, also if they are
+     * still referenced from C++ (e.g. captured by a native function). The
+     * exception are the arguments a native function passes to a lua function
+     * (kept while the lua function runs) and the results it gets back (kept
+     * until the native function returns). Tables that were created before calling Interpreter::evaluate
+     * are never freed while evaluating.
+     *
+     * The garbage collector only runs while executing Engine::BYTECODE.
+     *
+     * Defaults to 10000.
+     */
+    std::size_t gc_threshold;
+
+    /**
+     * @brief Which origins are recorded while evaluating (see OriginTracking).
+     *
+     * Source changes (e.g. from `force`) are only generated with
+     * OriginTracking::LAZY and OriginTracking::FULL. OriginTracking::OFF is
+     * the fastest option if the source changes are not needed.
+     *
+     * Defaults to OriginTracking::FULL.
+     */
+    OriginTracking origin_tracking;
+
+    /**
+     * @brief The maximum number of nested lua function calls.
+     *
+     * Exceeding the depth raises a "stack overflow" InterpreterException
+     * that can be caught with `pcall`.
+     *
+     * Every lua function call (except a tail call like `return f(x)`) also
+     * uses the native stack. Independent of this limit a call raises the same
+     * exception if the native stack of the thread that runs the interpreter is
+     * almost full. So runaway recursion doesn't crash the process. How many
+     * calls fit on the stack depends on the engine (the tree walker needs a
+     * lot more stack per call) and on the expressions in the functions.
+     *
+     * Defaults to `0` (only limited by the native stack).
+     */
+    std::size_t max_call_depth;
+
+    /**
+     * @brief Sample the lua call stack every `profile_interval` steps.
+     *
+     * A step is an executed instruction (Engine::BYTECODE) or a visited node
+     * (Engine::TREE_WALKER). The samples of the last run are available from
+     * Interpreter::profile.
+     *
+     * Defaults to `0` (disabled).
+     */
+    std::size_t profile_interval;
+    /**
+     * @brief Sample the lua call stack every `profile_period` of wall time.
+     *
+     * A timer thread requests the samples. They are taken at the next step,
+     * function call or return (see InterpreterConfig::profile_interval). Can
+     * be combined with `profile_interval`.
+     *
+     * Defaults to `0` (disabled).
+     */
+    std::chrono::microseconds profile_period;
+
     /**
      * @brief Default constructor turns all tracing off.
      */
@@ -136,6 +240,13 @@ struct InterpreterConfig {
  * }
  * interpreter.evaluate();
  * ```
+ *
+ * # Threads
+ *
+ * Every interpreter has its own memory and its own state of the stdlib (e.g.
+ * the random number generator). So different interpreters can be used on
+ * different threads at the same time. A single interpreter (and the values it
+ * created) must only be used by one thread at a time.
  */
 class Interpreter {
     struct Impl;
@@ -214,6 +325,16 @@ public:
      * Currently this throws `std::runtime_error`.
      */
     auto evaluate() -> EvalResult;
+
+    /**
+     * @brief Returns the samples collected by the last call to
+     * Interpreter::evaluate.
+     *
+     * The profile is empty if profiling was disabled (see
+     * InterpreterConfig::profile_interval and
+     * InterpreterConfig::profile_period).
+     */
+    [[nodiscard]] auto profile() const -> const Profile&;
 };
 
 }; // namespace minilua
@@ -66,7 +66,12 @@ auto type(const CallContext& ctx) -> Value;
 
 auto ult(const CallContext& ctx) -> Value;
 
-auto get_random_seed() -> std::default_random_engine;
+/**
+ * Returns the state of the random number generator used by `math.random`.
+ *
+ * Every interpreter has its own generator.
+ */
+auto get_random_seed(const CallContext& ctx) -> std::default_random_engine;
 } // namespace minilua::math
 
 #endif
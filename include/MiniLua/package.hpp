@@ -1,6 +1,5 @@
 #ifndef MINILUA_PACKAGE
 #define MINILUA_PACKAGE
-#endif
 
 #define MINILUA_ROOT "/usr/"
 #define MINILUA_VDIR "5.3" // hard coded because minilua support is only planned for lua 5.3
@@ -23,6 +22,31 @@ namespace minilua {
 auto require(const CallContext& ctx) -> Value;
 
 namespace package {
+/**
+ * The tables of the package library of one interpreter.
+ *
+ * Every interpreter has its own state (see details::StdlibState) so loading a
+ * module in one interpreter doesn't affect other interpreters.
+ */
+struct State {
+    /**
+     * The already loaded modules (`package.loaded`).
+     */
+    Table loaded;
+    /**
+     * The loaders of modules that don't have to be searched
+     * (`package.preload`).
+     */
+    Table preload;
+    /**
+     * The functions `require` uses to find the loader of a module
+     * (`package.searchers`).
+     */
+    Table searchers;
+
+    explicit State(MemoryAllocator* allocator);
+};
+
 const Value CPATH = Value(
     std::getenv("LUA_CPATH_5_3") != nullptr
         ? std::getenv("LUA_CPATH_5_3")
@@ -33,4 +57,6 @@ const Value PATH = Value(
         : (std::getenv("LUA_PATH") != nullptr ? std::getenv("LUA_PATH") : MINILUA_PATH_DEFAULT));
 auto searchpath(const CallContext& ctx) -> Vallist;
 } // end namespace package
-} // end namespace minilua
\ No newline at end of file
+} // end namespace minilua
+
+#endif
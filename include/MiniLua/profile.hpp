@@ -0,0 +1,94 @@
+#ifndef MINILUA_PROFILE_HPP
+#define MINILUA_PROFILE_HPP
+
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "source_change.hpp"
+
+namespace minilua {
+
+/**
+ * @brief Aggregated samples of the lua call stack.
+ *
+ * The Interpreter collects the samples while evaluating if profiling is
+ * enabled (see InterpreterConfig::profile_interval and
+ * InterpreterConfig::profile_period).
+ *
+ * Every sample is a stack of frames. The first frame is always the main chunk
+ * and every other frame is a function call with the name of the called
+ * function (as written at the call site) and the location of the call.
+ * Identical stacks are only stored once together with the number of samples.
+ *
+ * The samples can be written in the *collapsed stack* format that is
+ * understood by `flamegraph.pl` and speedscope (see Profile::write_folded).
+ */
+class Profile {
+public:
+    struct Frame {
+        std::string name;
+        std::optional<Range> location;
+    };
+
+    /**
+     * @brief A stack of indices into Profile::frames (the outermost frame first).
+     */
+    using Stack = std::vector<std::size_t>;
+
+private:
+    std::vector<Frame> _frames;
+    std::map<Stack, std::size_t> _samples;
+    std::size_t _num_samples = 0;
+
+public:
+    /**
+     * @brief Adds a frame and returns its index.
+     */
+    auto add_frame(Frame frame) -> std::size_t;
+
+    /**
+     * @brief Records `count` samples of the given stack.
+     */
+    void add_sample(const Stack& stack, std::size_t count = 1);
+
+    [[nodiscard]] auto frames() const -> const std::vector<Frame>&;
+    /**
+     * @brief The number of samples for every distinct stack.
+     */
+    [[nodiscard]] auto samples() const -> const std::map<Stack, std::size_t>&;
+    /**
+     * @brief The total number of samples.
+     */
+    [[nodiscard]] auto num_samples() const -> std::size_t;
+    [[nodiscard]] auto empty() const -> bool;
+
+    /**
+     * @brief Removes all frames and samples.
+     */
+    void clear();
+
+    /**
+     * @brief Formats a frame like `name (file:line)`.
+     */
+    [[nodiscard]] auto frame_label(std::size_t index) const -> std::string;
+
+    /**
+     * @brief Writes the samples in the collapsed stack format.
+     *
+     * Every distinct stack is written on its own line: the frame labels
+     * separated by `;` followed by a space and the number of samples. E.g.
+     *
+     * ```
+     * main chunk;fib (main.lua:5);fib (main.lua:3) 42
+     * ```
+     */
+    void write_folded(std::ostream&) const;
+};
+
+} // namespace minilua
+
+#endif
@@ -474,6 +474,18 @@ auto combine_source_changes(
     const std::optional<SourceChangeTree>& lhs, const std::optional<SourceChangeTree>& rhs)
     -> std::optional<SourceChangeTree>;
 
+/**
+ * @brief Adds a source change to `target` using a `SourceChangeCombination`
+ * if necessary.
+ *
+ * This has the same result as `combine_source_changes` but if `target`
+ * already is a combination (without origin and hint) the change is appended
+ * to it instead of nesting both in a new combination. So collecting many
+ * source changes one after another takes linear instead of quadratic time.
+ */
+void append_source_change(
+    std::optional<SourceChangeTree>& target, std::optional<SourceChangeTree> change);
+
 } // namespace minilua
 
 #endif
@@ -67,6 +67,24 @@ auto type(const CallContext& ctx) -> Value;
 
 auto next(const CallContext& ctx) -> Vallist;
 
+/**
+ * Returns the values `next, table, nil` so `for k, v in pairs(t)` iterates
+ * over all entries of the table.
+ *
+ * If the table has a metamethod `__pairs` it is called with the table and its
+ * first three results are returned instead.
+ */
+auto pairs(const CallContext& ctx) -> CallResult;
+
+/**
+ * Returns an iterator function, the table and `0` so `for i, v in ipairs(t)`
+ * iterates over the pairs `(1, t[1])`, `(2, t[2])`, ... up to the first `nil`
+ * value.
+ *
+ * The values are accessed with the `__index` metamethod.
+ */
+auto ipairs(const CallContext& ctx) -> Vallist;
+
 /**
  * If `index` is a number, returns all arguments after the `index`-th argument
  * (including `index`-th argument).
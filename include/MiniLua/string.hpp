@@ -7,13 +7,13 @@ namespace minilua::string {
 auto byte(const CallContext& ctx) -> Vallist;
 auto lua_char(const CallContext& ctx) -> Value;
 // auto dump(const CallContext& ctx) -> Value; //probably can be scraped
-// auto find(const CallContext& ctx) -> Vallist;
+auto find(const CallContext& ctx) -> Vallist;
 auto format(const CallContext& ctx) -> Value;
-// auto gmatch(const CallContext& ctx) -> Value;
-// auto gsub(const CallContext& ctx) -> Vallist;
+auto gmatch(const CallContext& ctx) -> Value;
+auto gsub(const CallContext& ctx) -> Vallist;
 auto len(const CallContext& ctx) -> Value;
 auto lower(const CallContext& ctx) -> Value;
-// auto match(const CallContext& ctx) -> Value;
+auto match(const CallContext& ctx) -> Vallist;
 // auto pack(const CallContext& ctx) -> Value;
 // auto packsize(const CallContext& ctx) -> Value;
 auto rep(const CallContext& ctx) -> Value;
@@ -3,9 +3,11 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <functional>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <unordered_map>
 #include <utility>
@@ -399,13 +401,33 @@ template <>
 /**
  * @brief A lua string value.
  *
+ * Strings are immutable and their content is shared between copies. Like in
+ * the reference implementation short strings are interned: while the
+ * interpreter runs all short strings with the same content share the same
+ * buffer. So they can be compared by comparing pointers. Every MemoryAllocator
+ * has its own table of interned strings. Strings created outside of the
+ * interpreter are not interned. The hash is computed once when the string is
+ * created.
+ *
  * Supports comparison operators.
  *
  * Is hashable.
  */
 struct String {
-    std::string value; // NOLINT(misc-non-private-member-variables-in-classes)
+    /**
+     * @brief Strings up to this length are interned.
+     */
+    constexpr static const std::size_t MAX_INTERNED_LENGTH = 40;
+
+private:
+    struct Data;
+    std::shared_ptr<const Data> data;
+
+    static auto make_data(std::string value) -> std::shared_ptr<const Data>;
 
+    friend class details::StringTable;
+
+public:
     /**
      * @brief The type of this value as a string.
      */
@@ -415,6 +437,40 @@ struct String {
      * @brief Create a String from a `std::string`.
      */
     String(std::string value);
+    /**
+     * @brief Create a String from a string literal.
+     */
+    String(const char* value);
+
+    /**
+     * @brief Copy constructor (shares the buffer).
+     */
+    String(const String& other) noexcept;
+    /**
+     * @brief Copy assignment operator (shares the buffer).
+     */
+    auto operator=(const String& other) noexcept -> String&;
+    ~String() = default;
+
+    /**
+     * @brief The content of the string.
+     *
+     * This refers to the shared (immutable) buffer of the string. It is valid
+     * as long as the String (or a copy of it) exists.
+     */
+    const std::string& value;
+
+    /**
+     * @brief The content of the string as a `std::string_view`.
+     *
+     * Valid as long as the String (or a copy of it) exists.
+     */
+    [[nodiscard]] auto view() const noexcept -> std::string_view;
+
+    /**
+     * @brief The precomputed hash of the string.
+     */
+    [[nodiscard]] auto hash() const noexcept -> std::size_t;
 
     /**
      * @brief Converts the value to it's literal representation.
@@ -435,14 +491,16 @@ struct String {
      * @brief Swap function.
      */
     friend void swap(String& self, String& other);
+
+    friend auto operator==(const String& a, const String& b) noexcept -> bool;
 };
 auto operator==(const String& a, const String& b) noexcept -> bool;
 auto operator!=(const String& a, const String& b) noexcept -> bool;
 inline auto operator<(const String& lhs, const String& rhs) noexcept -> bool {
-    return lhs.value < rhs.value;
+    return lhs.view() < rhs.view();
 }
 inline auto operator>(const String& lhs, const String& rhs) noexcept -> bool {
-    return lhs.value > rhs.value;
+    return lhs.view() > rhs.view();
 }
 inline auto operator<=(const String& lhs, const String& rhs) noexcept -> bool {
     return !(lhs > rhs);
@@ -458,6 +516,12 @@ class CallContext;
 
 struct TableImpl;
 
+namespace details {
+class GarbageCollector;
+class FieldCache;
+class TableSort;
+} // namespace details
+
 /**
  * @brief A lua table value.
  *
@@ -726,6 +790,16 @@ public:
      *value
      **/
     void remove(const Value& key);
+    /**
+     * Removes the element at `pos` and moves the elements `pos + 1 .. border`
+     * down by one (like `table.remove`). The elements stay in the array part.
+     *
+     * `border` has to be the result of Table::border and `1 <= pos <= border`
+     * has to hold.
+     *
+     * This method should just be used as a helper for table.remove.
+     */
+    void remove_shifting(int pos, int border);
     /**
      * @brief Returns the current metatable of this table.
      */
@@ -759,6 +833,9 @@ public:
     friend auto operator<<(std::ostream&, const Table&) -> std::ostream&;
 
     friend struct std::hash<Table>;
+    friend class details::GarbageCollector;
+    friend class details::FieldCache;
+    friend class details::TableSort;
 
     // TODO maybe return proxy "entry" type to avoid unnecessary Nil values
     /**
@@ -1110,6 +1187,15 @@ public:
      */
     [[nodiscard]] auto call(CallContext) const -> CallResult;
 
+    /**
+     * @brief Returns the wrapped callable if it has the type `T` (otherwise `nullptr`).
+     *
+     * This is used internally to find the values captured by lua functions.
+     */
+    template <typename T> [[nodiscard]] auto target() const -> const T* {
+        return this->func->template target<T>();
+    }
+
     /**
      * @brief Convert the value to a bool (always `true`).
      */
@@ -1120,6 +1206,19 @@ public:
      */
     friend void swap(Function& self, Function& other);
 
+    /**
+     * @brief Equality comparions.
+     *
+     * Two functions are only equal if they are the same function object.
+     */
+    friend auto operator==(const Function&, const Function&) noexcept -> bool;
+    /**
+     * @brief Unequality comparions.
+     *
+     * Two functions are only equal if they are the same function object.
+     */
+    friend auto operator!=(const Function&, const Function&) noexcept -> bool;
+
     friend struct std::hash<Function>;
 };
 
@@ -1332,6 +1431,64 @@ auto operator==(const MultipleArgsOrigin&, const MultipleArgsOrigin&) noexcept -
 auto operator!=(const MultipleArgsOrigin&, const MultipleArgsOrigin&) noexcept -> bool;
 auto operator<<(std::ostream&, const MultipleArgsOrigin&) -> std::ostream&;
 
+/**
+ * @brief Compact origin for the result of an arithmetic operation on two
+ * numbers.
+ *
+ * This is recorded instead of a BinaryOrigin with OriginTracking::LAZY. It
+ * only stores the operator, the operands and their origins in a single
+ * allocation. The equivalent BinaryOrigin (including the reverse function) is
+ * only created by `materialize` (e.g. when the value is forced).
+ *
+ * Support equality operators.
+ */
+struct ArithmeticOrigin {
+    enum class Operator { ADD, SUB, MUL, DIV, INT_DIV, POW };
+
+    Operator op;
+    Number lhs;
+    Number rhs;
+    /**
+     * @brief The origin of the lhs (`nullptr` means NoOrigin).
+     */
+    std::shared_ptr<Origin> lhs_origin;
+    /**
+     * @brief The origin of the rhs (`nullptr` means NoOrigin).
+     */
+    std::shared_ptr<Origin> rhs_origin;
+    /**
+     * @brief The range of the operator.
+     */
+    std::optional<Range> location;
+
+    /**
+     * @brief Records the operation `op` on the numbers `lhs` and `rhs`.
+     *
+     * The origins of the operands are shared (not copied).
+     *
+     * \note Both values have to be numbers.
+     */
+    ArithmeticOrigin(
+        Operator op, const Value& lhs, const Value& rhs, std::optional<Range> location);
+
+    /**
+     * @brief Creates the equivalent BinaryOrigin.
+     */
+    [[nodiscard]] auto materialize() const -> BinaryOrigin;
+
+    /**
+     * Simplify the origin.
+     *
+     * Removes unusable origins from the tree.
+     */
+    [[nodiscard]] auto simplify() const -> Origin;
+};
+
+auto operator==(const ArithmeticOrigin&, const ArithmeticOrigin&) noexcept -> bool;
+auto operator!=(const ArithmeticOrigin&, const ArithmeticOrigin&) noexcept -> bool;
+auto operator<<(std::ostream&, const ArithmeticOrigin::Operator&) -> std::ostream&;
+auto operator<<(std::ostream&, const ArithmeticOrigin&) -> std::ostream&;
+
 /**
  * @brief The origin of a value.
  *
@@ -1347,7 +1504,8 @@ auto operator<<(std::ostream&, const MultipleArgsOrigin&) -> std::ostream&;
 class Origin {
 public:
     using Type = std::variant<
-        NoOrigin, ExternalOrigin, LiteralOrigin, BinaryOrigin, UnaryOrigin, MultipleArgsOrigin>;
+        NoOrigin, ExternalOrigin, LiteralOrigin, BinaryOrigin, UnaryOrigin, MultipleArgsOrigin,
+        ArithmeticOrigin>;
 
 private:
     Type origin;
@@ -1382,6 +1540,10 @@ public:
      */
     Origin(UnaryOrigin);
     Origin(MultipleArgsOrigin);
+    /**
+     * @brief Creates an Origin from an ArithmeticOrigin.
+     */
+    Origin(ArithmeticOrigin);
 
     /**
      * @brief Returns the underlying variant type.
@@ -1412,6 +1574,10 @@ public:
      * @brief Check if the origin is a UnaryOrigin.
      */
     [[nodiscard]] auto is_unary() const -> bool;
+    /**
+     * @brief Check if the origin is an ArithmeticOrigin.
+     */
+    [[nodiscard]] auto is_arithmetic() const -> bool;
 
     /**
      * @brief Uses the reverse function to try to force the result value to
@@ -1458,6 +1624,66 @@ auto operator==(const Origin&, const Origin&) noexcept -> bool;
 auto operator!=(const Origin&, const Origin&) noexcept -> bool;
 auto operator<<(std::ostream&, const Origin&) -> std::ostream&;
 
+/**
+ * @brief Controls which origins the operations on `Value`s record.
+ *
+ * This is set per thread (see OriginTrackingScope). The Interpreter sets it
+ * to InterpreterConfig::origin_tracking while evaluating.
+ */
+enum class OriginTracking {
+    /**
+     * @brief Don't record any origins.
+     *
+     * Values produced by the operators and literals don't have an origin. So
+     * `Value::force` never produces source changes.
+     */
+    OFF,
+    /**
+     * @brief Only record origins that can produce a source change and record
+     * arithmetic operations compactly.
+     *
+     * The result of an operation only gets an origin if at least one of the
+     * operands has an origin. Reversing an operation only forces its
+     * operands, so an origin without any (transitive) literal origin can
+     * never produce a source change. Operations that can't be reversed
+     * (comparisons, concatenations, length, modulo and the bitwise operators)
+     * never get an origin.
+     *
+     * The arithmetic operators record an ArithmeticOrigin instead of a
+     * BinaryOrigin. It doesn't copy the operands and the reverse function is
+     * only created when the value is forced.
+     *
+     * `Value::force` produces the same source changes as with
+     * OriginTracking::FULL.
+     */
+    LAZY,
+    /**
+     * @brief Record the origins of all operations.
+     *
+     * This is the default.
+     */
+    FULL,
+};
+
+/**
+ * @brief Returns the OriginTracking of the current thread.
+ */
+auto origin_tracking() -> OriginTracking;
+
+/**
+ * @brief Sets the OriginTracking of the current thread until the scope is
+ * destroyed.
+ */
+class OriginTrackingScope {
+    OriginTracking previous;
+
+public:
+    explicit OriginTrackingScope(OriginTracking tracking);
+    ~OriginTrackingScope();
+    OriginTrackingScope(const OriginTrackingScope&) = delete;
+    auto operator=(const OriginTrackingScope&) -> OriginTrackingScope& = delete;
+};
+
 } // namespace minilua
 
 /**
@@ -1512,12 +1738,20 @@ namespace minilua {
  * mutated from multiple variables.
  */
 class Value {
-    struct Impl;
-    owning_ptr<Impl> impl;
-
 public:
     using Type = std::variant<Nil, Bool, Number, String, Table, Function>;
 
+private:
+    // The variant is stored inline so copying a value does not allocate.
+    // Origins can be large and are rarely changed so they are shared between
+    // copies (copy-on-write). `nullptr` means NoOrigin.
+    Type val;
+    std::shared_ptr<Origin> _origin;
+
+    friend struct ArithmeticOrigin;
+
+public:
+
     /**
      * @brief Creates a Nil value.
      */
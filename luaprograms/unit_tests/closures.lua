@@ -0,0 +1,68 @@
+-- every loop iteration creates new local variables
+local functions = {}
+for i = 1, 3 do
+    local j = i * 10
+    functions[i] = function() return i + j end
+end
+assert(functions[1]() == 11)
+assert(functions[2]() == 22)
+assert(functions[3]() == 33)
+
+-- closures share captured variables with the enclosing function
+local function make_counter()
+    local count = 0
+    local function increment()
+        count = count + 1
+        return count
+    end
+    local function get()
+        return count
+    end
+    return increment, get
+end
+
+local increment, get = make_counter()
+increment()
+increment()
+assert(get() == 2)
+assert(increment() == 3)
+
+-- variables can be captured through multiple functions
+local x = 1
+local function outer()
+    return function()
+        x = x + 1
+        return x
+    end
+end
+assert(outer()() == 2)
+assert(x == 2)
+
+-- parameters are new variables even if a variable with the same name is captured
+local y = 1
+local function shadow(y)
+    y = y + 1
+    return y
+end
+assert(shadow(10) == 11)
+assert(y == 1)
+
+-- captured variables declared in a repeat loop are visible in the condition
+local captured = {}
+local n = 0
+repeat
+    n = n + 1
+    local value = n
+    captured[n] = function() return value end
+until value >= 3
+assert(captured[1]() == 1)
+assert(captured[3]() == 3)
+
+-- breaking out of a loop keeps the captured variables
+local last
+while true do
+    local z = "z"
+    last = function() return z end
+    break
+end
+assert(last() == "z")
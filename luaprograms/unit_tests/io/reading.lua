@@ -80,3 +80,15 @@ current = file:seek("cur")
 assert(file:read(1) == nil)
 assert(file:seek("cur") == current)
 file:close()
+
+-- the formats of lua 5.1 start with a '*'
+file = io.open("/tmp/luatest.txt", "w")
+file:write(1, "\n", "two", "\n", "three\nfour")
+file:close()
+
+file = io.open("/tmp/luatest.txt", "r")
+assert(file:read("*n") == 1)
+assert(file:read("*L") == "\n")
+assert(file:read("*l") == "two")
+assert(file:read("*a") == "three\nfour")
+file:close()
@@ -0,0 +1,86 @@
+-- field accesses through __index tables (the bytecode caches where a field
+-- was found so every access below runs through the same few call sites)
+
+Base = {}
+Base.__index = Base
+function Base.name(obj) return "base" end
+function Base.kind(obj) return "base kind" end
+
+Class = {}
+Class.__index = Class
+setmetatable(Class, Base)
+function Class.name(obj) return "class" end
+
+function get_name(obj) return obj.name(obj) end
+function get_kind(obj) return obj.kind(obj) end
+function get_value(obj) return obj.value end
+function set_value(obj, value) obj.value = value end
+
+obj = setmetatable({}, Class)
+
+for i = 1, 3 do
+    assert(get_name(obj) == "class")
+    assert(get_kind(obj) == "base kind")
+end
+
+-- replace a method in the class
+function Class.name(obj) return "new class" end
+assert(get_name(obj) == "new class")
+
+-- shadow the method in the object
+obj.name = function(obj) return "object" end
+assert(get_name(obj) == "object")
+
+-- remove the shadowing method again
+obj.name = nil
+assert(get_name(obj) == "new class")
+
+-- add a method to the class that shadows the base class
+assert(get_kind(obj) == "base kind")
+Class.kind = function(obj) return "class kind" end
+assert(get_kind(obj) == "class kind")
+
+-- swap the metatable
+setmetatable(obj, Base)
+assert(get_name(obj) == "base")
+assert(get_kind(obj) == "base kind")
+
+-- change __index of the metatable
+Base.__index = { kind = function(obj) return "other kind" end }
+assert(get_kind(obj) == "other kind")
+
+-- __index functions are not cached
+Base.__index = function(table, key) return function(obj) return key end end
+assert(get_kind(obj) == "kind")
+assert(get_name(obj) == "name")
+
+-- plain fields
+t = { value = 1 }
+for i = 1, 3 do
+    set_value(t, get_value(t) + 1)
+end
+assert(get_value(t) == 4)
+
+set_value(t, nil)
+assert(get_value(t) == nil)
+set_value(t, 5)
+assert(get_value(t) == 5)
+
+-- __newindex is only used for missing fields
+log = {}
+proxy = setmetatable({ value = 1 }, { __newindex = function(table, key, value) log[key] = value end })
+set_value(proxy, 2)
+assert(proxy.value == 2)
+assert(log.value == nil)
+proxy.value = nil
+set_value(proxy, 3)
+assert(proxy.value == nil)
+assert(log.value == 3)
+
+-- different tables at the same call site
+a = { value = "a" }
+b = setmetatable({}, { __index = { value = "b" } })
+for i = 1, 3 do
+    assert(get_value(a) == "a")
+    assert(get_value(b) == "b")
+end
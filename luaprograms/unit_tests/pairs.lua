@@ -0,0 +1,67 @@
+local t = {10, 20, 30, a = 1, b = 2, c = 3}
+
+local count = 0
+local sum = 0
+for k, v in pairs(t) do
+    count = count + 1
+    sum = sum + v
+end
+assert(count == 6)
+assert(sum == 66)
+
+-- existing fields can be changed and cleared during the traversal
+for k, v in pairs(t) do
+    if type(k) == "string" then
+        t[k] = nil
+    else
+        t[k] = v + 1
+    end
+end
+assert(t.a == nil and t.b == nil and t.c == nil)
+assert(t[1] == 11 and t[2] == 21 and t[3] == 31)
+
+local f, s, init = pairs(t)
+assert(type(f) == "function" and s == t and init == nil)
+
+-- ipairs stops at the first nil
+local list = {1, 2, 3, nil, 5}
+local n = 0
+for i, v in ipairs(list) do
+    assert(i == v)
+    n = n + 1
+end
+assert(n == 3)
+
+-- ipairs respects __index
+local proxy = setmetatable({}, {__index = function(_, i)
+    if i <= 4 then
+        return i * 2
+    end
+end})
+local total = 0
+for i, v in ipairs(proxy) do
+    total = total + v
+end
+assert(total == 20)
+
+-- the iterator of ipairs checks the control variable
+local iter, state = ipairs({1})
+local ok, err = pcall(iter, state, "x")
+assert(not ok)
+assert(string.find(err, "number expected, got string", 1, true))
+
+-- __pairs
+local custom = setmetatable({}, {__pairs = function(tbl)
+    return function(_, k)
+        if k == nil then
+            return 1, "one"
+        end
+    end, tbl, nil
+end})
+local seen = {}
+for k, v in pairs(custom) do
+    seen[k] = v
+end
+assert(seen[1] == "one")
+
+assert(not pcall(pairs, nil))
@@ -0,0 +1,6 @@
+-- operators on literals are evaluated once while compiling
+local x
+for i = 1, 3 do
+    x = (1 + 2) * 4
+end
+force(x, 16) -- EXPECT SOURCE_CHANGE 4:10 2.0
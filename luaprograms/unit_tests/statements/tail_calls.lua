@@ -0,0 +1,70 @@
+-- tail calls don't count towards the maximum call depth
+local function count_down(n)
+    if n == 0 then
+        return "done"
+    end
+    return count_down(n - 1)
+end
+assert(count_down(10000) == "done")
+
+local is_odd
+
+local function is_even(n)
+    if n == 0 then
+        return true
+    end
+    return is_odd(n - 1)
+end
+
+is_odd = function(n)
+    if n == 0 then
+        return false
+    end
+    return is_even(n - 1)
+end
+
+assert(is_even(5000))
+assert(is_odd(5001))
+
+-- all values of the called function are returned
+local function values(a, b, ...)
+    return a, b, ...
+end
+local function forward(...)
+    return values(...)
+end
+local a, b, c, d = forward(1, 2, 3, 4)
+assert(a == 1 and b == 2 and c == 3 and d == 4)
+
+-- tail calls of native functions
+local function to_string(x)
+    return tostring(x)
+end
+assert(to_string(42) == "42")
+
+-- tail calls of tables with a __call metamethod
+local callable = setmetatable({}, {__call = function(self, x) return x * 2 end})
+local function call_callable(x)
+    return callable(x)
+end
+assert(call_callable(21) == 42)
+
+-- closures called in tail position still see their upvalues
+local function make_adder(x)
+    return function(y)
+        return x + y
+    end
+end
+local function add(x, y)
+    local adder = make_adder(x)
+    return adder(y)
+end
+assert(add(40, 2) == 42)
+
+-- too deep recursion raises an error
+local function recurse(n)
+    return 1 + recurse(n + 1)
+end
+local ok, err = pcall(recurse, 1)
+assert(not ok)
+assert(string.find(err, "stack overflow", 1, true))
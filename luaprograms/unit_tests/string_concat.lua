@@ -0,0 +1,43 @@
+-- chains of `..` are concatenated at once (from right to left)
+
+local a, b, c = "a", "b", "c"
+assert(a .. b .. c == "abc")
+assert(a .. 1 .. b .. 2.5 .. c == "a1b2.5c")
+assert(1 .. 2 == "12")
+assert((a .. b) .. (c .. a) == "abca")
+
+local s = ""
+for i = 1, 10 do
+    s = s .. i .. ","
+end
+assert(s == "1,2,3,4,5,6,7,8,9,10,")
+
+-- metamethods are called for the operators whose operands are not strings
+-- or numbers
+local calls = {}
+local mt = {
+    __concat = function(lhs, rhs)
+        local l = type(lhs) == "table" and "T" or lhs
+        local r = type(rhs) == "table" and "T" or rhs
+        calls[#calls + 1] = l .. "|" .. r
+        return l .. r
+    end,
+}
+local t = setmetatable({}, mt)
+
+assert(a .. t .. b .. c == "aTbc")
+assert(#calls == 1)
+assert(calls[1] == "T|bc")
+
+calls = {}
+assert(t .. a .. t == "TaT")
+assert(#calls == 2)
+assert(calls[1] == "a|T")
+assert(calls[2] == "T|aT")
+
+-- table.concat
+assert(table.concat({ 1, "a", 2.5 }) == "1a2.5")
+assert(table.concat({ "x", "y", "z" }, ", ") == "x, y, z")
+assert(table.concat({ "x", "y", "z" }, "-", 2) == "y-z")
+assert(table.concat({ "x", "y", "z" }, "-", 2, 2) == "y")
+assert(table.concat({}, "-") == "")
@@ -0,0 +1,27 @@
+-- string.find/match/gmatch/gsub (the patterns are compiled once and cached)
+
+local words = {}
+for i = 1, 3 do
+    for word in string.gmatch("one two three", "%a+") do
+        words[#words + 1] = word
+    end
+end
+assert(#words == 9)
+assert(words[4] == "one")
+
+assert(string.find("hello world", "wor") == 7)
+assert(string.find("a+b", "+", 1, true) == 2)
+assert(string.match("key = value", "(%w+)%s*=") == "key")
+assert(string.match("  padded  ", "^%s*(.-)%s*$") == "padded")
+
+local s, n = string.gsub("hello world", "o", "0")
+assert(s == "hell0 w0rld" and n == 2)
+
+s = string.gsub("$a + $b", "%$(%w+)", { a = "1", b = "2" })
+assert(s == "1 + 2")
+
+s = string.gsub("abc", "%w", function(c) return c .. c end)
+assert(s == "aabbcc")
+
+local ok = pcall(string.find, "x", "[x")
+assert(not ok)
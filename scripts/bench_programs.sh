@@ -0,0 +1,22 @@
+#!/usr/bin/env bash
+set -ex
+
+source "$(dirname "${BASH_SOURCE[0]}")/_env.sh"
+
+pushd build
+build_type=$(cmake -L .. | grep CMAKE_BUILD_TYPE | sed 's/CMAKE_BUILD_TYPE:STRING=//g')
+popd
+
+if [[ "$build_type" != "Release" ]]; then
+    ./scripts/setup_build.sh "-DCMAKE_BUILD_TYPE=Release"
+fi
+
+pushd build
+make MiniLua-bench-programs
+popd
+
+# Programs that are not in the baseline count as regressions. Record the
+# checked-in baseline without timings because they depend on the machine:
+#   ./scripts/bench_programs.sh --no-timings --output bench/baseline.json
+# Compare timings only against a baseline recorded on the same machine.
+./build/bench/MiniLua-bench-programs --compare bench/baseline.json "$@"
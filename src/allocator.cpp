@@ -1,14 +1,21 @@
+#include "details/string_table.hpp"
 #include "table.hpp"
 #include <MiniLua/allocator.hpp>
 #include <MiniLua/values.hpp>
 
+#include <algorithm>
+#include <iterator>
+
 namespace minilua {
 
 // class MemoryAllocator
+MemoryAllocator::MemoryAllocator() : strings(std::make_unique<details::StringTable>()) {}
 MemoryAllocator::~MemoryAllocator() { this->free_all(); }
 auto MemoryAllocator::allocate_table() -> TableImpl* {
     auto* ptr = new TableImpl();
     table_memory.push_back(ptr);
+    ++allocations;
+    peak = std::max(peak, table_memory.size());
     return ptr;
 }
 auto MemoryAllocator::get_all() const -> const std::vector<TableImpl*>& {
@@ -22,7 +29,26 @@ void MemoryAllocator::free_all() {
     table_memory.clear();
 }
 
+auto MemoryAllocator::sweep(std::size_t first) -> std::size_t {
+    auto unmarked = std::stable_partition(
+        this->table_memory.begin() + first, this->table_memory.end(),
+        [](const TableImpl* ptr) { return ptr->marked; });
+    for (auto it = unmarked; it != this->table_memory.end(); ++it) {
+        delete *it;
+    }
+    auto freed = std::distance(unmarked, this->table_memory.end());
+    this->table_memory.erase(unmarked, this->table_memory.end());
+    return freed;
+}
+
 auto MemoryAllocator::num_objects() -> std::size_t { return this->table_memory.size(); }
+auto MemoryAllocator::num_allocations() const -> std::size_t { return this->allocations; }
+auto MemoryAllocator::peak_objects() const -> std::size_t { return this->peak; }
+void MemoryAllocator::reset_statistics() {
+    this->allocations = 0;
+    this->peak = this->table_memory.size();
+}
+auto MemoryAllocator::string_table() -> details::StringTable& { return *this->strings; }
 
 // NOTE: This WILL NOT prevent all memory leaks.
 //
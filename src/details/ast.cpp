@@ -1496,15 +1496,15 @@ auto Expression::options() const -> ExpressionVariant {
                 } else if (node.type_id() == ts::NODE_UNARY_OPERATION) {
                     return UnaryOperation(node);
                 } else if (node.type_id() == ts::NODE_STRING) {
-                    return Literal(LiteralType::STRING, node.text(), convert_range(node.range()));
+                    return Literal(LiteralType::STRING, node);
                 } else if (node.type_id() == ts::NODE_NUMBER) {
-                    return Literal(LiteralType::NUMBER, node.text(), convert_range(node.range()));
+                    return Literal(LiteralType::NUMBER, node);
                 } else if (node.type_id() == ts::NODE_NIL) {
-                    return Literal(LiteralType::NIL, node.text(), convert_range(node.range()));
+                    return Literal(LiteralType::NIL, node);
                 } else if (node.type_id() == ts::NODE_TRUE) {
-                    return Literal(LiteralType::TRUE, node.text(), convert_range(node.range()));
+                    return Literal(LiteralType::TRUE, node);
                 } else if (node.type_id() == ts::NODE_FALSE) {
-                    return Literal(LiteralType::FALSE, node.text(), convert_range(node.range()));
+                    return Literal(LiteralType::FALSE, node);
                 } else if (node.type_id() == ts::NODE_IDENTIFIER) {
                     return Identifier(node);
                 } else if (
@@ -1699,7 +1699,14 @@ auto Statement::debug_print() const -> std::string {
 
 Literal::Literal(LiteralType type, std::string string, minilua::Range range)
     : literal_content(std::move(string)), literal_type(type), literal_range(std::move(range)) {}
+Literal::Literal(LiteralType type, ts::Node node)
+    : literal_node(node), literal_type(type), literal_range(convert_range(node.range())) {}
 auto Literal::type() const -> LiteralType { return this->literal_type; }
-auto Literal::content() const -> std::string { return this->literal_content; }
+auto Literal::content() const -> std::string {
+    if (this->literal_node) {
+        return this->literal_node->text();
+    }
+    return this->literal_content;
+}
 auto Literal::range() const -> minilua::Range { return this->literal_range; }
 } // namespace minilua::details::ast
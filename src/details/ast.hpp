@@ -3,6 +3,7 @@
 
 #include "../tree_sitter_lua.hpp"
 #include "MiniLua/values.hpp"
+#include <optional>
 #include <tree_sitter/tree_sitter.hpp>
 #include <variant>
 
@@ -28,12 +29,16 @@ enum GEN_CAUSE {
 };
 enum class LiteralType { TRUE, FALSE, NIL, NUMBER, STRING };
 class Literal {
+    // only set for literals from the source code, the content is then only
+    // copied out of the tree when it is needed
+    std::optional<ts::Node> literal_node;
     std::string literal_content;
     LiteralType literal_type;
     minilua::Range literal_range;
 
 public:
     Literal(LiteralType, std::string, minilua::Range);
+    Literal(LiteralType, ts::Node);
     auto content() const -> std::string;
     auto type() const -> LiteralType;
     auto range() const -> minilua::Range;
@@ -0,0 +1,1387 @@
+#include "bytecode.hpp"
+#include "MiniLua/utils.hpp"
+#include "concat.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace minilua::details::bytecode {
+
+auto operator<<(std::ostream& o, OpCode op) -> std::ostream& {
+    switch (op) {
+#define OPCODE_NAME(name)                                                                          \
+    case OpCode::name:                                                                             \
+        return o << #name;
+
+        OPCODE_NAME(LOAD_NIL)
+        OPCODE_NAME(LOAD_CONST)
+        OPCODE_NAME(LOAD_LITERAL)
+        OPCODE_NAME(LOAD_FOLDED)
+        OPCODE_NAME(MOVE)
+        OPCODE_NAME(UNPACK)
+        OPCODE_NAME(GET_GLOBAL)
+        OPCODE_NAME(SET_GLOBAL)
+        OPCODE_NAME(GET_UPVALUE)
+        OPCODE_NAME(SET_UPVALUE)
+        OPCODE_NAME(CLOSE)
+        OPCODE_NAME(GET_INDEX)
+        OPCODE_NAME(GET_FIELD)
+        OPCODE_NAME(SET_INDEX)
+        OPCODE_NAME(SET_FIELD)
+        OPCODE_NAME(NEW_TABLE)
+        OPCODE_NAME(TABLE_SET)
+        OPCODE_NAME(TABLE_SET_FIELD)
+        OPCODE_NAME(TABLE_APPEND)
+        OPCODE_NAME(ADD)
+        OPCODE_NAME(SUB)
+        OPCODE_NAME(MUL)
+        OPCODE_NAME(DIV)
+        OPCODE_NAME(MOD)
+        OPCODE_NAME(POW)
+        OPCODE_NAME(INT_DIV)
+        OPCODE_NAME(BIT_AND)
+        OPCODE_NAME(BIT_OR)
+        OPCODE_NAME(BIT_XOR)
+        OPCODE_NAME(SHIFT_LEFT)
+        OPCODE_NAME(SHIFT_RIGHT)
+        OPCODE_NAME(EQ)
+        OPCODE_NAME(NEQ)
+        OPCODE_NAME(LT)
+        OPCODE_NAME(LEQ)
+        OPCODE_NAME(GT)
+        OPCODE_NAME(GEQ)
+        OPCODE_NAME(AND)
+        OPCODE_NAME(OR)
+        OPCODE_NAME(CONCAT)
+        OPCODE_NAME(NEG)
+        OPCODE_NAME(BWNOT)
+        OPCODE_NAME(LEN)
+        OPCODE_NAME(NOT)
+        OPCODE_NAME(CLOSURE)
+        OPCODE_NAME(VARARG)
+        OPCODE_NAME(CALL)
+        OPCODE_NAME(TAIL_CALL)
+        OPCODE_NAME(ENTER_BLOCK)
+        OPCODE_NAME(JMP)
+        OPCODE_NAME(JMP_IF_NOT)
+        OPCODE_NAME(BREAK)
+        OPCODE_NAME(RETURN)
+        OPCODE_NAME(SET_RESULT)
+        OPCODE_NAME(CLEAR_RESULT)
+        OPCODE_NAME(HALT)
+        OPCODE_NAME(ERROR)
+
+#undef OPCODE_NAME
+    }
+
+    return o << "UNKNOWN";
+}
+
+auto operator<<(std::ostream& o, const Instruction& self) -> std::ostream& {
+    o << self.op << " " << self.a << " " << self.b << " " << self.c;
+    if (self.multi) {
+        o << " (multi)";
+    }
+    return o;
+}
+
+// struct Proto
+auto Proto::next_id() -> std::uint64_t {
+    static std::atomic<std::uint64_t> next = 0;
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+auto operator<<(std::ostream& o, const Proto& self) -> std::ostream& {
+    o << "function (";
+    const auto* sep = "";
+    for (const auto& param : self.parameters) {
+        o << sep << param;
+        sep = ", ";
+    }
+    if (self.vararg) {
+        o << sep << "...";
+    }
+    o << ") registers: " << self.num_registers;
+    if (!self.upvalues.empty()) {
+        o << " upvalues: ";
+        sep = "";
+        for (const auto& upvalue : self.upvalues) {
+            o << sep << upvalue.name << (upvalue.in_register ? " (R" : " (U") << upvalue.index
+              << ")";
+            sep = ", ";
+        }
+    }
+    o << "\n";
+
+    for (std::size_t pc = 0; pc < self.code.size(); ++pc) {
+        o << "  " << pc << ": " << self.code[pc] << "\n";
+    }
+
+    for (const auto& proto : self.protos) {
+        o << *proto;
+    }
+
+    return o;
+}
+
+/**
+ * Lowers the AST of a single function (or the top level code) into a Proto.
+ *
+ * Registers are allocated like a stack. Every `compile_` method that produces
+ * a value takes the register it should write to and is free to use all
+ * registers starting at `next_register` as temporaries.
+ *
+ * The local variables occupy the lowest registers (the `i`-th entry in
+ * `locals` is stored in register `i`). So at the start of every statement
+ * `next_register` is equal to the number of visible local variables.
+ *
+ * Variables are resolved while compiling: First the local variables of the
+ * function are searched (innermost first), then the enclosing functions (which
+ * makes the variable an upvalue) and if nothing is found the variable is
+ * global.
+ */
+class Compiler {
+    const CompileOptions& options;
+    std::shared_ptr<Proto> proto;
+    std::unordered_map<std::string, std::uint32_t> name_indices;
+
+    /**
+     * The compiler of the enclosing function (or `nullptr` for the top level code).
+     */
+    Compiler* parent;
+
+    std::uint32_t next_register = 0;
+
+    struct LocalVariable {
+        std::string name;
+        /**
+         * Set if a nested function captured the variable. The upvalues then
+         * have to be closed when the variable goes out of scope.
+         */
+        bool captured = false;
+    };
+    std::vector<LocalVariable> locals;
+
+    /**
+     * Targets for `break` (and `return` in top level code).
+     *
+     * Contains the innermost loop as the last element. In top level code the
+     * first element is the currently compiled top level statement.
+     */
+    struct JumpTarget {
+        /**
+         * Number of local variables that are visible at the target.
+         */
+        std::uint32_t num_locals;
+        std::vector<std::size_t> breaks;
+        std::vector<std::size_t> returns;
+    };
+    std::vector<JumpTarget> jump_targets;
+
+    /**
+     * How a variable is accessed (see Compiler::resolve).
+     */
+    struct Variable {
+        enum class Kind { LOCAL, UPVALUE, GLOBAL };
+
+        Kind kind;
+        std::uint32_t index;
+    };
+
+public:
+    Compiler(const CompileOptions& options)
+        : options(options), proto(std::make_shared<Proto>()), parent(nullptr) {}
+    Compiler(Compiler* parent)
+        : options(parent->options), proto(std::make_shared<Proto>()), parent(parent) {}
+
+    auto compile_program(const ast::Program& program) -> std::shared_ptr<const Proto> {
+        this->proto->root = true;
+
+        auto body = program.body();
+        for (const auto& statement : body.statements()) {
+            this->jump_targets.push_back(JumpTarget{.num_locals = this->num_locals()});
+            this->compile_statement(statement);
+            auto target = std::move(this->jump_targets.back());
+            this->jump_targets.pop_back();
+
+            // the result of a statement is discarded unless it returned
+            this->patch(target.breaks, this->pc());
+            this->emit(Instruction{.op = OpCode::CLEAR_RESULT});
+            this->patch(target.returns, this->pc());
+        }
+
+        auto return_statement = body.return_statement();
+        if (return_statement) {
+            this->compile_return(return_statement->exp_list());
+        }
+        this->emit(Instruction{.op = OpCode::HALT});
+
+        return this->proto;
+    }
+
+    auto compile_function(const ast::FunctionDefinition& function_definition)
+        -> std::shared_ptr<const Proto> {
+        auto parameters = function_definition.parameters();
+        for (const auto& param : parameters.params()) {
+            this->proto->parameters.push_back(param.string());
+            this->reserve_registers();
+            this->declare_local(param.string());
+        }
+        this->proto->vararg = parameters.spread();
+
+        this->compile_body(function_definition.body());
+
+        // implicit return without values
+        this->emit(Instruction{.op = OpCode::RETURN});
+
+        return this->proto;
+    }
+
+private:
+    // helpers
+    [[nodiscard]] auto pc() const -> std::size_t { return this->proto->code.size(); }
+
+    auto emit(Instruction instruction) -> std::size_t {
+        if (instruction.op == OpCode::GET_FIELD || instruction.op == OpCode::SET_FIELD) {
+            instruction.cache = this->proto->num_field_caches++;
+        }
+        this->proto->code.push_back(instruction);
+        return this->proto->code.size() - 1;
+    }
+
+    void patch(const std::vector<std::size_t>& jumps, std::size_t target) {
+        for (auto jump : jumps) {
+            this->proto->code[jump].b = target;
+        }
+    }
+
+    auto reserve_registers(std::uint32_t count = 1) -> std::uint32_t {
+        auto first = this->next_register;
+        this->next_register += count;
+        this->proto->num_registers = std::max(this->proto->num_registers, this->next_register);
+        return first;
+    }
+
+    auto add_name(const std::string& name) -> std::uint32_t {
+        auto [iter, inserted] = this->name_indices.try_emplace(name, this->proto->names.size());
+        if (inserted) {
+            this->proto->names.push_back(name);
+            this->proto->name_values.emplace_back(name);
+        }
+        return iter->second;
+    }
+
+    auto add_constant(Value value) -> std::uint32_t {
+        this->proto->constants.push_back(std::move(value));
+        return this->proto->constants.size() - 1;
+    }
+
+    auto add_location(Range range) -> std::uint32_t {
+        this->proto->locations.push_back(std::move(range));
+        return this->proto->locations.size() - 1;
+    }
+
+    [[nodiscard]] auto num_locals() const -> std::uint32_t {
+        return static_cast<std::uint32_t>(this->locals.size());
+    }
+
+    /**
+     * Declares a new local variable in the next free local register.
+     *
+     * The value has to already be in the register.
+     */
+    void declare_local(const std::string& name) {
+        this->locals.push_back(LocalVariable{.name = name});
+        assert(this->next_register >= this->num_locals());
+    }
+
+    /**
+     * Returns the current number of local variables. Pass it to
+     * Compiler::leave_scope to remove all variables declared after this call.
+     */
+    [[nodiscard]] auto enter_scope() const -> std::uint32_t { return this->num_locals(); }
+
+    /**
+     * Removes the local variables of the scope and closes their upvalues if
+     * necessary.
+     */
+    void leave_scope(std::uint32_t num_locals) {
+        bool captured = std::any_of(
+            this->locals.begin() + num_locals, this->locals.end(),
+            [](const LocalVariable& local) { return local.captured; });
+        if (captured) {
+            this->emit(Instruction{.op = OpCode::CLOSE, .a = num_locals});
+        }
+
+        this->locals.resize(num_locals);
+        this->next_register = num_locals;
+    }
+
+    auto resolve_local(const std::string& name) -> std::optional<std::uint32_t> {
+        for (auto i = this->locals.size(); i > 0; --i) {
+            if (this->locals[i - 1].name == name) {
+                return i - 1;
+            }
+        }
+        return std::nullopt;
+    }
+
+    auto resolve_upvalue(const std::string& name) -> std::optional<std::uint32_t> {
+        if (this->parent == nullptr) {
+            return std::nullopt;
+        }
+
+        auto add_upvalue = [this, &name](bool in_register, std::uint32_t index) {
+            auto& upvalues = this->proto->upvalues;
+            for (std::uint32_t i = 0; i < upvalues.size(); ++i) {
+                if (upvalues[i].in_register == in_register && upvalues[i].index == index) {
+                    return i;
+                }
+            }
+            upvalues.push_back(UpvalueDescription{
+                .name = name,
+                .in_register = in_register,
+                .index = index,
+            });
+            return static_cast<std::uint32_t>(upvalues.size() - 1);
+        };
+
+        if (auto local = this->parent->resolve_local(name)) {
+            this->parent->locals[*local].captured = true;
+            return add_upvalue(true, *local);
+        }
+        if (auto upvalue = this->parent->resolve_upvalue(name)) {
+            return add_upvalue(false, *upvalue);
+        }
+        return std::nullopt;
+    }
+
+    auto resolve(const std::string& name) -> Variable {
+        if (auto local = this->resolve_local(name)) {
+            return Variable{.kind = Variable::Kind::LOCAL, .index = *local};
+        }
+        if (auto upvalue = this->resolve_upvalue(name)) {
+            return Variable{.kind = Variable::Kind::UPVALUE, .index = *upvalue};
+        }
+        return Variable{.kind = Variable::Kind::GLOBAL, .index = this->add_name(name)};
+    }
+
+    void emit_get_variable(const std::string& name, std::uint32_t target) {
+        auto variable = this->resolve(name);
+        switch (variable.kind) {
+        case Variable::Kind::LOCAL:
+            if (variable.index != target) {
+                this->emit(Instruction{.op = OpCode::MOVE, .a = target, .b = variable.index});
+            }
+            break;
+        case Variable::Kind::UPVALUE:
+            this->emit(Instruction{.op = OpCode::GET_UPVALUE, .a = target, .b = variable.index});
+            break;
+        case Variable::Kind::GLOBAL:
+            this->emit(Instruction{.op = OpCode::GET_GLOBAL, .a = target, .b = variable.index});
+            break;
+        }
+    }
+
+    void emit_set_variable(const std::string& name, std::uint32_t value) {
+        auto variable = this->resolve(name);
+        switch (variable.kind) {
+        case Variable::Kind::LOCAL:
+            if (variable.index != value) {
+                this->emit(Instruction{.op = OpCode::MOVE, .a = variable.index, .b = value});
+            }
+            break;
+        case Variable::Kind::UPVALUE:
+            this->emit(Instruction{.op = OpCode::SET_UPVALUE, .a = value, .b = variable.index});
+            break;
+        case Variable::Kind::GLOBAL:
+            this->emit(Instruction{.op = OpCode::SET_GLOBAL, .a = value, .b = variable.index});
+            break;
+        }
+    }
+
+    void emit_error(const std::string& message) {
+        this->emit(Instruction{.op = OpCode::ERROR, .b = this->add_name(message)});
+    }
+
+    /**
+     * Checks if the expression can evaluate to more than one value.
+     */
+    static auto is_multi_value(const ast::Expression& expr) -> bool {
+        return std::visit(
+            overloaded{
+                [](const ast::Spread& /*unused*/) { return true; },
+                [](const ast::Prefix& prefix) {
+                    return std::visit(
+                        overloaded{
+                            [](const ast::FunctionCall& /*unused*/) { return true; },
+                            [](const ast::Expression& expr) { return is_multi_value(expr); },
+                            [](const auto& /*unused*/) { return false; },
+                        },
+                        prefix.options());
+                },
+                [](const auto& /*unused*/) { return false; },
+            },
+            expr.options());
+    }
+
+    // statements
+    void compile_body(ast::Body body) {
+        for (const auto& statement : body.statements()) {
+            this->compile_statement(statement);
+        }
+
+        auto return_statement = body.return_statement();
+        if (return_statement) {
+            this->compile_return(return_statement->exp_list());
+        }
+    }
+
+    void compile_block(ast::Body body) {
+        this->emit(Instruction{.op = OpCode::ENTER_BLOCK});
+        auto scope = this->enter_scope();
+
+        this->compile_body(std::move(body));
+
+        this->leave_scope(scope);
+    }
+
+    void compile_statement(const ast::Statement& statement) {
+        assert(this->next_register == this->num_locals());
+
+        std::visit(
+            overloaded{
+                [this](const ast::VariableDeclaration& node) {
+                    this->compile_variable_declaration(node);
+                },
+                [this](const ast::DoStatement& node) { this->compile_block(node.body()); },
+                [this](const ast::IfStatement& node) { this->compile_if_statement(node); },
+                [this](const ast::WhileStatement& node) { this->compile_while_statement(node); },
+                [this](const ast::RepeatStatement& node) { this->compile_repeat_statement(node); },
+                [this](const ast::ForStatement& node) {
+                    this->compile_block(node.desugar().body());
+                },
+                [this](const ast::ForInStatement& node) {
+                    this->compile_block(node.desugar().body());
+                },
+                [](const ast::GoTo& node) { throw CompileError("goto", node.range()); },
+                [this](const ast::Break& /*node*/) { this->compile_break(); },
+                [](const ast::Label& node) { throw CompileError("label", node.range()); },
+                [this](const ast::FunctionStatement& node) {
+                    this->compile_variable_declaration(node.desugar());
+                },
+                [this](const ast::FunctionCall& node) {
+                    this->compile_function_call(node, this->reserve_registers());
+                },
+                [this](const ast::Expression& node) {
+                    this->compile_expression(node, this->reserve_registers());
+                },
+            },
+            statement.options());
+
+        // free the temporary registers (but keep newly declared local variables)
+        this->next_register = this->num_locals();
+    }
+
+    void compile_variable_declaration(const ast::VariableDeclaration& decl) {
+        auto declarators = decl.declarators();
+        auto count = static_cast<std::uint32_t>(declarators.size());
+
+        // evaluate all expressions before assigning any variable
+        auto values = this->next_register;
+        auto [num_values, multi] = this->compile_expression_list(decl.declarations());
+        if (num_values < count) {
+            this->reserve_registers(count - num_values);
+            if (multi) {
+                this->emit(Instruction{
+                    .op = OpCode::UNPACK,
+                    .a = values + num_values,
+                    .b = count - num_values,
+                });
+            } else {
+                this->emit(Instruction{
+                    .op = OpCode::LOAD_NIL,
+                    .a = values + num_values,
+                    .b = count - num_values,
+                });
+            }
+        }
+
+        if (decl.local()) {
+            // the values are already in the next free registers so they become
+            // the new local variables
+            this->next_register = values + count;
+        }
+
+        for (std::uint32_t i = 0; i < count; ++i) {
+            auto value = values + i;
+            auto first_free_register = this->next_register;
+
+            if (decl.local()) {
+                // the only target that is allowed for local declarations is an identifier
+                std::visit(
+                    overloaded{
+                        [this](const ast::Identifier& ident) {
+                            this->declare_local(ident.string());
+                        },
+                        // NOTE the placeholder variables keep the registers of
+                        // the following local variables correct
+                        [this](const ast::FieldExpression& /*node*/) {
+                            this->emit_error(
+                                "Field expression not allowed as target of local declaration");
+                            this->declare_local("");
+                        },
+                        [this](const ast::TableIndex& /*node*/) {
+                            this->emit_error(
+                                "Table access not allowed as target of local declaration");
+                            this->declare_local("");
+                        },
+                    },
+                    declarators[i].options());
+            } else {
+                std::visit(
+                    overloaded{
+                        [this, value](const ast::Identifier& ident) {
+                            this->emit_set_variable(ident.string(), value);
+                        },
+                        [this, value](const ast::TableIndex& table_index) {
+                            auto table = this->reserve_registers();
+                            this->compile_prefix(table_index.table(), table);
+                            auto index = this->reserve_registers();
+                            this->compile_expression(table_index.index(), index);
+                            this->emit(Instruction{
+                                .op = OpCode::SET_INDEX,
+                                .a = table,
+                                .b = index,
+                                .c = value,
+                            });
+                        },
+                        [this, value](const ast::FieldExpression& field_expr) {
+                            auto table = this->reserve_registers();
+                            this->compile_prefix(field_expr.table_id(), table);
+                            this->emit(Instruction{
+                                .op = OpCode::SET_FIELD,
+                                .a = table,
+                                .b = this->add_name(field_expr.property_id().string()),
+                                .c = value,
+                            });
+                        },
+                    },
+                    declarators[i].options());
+            }
+
+            this->next_register = first_free_register;
+        }
+    }
+
+    void compile_if_statement(const ast::IfStatement& if_stmt) {
+        std::vector<std::size_t> jumps_to_end;
+
+        auto compile_branch = [this, &jumps_to_end](const ast::Expression& condition,
+                                                    ast::Body body) {
+            auto condition_register = this->reserve_registers();
+            this->compile_expression(condition, condition_register);
+            this->next_register = condition_register;
+
+            auto skip = this->emit(Instruction{.op = OpCode::JMP_IF_NOT, .a = condition_register});
+            this->compile_block(std::move(body));
+            jumps_to_end.push_back(this->emit(Instruction{.op = OpCode::JMP}));
+            this->patch({skip}, this->pc());
+        };
+
+        compile_branch(if_stmt.condition(), if_stmt.body());
+        for (const auto& elseif_stmt : if_stmt.elseifs()) {
+            compile_branch(elseif_stmt.condition(), elseif_stmt.body());
+        }
+
+        auto else_stmt = if_stmt.else_statement();
+        if (else_stmt) {
+            this->compile_block(else_stmt->body());
+        }
+
+        this->patch(jumps_to_end, this->pc());
+    }
+
+    void compile_while_statement(const ast::WhileStatement& while_stmt) {
+        auto loop_start = this->pc();
+
+        auto condition_register = this->reserve_registers();
+        this->compile_expression(while_stmt.repeat_conditon(), condition_register);
+        this->next_register = condition_register;
+        auto exit_jump = this->emit(Instruction{.op = OpCode::JMP_IF_NOT, .a = condition_register});
+
+        this->jump_targets.push_back(JumpTarget{.num_locals = this->num_locals()});
+        this->compile_block(while_stmt.body());
+        auto target = std::move(this->jump_targets.back());
+        this->jump_targets.pop_back();
+
+        this->emit(Instruction{.op = OpCode::JMP, .b = static_cast<std::uint32_t>(loop_start)});
+
+        this->patch({exit_jump}, this->pc());
+        this->patch(target.breaks, this->pc());
+    }
+
+    void compile_repeat_statement(const ast::RepeatStatement& repeat_stmt) {
+        auto loop_start = this->pc();
+
+        // the condition is part of the same block and can access local variables
+        // declared in the repeat block
+        this->jump_targets.push_back(JumpTarget{.num_locals = this->num_locals()});
+        this->emit(Instruction{.op = OpCode::ENTER_BLOCK});
+        auto scope = this->enter_scope();
+
+        this->compile_body(repeat_stmt.body());
+
+        auto condition_register = this->reserve_registers();
+        this->compile_expression(repeat_stmt.repeat_condition(), condition_register);
+
+        // NOTE this does not change the condition register
+        this->leave_scope(scope);
+        auto target = std::move(this->jump_targets.back());
+        this->jump_targets.pop_back();
+
+        // repeat until condition is true
+        this->emit(Instruction{
+            .op = OpCode::JMP_IF_NOT,
+            .a = condition_register,
+            .b = static_cast<std::uint32_t>(loop_start),
+        });
+
+        this->patch(target.breaks, this->pc());
+    }
+
+    void compile_break() {
+        if (this->jump_targets.empty()) {
+            // breaking outside of a loop ends the current function
+            this->emit(Instruction{.op = OpCode::RETURN});
+            return;
+        }
+
+        auto& target = this->jump_targets.back();
+        target.breaks.push_back(this->emit(Instruction{
+            .op = OpCode::BREAK,
+            .a = target.num_locals,
+        }));
+    }
+
+    void compile_return(const std::vector<ast::Expression>& expressions) {
+        if (!this->proto->root && expressions.size() == 1) {
+            if (auto call = as_function_call(expressions.front())) {
+                this->compile_tail_call(*call);
+                return;
+            }
+        }
+
+        auto values = this->next_register;
+        auto [num_values, multi] = this->compile_expression_list(expressions);
+
+        if (!this->proto->root) {
+            this->emit(Instruction{
+                .op = OpCode::RETURN,
+                .multi = multi,
+                .a = values,
+                .b = num_values,
+            });
+        } else {
+            this->emit(Instruction{
+                .op = OpCode::SET_RESULT,
+                .multi = multi,
+                .a = values,
+                .b = num_values,
+            });
+
+            if (this->jump_targets.empty()) {
+                // return statement of the file
+                this->emit(Instruction{.op = OpCode::HALT});
+            } else {
+                // returning only ends the current top level statement
+                auto& target = this->jump_targets.front();
+                target.returns.push_back(this->emit(Instruction{
+                    .op = OpCode::BREAK,
+                    .a = target.num_locals,
+                }));
+            }
+        }
+
+        this->next_register = values;
+    }
+
+    // expressions
+
+    /**
+     * Evaluates a list of expressions into consecutive registers starting at
+     * `next_register`.
+     *
+     * Returns the number of registers that were filled and if the values of
+     * the last expression are in `multi`.
+     */
+    auto compile_expression_list(const std::vector<ast::Expression>& expressions)
+        -> std::pair<std::uint32_t, bool> {
+        if (expressions.empty()) {
+            return std::make_pair(0, false);
+        }
+
+        std::uint32_t count = 0;
+        for (std::size_t i = 0; i < expressions.size() - 1; ++i) {
+            this->compile_expression(expressions[i], this->reserve_registers());
+            count++;
+        }
+
+        const auto& last = expressions.back();
+        if (is_multi_value(last)) {
+            auto first_free_register = this->next_register;
+            this->compile_multi_value_expression(last);
+            this->next_register = first_free_register;
+            return std::make_pair(count, true);
+        }
+
+        this->compile_expression(last, this->reserve_registers());
+        count++;
+        return std::make_pair(count, false);
+    }
+
+    /**
+     * Evaluates an expression and puts all of its values into `multi`.
+     */
+    void compile_multi_value_expression(const ast::Expression& expr) {
+        std::visit(
+            overloaded{
+                [this](const ast::Spread& /*unused*/) {
+                    this->emit(Instruction{.op = OpCode::VARARG, .multi = true});
+                },
+                [this](const ast::Prefix& prefix) {
+                    std::visit(
+                        overloaded{
+                            [this](const ast::FunctionCall& call) {
+                                // CALL always sets multi
+                                this->compile_function_call(call, this->reserve_registers());
+                            },
+                            [this](const ast::Expression& expr) {
+                                this->compile_multi_value_expression(expr);
+                            },
+                            [](const auto& /*unused*/) { assert(false); },
+                        },
+                        prefix.options());
+                },
+                [](const auto& /*unused*/) { assert(false); },
+            },
+            expr.options());
+    }
+
+    void compile_expression(const ast::Expression& expr, std::uint32_t target) {
+        auto first_free_register = this->next_register;
+
+        std::visit(
+            overloaded{
+                [this, target](const ast::Spread& /*unused*/) {
+                    this->emit(Instruction{.op = OpCode::VARARG, .a = target});
+                },
+                [this, target](const ast::Prefix& prefix) { this->compile_prefix(prefix, target); },
+                [this, target](const ast::FunctionDefinition& function_definition) {
+                    Compiler compiler(this);
+                    this->proto->protos.push_back(compiler.compile_function(function_definition));
+                    this->emit(Instruction{
+                        .op = OpCode::CLOSURE,
+                        .a = target,
+                        .b = static_cast<std::uint32_t>(this->proto->protos.size() - 1),
+                    });
+                },
+                [this, target](const ast::Table& table) {
+                    this->compile_table_constructor(table, target);
+                },
+                [this, target](const ast::BinaryOperation& bin_op) {
+                    this->compile_binary_operation(bin_op, target);
+                },
+                [this, target](const ast::UnaryOperation& unary_op) {
+                    this->compile_unary_operation(unary_op, target);
+                },
+                [this, target](const ast::Literal& literal) {
+                    this->compile_literal(literal, target);
+                },
+                [this, target](const ast::Identifier& ident) {
+                    this->emit_get_variable(ident.string(), target);
+                },
+            },
+            expr.options());
+
+        this->next_register = first_free_register;
+    }
+
+    /**
+     * Returns the value of the literal or `std::nullopt` if it can't be parsed.
+     */
+    static auto literal_value(const ast::Literal& literal) -> std::optional<Value> {
+        try {
+            switch (literal.type()) {
+            case ast::LiteralType::TRUE:
+                return Value(Bool(true));
+            case ast::LiteralType::FALSE:
+                return Value(Bool(false));
+            case ast::LiteralType::NIL:
+                return Value(Nil());
+            case ast::LiteralType::NUMBER:
+                return parse_number_literal(literal.content());
+            case ast::LiteralType::STRING:
+                return parse_string_literal(literal.content());
+            }
+        } catch (const std::exception&) {
+        }
+        return std::nullopt;
+    }
+
+    void compile_literal(const ast::Literal& literal, std::uint32_t target) {
+        auto loc = this->add_location(literal.range());
+
+        auto value = literal_value(literal);
+        if (!value) {
+            // report the error when the literal is evaluated
+            this->emit(Instruction{
+                .op = OpCode::LOAD_LITERAL,
+                .a = target,
+                .b = this->add_name(literal.content()),
+                .c = literal.type() == ast::LiteralType::NUMBER ? 0U : 1U,
+                .loc = loc,
+            });
+            return;
+        }
+
+        this->emit(Instruction{
+            .op = OpCode::LOAD_CONST,
+            .a = target,
+            .b = this->add_constant(std::move(*value)),
+            .loc = loc,
+        });
+    }
+
+    // constant folding (see CompileOptions::fold_constants)
+
+    /**
+     * Evaluates the expression if it only consists of literals and operators.
+     *
+     * Returns the value with the origin it would get at runtime or
+     * `std::nullopt` if the expression can't be folded.
+     */
+    auto fold_expression(const ast::Expression& expr) const -> std::optional<Value> {
+        return std::visit(
+            overloaded{
+                [this](const ast::Literal& literal) -> std::optional<Value> {
+                    auto value = literal_value(literal);
+                    if (!value || origin_tracking() == OriginTracking::OFF) {
+                        return value;
+                    }
+                    auto origin =
+                        LiteralOrigin{.location = literal.range().with_file(this->options.file)};
+                    return value->with_origin(origin);
+                },
+                [this](const ast::BinaryOperation& bin_op) {
+                    return this->fold_binary_operation(bin_op);
+                },
+                [this](const ast::UnaryOperation& unary_op) {
+                    return this->fold_unary_operation(unary_op);
+                },
+                [this](const ast::Prefix& prefix) -> std::optional<Value> {
+                    // parenthesized expression
+                    auto options = prefix.options();
+                    if (const auto* inner = std::get_if<ast::Expression>(&options)) {
+                        return this->fold_expression(*inner);
+                    }
+                    return std::nullopt;
+                },
+                [](const auto& /*unused*/) -> std::optional<Value> { return std::nullopt; },
+            },
+            expr.options());
+    }
+
+    auto fold_binary_operation(const ast::BinaryOperation& bin_op) const -> std::optional<Value> {
+        if (!this->options.fold_constants) {
+            return std::nullopt;
+        }
+
+        if (bin_op.binary_operator() == ast::BinOpEnum::CONCAT) {
+            return this->fold_concat(bin_op);
+        }
+
+        auto lhs = this->fold_expression(bin_op.left());
+        if (!lhs) {
+            return std::nullopt;
+        }
+        auto rhs = this->fold_expression(bin_op.right());
+        if (!rhs) {
+            return std::nullopt;
+        }
+
+        // the same operations the virtual machine uses for values that are
+        // not tables (the comparisons only have a fast path for numbers)
+        auto location = bin_op.range().with_file(this->options.file);
+        bool numbers = lhs->is_number() && rhs->is_number();
+        try {
+            switch (bin_op.binary_operator()) {
+#define FOLD(op, method)                                                                           \
+    case ast::BinOpEnum::op:                                                                       \
+        return lhs->method(*rhs, location);
+
+                FOLD(ADD, add)
+                FOLD(SUB, sub)
+                FOLD(MUL, mul)
+                FOLD(DIV, div)
+                FOLD(MOD, mod)
+                FOLD(POW, pow)
+                FOLD(INT_DIV, int_div)
+                FOLD(BIT_AND, bit_and)
+                FOLD(BIT_OR, bit_or)
+                FOLD(BIT_XOR, bit_xor)
+                FOLD(SHIFT_LEFT, bit_shl)
+                FOLD(SHIFT_RIGHT, bit_shr)
+                FOLD(AND, logic_and)
+                FOLD(OR, logic_or)
+
+#undef FOLD
+
+            case ast::BinOpEnum::EQ:
+                if (numbers) {
+                    return lhs->equals(*rhs, location);
+                }
+                break;
+            case ast::BinOpEnum::NEQ:
+                if (numbers) {
+                    return lhs->equals(*rhs, location).invert();
+                }
+                break;
+            case ast::BinOpEnum::LT:
+                if (numbers) {
+                    return lhs->less_than(*rhs, location);
+                }
+                break;
+            case ast::BinOpEnum::LEQ:
+                if (numbers) {
+                    return lhs->less_than_or_equal(*rhs, location);
+                }
+                break;
+            case ast::BinOpEnum::GT:
+                if (numbers) {
+                    return rhs->less_than(*lhs, location);
+                }
+                break;
+            case ast::BinOpEnum::GEQ:
+                if (numbers) {
+                    return rhs->less_than_or_equal(*lhs, location);
+                }
+                break;
+            case ast::BinOpEnum::CONCAT:
+                // see fold_concat
+                break;
+            }
+        } catch (const std::exception&) {
+            // the error is raised when the operator is evaluated
+        }
+        return std::nullopt;
+    }
+
+    // The virtual machine concatenates strings and numbers of a chain at once
+    // (see Interpreter::concat). So the chain is folded as a whole to get the
+    // same origin.
+    auto fold_concat(const ast::BinaryOperation& bin_op) const -> std::optional<Value> {
+        std::vector<Value> values;
+        auto fold_operand = [this, &values](const ast::Expression& operand) {
+            auto value = this->fold_expression(operand);
+            if (!value || !is_concatenable(*value)) {
+                // the error is raised when the operator is evaluated
+                return false;
+            }
+            values.push_back(std::move(*value));
+            return true;
+        };
+
+        auto current = bin_op;
+        while (true) {
+            if (!fold_operand(current.left())) {
+                return std::nullopt;
+            }
+
+            auto right = current.right();
+            auto options = right.options();
+            const auto* next = std::get_if<ast::BinaryOperation>(&options);
+            if (next == nullptr || next->binary_operator() != ast::BinOpEnum::CONCAT) {
+                if (!fold_operand(right)) {
+                    return std::nullopt;
+                }
+                break;
+            }
+            current = *next;
+        }
+
+        return concat_flattened(
+            values.data(), values.size(), bin_op.range().with_file(this->options.file));
+    }
+
+    auto fold_unary_operation(const ast::UnaryOperation& unary_op) const -> std::optional<Value> {
+        if (!this->options.fold_constants) {
+            return std::nullopt;
+        }
+
+        auto value = this->fold_expression(unary_op.expression());
+        if (!value) {
+            return std::nullopt;
+        }
+
+        auto location = unary_op.range().with_file(this->options.file);
+        try {
+            if (unary_op.unary_operator() == ast::UnOpEnum::NOT) {
+                return value->invert(location);
+            }
+
+            // NOTE the metamethods (see mt::unm) call the operators on a copy
+            // of the value without its origin
+            return std::visit(
+                [&unary_op, &location](const auto& raw) -> Value {
+                    switch (unary_op.unary_operator()) {
+                    case ast::UnOpEnum::NEG:
+                        return Value(raw).negate(location);
+                    case ast::UnOpEnum::BWNOT:
+                        return Value(raw).bit_not(location);
+                    case ast::UnOpEnum::LEN:
+                    default:
+                        return Value(raw).len(location);
+                    }
+                },
+                value->raw());
+        } catch (const std::exception&) {
+            // the error is raised when the operator is evaluated
+        }
+        return std::nullopt;
+    }
+
+    void emit_folded(Value value, const Range& range, std::uint32_t target) {
+        this->emit(Instruction{
+            .op = OpCode::LOAD_FOLDED,
+            .a = target,
+            .b = this->add_constant(std::move(value)),
+            .loc = this->add_location(range),
+        });
+    }
+
+    void compile_prefix(const ast::Prefix& prefix, std::uint32_t target) {
+        std::visit(
+            overloaded{
+                [&prefix](const ast::Self& /*unused*/) {
+                    throw CompileError("self", prefix.range());
+                },
+                [this, target](const ast::VariableDeclarator& variable_decl) {
+                    std::visit(
+                        overloaded{
+                            [this, target](const ast::Identifier& ident) {
+                                this->emit_get_variable(ident.string(), target);
+                            },
+                            [this, target](const ast::FieldExpression& field) {
+                                this->compile_prefix(field.table_id(), target);
+                                this->emit(Instruction{
+                                    .op = OpCode::GET_FIELD,
+                                    .a = target,
+                                    .b = target,
+                                    .c = this->add_name(field.property_id().string()),
+                                });
+                            },
+                            [this, target](const ast::TableIndex& table_index) {
+                                this->compile_prefix(table_index.table(), target);
+                                auto index = this->reserve_registers();
+                                this->compile_expression(table_index.index(), index);
+                                this->emit(Instruction{
+                                    .op = OpCode::GET_INDEX,
+                                    .a = target,
+                                    .b = target,
+                                    .c = index,
+                                });
+                                this->next_register = index;
+                            },
+                        },
+                        variable_decl.options());
+                },
+                [this, target](const ast::FunctionCall& call) {
+                    this->compile_function_call(call, target);
+                },
+                [this, target](const ast::Expression& expr) {
+                    this->compile_expression(expr, target);
+                },
+            },
+            prefix.options());
+    }
+
+    void compile_function_call(const ast::FunctionCall& call, std::uint32_t target) {
+        auto first_free_register = this->next_register;
+
+        auto function = this->reserve_registers();
+        this->compile_prefix(call.id(), function);
+
+        auto [num_args, multi] = this->compile_expression_list(call.args());
+
+        this->emit(Instruction{
+            .op = OpCode::CALL,
+            .multi = multi,
+            .a = function,
+            .b = num_args,
+            .c = this->add_name(call.id().to_string()),
+            .loc = this->add_location(call.range()),
+        });
+
+        if (target != function) {
+            this->emit(Instruction{.op = OpCode::MOVE, .a = target, .b = function});
+        }
+
+        this->next_register = first_free_register;
+    }
+
+    // `return f(args)` (but not `return (f(args))`)
+    static auto as_function_call(const ast::Expression& expr) -> std::optional<ast::FunctionCall> {
+        const auto expr_options = expr.options();
+        const auto* prefix = std::get_if<ast::Prefix>(&expr_options);
+        if (prefix == nullptr) {
+            return std::nullopt;
+        }
+        auto prefix_options = prefix->options();
+        if (auto* call = std::get_if<ast::FunctionCall>(&prefix_options)) {
+            return std::move(*call);
+        }
+        return std::nullopt;
+    }
+
+    void compile_tail_call(const ast::FunctionCall& call) {
+        auto first_free_register = this->next_register;
+
+        auto function = this->reserve_registers();
+        this->compile_prefix(call.id(), function);
+
+        auto [num_args, multi] = this->compile_expression_list(call.args());
+
+        this->emit(Instruction{
+            .op = OpCode::TAIL_CALL,
+            .multi = multi,
+            .a = function,
+            .b = num_args,
+            .c = this->add_name(call.id().to_string()),
+            .loc = this->add_location(call.range()),
+        });
+
+        this->next_register = first_free_register;
+    }
+
+    void compile_table_constructor(const ast::Table& table_constructor, std::uint32_t target) {
+        this->emit(Instruction{.op = OpCode::NEW_TABLE, .a = target});
+
+        const auto fields = table_constructor.fields();
+
+        // positional fields get the keys 1, 2, ... independent of the other
+        // fields (e.g. `{[1] = "a", "b"}` stores "b" at 1)
+        std::uint32_t consecutive_key = 1;
+
+        for (std::size_t i = 0; i < fields.size(); ++i) {
+            bool last = i == fields.size() - 1;
+            auto first_free_register = this->next_register;
+
+            std::visit(
+                overloaded{
+                    [this, target](const std::pair<ast::Expression, ast::Expression>& field) {
+                        auto key = this->reserve_registers();
+                        this->compile_expression(field.first, key);
+                        auto value = this->reserve_registers();
+                        this->compile_expression(field.second, value);
+                        this->emit(Instruction{
+                            .op = OpCode::TABLE_SET,
+                            .a = target,
+                            .b = key,
+                            .c = value,
+                        });
+                    },
+                    [this, target](const std::pair<ast::Identifier, ast::Expression>& field) {
+                        auto value = this->reserve_registers();
+                        this->compile_expression(field.second, value);
+                        this->emit(Instruction{
+                            .op = OpCode::TABLE_SET_FIELD,
+                            .a = target,
+                            .b = this->add_name(field.first.string()),
+                            .c = value,
+                        });
+                    },
+                    [this, target, last, &consecutive_key](const ast::Expression& item) {
+                        // if the last entry returns a vallist the vallist is appended
+                        if (last && is_multi_value(item)) {
+                            this->compile_multi_value_expression(item);
+                            this->emit(Instruction{
+                                .op = OpCode::TABLE_APPEND,
+                                .multi = true,
+                                .a = target,
+                                .b = consecutive_key,
+                            });
+                            return;
+                        }
+
+                        auto value = this->reserve_registers();
+                        this->compile_expression(item, value);
+                        this->emit(Instruction{
+                            .op = OpCode::TABLE_APPEND,
+                            .a = target,
+                            .b = consecutive_key,
+                            .c = value,
+                        });
+                        consecutive_key++;
+                    },
+                },
+                fields[i].content());
+
+            this->next_register = first_free_register;
+        }
+    }
+
+    void compile_binary_operation(const ast::BinaryOperation& bin_op, std::uint32_t target) {
+        if (auto folded = this->fold_binary_operation(bin_op)) {
+            this->emit_folded(std::move(*folded), bin_op.range(), target);
+            return;
+        }
+        if (bin_op.binary_operator() == ast::BinOpEnum::CONCAT) {
+            this->compile_concat(bin_op, target);
+            return;
+        }
+
+        auto lhs = this->reserve_registers();
+        this->compile_expression(bin_op.left(), lhs);
+        auto rhs = this->reserve_registers();
+        this->compile_expression(bin_op.right(), rhs);
+
+        OpCode op = OpCode::ADD;
+        switch (bin_op.binary_operator()) {
+#define BIN_OP(name)                                                                               \
+    case ast::BinOpEnum::name:                                                                     \
+        op = OpCode::name;                                                                         \
+        break;
+
+            BIN_OP(ADD)
+            BIN_OP(SUB)
+            BIN_OP(MUL)
+            BIN_OP(DIV)
+            BIN_OP(MOD)
+            BIN_OP(POW)
+            BIN_OP(INT_DIV)
+            BIN_OP(BIT_AND)
+            BIN_OP(BIT_OR)
+            BIN_OP(BIT_XOR)
+            BIN_OP(SHIFT_LEFT)
+            BIN_OP(SHIFT_RIGHT)
+            BIN_OP(EQ)
+            BIN_OP(NEQ)
+            BIN_OP(LT)
+            BIN_OP(LEQ)
+            BIN_OP(GT)
+            BIN_OP(GEQ)
+            BIN_OP(AND)
+            BIN_OP(OR)
+
+#undef BIN_OP
+        case ast::BinOpEnum::CONCAT:
+            // see compile_concat
+            break;
+        }
+
+        this->emit(Instruction{
+            .op = op,
+            .a = target,
+            .b = lhs,
+            .c = rhs,
+            .loc = this->add_location(bin_op.range()),
+        });
+    }
+
+    // Compiles a chain of concatenations into a single CONCAT instruction. The
+    // operator is right associative so `a .. b .. c` is `a .. (b .. c)`.
+    void compile_concat(const ast::BinaryOperation& bin_op, std::uint32_t target) {
+        std::vector<ast::Expression> operands;
+        std::vector<Range> locations;
+
+        auto current = bin_op;
+        while (true) {
+            operands.push_back(current.left());
+            locations.push_back(current.range());
+
+            auto right = current.right();
+            auto options = right.options();
+            const auto* next = std::get_if<ast::BinaryOperation>(&options);
+            // NOTE constant parts of the chain are not folded on their own
+            // because the virtual machine concatenates them together with the
+            // other strings and numbers (see fold_concat)
+            if (next == nullptr || next->binary_operator() != ast::BinOpEnum::CONCAT) {
+                operands.push_back(right);
+                break;
+            }
+            current = *next;
+        }
+
+        auto count = static_cast<std::uint32_t>(operands.size());
+        auto first = this->reserve_registers(count);
+        for (std::uint32_t i = 0; i < count; ++i) {
+            this->compile_expression(operands[i], first + i);
+        }
+
+        auto loc = this->add_location(locations[0]);
+        for (std::size_t i = 1; i < locations.size(); ++i) {
+            this->add_location(locations[i]);
+        }
+
+        this->emit(Instruction{
+            .op = OpCode::CONCAT,
+            .a = target,
+            .b = first,
+            .c = count,
+            .loc = loc,
+        });
+    }
+
+    void compile_unary_operation(const ast::UnaryOperation& unary_op, std::uint32_t target) {
+        if (auto folded = this->fold_unary_operation(unary_op)) {
+            this->emit_folded(std::move(*folded), unary_op.range(), target);
+            return;
+        }
+
+        auto operand = this->reserve_registers();
+        this->compile_expression(unary_op.expression(), operand);
+
+        OpCode op = OpCode::NOT;
+        switch (unary_op.unary_operator()) {
+        case ast::UnOpEnum::NEG:
+            op = OpCode::NEG;
+            break;
+        case ast::UnOpEnum::BWNOT:
+            op = OpCode::BWNOT;
+            break;
+        case ast::UnOpEnum::LEN:
+            op = OpCode::LEN;
+            break;
+        case ast::UnOpEnum::NOT:
+            op = OpCode::NOT;
+            break;
+        }
+
+        this->emit(Instruction{
+            .op = op,
+            .a = target,
+            .b = operand,
+            .loc = this->add_location(unary_op.range()),
+        });
+    }
+};
+
+// class CompileError
+CompileError::CompileError(const std::string& feature, const Range& location)
+    : InterpreterException(
+          "unsupported: \"" + feature + "\" in line " + std::to_string(location.start.line + 1)) {}
+
+auto compile(const ast::Program& program, const CompileOptions& options)
+    -> std::shared_ptr<const Proto> {
+    Compiler compiler(options);
+    return compiler.compile_program(program);
+}
+
+} // namespace minilua::details::bytecode
@@ -0,0 +1,333 @@
+#ifndef MINILUA_DETAILS_BYTECODE_HPP
+#define MINILUA_DETAILS_BYTECODE_HPP
+
+#include "MiniLua/exceptions.hpp"
+#include "MiniLua/source_change.hpp"
+#include "MiniLua/values.hpp"
+#include "ast.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Register based bytecode for the lua [AST](@ref minilua::details::ast).
+ *
+ * The AST is lowered once into a flat list of instructions per function (see
+ * Proto). The virtual machine in `vm.cpp` then executes the instructions
+ * instead of recursively walking the AST. This avoids re-deriving the AST
+ * classes from the tree-sitter nodes and re-running the desugaring every time
+ * a statement is executed.
+ *
+ * The instructions are designed to mirror the semantics of the tree walking
+ * interpreter exactly (including the generated origins and source changes).
+ */
+namespace minilua::details::bytecode {
+
+/**
+ * The operations of the virtual machine.
+ *
+ * `R[x]` denotes register `x`, `K[x]` the constant `x`, `N[x]` the name `x`,
+ * `U[x]` the upvalue `x`, `L[x]` the source location `x` and `C[x]` the field
+ * cache `x` of the current Proto. `multi` is the list of values produced by the last instruction that
+ * was marked as multi-valued (function calls and varargs).
+ *
+ * Local variables (including parameters) live in the lowest registers. The
+ * local variable declared `i`-th in the current scope chain is stored in
+ * `R[i]`. Local variables that are captured by a nested function are
+ * accessed by that function through an upvalue (see Proto::upvalues).
+ *
+ * Instructions that consume a list of values (e.g. arguments or return values)
+ * read `b` consecutive registers and additionally append `multi` if the `multi`
+ * flag of the instruction is set.
+ */
+enum class OpCode : std::uint8_t {
+    /** `R[a] = nil` for `b` registers starting at `a`. */
+    LOAD_NIL,
+    /** `R[a] = K[b]` with a literal origin at `L[loc]`. */
+    LOAD_CONST,
+    /**
+     * `R[a] = parse(N[b])` with a literal origin at `L[loc]`.
+     *
+     * Only used for literals that failed to parse while compiling so the error
+     * is raised at the time the literal is evaluated.
+     */
+    LOAD_LITERAL,
+    /**
+     * `R[a] = K[b]` keeping the origin of the constant.
+     *
+     * Used for operators on constants that were evaluated while compiling
+     * (see CompileOptions::fold_constants). The constant already has the
+     * origin the operators would have produced.
+     */
+    LOAD_FOLDED,
+    /** `R[a] = R[b]` */
+    MOVE,
+    /** Copy `multi` into the `b` registers starting at `R[a]` (padded with nil). */
+    UNPACK,
+
+    /** `R[a] = <global variable N[b]>` */
+    GET_GLOBAL,
+    /** `<global variable N[b]> = R[a]` */
+    SET_GLOBAL,
+    /** `R[a] = U[b]` */
+    GET_UPVALUE,
+    /** `U[b] = R[a]` */
+    SET_UPVALUE,
+    /**
+     * Close all upvalues that point to registers `>= R[a]`.
+     *
+     * Emitted when leaving a scope that declared a captured local variable.
+     * Afterwards the upvalues keep their own copy of the value, so the next
+     * declaration in the same register (e.g. in the next loop iteration) gets
+     * a new variable.
+     */
+    CLOSE,
+
+    /** `R[a] = R[b][R[c]]` */
+    GET_INDEX,
+    /** `R[a] = R[b][N[c]]` (using the inline cache `C[cache]`) */
+    GET_FIELD,
+    /** `R[a][R[b]] = R[c]` */
+    SET_INDEX,
+    /** `R[a][N[b]] = R[c]` (using the inline cache `C[cache]`) */
+    SET_FIELD,
+
+    /** `R[a] = {}` */
+    NEW_TABLE,
+    /** `R[a][R[b]] = R[c]` without invoking metamethods */
+    TABLE_SET,
+    /** `R[a][N[b]] = R[c]` without invoking metamethods */
+    TABLE_SET_FIELD,
+    /** `R[a][b + i] = multi[i]` (or `R[a][b] = R[c]` if the multi flag is not set) */
+    TABLE_APPEND,
+
+    // binary operators: `R[a] = R[b] op R[c]` (with origin `L[loc]`)
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    MOD,
+    POW,
+    INT_DIV,
+    BIT_AND,
+    BIT_OR,
+    BIT_XOR,
+    SHIFT_LEFT,
+    SHIFT_RIGHT,
+    EQ,
+    NEQ,
+    LT,
+    LEQ,
+    GT,
+    GEQ,
+    // NOTE `and` and `or` evaluate both operands (see the tree walking
+    // interpreter) so they are plain binary operators
+    AND,
+    OR,
+    /**
+     * `R[a] = R[b] .. R[b + 1] .. ... .. R[b + c - 1]` (the `i`-th operator has
+     * the origin `L[loc + i]`)
+     *
+     * The registers `R[b]` to `R[b + c - 1]` are overwritten.
+     */
+    CONCAT,
+
+    // unary operators: `R[a] = op R[b]` (with origin `L[loc]`)
+    NEG,
+    BWNOT,
+    LEN,
+    NOT,
+
+    /**
+     * `R[a] = closure(protos[b])` capturing the current environment and the
+     * upvalues described in `protos[b]->upvalues`.
+     */
+    CLOSURE,
+    /** `R[a] = ...` (or `multi = ...` if the multi flag is set) */
+    VARARG,
+    /**
+     * Call the function `R[a]` with the argument list `R[a+1] ... R[a+b]`.
+     *
+     * The first result is stored in `R[a]` and `multi` is set to all results.
+     * The called function is named `N[c]` in stacktraces and the call is
+     * located at `L[loc]`.
+     */
+    CALL,
+    /**
+     * Call the function `R[a]` like `CALL` and return all of its results.
+     *
+     * If `R[a]` is a lua function the call is not executed but returned to
+     * the calling BytecodeFunction (see TailCall). Only used in functions.
+     */
+    TAIL_CALL,
+
+    /**
+     * Marks the start of a new scope.
+     *
+     * Only used for InterpreterConfig::trace_enter_block.
+     */
+    ENTER_BLOCK,
+
+    /** Jump to instruction `b`. */
+    JMP,
+    /** Jump to instruction `b` if `R[a]` is falsy. */
+    JMP_IF_NOT,
+    /** Close all upvalues `>= R[a]` (see `CLOSE`) and jump to instruction `b`. */
+    BREAK,
+
+    /** Return the value list `R[a] ... R[a+b-1]`. */
+    RETURN,
+    /**
+     * Store the value list `R[a] ... R[a+b-1]` as the result of the program.
+     *
+     * Only used for the top level code. Returning there does not stop the
+     * program but only the current (top level) statement.
+     */
+    SET_RESULT,
+    /** Clear the stored result of the program. */
+    CLEAR_RESULT,
+    /** Stop the program and return the stored result. */
+    HALT,
+
+    /** Throw an InterpreterException with the message `N[b]`. */
+    ERROR,
+};
+
+auto operator<<(std::ostream&, OpCode) -> std::ostream&;
+
+struct Instruction {
+    OpCode op;
+    /**
+     * Marks an instruction to produce or consume `multi`.
+     */
+    bool multi = false;
+    std::uint32_t a = 0;
+    std::uint32_t b = 0;
+    std::uint32_t c = 0;
+    /**
+     * Index into Proto::locations.
+     */
+    std::uint32_t loc = 0;
+    /**
+     * Index of the inline cache of the instruction (only for field accesses,
+     * see Proto::num_field_caches).
+     */
+    std::uint32_t cache = 0;
+};
+
+auto operator<<(std::ostream&, const Instruction&) -> std::ostream&;
+
+/**
+ * Describes where a closure gets one of its upvalues from when it is created.
+ */
+struct UpvalueDescription {
+    /**
+     * Name of the captured variable (only used for debugging).
+     */
+    std::string name;
+    /**
+     * If set the upvalue captures the local variable in register `index` of
+     * the enclosing function. Otherwise it is the upvalue `index` of the
+     * enclosing function.
+     */
+    bool in_register;
+    std::uint32_t index;
+};
+
+/**
+ * A compiled function (or the top level code of a file).
+ */
+struct Proto {
+    std::vector<Instruction> code;
+    std::vector<Value> constants;
+    std::vector<std::string> names;
+    /**
+     * The same as `names` but as (interned) strings for looking up fields and
+     * global variables.
+     */
+    std::vector<Value> name_values;
+    std::vector<Range> locations;
+    std::vector<std::shared_ptr<const Proto>> protos;
+    std::vector<UpvalueDescription> upvalues;
+    /**
+     * The number of field accesses (see Instruction::cache).
+     *
+     * The inline caches (see FieldCache) are updated while executing and they
+     * point into the tables of one run. So they are stored in the interpreter
+     * (see Interpreter::field_caches_of) and a proto never changes after it
+     * was compiled. This allows sharing protos (e.g. of the stdlib) between
+     * threads.
+     */
+    std::uint32_t num_field_caches = 0;
+    /**
+     * Identifies the proto (for the inline caches). Ids are never reused
+     * even if the proto is destroyed.
+     */
+    std::uint64_t id = next_id();
+
+    /**
+     * The parameters are stored in the first registers.
+     */
+    std::vector<std::string> parameters;
+    bool vararg = false;
+    /**
+     * Top level code has different semantics for `return` and `break`.
+     */
+    bool root = false;
+    std::uint32_t num_registers = 0;
+
+    static auto next_id() -> std::uint64_t;
+};
+
+/**
+ * Prints a human readable listing of the instructions (including nested functions).
+ */
+auto operator<<(std::ostream&, const Proto&) -> std::ostream&;
+
+struct CompileOptions {
+    /**
+     * The file the code will be executed with (see Env::get_file).
+     *
+     * This is needed for the origins of folded constants.
+     */
+    std::optional<std::shared_ptr<const std::string>> file;
+    /**
+     * Evaluate operators whose operands are all literals while compiling
+     * (e.g. `2 * 1024` or `"a" .. "b"`).
+     *
+     * The folded value gets the same origin as if the operator was evaluated
+     * at runtime. So source changes can still be reversed through it.
+     * Operators that would fail at runtime are not folded.
+     *
+     * This has to be disabled if operator calls are traced (see
+     * InterpreterConfig::trace_metamethod_calls).
+     */
+    bool fold_constants = true;
+};
+
+/**
+ * Thrown by `compile` if the program uses a feature that the compiler does
+ * not support (e.g. `goto`).
+ */
+class CompileError : public InterpreterException {
+public:
+    CompileError(const std::string& feature, const Range& location);
+};
+
+/**
+ * Compiles a whole file (or the stdlib).
+ *
+ * Throws a CompileError if the program uses an unsupported feature. Other
+ * errors that the tree walking interpreter would only detect while executing
+ * are compiled into instructions that throw when they are executed.
+ */
+auto compile(const ast::Program& program, const CompileOptions& options = CompileOptions())
+    -> std::shared_ptr<const Proto>;
+
+} // namespace minilua::details::bytecode
+
+#endif
@@ -0,0 +1,58 @@
+#include "concat.hpp"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace minilua::details {
+
+auto concat_strings(const Value* values, std::size_t count, std::string_view separator)
+    -> Value {
+    std::vector<std::string> numbers;
+    std::size_t length = count > 0 ? separator.size() * (count - 1) : 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (const auto* string = std::get_if<String>(&values[i].raw())) {
+            length += string->view().size();
+        } else {
+            numbers.push_back(std::get<Number>(values[i].raw()).to_literal());
+            length += numbers.back().size();
+        }
+    }
+
+    std::string result;
+    result.reserve(length);
+    auto number = numbers.begin();
+    for (std::size_t i = 0; i < count; ++i) {
+        if (i > 0) {
+            result += separator;
+        }
+        if (const auto* string = std::get_if<String>(&values[i].raw())) {
+            result += string->view();
+        } else {
+            result += *number++;
+        }
+    }
+    return Value(std::move(result));
+}
+
+auto concat_flattened(const Value* values, std::size_t count, std::optional<Range> location)
+    -> Value {
+    auto result = concat_strings(values, count);
+    if (origin_tracking() != OriginTracking::FULL) {
+        return result;
+    }
+
+    return result.with_origin(MultipleArgsOrigin{
+        .values = std::make_shared<Vallist>(std::vector<Value>(values, values + count)),
+        .location = std::move(location),
+        .reverse = [](const Value& /*new_value*/,
+                      const Vallist& /*old_values*/) -> std::optional<SourceChangeTree> {
+            // can't reverse the concatenation (see Value::concat)
+            return std::nullopt;
+        },
+    });
+}
+
+} // namespace minilua::details
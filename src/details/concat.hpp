@@ -0,0 +1,81 @@
+#ifndef MINILUA_DETAILS_CONCAT_HPP
+#define MINILUA_DETAILS_CONCAT_HPP
+
+#include "MiniLua/values.hpp"
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+namespace minilua::details {
+
+/**
+ * Returns true if the value can be concatenated without a metamethod (i.e. it
+ * is a string or a number).
+ */
+inline auto is_concatenable(const Value& value) -> bool {
+    return value.is_string() || value.is_number();
+}
+
+/**
+ * Concatenates strings and numbers (optionally separated by `separator`).
+ *
+ * The numbers are converted first so the exact length of the result is known
+ * and the string is allocated only once.
+ *
+ * All values have to be concatenable (see details::is_concatenable). The
+ * result has no origin.
+ */
+auto concat_strings(const Value* values, std::size_t count, std::string_view separator = "")
+    -> Value;
+
+/**
+ * Concatenates strings and numbers like details::concat_strings.
+ *
+ * With OriginTracking::FULL the result gets a single MultipleArgsOrigin with
+ * all values instead of one BinaryOrigin per operator. Like Value::concat
+ * the concatenation can't be reversed.
+ */
+auto concat_flattened(const Value* values, std::size_t count, std::optional<Range> location)
+    -> Value;
+
+/**
+ * Evaluates the concatenation chain `values[0] .. values[1] .. ... ..
+ * values[count - 1]`.
+ *
+ * Like in the reference implementation the chain is evaluated from right to
+ * left (`..` is right associative) and the values are used as scratch space
+ * for the intermediate results. If `flatten` is true consecutive strings and
+ * numbers are concatenated at once by `concat_run(index, run, length)`
+ * instead of creating an intermediate string for every operator. All other
+ * operators are evaluated by `concat_pair(index, lhs, rhs)`. `index` is the
+ * index of the (first) left operand (e.g. to call the `__concat` metamethod
+ * or to get the location of the operator).
+ *
+ * `concat_run` should concatenate the values using details::concat_flattened.
+ */
+template <typename ConcatPair, typename ConcatRun>
+auto concat_chain(
+    Value* values, std::size_t count, bool flatten, ConcatPair concat_pair, ConcatRun concat_run)
+    -> Value {
+    // values[last] is the concatenation of all values after it
+    std::size_t last = count - 1;
+    while (last > 0) {
+        std::size_t first = last - 1;
+        if (flatten && is_concatenable(values[last]) && is_concatenable(values[first])) {
+            while (first > 0 && is_concatenable(values[first - 1])) {
+                first--;
+            }
+            values[first] = concat_run(first, values + first, last - first + 1);
+        } else {
+            values[first] = concat_pair(first, values[first], values[last]);
+        }
+        last = first;
+    }
+    return std::move(values[0]);
+}
+
+} // namespace minilua::details
+
+#endif
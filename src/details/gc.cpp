@@ -0,0 +1,193 @@
+#include "gc.hpp"
+#include "interpreter.hpp"
+
+namespace minilua::details {
+
+// class GarbageCollector
+GarbageCollector::GarbageCollector(MemoryAllocator& allocator, std::size_t first)
+    : allocator(allocator), first(first) {}
+
+GarbageCollector::~GarbageCollector() {
+    for (TableImpl* table : this->marked) {
+        table->marked = false;
+    }
+}
+
+void GarbageCollector::mark(const Value& value) {
+    this->pending.push_back(&value);
+    this->propagate();
+}
+void GarbageCollector::mark(const Vallist& values) {
+    for (const auto& value : values) {
+        this->pending.push_back(&value);
+    }
+    this->propagate();
+}
+void GarbageCollector::mark(const std::vector<Value>& values) {
+    for (const auto& value : values) {
+        this->pending.push_back(&value);
+    }
+    this->propagate();
+}
+void GarbageCollector::mark(const Env& env) {
+    this->visit_env(env);
+    this->propagate();
+}
+void GarbageCollector::mark(const std::vector<std::shared_ptr<Upvalue>>& upvalues) {
+    for (const auto& upvalue : upvalues) {
+        if (this->visited.insert(upvalue.get()).second) {
+            this->pending.push_back(upvalue->value);
+        }
+    }
+    this->propagate();
+}
+
+auto GarbageCollector::collect() -> std::vector<Table> {
+    const auto& tables = this->allocator.get_all();
+
+    // tables allocated before the collected ones might still be referenced
+    // from outside (e.g. by the user of the library)
+    for (std::size_t i = 0; i < this->first; ++i) {
+        this->mark_table(tables[i]);
+    }
+    this->propagate();
+
+    // unreachable tables with a `__gc` metamethod (and everything they
+    // reference) survive this collection so the metamethod can be called
+    std::vector<Table> finalize;
+    for (std::size_t i = this->first; i < tables.size(); ++i) {
+        TableImpl* table = tables[i];
+        if (table->marked || table->finalized || !table->metatable.has_value() ||
+            table->metatable->get("__gc").is_nil()) {
+            continue;
+        }
+        table->finalized = true;
+        finalize.emplace_back(table, &this->allocator);
+    }
+    for (const auto& table : finalize) {
+        this->mark_table(table.impl);
+    }
+    this->propagate();
+
+    this->allocator.sweep(this->first);
+    return finalize;
+}
+
+void GarbageCollector::mark_table(TableImpl* table) {
+    if (table->marked) {
+        return;
+    }
+    table->marked = true;
+    this->marked.push_back(table);
+    this->gray.push_back(table);
+}
+
+void GarbageCollector::visit(const Value& value) {
+    this->visit_origin(value.origin());
+
+    std::visit(
+        overloaded{
+            [this](const Table& table) { this->mark_table(table.impl); },
+            [this](const Function& function) { this->visit_function(function); },
+            [](const auto& /*unused*/) {}},
+        value.raw());
+}
+
+void GarbageCollector::visit_origin(const Origin& origin) {
+    // NOTE: origins share their values so they might be visited multiple times
+    auto visit_shared = [this](const std::shared_ptr<Value>& value) {
+        if (value && this->visited.insert(value.get()).second) {
+            this->pending.push_back(value.get());
+        }
+    };
+
+    std::visit(
+        overloaded{
+            [&visit_shared](const BinaryOrigin& origin) {
+                visit_shared(origin.lhs);
+                visit_shared(origin.rhs);
+            },
+            [&visit_shared](const UnaryOrigin& origin) { visit_shared(origin.val); },
+            [this](const MultipleArgsOrigin& origin) {
+                if (origin.values && this->visited.insert(origin.values.get()).second) {
+                    for (const auto& value : *origin.values) {
+                        this->pending.push_back(&value);
+                    }
+                }
+            },
+            [this](const ArithmeticOrigin& origin) {
+                for (const Origin* operand : {origin.lhs_origin.get(), origin.rhs_origin.get()}) {
+                    if (operand && this->visited.insert(operand).second) {
+                        this->pending_origins.push_back(operand);
+                    }
+                }
+            },
+            [](const auto& /*unused*/) {}},
+        origin.raw());
+}
+
+void GarbageCollector::visit_function(const Function& function) {
+    if (const auto* bytecode_function = function.target<BytecodeFunction>()) {
+        if (!this->visited.insert(bytecode_function).second) {
+            return;
+        }
+        this->visit_env(bytecode_function->env);
+        for (const auto& upvalue : bytecode_function->upvalues) {
+            if (this->visited.insert(upvalue.get()).second) {
+                this->pending.push_back(upvalue->value);
+            }
+        }
+    } else if (const auto* function_impl = function.target<FunctionImpl>()) {
+        if (!this->visited.insert(function_impl).second) {
+            return;
+        }
+        this->visit_env(function_impl->env);
+    }
+}
+
+void GarbageCollector::visit_env(const Env& env) {
+    this->mark_table(env.global().impl);
+    for (const auto& [name, value] : env.local()) {
+        this->pending.push_back(value.get());
+    }
+    if (const auto& varargs = env.get_varargs()) {
+        for (const auto& value : *varargs) {
+            this->pending.push_back(&value);
+        }
+    }
+}
+
+void GarbageCollector::propagate() {
+    while (!this->pending.empty() || !this->pending_origins.empty() || !this->gray.empty()) {
+        if (!this->pending.empty()) {
+            const Value* value = this->pending.back();
+            this->pending.pop_back();
+            this->visit(*value);
+            continue;
+        }
+        if (!this->pending_origins.empty()) {
+            const Origin* origin = this->pending_origins.back();
+            this->pending_origins.pop_back();
+            this->visit_origin(*origin);
+            continue;
+        }
+
+        TableImpl* table = this->gray.back();
+        this->gray.pop_back();
+        for (const auto& [key, value] : table->array) {
+            this->pending.push_back(&key);
+            this->pending.push_back(&value);
+        }
+        for (std::size_t slot = table->hash.next_slot(0); slot < table->hash.num_slots();
+             slot = table->hash.next_slot(slot + 1)) {
+            const auto& [key, value] = table->hash.entry(slot);
+            this->pending.push_back(&key);
+            this->pending.push_back(&value);
+        }
+        if (table->metatable) {
+            this->mark_table(table->metatable->impl);
+        }
+    }
+}
+
+} // namespace minilua::details
@@ -0,0 +1,85 @@
+#ifndef MINILUA_DETAILS_GC_H
+#define MINILUA_DETAILS_GC_H
+
+#include "../internal_env.hpp"
+#include "../table.hpp"
+#include "MiniLua/allocator.hpp"
+#include "MiniLua/values.hpp"
+
+#include <cstddef>
+#include <unordered_set>
+#include <vector>
+
+namespace minilua::details {
+
+struct Upvalue;
+
+/**
+ * A tracing mark-and-sweep garbage collector for the tables of a MemoryAllocator.
+ *
+ * First all roots (e.g. the registers of running functions) have to be marked
+ * using the `mark` methods. This also marks everything that is reachable
+ * from the roots:
+ *
+ * - the keys, values and metatables of tables
+ * - the environments and upvalues captured by lua functions
+ * - the values referenced by [Origins](@ref Origin)
+ *
+ * Then GarbageCollector::collect frees all unreachable tables. Cycles don't
+ * need special handling because only reachability matters.
+ *
+ * Native functions are opaque so values captured by them are not marked.
+ */
+class GarbageCollector {
+    MemoryAllocator& allocator;
+    std::size_t first;
+
+    // all marked tables (their marks have to be reset after collecting)
+    std::vector<TableImpl*> marked;
+    // marked tables whose content was not yet marked
+    std::vector<TableImpl*> gray;
+    // values that still need to be marked
+    std::vector<const Value*> pending;
+    // origins of the operands of ArithmeticOrigins that still need to be marked
+    std::vector<const Origin*> pending_origins;
+    // shared objects that were already visited (e.g. origins or upvalues)
+    std::unordered_set<const void*> visited;
+
+public:
+    /**
+     * Only the tables allocated after the first `first` tables are collected.
+     * The other tables are treated as roots.
+     */
+    GarbageCollector(MemoryAllocator& allocator, std::size_t first);
+    ~GarbageCollector();
+
+    GarbageCollector(const GarbageCollector&) = delete;
+    auto operator=(const GarbageCollector&) -> GarbageCollector& = delete;
+
+    void mark(const Value& value);
+    void mark(const Vallist& values);
+    void mark(const std::vector<Value>& values);
+    void mark(const Env& env);
+    void mark(const std::vector<std::shared_ptr<Upvalue>>& upvalues);
+
+    /**
+     * Frees all unreachable tables.
+     *
+     * Unreachable tables that have a `__gc` metamethod are kept alive until
+     * the next collection. They are returned so the metamethod can be called
+     * (and they are only returned once).
+     */
+    auto collect() -> std::vector<Table>;
+
+private:
+    void mark_table(TableImpl* table);
+    void visit(const Value& value);
+    void visit_origin(const Origin& origin);
+    void visit_function(const Function& function);
+    void visit_env(const Env& env);
+    void propagate();
+};
+
+} // namespace minilua::details
+
+#endif
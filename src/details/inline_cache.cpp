@@ -0,0 +1,85 @@
+#include "inline_cache.hpp"
+
+namespace minilua::details {
+
+// class FieldCache
+auto FieldCache::find(const Table& table) const -> Value* {
+    const TableImpl* current = table.impl;
+
+    for (std::size_t i = 0; i < this->depth; ++i) {
+        const Level& level = this->levels[i];
+        if (current != level.table || current->version != level.version) {
+            return nullptr;
+        }
+
+        if (i + 1 == this->depth) {
+            // the value might have been set to nil in the meantime
+            if (level.entry == nullptr || level.entry->is_nil()) {
+                return nullptr;
+            }
+            return level.entry;
+        }
+
+        // the field might have gotten a value in the meantime
+        if (level.entry != nullptr && !level.entry->is_nil()) {
+            return nullptr;
+        }
+
+        // NOTE: the version of `current` guarantees that it still has the
+        // same metatable, so it is safe to access it
+        if (level.metatable->version != level.metatable_version) {
+            return nullptr;
+        }
+        const auto* next = std::get_if<Table>(&level.index_entry->raw());
+        if (next == nullptr) {
+            return nullptr;
+        }
+        current = next->impl;
+    }
+
+    return nullptr;
+}
+
+auto FieldCache::update(const Table& table, const Value& key) -> Value* {
+    this->depth = 0;
+
+    TableImpl* current = table.impl;
+
+    for (std::size_t i = 0; i <= MAX_DEPTH; ++i) {
+        // only the hash part has stable entries
+        if (current->array_index(key)) {
+            return nullptr;
+        }
+
+        Level& level = this->levels[i];
+        level.table = current;
+        level.version = current->version;
+
+        level.entry = current->hash.find(key);
+
+        if (level.entry != nullptr && !level.entry->is_nil()) {
+            this->depth = i + 1;
+            return level.entry;
+        }
+
+        // the same lookup as in mt::index
+        if (!current->metatable) {
+            return nullptr;
+        }
+        const TableImpl* metatable = current->metatable->impl;
+        const Value* index_entry = metatable->find("__index");
+        if (index_entry == nullptr || !index_entry->is_table()) {
+            return nullptr;
+        }
+
+        level.metatable = metatable;
+        level.metatable_version = metatable->version;
+        level.index_entry = index_entry;
+
+        current = std::get<Table>(index_entry->raw()).impl;
+    }
+
+    return nullptr;
+}
+
+} // namespace minilua::details
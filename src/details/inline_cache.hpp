@@ -0,0 +1,84 @@
+#ifndef MINILUA_DETAILS_INLINE_CACHE_HPP
+#define MINILUA_DETAILS_INLINE_CACHE_HPP
+
+#include "../table.hpp"
+#include "MiniLua/values.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace minilua::details {
+
+/**
+ * An inline cache for a single field access in the bytecode (see
+ * bytecode::OpCode::GET_FIELD and bytecode::OpCode::SET_FIELD).
+ *
+ * It remembers where the field was found the last time: either directly in
+ * the table or by following the `__index` tables of the metatables (e.g. the
+ * methods of a class). Every table on the way is stored together with its
+ * TableImpl::version. So the cache is invalidated when a key is added to or
+ * removed from one of the tables or when one of the metatables is replaced.
+ *
+ * The cache points directly to the entry in the hash part of the table. The
+ * entries only move when a key is added or removed (see HashPart) and that
+ * changes the version. So the pointer stays valid as long as the version
+ * matches.
+ *
+ * Lookups that end in an `__index` function or in `nil` are not cached.
+ */
+class FieldCache {
+public:
+    /**
+     * The maximum number of `__index` tables that are followed.
+     */
+    static constexpr std::size_t MAX_DEPTH = 4;
+
+private:
+    struct Level {
+        const TableImpl* table = nullptr;
+        std::uint64_t version = 0;
+        /**
+         * The entry of the field in `table` or `nullptr` if there is no entry.
+         *
+         * For all but the last level the entry is either missing or `nil`.
+         */
+        Value* entry = nullptr;
+
+        // only set if this is not the last level
+        const TableImpl* metatable = nullptr;
+        std::uint64_t metatable_version = 0;
+        const Value* index_entry = nullptr;
+    };
+
+    std::array<Level, MAX_DEPTH + 1> levels;
+    std::size_t depth = 0;
+
+public:
+    /**
+     * Returns the cached entry of the field if the cache is still valid and
+     * the field has a (non nil) value. Otherwise returns `nullptr`.
+     *
+     * The entry might be found in an `__index` table. So only use it for
+     * writing if FieldCache::is_own_entry returns true.
+     */
+    [[nodiscard]] auto find(const Table& table) const -> Value*;
+
+    /**
+     * Looks up the field like `mt::index` and caches where it was found.
+     *
+     * Returns `nullptr` (and clears the cache) if the lookup can't be cached.
+     * Then the caller has to fall back to `mt::index`.
+     */
+    auto update(const Table& table, const Value& key) -> Value*;
+
+    /**
+     * Returns true if the cached entry is in the table itself (and not in an
+     * `__index` table).
+     */
+    [[nodiscard]] auto is_own_entry() const -> bool { return this->depth == 1; }
+};
+
+} // namespace minilua::details
+
+#endif
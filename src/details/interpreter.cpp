@@ -6,6 +6,9 @@
 #include "MiniLua/metatables.hpp"
 #include "MiniLua/stdlib.hpp"
 #include "ast.hpp"
+#include "gc.hpp"
+#include "native_stack.hpp"
+#include "string_table.hpp"
 #include "tree_sitter/tree_sitter.hpp"
 
 #include <algorithm>
@@ -53,7 +56,15 @@ void EvalResult::combine(const EvalResult& other) {
     this->values = other.values;
     this->do_break = other.do_break;
     this->do_return = other.do_return;
-    this->source_change = combine_source_changes(this->source_change, other.source_change);
+    this->tail_call = other.tail_call;
+    append_source_change(this->source_change, other.source_change);
+}
+void EvalResult::combine(EvalResult&& other) {
+    this->values = std::move(other.values);
+    this->do_break = other.do_break;
+    this->do_return = other.do_return;
+    this->tail_call = std::move(other.tail_call);
+    append_source_change(this->source_change, std::move(other.source_change));
 }
 
 EvalResult::operator minilua::EvalResult() const {
@@ -77,13 +88,141 @@ auto operator<<(std::ostream& o, const EvalResult& self) -> std::ostream& {
     return o << "}";
 }
 
+auto raw_index(const Value& table, const Value& key) -> std::optional<Value> {
+    const auto* raw_table = std::get_if<Table>(&table.raw());
+    if (raw_table == nullptr) {
+        return std::nullopt;
+    }
+
+    auto value = raw_table->get(key);
+    if (value.is_nil() && raw_table->get_metatable()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+auto raw_newindex(const Value& table, const Value& key, const Value& value) -> bool {
+    const auto* raw_table = std::get_if<Table>(&table.raw());
+    if (raw_table == nullptr || (raw_table->get_metatable() && raw_table->get(key).is_nil())) {
+        return false;
+    }
+
+    // NOTE: tables are references, so the copy modifies the same table
+    Table target = *raw_table;
+    target.set(key, value);
+    return true;
+}
+
 // class Interpreter
-Interpreter::Interpreter(const InterpreterConfig& config, ts::Parser& parser)
-    : config(config), parser(parser) {}
+Interpreter::Interpreter(const InterpreterConfig& config, ts::Parser& parser, Profile* profile)
+    : config(config), parser(parser), profile(profile) {}
+
+// class Interpreter::CallDepth
+Interpreter::CallDepth::CallDepth(Interpreter& interpreter)
+    : call_depth(interpreter.call_depth) {
+    const auto max_call_depth = interpreter.config.max_call_depth;
+    if ((max_call_depth != 0 && this->call_depth >= max_call_depth) ||
+        remaining_native_stack() < NATIVE_STACK_RESERVE) {
+        throw InterpreterException("stack overflow");
+    }
+    this->call_depth++;
+}
+
+// class Interpreter::NativeCall
+Interpreter::NativeCall::NativeCall(Interpreter& interpreter, bool native)
+    : interpreter(interpreter), num_roots(interpreter.native_roots.size()),
+      was_native(interpreter.in_native_call), native(native) {
+    if (this->native) {
+        this->interpreter.in_native_call = true;
+    }
+}
+
+Interpreter::NativeCall::~NativeCall() {
+    if (this->native) {
+        this->interpreter.native_roots.resize(this->num_roots);
+        this->interpreter.in_native_call = this->was_native;
+    }
+}
+
+// only tables and functions (which capture tables) have to be kept alive
+static void add_native_roots(std::vector<Value>& roots, const Vallist& values) {
+    for (const auto& value : values) {
+        if (value.is_table() || value.is_function()) {
+            roots.push_back(value);
+        }
+    }
+}
+
+// class Interpreter::LuaCall
+Interpreter::LuaCall::LuaCall(Interpreter& interpreter, const Vallist& arguments)
+    : interpreter(interpreter), num_roots(interpreter.native_roots.size()),
+      from_native(interpreter.in_native_call) {
+    if (this->from_native) {
+        add_native_roots(this->interpreter.native_roots, arguments);
+    }
+    this->interpreter.in_native_call = false;
+}
+
+Interpreter::LuaCall::~LuaCall() {
+    this->interpreter.native_roots.resize(this->num_roots);
+    this->interpreter.in_native_call = this->from_native;
+}
+
+void Interpreter::LuaCall::keep_results(const Vallist& results) {
+    if (this->from_native) {
+        this->interpreter.native_roots.resize(this->num_roots);
+        add_native_roots(this->interpreter.native_roots, results);
+        this->num_roots = this->interpreter.native_roots.size();
+    }
+}
+
+// class Interpreter::TailCalls
+Interpreter::TailCalls::TailCalls(Interpreter& interpreter) : interpreter(interpreter) {}
+
+auto Interpreter::TailCalls::needs_call_info(const Interpreter& interpreter) -> bool {
+    return interpreter.config.trace_calls || interpreter.profiler != nullptr;
+}
+
+void Interpreter::TailCalls::enter(const TailCall& tail_call) {
+    if (this->interpreter.profiler != nullptr) {
+        // the tail call replaces the frame of the previous one
+        this->profiler_call.reset();
+        this->profiler_call.emplace(
+            this->interpreter.profiler.get(), tail_call.location,
+            [&tail_call]() { return tail_call.name; });
+    }
+    if (this->interpreter.config.trace_calls) {
+        this->names.push_back(tail_call.name);
+    }
+}
+
+void Interpreter::TailCalls::trace_results(const CallResult& result) const {
+    // the last tail call returned first
+    for (auto name = this->names.rbegin(); name != this->names.rend(); ++name) {
+        this->interpreter.trace_function_call_result(*name, result);
+    }
+}
 
 auto Interpreter::run(const ts::Tree& tree, Env& user_env) -> EvalResult {
+    OriginTrackingScope origin_tracking(this->config.origin_tracking);
+    StringTableScope string_table(user_env.allocator());
+
+    auto first_table = user_env.allocator()->num_objects();
+
     Env env = this->setup_environment(user_env);
 
+    // NOTE the garbage collector is only enabled now because the stdlib
+    // snapshot might have been created in setup_environment
+    this->gc_user_env = &user_env;
+    this->gc_first_table = first_table;
+    this->gc_next_collection = env.allocator()->num_objects() + this->config.gc_threshold;
+
+    if (this->profile != nullptr &&
+        (this->config.profile_interval != 0 || this->config.profile_period.count() != 0)) {
+        this->profiler = std::make_unique<Profiler>(
+            *this->profile, this->config.profile_interval, this->config.profile_period);
+    }
+
     // execute the actual program
     std::shared_ptr<std::string> root_filename = std::make_shared<std::string>("__root__");
     env.set_file(root_filename);
@@ -105,8 +244,7 @@ auto Interpreter::run(const ts::Tree& tree, Env& user_env) -> EvalResult {
             }
         }
 
-        // NOTE: This will not free the tables it only calls all __gc metamethods.
-        this->cleanup_environment(env);
+        this->cleanup_environment(env, result.values);
 
         return result;
     } catch (const std::runtime_error& e) {
@@ -120,11 +258,18 @@ auto Interpreter::run(const ts::Tree& tree, Env& user_env) -> EvalResult {
 
 auto Interpreter::setup_environment(Env& user_env) -> Env {
     Env env(user_env.allocator());
+    // NOTE the functions of the stdlib capture the environment so the state
+    // has to be set before loading them
+    env.set_stdlib_state(user_env.stdlib_state());
 
-    // load the C++ part of the stdlib
-    add_stdlib(env.global());
-    // run the Lua part of the stdlib
-    this->execute_stdlib(env);
+    if (this->config.engine == Engine::BYTECODE) {
+        this->load_stdlib_snapshot(env);
+    } else {
+        // load the C++ part of the stdlib
+        add_stdlib(env.global());
+        // run the Lua part of the stdlib
+        this->execute_stdlib(env);
+    }
 
     // apply user overwrites
     // NOTE we only consider global variables because the user can only set
@@ -146,13 +291,46 @@ auto Interpreter::setup_environment(Env& user_env) -> Env {
     return env;
 }
 
-void Interpreter::execute_stdlib(Env& env) {
-    // NOTE The tree is static so it is only initialized once
-    static const ts::Tree stdlib_tree = this->load_stdlib();
+auto Interpreter::shared_stdlib_tree() -> const ts::Tree& {
+    // NOTE The tree is static so it is only parsed once (see
+    // Interpreter::execute_stdlib for using it from multiple threads)
+    static const ts::Tree tree = this->load_stdlib();
+    return tree;
+}
+
+auto Interpreter::stdlib_proto(bool fold_constants) -> const bytecode::Proto& {
+    // NOTE The bytecode is static so it is only compiled once. The protos
+    // don't change while executing (the inline caches are stored in the
+    // interpreter) so all threads can share them.
+    //
+    // The stdlib is compiled once with and once without folded constants
+    // because folded operators can't be traced (see Interpreter::run_file).
+    auto compile = [this](bool fold_constants) {
+        // the constants are shared by all runs so they must not be interned
+        StringTableScope no_interning(nullptr);
+        return bytecode::compile(
+            ast::Program(this->shared_stdlib_tree().root_node()),
+            bytecode::CompileOptions{.fold_constants = fold_constants});
+    };
+    if (fold_constants) {
+        static const std::shared_ptr<const bytecode::Proto> proto = compile(true);
+        return *proto;
+    }
+    static const std::shared_ptr<const bytecode::Proto> proto = compile(false);
+    return *proto;
+}
 
+void Interpreter::execute_stdlib(Env& env) {
     try {
         env.set_file(std::nullopt);
-        this->run_file(stdlib_tree, env);
+        if (this->config.engine == Engine::BYTECODE) {
+            this->execute(this->stdlib_proto(!this->config.trace_metamethod_calls), env);
+        } else {
+            // tree-sitter trees can't be used by multiple threads at the same
+            // time so every run uses its own (shallow) copy
+            this->stdlib_tree.emplace(this->shared_stdlib_tree());
+            this->run_file(*this->stdlib_tree, env);
+        }
     } catch (const std::exception& e) {
         // This should never actually throw an exception
         throw InterpreterException(
@@ -160,9 +338,119 @@ void Interpreter::execute_stdlib(Env& env) {
     }
 }
 
+auto Interpreter::create_stdlib_snapshot(ts::Parser& parser, bool fold_constants)
+    -> StdlibSnapshot {
+    // The snapshot is shared by all runs so it is created with the default
+    // config instead of the config of the run that happens to need it first.
+    // Only the compile options (see Interpreter::stdlib_proto) depend on the
+    // config of the run. So loading the stdlib is never traced and the
+    // snapshot contains all origins (i.e. OriginTracking::FULL).
+    const InterpreterConfig config;
+    Interpreter interpreter(config, parser);
+
+    // its strings must not be interned in the string table of one run
+    OriginTrackingScope origin_tracking(OriginTracking::FULL);
+    StringTableScope no_interning(nullptr);
+
+    auto allocator = std::make_unique<MemoryAllocator>();
+    std::unordered_map<Value, std::shared_ptr<const bytecode::Proto>> functions;
+
+    Env env(allocator.get());
+    add_stdlib(env.global());
+
+    interpreter.defined_functions = &functions;
+    try {
+        interpreter.execute(interpreter.stdlib_proto(fold_constants), env);
+    } catch (const std::exception& e) {
+        // This should never actually throw an exception
+        throw InterpreterException(
+            std::string("THIS IS A BUG! Failed to execute the stdlib file: ") + e.what());
+    }
+    interpreter.defined_functions = nullptr;
+
+    // The functions are recreated in the global environment when the snapshot
+    // is copied. So they can't capture local variables.
+    for (const auto& [function, proto] : functions) {
+        if (!proto->upvalues.empty()) {
+            throw InterpreterException(
+                "THIS IS A BUG! The functions in the stdlib file can't capture local variables");
+        }
+    }
+
+    return StdlibSnapshot{
+        .allocator = std::move(allocator),
+        .global = env.global(),
+        .functions = std::move(functions),
+    };
+}
+
+void Interpreter::load_stdlib_snapshot(Env& env) {
+    // NOTE The snapshots are static so they are only created once. They are
+    // never changed after they were created so all threads can copy them at
+    // the same time.
+    auto get_snapshot = [this]() -> const StdlibSnapshot& {
+        if (this->config.trace_metamethod_calls) {
+            static const StdlibSnapshot snapshot = create_stdlib_snapshot(this->parser, false);
+            return snapshot;
+        }
+        static const StdlibSnapshot snapshot = create_stdlib_snapshot(this->parser, true);
+        return snapshot;
+    };
+    const StdlibSnapshot& snapshot = get_snapshot();
+
+    // the functions defined in stdlib.lua capture the environment
+    // (they get a copy of the empty environment with the new global table)
+    const Env function_env = env;
+
+    // maps the tables in the snapshot to their copies (for shared and cyclic tables)
+    std::unordered_map<Value, Table> copies;
+    copies.emplace(snapshot.global, env.global());
+
+    std::function<Value(const Value&)> copy_value;
+    auto copy_table = [&](const Table& table, Table& target) {
+        for (const auto& [key, value] : table) {
+            target.set(copy_value(key), copy_value(value));
+        }
+        auto metatable = table.get_metatable();
+        if (metatable) {
+            target.set_metatable(std::get<Table>(copy_value(*metatable).raw()));
+        }
+    };
+    copy_value = [&](const Value& value) -> Value {
+        if (value.is_table()) {
+            auto copy = copies.find(value);
+            if (copy != copies.end()) {
+                return copy->second;
+            }
+
+            // NOTE use the same allocator as add_stdlib
+            Table target(env.global().allocator());
+            copies.emplace(value, target);
+            copy_table(std::get<Table>(value.raw()), target);
+            return target;
+        }
+        if (value.is_function()) {
+            auto function = snapshot.functions.find(value);
+            if (function != snapshot.functions.end()) {
+                return Function(BytecodeFunction{
+                    .proto = function->second,
+                    .env = function_env,
+                    .upvalues = {},
+                    .interpreter = *this,
+                });
+            }
+        }
+
+        // native functions and all other values don't depend on the environment
+        return value;
+    };
+
+    copy_table(snapshot.global, env.global());
+}
+
 auto Interpreter::load_stdlib() -> ts::Tree {
-    // NOTE this method should only be called once when the stdlib_tree in
-    // Interpreter::execute_stdlib is initialized
+    // NOTE this method should only be called once when the tree in
+    // Interpreter::shared_stdlib_tree is initialized
 
     // load the Lua part of the stdlib
     // NOTE the result of executing the stdlib file will be ignored
@@ -192,19 +480,88 @@ auto Interpreter::load_stdlib() -> ts::Tree {
     }
 }
 
-void Interpreter::cleanup_environment(Env& env) {
-    for (auto* table_impl : env.allocator()->get_all()) {
-        Environment environment(env);
-        CallContext ctx(&environment);
+void Interpreter::collect_garbage(Env& env, const Vallist& roots) {
+    if (this->gc_user_env == nullptr) {
+        return;
+    }
+
+    auto* allocator = this->gc_user_env->allocator();
+
+    std::vector<Table> finalize;
+    {
+        GarbageCollector gc(*allocator, this->gc_first_table);
+        for (const Frame* frame : this->frames) {
+            gc.mark(frame->registers);
+            gc.mark(frame->multi);
+            gc.mark(frame->result);
+            gc.mark(frame->upvalues);
+            gc.mark(frame->env);
+        }
+        gc.mark(this->native_roots);
+        gc.mark(*this->gc_user_env);
+        gc.mark(roots);
+
+        finalize = gc.collect();
+
+        // only the surviving tables are left so the next collection happens
+        // when the heap grew by at least the threshold (or doubled)
+        auto num_alive = allocator->num_objects();
+        this->gc_next_collection = num_alive + std::max(this->config.gc_threshold, num_alive);
+    }
+
+    // the tables in `finalize` are not reachable anymore so we have to
+    // prevent collecting them while calling the metamethods
+    NativeCall native_call(*this);
+    this->native_roots.insert(this->native_roots.end(), finalize.begin(), finalize.end());
+    for (const auto& table : finalize) {
+        BorrowedContext ctx(env);
+        mt::gc(ctx.make_new({table}));
+    }
+}
+
+void Interpreter::step_garbage_collector(Env& env) {
+    if (this->gc_user_env == nullptr || this->config.gc_threshold == 0 ||
+        env.allocator()->num_objects() < this->gc_next_collection) {
+        return;
+    }
+    this->collect_garbage(env);
+}
+
+void Interpreter::cleanup_environment(Env& env, const Vallist& results) {
+    // like closing a lua state: call the `__gc` metamethods of all tables
+    // that were created in this run
+    // NOTE the metamethods might allocate new tables
+    auto* allocator = env.allocator();
+    for (std::size_t i = this->gc_first_table; i < allocator->num_objects(); ++i) {
+        TableImpl* table_impl = allocator->get_all()[i];
+        if (table_impl->finalized) {
+            continue;
+        }
+        table_impl->finalized = true;
+
+        BorrowedContext ctx(env);
 
-        Table table(table_impl, env.allocator());
+        Table table(table_impl, allocator);
 
         mt::gc(ctx.make_new({table}));
     }
+
+    // free everything that is not reachable by the user anymore
+    this->collect_garbage(env, results);
 }
 
 auto Interpreter::run_file(const ts::Tree& tree, Env& env) -> EvalResult {
     try {
+        if (this->config.engine == Engine::BYTECODE) {
+            // NOTE folded operators can't be traced
+            auto proto = bytecode::compile(
+                ast::Program(tree.root_node()),
+                bytecode::CompileOptions{
+                    .file = env.get_file(),
+                    .fold_constants = !this->config.trace_metamethod_calls,
+                });
+            return this->execute(*proto, env);
+        }
         return this->visit_root(ast::Program(tree.root_node()), env);
     } catch (const InterpreterException&) {
         throw;
@@ -214,33 +571,30 @@ auto Interpreter::run_file(const ts::Tree& tree, Env& env) -> EvalResult {
 }
 
 auto Interpreter::tracer() const -> std::ostream& { return *this->config.target; }
-void Interpreter::trace_enter_node(
-    std::string ast_class, std::optional<std::string> method_name) const {
+void Interpreter::trace_enter_node(const std::string& ast_class, const char* method_name) const {
     if (this->config.trace_nodes) {
         this->tracer() << "Enter node: " << ast_class;
-        if (method_name) {
-            this->tracer() << " (method: " << method_name.value() << ")";
+        if (method_name != nullptr) {
+            this->tracer() << " (method: " << method_name << ")";
         }
         this->tracer() << "\n";
     }
 }
 void Interpreter::trace_exit_node(
-    std::string ast_class, std::optional<std::string> method_name,
-    std::optional<std::string> reason) const {
+    const std::string& ast_class, const char* method_name, const char* reason) const {
     if (this->config.trace_nodes) {
         this->tracer() << "Exit node: " << ast_class;
-        if (method_name) {
-            this->tracer() << " (method: " << method_name.value() << ")";
+        if (method_name != nullptr) {
+            this->tracer() << " (method: " << method_name << ")";
         }
-        if (reason) {
-            this->tracer() << " reason: " << reason.value();
+        if (reason != nullptr) {
+            this->tracer() << " reason: " << reason;
         }
         this->tracer() << "\n";
     }
 }
 void Interpreter::trace_function_call(
-    ast::Prefix prefix, const std::vector<Value>& arguments) const {
-    auto function_name = std::string(prefix.to_string());
+    const std::string& function_name, const std::vector<Value>& arguments) const {
     if (this->config.trace_calls) {
         this->tracer() << "Calling function: " << function_name << " with arguments (";
         for (const auto& arg : arguments) {
@@ -249,9 +603,9 @@ void Interpreter::trace_function_call(
         this->tracer() << ")\n";
     }
 }
-void Interpreter::trace_function_call_result(ast::Prefix prefix, const CallResult& result) const {
+void Interpreter::trace_function_call_result(
+    const std::string& function_name, const CallResult& result) const {
     if (this->config.trace_calls) {
-        auto function_name = std::string(prefix.to_string());
         this->tracer() << "Function call to: " << function_name << " resulted in "
                        << result.values();
         if (result.source_change().has_value()) {
@@ -295,13 +649,10 @@ void Interpreter::trace_enter_block(Env& env) {
 }
 
 // class Interpreter::NodeTracer
-Interpreter::NodeTracer::NodeTracer(
-    Interpreter* interpreter, std::string ast_class, std::optional<std::string> method_name)
-    : interpreter(*interpreter), ast_class(ast_class), method_name(std::move(method_name)) {
-    this->interpreter.trace_enter_node(this->ast_class, this->method_name);
-}
 Interpreter::NodeTracer::~NodeTracer() {
-    this->interpreter.trace_exit_node(this->ast_class, this->method_name);
+    if (this->ast_class) {
+        this->interpreter.trace_exit_node(*this->ast_class, this->method_name);
+    }
 }
 
 // helper functions
@@ -314,7 +665,7 @@ static auto convert_range(ts::Range range) -> Range {
 
 // interpreter implementation
 auto Interpreter::visit_root(ast::Program program, Env& env) -> EvalResult {
-    auto _ = NodeTracer(this, program.debug_print(), "visit_root");
+    auto _ = NodeTracer(this, program, "visit_root");
 
     EvalResult result;
 
@@ -322,7 +673,7 @@ auto Interpreter::visit_root(ast::Program program, Env& env) -> EvalResult {
 
     for (auto child : body.statements()) {
         EvalResult sub_result = this->visit_statement(child, env);
-        result.combine(sub_result);
+        result.combine(std::move(sub_result));
     }
 
     if (body.return_statement()) {
@@ -333,7 +684,7 @@ auto Interpreter::visit_root(ast::Program program, Env& env) -> EvalResult {
 }
 
 auto Interpreter::visit_statement(ast::Statement statement, Env& env) -> EvalResult {
-    auto _ = NodeTracer(this, statement.debug_print(), "visit_statement");
+    auto _ = NodeTracer(this, statement, "visit_statement");
 
     auto result = std::visit(
         overloaded{
@@ -375,7 +726,7 @@ auto Interpreter::visit_statement(ast::Statement statement, Env& env) -> EvalRes
 }
 
 auto Interpreter::visit_do_statement(ast::DoStatement do_stmt, Env& env) -> EvalResult {
-    auto _ = NodeTracer(this, do_stmt.debug_print(), "visit_do_statement");
+    auto _ = NodeTracer(this, do_stmt, "visit_do_statement");
 
     return this->visit_block(do_stmt.body(), env);
 }
@@ -391,7 +742,7 @@ auto Interpreter::visit_block_with_local_env(ast::Body block, Env& block_env) ->
 
     for (auto stmt : block.statements()) {
         auto sub_result = this->visit_statement(stmt, block_env);
-        result.combine(sub_result);
+        result.combine(std::move(sub_result));
 
         if (result.do_break) {
             return result;
@@ -404,14 +755,14 @@ auto Interpreter::visit_block_with_local_env(ast::Body block, Env& block_env) ->
     auto return_stmt = block.return_statement();
     if (return_stmt) {
         auto sub_result = this->visit_return_statement(return_stmt.value(), block_env);
-        result.combine(sub_result);
+        result.combine(std::move(sub_result));
     }
 
     return result;
 }
 
 auto Interpreter::visit_if_statement(ast::IfStatement if_stmt, Env& env) -> EvalResult {
-    auto _ = NodeTracer(this, if_stmt.debug_print(), "visit_if_statement");
+    auto _ = NodeTracer(this, if_stmt, "visit_if_statement");
 
     EvalResult result;
 
@@ -425,7 +776,7 @@ auto Interpreter::visit_if_statement(ast::IfStatement if_stmt, Env& env) -> Eval
         // "then" block
         if (condition_result.values.get(0)) {
             auto body_result = this->visit_block(if_stmt.body(), env);
-            result.combine(body_result);
+            result.combine(std::move(body_result));
 
             return result;
         }
@@ -440,7 +791,7 @@ auto Interpreter::visit_if_statement(ast::IfStatement if_stmt, Env& env) -> Eval
         // "else if" block
         if (condition_result.values.get(0)) {
             auto body_result = this->visit_block(elseif_stmt.body(), env);
-            result.combine(body_result);
+            result.combine(std::move(body_result));
 
             return result;
         }
@@ -450,14 +801,14 @@ auto Interpreter::visit_if_statement(ast::IfStatement if_stmt, Env& env) -> Eval
     auto else_stmt = if_stmt.else_statement();
     if (else_stmt) {
         auto body_result = this->visit_block(else_stmt->body(), env);
-        result.combine(body_result);
+        result.combine(std::move(body_result));
     }
 
     return result;
 }
 
 auto Interpreter::visit_while_statement(ast::WhileStatement while_stmt, Env& env) -> EvalResult {
-    auto _ = NodeTracer(this, while_stmt.debug_print(), "visit_while_statement");
+    auto _ = NodeTracer(this, while_stmt, "visit_while_statement");
 
     EvalResult result;
 
@@ -473,7 +824,7 @@ auto Interpreter::visit_while_statement(ast::WhileStatement while_stmt, Env& env
         }
 
         auto block_result = this->visit_block(while_stmt.body(), env);
-        result.combine(block_result);
+        result.combine(std::move(block_result));
 
         if (result.do_break) {
             result.do_break = false;
@@ -489,7 +840,7 @@ auto Interpreter::visit_while_statement(ast::WhileStatement while_stmt, Env& env
 
 auto Interpreter::visit_repeat_until_statement(ast::RepeatStatement repeat_stmt, Env& env)
     -> EvalResult {
-    auto _ = NodeTracer(this, repeat_stmt.debug_print(), "visit_repeat_until_statement");
+    auto _ = NodeTracer(this, repeat_stmt, "visit_repeat_until_statement");
 
     EvalResult result;
 
@@ -500,7 +851,7 @@ auto Interpreter::visit_repeat_until_statement(ast::RepeatStatement repeat_stmt,
         Env block_env = Env(env);
 
         auto block_result = this->visit_block_with_local_env(body, block_env);
-        result.combine(block_result);
+        result.combine(std::move(block_result));
 
         if (result.do_break) {
             result.do_break = false;
@@ -563,10 +914,36 @@ auto Interpreter::visit_expression_list(std::vector<ast::Expression> expressions
     return result;
 }
 
+// `return f(args)` (but not `return (f(args))`)
+static auto as_function_call(const ast::Expression& expr) -> std::optional<ast::FunctionCall> {
+    const auto expr_options = expr.options();
+    const auto* prefix = std::get_if<ast::Prefix>(&expr_options);
+    if (prefix == nullptr) {
+        return std::nullopt;
+    }
+    auto prefix_options = prefix->options();
+    if (auto* call = std::get_if<ast::FunctionCall>(&prefix_options)) {
+        return std::move(*call);
+    }
+    return std::nullopt;
+}
+
 auto Interpreter::visit_return_statement(ast::Return return_stmt, Env& env) -> EvalResult {
-    auto _ = NodeTracer(this, return_stmt.debug_print(), "visit_return_statement");
+    auto _ = NodeTracer(this, return_stmt, "visit_return_statement");
+
+    auto expressions = return_stmt.exp_list();
 
-    auto result = this->visit_expression_list(return_stmt.exp_list(), env);
+    // `return f(args)` in a function is a tail call (the main chunk only runs
+    // while no function is running)
+    if (this->call_depth > 0 && expressions.size() == 1) {
+        if (auto call = as_function_call(expressions.front())) {
+            auto result = this->visit_function_call(*call, env, true);
+            result.do_return = true;
+            return result;
+        }
+    }
+
+    auto result = this->visit_expression_list(expressions, env);
     result.do_return = true;
 
     return result;
@@ -574,7 +951,7 @@ auto Interpreter::visit_return_statement(ast::Return return_stmt, Env& env) -> E
 
 auto Interpreter::visit_variable_declaration(ast::VariableDeclaration decl, Env& env)
     -> EvalResult {
-    auto _ = NodeTracer(this, decl.debug_print(), "visit_variable_declaration");
+    auto _ = NodeTracer(this, decl, "visit_variable_declaration");
 
     EvalResult result = this->visit_expression_list(decl.declarations(), env);
     const auto vallist = result.values;
@@ -621,8 +998,11 @@ auto Interpreter::visit_variable_declaration(ast::VariableDeclaration decl, Env&
                         result.combine(index_result);
                         auto index = index_result.values.get(0);
 
-                        Environment environment(env);
-                        CallContext ctx(&environment);
+                        if (raw_newindex(table, index, value)) {
+                            return;
+                        }
+
+                        BorrowedContext ctx(env);
 
                         auto newindex_call_result =
                             mt::newindex(ctx.make_new({table, index, value}));
@@ -637,8 +1017,11 @@ auto Interpreter::visit_variable_declaration(ast::VariableDeclaration decl, Env&
                         // get the property identifier (i.e. the part after the dot)
                         auto index = field_expr.property_id().string();
 
-                        Environment environment(env);
-                        CallContext ctx(&environment);
+                        if (raw_newindex(table, index, value)) {
+                            return;
+                        }
+
+                        BorrowedContext ctx(env);
 
                         auto newindex_call_result =
                             mt::newindex(ctx.make_new({table, index, value}));
@@ -652,12 +1035,12 @@ auto Interpreter::visit_variable_declaration(ast::VariableDeclaration decl, Env&
 }
 
 auto Interpreter::visit_identifier(ast::Identifier ident, Env& env) -> std::string {
-    auto _ = NodeTracer(this, ident.debug_print(), "visit_identifier");
+    auto _ = NodeTracer(this, ident, "visit_identifier");
     return ident.string();
 }
 
 auto Interpreter::visit_expression(ast::Expression expr, Env& env) -> EvalResult {
-    auto _ = NodeTracer(this, expr.debug_print(), "visit_expression");
+    auto _ = NodeTracer(this, expr, "visit_expression");
 
     EvalResult result = std::visit(
         overloaded{
@@ -691,6 +1074,10 @@ auto Interpreter::visit_expression(ast::Expression expr, Env& env) -> EvalResult
 auto Interpreter::visit_literal(ast::Literal literal, Env& env) -> EvalResult {
     EvalResult result;
 
+    auto origin = LiteralOrigin{.location = literal.range()};
+    origin.location.file = env.get_file();
+    bool track_origin = this->config.origin_tracking != OriginTracking::OFF;
+
     Value value;
     switch (literal.type()) {
     case ast::LiteralType::TRUE:
@@ -703,16 +1090,25 @@ auto Interpreter::visit_literal(ast::Literal literal, Env& env) -> EvalResult {
         value = Value(Nil());
         break;
     case ast::LiteralType::NUMBER:
-        value = parse_number_literal(literal.content());
-        break;
-    case ast::LiteralType::STRING:
-        value = parse_string_literal(literal.content());
+    case ast::LiteralType::STRING: {
+        auto cached = this->literal_cache.find(origin.location);
+        // NOTE literals generated while desugaring reuse the range of the
+        // original node so we also have to compare the type
+        if (cached != this->literal_cache.end() && cached->second.first == literal.type()) {
+            value = cached->second.second;
+            break;
+        }
+
+        value = literal.type() == ast::LiteralType::NUMBER
+                    ? parse_number_literal(literal.content())
+                    : parse_string_literal(literal.content());
+        this->literal_cache.insert_or_assign(
+            origin.location, std::make_pair(literal.type(), value));
         break;
     }
+    }
 
-    auto origin = LiteralOrigin{.location = literal.range()};
-    origin.location.file = env.get_file();
-    result.values = Vallist(value.with_origin(origin));
+    result.values = Vallist(track_origin ? value.with_origin(origin) : value);
 
     return result;
 }
@@ -732,19 +1128,54 @@ auto Interpreter::visit_vararg_expression(Env& env) -> EvalResult {
 }
 
 auto FunctionImpl::operator()(const CallContext& ctx) -> CallResult {
+    Interpreter::CallDepth call_depth(this->interpreter);
+    Interpreter::TailCalls tail_calls(this->interpreter);
+
+    const FunctionImpl* function = this;
+    const Vallist* arguments = &ctx.arguments();
+    std::optional<SourceChangeTree> source_change;
+
+    // keeps the function and arguments of the current tail call alive
+    std::optional<TailCall> tail_call;
+
+    while (true) {
+        auto result = function->execute(*arguments);
+        append_source_change(source_change, std::move(result.source_change));
+
+        if (!result.tail_call) {
+            auto return_value = Vallist();
+            if (result.do_return) {
+                return_value = std::move(result.values);
+            }
+            auto call_result = CallResult(return_value, std::move(source_change));
+            tail_calls.trace_results(call_result);
+            return call_result;
+        }
+
+        tail_call = std::move(result.tail_call);
+        tail_calls.enter(*tail_call);
+        function = tail_call->function.target<FunctionImpl>();
+        arguments = &tail_call->arguments;
+    }
+}
+
+auto FunctionImpl::execute(const Vallist& arguments) const -> EvalResult {
     // setup parameters as local variables
+    // NOTE parameters are new variables and must not change captured variables
+    // with the same name
     auto env = Env(this->env);
     for (int i = 0; i < parameters.size(); ++i) {
-        env.set_local(parameters[i], ctx.arguments().get(i));
+        env.declare_local(parameters[i]);
+        env.set_local(parameters[i], arguments.get(i));
     }
 
     // add varargs to the environment
     if (vararg) {
         std::vector<Value> varargs;
-        if (parameters.size() < ctx.arguments().size()) {
-            varargs.reserve(ctx.arguments().size() - parameters.size());
+        if (parameters.size() < arguments.size()) {
+            varargs.reserve(arguments.size() - parameters.size());
             std::copy(
-                ctx.arguments().begin() + parameters.size(), ctx.arguments().end(),
+                arguments.begin() + parameters.size(), arguments.end(),
                 std::back_inserter(varargs));
         }
         env.set_varargs(varargs);
@@ -756,13 +1187,7 @@ auto FunctionImpl::operator()(const CallContext& ctx) -> CallResult {
     }
 
     // execute the actual function in the correct environment
-    auto result = interpreter.visit_block_with_local_env(body, env);
-
-    auto return_value = Vallist();
-    if (result.do_return) {
-        return_value = result.values;
-    }
-    return CallResult(return_value, result.source_change);
+    return interpreter.visit_block_with_local_env(body, env);
 }
 
 auto Interpreter::visit_parameter_list(std::vector<ast::Identifier> raw_params, Env& env)
@@ -778,7 +1203,7 @@ auto Interpreter::visit_parameter_list(std::vector<ast::Identifier> raw_params,
 
 auto Interpreter::visit_function_expression(ast::FunctionDefinition function_definition, Env& env)
     -> EvalResult {
-    auto _ = NodeTracer(this, function_definition.debug_print(), "visit_function_expression");
+    auto _ = NodeTracer(this, function_definition, "visit_function_expression");
 
     EvalResult result;
 
@@ -805,7 +1230,7 @@ auto Interpreter::visit_function_expression(ast::FunctionDefinition function_def
 }
 
 auto Interpreter::visit_table_index(ast::TableIndex table_index, Env& env) -> EvalResult {
-    auto _ = NodeTracer(this, table_index.debug_print(), "visit_table_index");
+    auto _ = NodeTracer(this, table_index, "visit_table_index");
 
     EvalResult result;
 
@@ -819,8 +1244,12 @@ auto Interpreter::visit_table_index(ast::TableIndex table_index, Env& env) -> Ev
     result.combine(index_result);
     auto index = index_result.values.get(0);
 
-    Environment environment(env);
-    CallContext ctx(&environment);
+    if (auto value = raw_index(table, index)) {
+        result.values = Vallist(*value);
+        return result;
+    }
+
+    BorrowedContext ctx(env);
 
     auto index_call_result = mt::index(ctx.make_new({table, index}));
     result.combine(EvalResult(index_call_result));
@@ -830,7 +1259,7 @@ auto Interpreter::visit_table_index(ast::TableIndex table_index, Env& env) -> Ev
 
 auto Interpreter::visit_field_expression(ast::FieldExpression field_expression, Env& env)
     -> EvalResult {
-    auto _ = NodeTracer(this, field_expression.debug_print(), "visit_field_expression");
+    auto _ = NodeTracer(this, field_expression, "visit_field_expression");
 
     EvalResult result;
 
@@ -841,8 +1270,12 @@ auto Interpreter::visit_field_expression(ast::FieldExpression field_expression,
 
     std::string key = this->visit_identifier(field_expression.property_id(), env);
 
-    Environment environment(env);
-    CallContext ctx(&environment);
+    if (auto value = raw_index(table, key)) {
+        result.values = Vallist(*value);
+        return result;
+    }
+
+    BorrowedContext ctx(env);
 
     auto index_call_result = mt::index(ctx.make_new({table, key}));
     result.combine(EvalResult(index_call_result));
@@ -851,7 +1284,7 @@ auto Interpreter::visit_field_expression(ast::FieldExpression field_expression,
 }
 
 auto Interpreter::visit_table_constructor(ast::Table table_constructor, Env& env) -> EvalResult {
-    auto _ = NodeTracer(this, table_constructor.debug_print(), "visit_table_constructor");
+    auto _ = NodeTracer(this, table_constructor, "visit_table_constructor");
 
     EvalResult result;
 
@@ -940,7 +1373,11 @@ auto Interpreter::visit_table_constructor(ast::Table table_constructor, Env& env
 }
 
 auto Interpreter::visit_binary_operation(ast::BinaryOperation bin_op, Env& env) -> EvalResult {
-    auto _ = NodeTracer(this, bin_op.debug_print(), "visit_binary_operation");
+    if (bin_op.binary_operator() == ast::BinOpEnum::CONCAT) {
+        return this->visit_concat(bin_op, env);
+    }
+
+    auto _ = NodeTracer(this, bin_op, "visit_binary_operation");
 
     EvalResult result;
 
@@ -949,11 +1386,11 @@ auto Interpreter::visit_binary_operation(ast::BinaryOperation bin_op, Env& env)
 
     auto lhs_result = this->visit_expression(bin_op.left(), env);
     auto lhs = lhs_result.values.get(0);
-    result.combine(lhs_result);
+    result.combine(std::move(lhs_result));
 
     auto rhs_result = this->visit_expression(bin_op.right(), env);
     auto rhs = rhs_result.values.get(0);
-    result.combine(rhs_result);
+    result.combine(std::move(rhs_result));
 
     // raw operators
     auto impl_operator = [&result, &origin](auto f, Value lhs, Value rhs) {
@@ -966,8 +1403,7 @@ auto Interpreter::visit_binary_operation(ast::BinaryOperation bin_op, Env& env)
         impl_operator(&Value::method, lhs, rhs);                                                   \
         break;
 
-    Environment environment(env);
-    CallContext ctx(&environment);
+    BorrowedContext ctx(env);
 
     // operators supporting metamethods
     auto impl_mt_operator = [this, &ctx, &result,
@@ -976,11 +1412,8 @@ auto Interpreter::visit_binary_operation(ast::BinaryOperation bin_op, Env& env)
         this->trace_metamethod_call(name, args);
 
         auto call_result = with_call_stack(
-            [&f, &ctx, &args, &origin]() { return f(ctx.make_new(args), origin); }, name,
-            StackItem{
-                .position = origin,
-                .info = "metamethod '" + name + "'",
-            });
+            [&f, &ctx, &args, &origin]() { return f(ctx.make_new(std::move(args)), origin); },
+            [&name, &origin]() { return describe_metamethod_call(name, origin); });
         result.combine(EvalResult(call_result.one_value()));
     };
 
@@ -989,17 +1422,26 @@ auto Interpreter::visit_binary_operation(ast::BinaryOperation bin_op, Env& env)
         impl_mt_operator(function, lhs, rhs, name);                                                \
         break;
 
+#define IMPL_NUMERIC_MT(op, function, name, method)                                                \
+    case ast::BinOpEnum::op:                                                                       \
+        if (this->is_plain_number_operation(lhs, rhs)) {                                           \
+            impl_operator(&Value::method, lhs, rhs);                                               \
+        } else {                                                                                   \
+            impl_mt_operator(function, lhs, rhs, name);                                            \
+        }                                                                                          \
+        break;
+
     switch (bin_op.binary_operator()) {
         // operators with metamethods
 
         // arithmetic
-        IMPL_MT(ADD, mt::add, "add")
-        IMPL_MT(SUB, mt::sub, "sub")
-        IMPL_MT(MUL, mt::mul, "mul")
-        IMPL_MT(DIV, mt::div, "div")
-        IMPL_MT(MOD, mt::mod, "mod")
-        IMPL_MT(POW, mt::pow, "pow")
-        IMPL_MT(INT_DIV, mt::idiv, "idiv")
+        IMPL_NUMERIC_MT(ADD, mt::add, "add", add)
+        IMPL_NUMERIC_MT(SUB, mt::sub, "sub", sub)
+        IMPL_NUMERIC_MT(MUL, mt::mul, "mul", mul)
+        IMPL_NUMERIC_MT(DIV, mt::div, "div", div)
+        IMPL_NUMERIC_MT(MOD, mt::mod, "mod", mod)
+        IMPL_NUMERIC_MT(POW, mt::pow, "pow", pow)
+        IMPL_NUMERIC_MT(INT_DIV, mt::idiv, "idiv", int_div)
 
         // bitwise
         IMPL_MT(BIT_AND, mt::band, "band")
@@ -1007,25 +1449,36 @@ auto Interpreter::visit_binary_operation(ast::BinaryOperation bin_op, Env& env)
         IMPL_MT(BIT_XOR, mt::bxor, "bxor")
         IMPL_MT(SHIFT_LEFT, mt::shl, "shl")
         IMPL_MT(SHIFT_RIGHT, mt::shr, "shr")
-        IMPL_MT(CONCAT, mt::concat, "concat")
 
         // comparison
-        IMPL_MT(EQ, mt::eq, "eq")
-        IMPL_MT(LT, mt::lt, "lt")
-        IMPL_MT(LEQ, mt::le, "le")
+        IMPL_NUMERIC_MT(EQ, mt::eq, "eq", equals)
+        IMPL_NUMERIC_MT(LT, mt::lt, "lt", less_than)
+        IMPL_NUMERIC_MT(LEQ, mt::le, "le", less_than_or_equal)
 
         // the following operators have to be converted to other metamethods
     case ast::BinOpEnum::GT:
         // gt: "x > y" == "y < x"
-        impl_mt_operator(mt::lt, rhs, lhs, "gt");
+        if (this->is_plain_number_operation(rhs, lhs)) {
+            impl_operator(&Value::less_than, rhs, lhs);
+        } else {
+            impl_mt_operator(mt::lt, rhs, lhs, "gt");
+        }
         break;
     case ast::BinOpEnum::GEQ:
         // geq: "x >= y" == "y <= x"
-        impl_mt_operator(mt::le, rhs, lhs, "geq");
+        if (this->is_plain_number_operation(rhs, lhs)) {
+            impl_operator(&Value::less_than_or_equal, rhs, lhs);
+        } else {
+            impl_mt_operator(mt::le, rhs, lhs, "geq");
+        }
         break;
     case ast::BinOpEnum::NEQ:
         // neq: "x ~= y" == "not (x == y)"
-        impl_mt_operator(mt::eq, lhs, rhs, "eq");
+        if (this->is_plain_number_operation(lhs, rhs)) {
+            impl_operator(&Value::equals, lhs, rhs);
+        } else {
+            impl_mt_operator(mt::eq, lhs, rhs, "eq");
+        }
         result.values = Vallist(result.values.get(0).invert());
         break;
 
@@ -1033,35 +1486,69 @@ auto Interpreter::visit_binary_operation(ast::BinaryOperation bin_op, Env& env)
         // TODO do short circuiting
         IMPL(OR, logic_or)
         IMPL(AND, logic_and)
+
+    case ast::BinOpEnum::CONCAT:
+        // see visit_concat
+        break;
     }
 
 #undef IMPL
 #undef IMPL_MT
+#undef IMPL_NUMERIC_MT
+
+    return result;
+}
+
+auto Interpreter::visit_concat(ast::BinaryOperation bin_op, Env& env) -> EvalResult {
+    auto _ = NodeTracer(this, bin_op, "visit_concat");
+
+    EvalResult result;
+
+    // the whole chain is evaluated at once: `..` is right associative so
+    // `a .. b .. c` is `a .. (b .. c)`
+    std::vector<Value> values;
+    std::vector<Range> locations;
+    while (true) {
+        auto lhs_result = this->visit_expression(bin_op.left(), env);
+        values.push_back(lhs_result.values.get(0));
+        result.combine(std::move(lhs_result));
+        locations.push_back(bin_op.range());
+
+        auto right = bin_op.right();
+        auto options = right.options();
+        const auto* next = std::get_if<ast::BinaryOperation>(&options);
+        if (next == nullptr || next->binary_operator() != ast::BinOpEnum::CONCAT) {
+            auto rhs_result = this->visit_expression(right, env);
+            values.push_back(rhs_result.values.get(0));
+            result.combine(std::move(rhs_result));
+            break;
+        }
+        bin_op = *next;
+    }
+
+    auto call_result = this->concat(values.data(), values.size(), locations.data(), env);
+    result.combine(EvalResult(call_result));
 
     return result;
 }
 
 auto Interpreter::visit_unary_operation(ast::UnaryOperation unary_op, Env& env) -> EvalResult {
-    auto _ = NodeTracer(this, unary_op.debug_print(), "visit_unary_operation");
+    auto _ = NodeTracer(this, unary_op, "visit_unary_operation");
 
     EvalResult result = this->visit_expression(unary_op.expression(), env);
 
     auto range = unary_op.range();
     range.file = env.get_file();
 
-    Environment environment(env);
-    CallContext ctx(&environment);
+    BorrowedContext ctx(env);
 
     auto impl_mt_operator = [this, &ctx, &result, &range](auto f, const std::string& name) {
         auto args = Vallist{result.values.get(0)};
         this->trace_metamethod_call(name, args);
 
         auto call_result = with_call_stack(
-            [&f, &ctx, &args, &range]() { return f(ctx.make_new(args), range); }, name,
-            StackItem{
-                .position = range,
-                .info = "metamethod '" + name + "'",
-            });
+            [&f, &ctx, &args, &range]() { return f(ctx.make_new(std::move(args)), range); },
+            [&name, &range]() { return describe_metamethod_call(name, range); });
         result.combine(EvalResult(call_result.one_value()));
     };
 
@@ -1087,7 +1574,7 @@ auto Interpreter::visit_unary_operation(ast::UnaryOperation unary_op, Env& env)
 }
 
 auto Interpreter::visit_prefix(ast::Prefix prefix, Env& env) -> EvalResult {
-    auto _ = NodeTracer(this, prefix.debug_print(), "visit_prefix");
+    auto _ = NodeTracer(this, prefix, "visit_prefix");
 
     EvalResult result = std::visit(
         overloaded{
@@ -1119,8 +1606,9 @@ auto Interpreter::visit_prefix(ast::Prefix prefix, Env& env) -> EvalResult {
 
 static auto prefix_to_ident(const ast::Prefix& prefix) -> std::string { return prefix.to_string(); }
 
-auto Interpreter::visit_function_call(ast::FunctionCall call, Env& env) -> EvalResult {
-    auto _ = NodeTracer(this, call.debug_print(), "visit_function_call");
+auto Interpreter::visit_function_call(ast::FunctionCall call, Env& env, bool tail_call)
+    -> EvalResult {
+    auto _ = NodeTracer(this, call, "visit_function_call");
 
     EvalResult result;
 
@@ -1128,40 +1616,49 @@ auto Interpreter::visit_function_call(ast::FunctionCall call, Env& env) -> EvalR
     result.combine(function_obj_result);
 
     EvalResult exprlist_result = this->visit_expression_list(call.args(), env);
-    auto arguments = exprlist_result.values;
+    auto arguments = std::move(exprlist_result.values);
 
-    this->trace_function_call(call.id(), std::vector<Value>(arguments.begin(), arguments.end()));
+    // the name is only needed for tracing, profiling and errors
+    auto function_name = [&call]() { return call.id().to_string(); };
+
+    if (this->config.trace_calls) {
+        this->trace_function_call(
+            function_name(), std::vector<Value>(arguments.begin(), arguments.end()));
+    }
 
     // call function
     // this will produce an error if the obj is not callable
     auto obj = function_obj_result.values.get(0);
 
-    // metamethod __call gets the called object as first argument
-    std::vector<Value> meta_arguments;
-    meta_arguments.reserve(arguments.size() + 1);
-    meta_arguments.push_back(obj);
-    std::move(arguments.begin(), arguments.end(), std::back_inserter(meta_arguments));
+    if (tail_call) {
+        const auto* function = std::get_if<Function>(&obj.raw());
+        if (function != nullptr && function->target<FunctionImpl>() != nullptr) {
+            // FunctionImpl executes the function after the current one returned
+            result.values = Vallist();
+            result.tail_call = TailCall{.function = *function, .arguments = std::move(arguments)};
+            if (TailCalls::needs_call_info(*this)) {
+                result.tail_call->name = function_name();
+                result.tail_call->location = call.range().with_file(env.get_file());
+            }
+            return result;
+        }
+    }
 
     auto call_range = call.range().with_file(env.get_file());
 
-    // move the Env to the CallContext (and move it back later)
-    auto environment = Environment(env);
-    auto ctx = CallContext(&environment).make_new(meta_arguments, call_range);
-
-    auto function_name = call.id().to_string();
-
-    auto call_result = with_call_stack(
-        [&ctx]() { return mt::call(ctx); }, function_name,
-        StackItem{
-            .position = call_range,
-            .info = "function '" + function_name + "'",
-        });
+    auto call_result = [&]() {
+        Profiler::Call profiler_call(this->profiler.get(), call_range, function_name);
+        return with_call_stack(
+            [&]() { return this->call_function(obj, std::move(arguments), call_range, env); },
+            [&function_name, &call_range]() {
+                return describe_function_call(function_name(), call_range);
+            });
+    }();
     result.combine(EvalResult(call_result));
 
-    this->trace_function_call_result(call.id(), call_result);
-
-    // move the Env back in case something has changed internally
-    env = environment.get_raw_impl().inner;
+    if (this->config.trace_calls) {
+        this->trace_function_call_result(function_name(), call_result);
+    }
 
     return result;
 }
@@ -5,8 +5,18 @@
 #include "MiniLua/environment.hpp"
 #include "MiniLua/interpreter.hpp"
 #include "ast.hpp"
+#include "bytecode.hpp"
+#include "inline_cache.hpp"
+#include "profiler.hpp"
 #include "tree_sitter/tree_sitter.hpp"
 
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 /**
  * @brief Users of the library should ignore this namespace. It is only usable internally.
  */
@@ -19,6 +29,59 @@ namespace minilua::details {
  */
 void add_stdlib(Table& table);
 
+/**
+ * Returns `table[key]` if no metamethod is involved. That is the case if the
+ * value is a table and the key is present or the table has no metatable.
+ *
+ * Otherwise returns `std::nullopt` and `mt::index` has to be used.
+ *
+ * This does not need a CallContext.
+ */
+auto raw_index(const Value& table, const Value& key) -> std::optional<Value>;
+
+/**
+ * Sets `table[key] = value` if no metamethod is involved (see `raw_index`).
+ *
+ * Returns false if nothing was set and `mt::newindex` has to be used.
+ */
+auto raw_newindex(const Value& table, const Value& key, const Value& value) -> bool;
+
+/**
+ * Describes the call of the function `name` for the stack trace (see the lazy
+ * overload of `with_call_stack`).
+ */
+inline auto describe_function_call(std::string name, const Range& location)
+    -> std::pair<std::string, StackItem> {
+    StackItem item{.position = location, .info = "function '" + name + "'"};
+    return {std::move(name), std::move(item)};
+}
+
+/**
+ * Describes the call of the metamethod `name` for the stack trace.
+ */
+inline auto describe_metamethod_call(const std::string& name, const Range& location)
+    -> std::pair<std::string, StackItem> {
+    return {name, StackItem{.position = location, .info = "metamethod '" + name + "'"}};
+}
+
+/**
+ * A call in tail position (`return f(args)`) that was not executed yet.
+ *
+ * Lua functions return it to their caller (see FunctionImpl and
+ * BytecodeFunction) which then executes the called function in a loop. So a
+ * chain of tail calls doesn't grow the native stack.
+ */
+struct TailCall {
+    Function function;
+    Vallist arguments;
+    /**
+     * The name and location of the call. Only set if calls are traced or
+     * profiled (see Interpreter::TailCalls).
+     */
+    std::string name;
+    Range location;
+};
+
 /**
  * Internal results of the interpreter.
  *
@@ -61,6 +124,12 @@ struct EvalResult {
      */
     std::optional<SourceChangeTree> source_change;
 
+    /**
+     * Set (together with `do_return`) if the function returns the results of
+     * a tail call. The values are empty in this case.
+     */
+    std::optional<TailCall> tail_call;
+
     EvalResult();
     explicit EvalResult(Vallist values);
     explicit EvalResult(const CallResult&);
@@ -71,6 +140,10 @@ struct EvalResult {
      * This will combine the source changes and override all other fields.
      */
     void combine(const EvalResult& other);
+    /**
+     * Same as above but moves the values and source changes out of `other`.
+     */
+    void combine(EvalResult&& other);
 
     // convertion operator
     operator minilua::EvalResult() const;
@@ -78,6 +151,66 @@ struct EvalResult {
 
 auto operator<<(std::ostream&, const EvalResult&) -> std::ostream&;
 
+/**
+ * A local variable that was captured by a closure (see bytecode::Proto::upvalues).
+ *
+ * While the variable is still in scope the upvalue is *open* and points to the
+ * register of the variable. When the variable goes out of scope the upvalue is
+ * *closed* and keeps its own copy of the value.
+ */
+struct Upvalue {
+    Value* value;
+    Value closed;
+
+    explicit Upvalue(Value* value) : value(value) {}
+    Upvalue(const Upvalue&) = delete;
+    auto operator=(const Upvalue&) -> Upvalue& = delete;
+
+    void close() {
+        this->closed = *this->value;
+        this->value = &this->closed;
+    }
+};
+
+using Upvalues = std::vector<std::shared_ptr<Upvalue>>;
+
+/**
+ * The state of a function that is currently executed by Interpreter::execute.
+ *
+ * The values of all running functions are roots for the garbage collector.
+ */
+struct Frame {
+    const std::vector<Value>& registers;
+    const Vallist& multi;
+    const Vallist& result;
+    const Upvalues& upvalues;
+    const Env& env;
+};
+
+/**
+ * The global variables after loading the stdlib.
+ *
+ * Loading the stdlib produces the same global variables for every run. So this
+ * is only created once per process and every run gets a copy of it (see
+ * Interpreter::setup_environment).
+ *
+ * It is always created with the default InterpreterConfig (e.g. with
+ * OriginTracking::FULL and without tracing) and not with the config of the
+ * run that uses it first. Only the compiled functions depend on the config so
+ * there is one snapshot with and one without folded constants.
+ */
+struct StdlibSnapshot {
+    std::unique_ptr<MemoryAllocator> allocator;
+    Table global;
+    /**
+     * The functions defined in `stdlib.lua`.
+     *
+     * They have to be recreated when copying the snapshot because they
+     * capture the environment they were defined in.
+     */
+    std::unordered_map<Value, std::shared_ptr<const bytecode::Proto>> functions;
+};
+
 /**
  * This is in a class so we can track some state. E.g. including lua files or
  * do some caching.
@@ -96,14 +229,90 @@ auto operator<<(std::ostream&, const EvalResult&) -> std::ostream&;
  *
  * Additionally there are some `trace_` methods to help in debugging and logging.
  * And NodeTracer to trace entering and exiting the `visit_` methods.
+ *
+ * By default (see InterpreterConfig::engine) the AST is not evaluated directly
+ * but first compiled to [bytecode](@ref minilua::details::bytecode) which is
+ * then executed by Interpreter::execute. The `visit_` methods are still used
+ * for Engine::TREE_WALKER.
  */
 struct Interpreter {
 private:
     const InterpreterConfig& config;
     ts::Parser& parser;
 
+    /**
+     * If this is set all functions created by executing bytecode will be
+     * added to it (used to create the StdlibSnapshot).
+     */
+    std::unordered_map<Value, std::shared_ptr<const bytecode::Proto>>* defined_functions =
+        nullptr;
+
+    // state of the garbage collector (see Interpreter::collect_garbage)
+    // NOTE the garbage collector is disabled if gc_user_env is nullptr
+    const Env* gc_user_env = nullptr;
+    // the number of tables that existed before the run
+    std::size_t gc_first_table = 0;
+    // the number of tables that triggers the next collection
+    std::size_t gc_next_collection = 0;
+    std::vector<const Frame*> frames;
+    /**
+     * The tables and functions that running native functions (or
+     * metamethods) hold while they call lua functions.
+     *
+     * Native functions are opaque to the garbage collector. The arguments of
+     * a native function called from bytecode are still in the registers of
+     * the caller. But only the native function knows about the arguments it
+     * passes to a lua function and the results it gets back. So they are
+     * roots until the lua function returns (arguments) or until the native
+     * function returns (results). See Interpreter::NativeCall and
+     * Interpreter::LuaCall.
+     */
+    std::vector<Value> native_roots;
+    // true while native code (called from bytecode) runs
+    bool in_native_call = false;
+
+    /**
+     * The parsed number and string literals (see Interpreter::visit_literal)
+     * by their location (including the file).
+     *
+     * The tree does not change while running so every literal only has to be
+     * parsed once.
+     */
+    std::unordered_map<Range, std::pair<ast::LiteralType, Value>> literal_cache;
+
+    /**
+     * The inline caches of the executed protos by their id (see
+     * Proto::num_field_caches).
+     */
+    std::unordered_map<std::uint64_t, std::vector<FieldCache>> field_caches;
+
+    /**
+     * The copy of the stdlib tree used by this run (only for
+     * Engine::TREE_WALKER).
+     *
+     * The functions defined in the stdlib reference the tree so it has to
+     * live as long as the interpreter.
+     */
+    std::optional<ts::Tree> stdlib_tree;
+
+    /**
+     * Where the samples are stored if profiling is enabled (see
+     * InterpreterConfig::profile_interval).
+     */
+    Profile* profile;
+    // only created for the actual program (i.e. not for loading the stdlib)
+    std::unique_ptr<Profiler> profiler;
+
+    /**
+     * The number of lua functions that are currently running (see
+     * InterpreterConfig::max_call_depth).
+     *
+     * Tail calls don't increase the depth.
+     */
+    std::size_t call_depth = 0;
+
 public:
-    Interpreter(const InterpreterConfig& config, ts::Parser& parser);
+    Interpreter(const InterpreterConfig& config, ts::Parser& parser, Profile* profile = nullptr);
     auto run(const ts::Tree& tree, Env& user_env) -> EvalResult;
 
 private:
@@ -114,14 +323,121 @@ private:
     auto setup_environment(Env& user_env) -> Env;
 
     auto load_stdlib() -> ts::Tree;
+    /**
+     * The process wide parsed stdlib.
+     */
+    auto shared_stdlib_tree() -> const ts::Tree&;
+    /**
+     * The process wide compiled stdlib (see CompileOptions::fold_constants).
+     */
+    auto stdlib_proto(bool fold_constants) -> const bytecode::Proto&;
     void execute_stdlib(Env& env);
 
+    /**
+     * Creates a process wide StdlibSnapshot.
+     *
+     * The snapshot does not depend on the config of the current run (except
+     * for the compile options). It is always created with the default
+     * InterpreterConfig.
+     *
+     * Should only be called from Interpreter::load_stdlib_snapshot.
+     */
+    static auto create_stdlib_snapshot(ts::Parser& parser, bool fold_constants)
+        -> StdlibSnapshot;
+    /**
+     * Copies the global variables of the stdlib into the given (empty) environment.
+     *
+     * This is equivalent to but a lot faster than calling `add_stdlib` and
+     * Interpreter::execute_stdlib.
+     */
+    void load_stdlib_snapshot(Env& env);
+
+    /**
+     * Executes compiled bytecode (see `vm.cpp`).
+     *
+     * The returned values are the return values of the function (or the
+     * program) and the source changes contain all changes generated while
+     * executing.
+     *
+     * The arguments are assigned to the parameters of the function.
+     */
+    auto execute(
+        const bytecode::Proto& proto, Env& env, const Upvalues& upvalues = {},
+        const Vallist& arguments = {}) -> EvalResult;
+
+    /**
+     * Returns the inline caches of the proto in this interpreter (creates
+     * them when the proto is executed the first time).
+     */
+    auto field_caches_of(const bytecode::Proto& proto) -> FieldCache*;
+
+    /**
+     * Calls `function` (or its `__call` metamethod) with the given arguments.
+     *
+     * The callee borrows the Env (see BorrowedContext). So changes to the
+     * environment are directly visible to the caller and the Env is not
+     * copied for every call.
+     */
+    auto call_function(const Value& function, Vallist arguments, const Range& location, Env& env)
+        -> CallResult;
+
+    /**
+     * Calls a metamethod (e.g. for a binary operator) and records it in the
+     * stack trace in case of an error.
+     */
+    auto call_metamethod(
+        CallResult (*f)(const CallContext&, std::optional<Range>), const std::string& name,
+        Vallist args, const Range& location, Env& env) -> CallResult;
+
+    /**
+     * Returns true if a binary operator can be applied directly to the operands
+     * without calling the metamethod function.
+     *
+     * Numbers don't have metatables so this skips the metamethod lookup and
+     * the CallContext for operations on numbers. The operator method of Value
+     * still records the origin.
+     */
+    [[nodiscard]] auto is_plain_number_operation(const Value& lhs, const Value& rhs) const
+        -> bool;
+
+    /**
+     * Evaluates the concatenation chain `values[0] .. ... .. values[count - 1]`
+     * (see details::concat_chain). `locations[i]` is the location of the
+     * operator after `values[i]`.
+     *
+     * Consecutive strings and numbers are concatenated at once. With
+     * OriginTracking::FULL their result gets a single MultipleArgsOrigin with
+     * all of them instead of one BinaryOrigin per operator.
+     *
+     * The values are overwritten with intermediate results.
+     */
+    auto concat(Value* values, std::size_t count, const Range* locations, Env& env) -> CallResult;
+
+    /**
+     * Frees all tables (created during this run) that are not reachable from
+     * the running functions, the user environment or the given values.
+     *
+     * The `__gc` metamethods of the unreachable tables are called after
+     * collecting. Their tables are only freed by the next collection.
+     */
+    void collect_garbage(Env& env, const Vallist& roots = {});
+    /**
+     * Calls Interpreter::collect_garbage if enough tables were allocated since
+     * the last collection.
+     *
+     * This has to be called at a point where all live values are in the
+     * registers of the running functions.
+     */
+    void step_garbage_collector(Env& env);
+
     /**
      * Cleans up the environment (i.e. garbage collection).
      *
-     * This will call `__gc` metamethod on all tables (if they exist).
+     * Frees all tables that are not reachable from the user environment or the
+     * results and calls the `__gc` metamethod on all other tables created in
+     * this run (if they exist).
      */
-    void cleanup_environment(Env& env);
+    void cleanup_environment(Env& env, const Vallist& results = {});
 
     /**
      * Run a file.
@@ -168,7 +484,13 @@ private:
     auto visit_expression(ast::Expression expr, Env& env) -> EvalResult;
     auto visit_unary_operation(ast::UnaryOperation unary_op, Env& env) -> EvalResult;
     auto visit_binary_operation(ast::BinaryOperation bin_op, Env& env) -> EvalResult;
-    auto visit_function_call(ast::FunctionCall call, Env& env) -> EvalResult;
+    auto visit_concat(ast::BinaryOperation bin_op, Env& env) -> EvalResult;
+    /**
+     * If `tail_call` is set and the called value is a lua function the call
+     * is not executed but returned as EvalResult::tail_call.
+     */
+    auto visit_function_call(ast::FunctionCall call, Env& env, bool tail_call = false)
+        -> EvalResult;
     auto visit_field_expression(ast::FieldExpression field_expression, Env& env) -> EvalResult;
     auto visit_table_index(ast::TableIndex table_index, Env& env) -> EvalResult;
     auto visit_function_expression(ast::FunctionDefinition function_definition, Env& env)
@@ -205,13 +527,14 @@ private:
 
     // helper methods for debugging/tracing
     [[nodiscard]] auto tracer() const -> std::ostream&;
-    void trace_enter_node(
-        std::string ast_class, std::optional<std::string> method_name = std::nullopt) const;
+    void trace_enter_node(const std::string& ast_class, const char* method_name = nullptr) const;
     void trace_exit_node(
-        std::string ast_class, std::optional<std::string> method_name = std::nullopt,
-        std::optional<std::string> reason = std::nullopt) const;
-    void trace_function_call(ast::Prefix prefix, const std::vector<Value>& arguments) const;
-    void trace_function_call_result(ast::Prefix prefix, const CallResult& result) const;
+        const std::string& ast_class, const char* method_name = nullptr,
+        const char* reason = nullptr) const;
+    void trace_function_call(
+        const std::string& function_name, const std::vector<Value>& arguments) const;
+    void trace_function_call_result(
+        const std::string& function_name, const CallResult& result) const;
     void trace_exprlists(std::vector<ast::Expression>& exprlist, const Vallist& result) const;
     void trace_metamethod_call(const std::string& name, const Vallist& arguments) const;
 
@@ -225,25 +548,132 @@ private:
      * Add the following to be beginning of the method you want to trace:
      *
      * ```cpp
-     * auto _ = NodeTracer(this, ast_element.raw(), "method_name");
+     * auto _ = NodeTracer(this, ast_element, "method_name");
      * ```
      *
      * The constructor will call Interpreter::trace_enter_node and the destructor (which
      * is always run before exiting the method) will call Interpreter::trace_exit_node.
+     *
+     * The AST element is only formatted (using `debug_print`) if
+     * InterpreterConfig::trace_nodes is enabled. Otherwise this costs a single
+     * branch in the constructor and destructor.
      */
     class NodeTracer {
-        Interpreter& interpreter;
-        std::string ast_class;
-        std::optional<std::string> method_name;
+        const Interpreter& interpreter;
+        // empty if tracing is disabled
+        std::optional<std::string> ast_class;
+        const char* method_name;
 
     public:
-        NodeTracer(
-            Interpreter* interpreter, std::string ast_class,
-            std::optional<std::string> method_name = std::nullopt);
+        template <typename Node>
+        NodeTracer(const Interpreter* interpreter, const Node& node, const char* method_name)
+            : interpreter(*interpreter), method_name(method_name) {
+            if (this->interpreter.profiler != nullptr) {
+                this->interpreter.profiler->step();
+            }
+            if (this->interpreter.config.trace_nodes) {
+                this->ast_class = node.debug_print();
+                this->interpreter.trace_enter_node(*this->ast_class, this->method_name);
+            }
+        }
         ~NodeTracer();
+
+        NodeTracer(const NodeTracer&) = delete;
+        auto operator=(const NodeTracer&) -> NodeTracer& = delete;
+    };
+
+    /**
+     * Counts a running lua function (see Interpreter::call_depth).
+     *
+     * Throws an InterpreterException if this exceeds
+     * InterpreterConfig::max_call_depth or if the native stack is almost
+     * full (see details::NATIVE_STACK_RESERVE).
+     */
+    class CallDepth {
+        std::size_t& call_depth;
+
+    public:
+        explicit CallDepth(Interpreter& interpreter);
+        ~CallDepth() { this->call_depth--; }
+
+        CallDepth(const CallDepth&) = delete;
+        auto operator=(const CallDepth&) -> CallDepth& = delete;
+    };
+
+    /**
+     * Marks a call from bytecode (or the garbage collector) to native code.
+     *
+     * The values the native code adds to Interpreter::native_roots are
+     * removed when it returns. Does nothing if `native` is false (e.g. for
+     * calls to lua functions).
+     */
+    class NativeCall {
+        Interpreter& interpreter;
+        std::size_t num_roots;
+        bool was_native;
+        bool native;
+
+    public:
+        explicit NativeCall(Interpreter& interpreter, bool native = true);
+        ~NativeCall();
+
+        NativeCall(const NativeCall&) = delete;
+        auto operator=(const NativeCall&) -> NativeCall& = delete;
+    };
+
+    /**
+     * Marks the call of a lua function.
+     *
+     * If it is called by native code its arguments are added to
+     * Interpreter::native_roots until it returns and its results until the
+     * native code returns (see LuaCall::keep_results).
+     */
+    class LuaCall {
+        Interpreter& interpreter;
+        std::size_t num_roots;
+        bool from_native;
+
+    public:
+        LuaCall(Interpreter& interpreter, const Vallist& arguments);
+        ~LuaCall();
+
+        void keep_results(const Vallist& results);
+
+        LuaCall(const LuaCall&) = delete;
+        auto operator=(const LuaCall&) -> LuaCall& = delete;
+    };
+
+    /**
+     * Traces and profiles the tail calls a lua function executes in its loop
+     * (see FunctionImpl and BytecodeFunction).
+     *
+     * Every tail call replaces the profiler frame of the previous one so the
+     * samples are attributed to the function that actually runs. The results
+     * of the tail calls are traced when the last one returned.
+     */
+    class TailCalls {
+        Interpreter& interpreter;
+        std::optional<Profiler::Call> profiler_call;
+        // the names of the traced tail calls (only if InterpreterConfig::trace_calls)
+        std::vector<std::string> names;
+
+    public:
+        explicit TailCalls(Interpreter& interpreter);
+
+        /**
+         * Returns true if TailCall::name and TailCall::location are needed.
+         */
+        [[nodiscard]] static auto needs_call_info(const Interpreter& interpreter) -> bool;
+
+        void enter(const TailCall& tail_call);
+        void trace_results(const CallResult& result) const;
+
+        TailCalls(const TailCalls&) = delete;
+        auto operator=(const TailCalls&) -> TailCalls& = delete;
     };
 
     friend struct FunctionImpl;
+    friend struct BytecodeFunction;
 };
 
 /**
@@ -262,7 +692,42 @@ struct FunctionImpl {
     bool vararg;
     Interpreter& interpreter;
 
+    /**
+     * Calls the function and executes the tail calls it returns.
+     */
+    auto operator()(const CallContext& ctx) -> CallResult;
+
+private:
+    /**
+     * Executes the body once (the result might contain a tail call).
+     */
+    [[nodiscard]] auto execute(const Vallist& arguments) const -> EvalResult;
+};
+
+/**
+ * The *implementation* of a lua function compiled to bytecode.
+ */
+struct BytecodeFunction {
+    std::shared_ptr<const bytecode::Proto> proto;
+    /**
+     * Store a copy of the environment for the global variables, the streams, etc.
+     *
+     * The local variables are only accessed through the upvalues.
+     */
+    Env env;
+    Upvalues upvalues;
+    Interpreter& interpreter;
+
+    /**
+     * Calls the function and executes the tail calls it returns.
+     */
     auto operator()(const CallContext& ctx) -> CallResult;
+
+private:
+    /**
+     * Executes the proto once (the result might contain a tail call).
+     */
+    [[nodiscard]] auto execute(const Vallist& arguments) const -> EvalResult;
 };
 
 } // namespace minilua::details
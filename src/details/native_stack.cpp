@@ -0,0 +1,39 @@
+#include "native_stack.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <pthread.h>
+
+namespace minilua::details {
+
+// Returns the lowest address of the stack of the current thread (the stack
+// grows down) or 0 if it is not known.
+static auto stack_limit() -> std::uintptr_t {
+    pthread_attr_t attributes;
+    if (pthread_getattr_np(pthread_self(), &attributes) != 0) {
+        return 0;
+    }
+
+    void* address = nullptr;
+    std::size_t size = 0;
+    int error = pthread_attr_getstack(&attributes, &address, &size);
+    pthread_attr_destroy(&attributes);
+    if (error != 0) {
+        return 0;
+    }
+    return reinterpret_cast<std::uintptr_t>(address); // NOLINT
+}
+
+auto remaining_native_stack() -> std::size_t {
+    thread_local const std::uintptr_t limit = stack_limit();
+    if (limit == 0) {
+        return std::numeric_limits<std::size_t>::max();
+    }
+
+    // NOTE the frame address is always on the native stack (local variables
+    // might be moved somewhere else by the address sanitizer)
+    auto current = reinterpret_cast<std::uintptr_t>(__builtin_frame_address(0)); // NOLINT
+    return current > limit ? current - limit : 0;
+}
+
+} // namespace minilua::details
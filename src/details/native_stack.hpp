@@ -0,0 +1,28 @@
+#ifndef MINILUA_DETAILS_NATIVE_STACK_HPP
+#define MINILUA_DETAILS_NATIVE_STACK_HPP
+
+#include <cstddef>
+
+namespace minilua::details {
+
+/**
+ * The native stack that has to stay free when a lua function is called.
+ *
+ * This has to be enough for everything between two calls (e.g. the nested
+ * expressions visited by the tree walker or a native function like `pcall`)
+ * and for throwing the "stack overflow" exception.
+ */
+constexpr std::size_t NATIVE_STACK_RESERVE = 256 * 1024; // NOLINT
+
+/**
+ * Returns the number of bytes that are still free on the native stack of the
+ * current thread (below the frame of the caller).
+ *
+ * The bounds of the stack are only looked up once per thread. Returns the
+ * maximum `std::size_t` if they are not known.
+ */
+auto remaining_native_stack() -> std::size_t;
+
+} // namespace minilua::details
+
+#endif
@@ -0,0 +1,242 @@
+#include "number_scanner.hpp"
+
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <string>
+
+namespace minilua::details {
+
+// hexadecimal floats with more significant digits are rounded (see `scan_hex`)
+static const int MAX_SIGNIFICANT_DIGITS = 30;
+// longer exponents are clamped (the result is 0 or inf anyway)
+static const int MAX_EXPONENT = 100000;
+// decimal floats up to this length are converted without allocating
+static const std::size_t FLOAT_BUFFER_SIZE = 100;
+
+static auto is_space(char c) -> bool { return std::isspace(static_cast<unsigned char>(c)); }
+static auto is_digit(char c) -> bool { return std::isdigit(static_cast<unsigned char>(c)); }
+static auto is_hex_digit(char c) -> bool { return std::isxdigit(static_cast<unsigned char>(c)); }
+
+// works for all bases up to 36
+static auto digit_value(char c) -> int {
+    if (is_digit(c)) {
+        return c - '0';
+    }
+    return std::toupper(static_cast<unsigned char>(c)) - 'A' + 10; // NOLINT
+}
+
+static auto trim(std::string_view str) -> std::string_view {
+    while (!str.empty() && is_space(str.front())) {
+        str.remove_prefix(1);
+    }
+    while (!str.empty() && is_space(str.back())) {
+        str.remove_suffix(1);
+    }
+    return str;
+}
+
+// scans the decimal exponent after `e` or `p`
+static auto scan_exponent(std::string_view str, std::size_t& pos) -> std::optional<int> {
+    bool negative = false;
+    if (pos < str.size() && (str[pos] == '-' || str[pos] == '+')) {
+        negative = str[pos] == '-';
+        pos++;
+    }
+    if (pos >= str.size() || !is_digit(str[pos])) {
+        return std::nullopt;
+    }
+    int exponent = 0;
+    while (pos < str.size() && is_digit(str[pos])) {
+        if (exponent < MAX_EXPONENT) {
+            exponent = exponent * 10 + (str[pos] - '0'); // NOLINT
+        }
+        pos++;
+    }
+    return negative ? -exponent : exponent;
+}
+
+// the same algorithm as `lua_strx2number` (`str` starts after the `0x`)
+static auto scan_hex(std::string_view str, bool negative) -> std::optional<Number> {
+    std::uint64_t int_value = 0;
+    Number::Float float_value = 0;
+    int exponent = 0;
+    int significant_digits = 0;
+    bool any_digit = false;
+    bool has_dot = false;
+    bool is_float = false;
+
+    std::size_t pos = 0;
+    for (; pos < str.size(); ++pos) {
+        if (str[pos] == '.') {
+            if (has_dot) {
+                return std::nullopt;
+            }
+            has_dot = true;
+            is_float = true;
+        } else if (is_hex_digit(str[pos])) {
+            const int digit = digit_value(str[pos]);
+            any_digit = true;
+            // integers wrap around
+            int_value = int_value * 16 + digit; // NOLINT
+
+            if (significant_digits == 0 && digit == 0) {
+                // leading zeros are not significant
+            } else if (++significant_digits <= MAX_SIGNIFICANT_DIGITS) {
+                float_value = float_value * 16 + digit; // NOLINT
+            } else {
+                // too many digits: ignore the digit but count it for the exponent
+                exponent++;
+            }
+            if (has_dot) {
+                exponent--;
+            }
+        } else {
+            break;
+        }
+    }
+
+    if (!any_digit) {
+        return std::nullopt;
+    }
+
+    // every digit is 4 bits
+    exponent *= 4;
+
+    if (pos < str.size() && (str[pos] == 'p' || str[pos] == 'P')) {
+        pos++;
+        auto binary_exponent = scan_exponent(str, pos);
+        if (!binary_exponent) {
+            return std::nullopt;
+        }
+        exponent += *binary_exponent;
+        is_float = true;
+    }
+
+    if (pos != str.size()) {
+        return std::nullopt;
+    }
+
+    if (!is_float) {
+        return static_cast<Number::Int>(negative ? 0U - int_value : int_value);
+    }
+    const auto value = std::ldexp(float_value, exponent);
+    return negative ? -value : value;
+}
+
+static auto scan_decimal(std::string_view str, bool negative) -> std::optional<Number> {
+    std::size_t pos = 0;
+    std::size_t digits = 0;
+    bool is_float = false;
+
+    while (pos < str.size() && is_digit(str[pos])) {
+        pos++;
+        digits++;
+    }
+    const std::size_t int_digits = digits;
+
+    if (pos < str.size() && str[pos] == '.') {
+        is_float = true;
+        pos++;
+        while (pos < str.size() && is_digit(str[pos])) {
+            pos++;
+            digits++;
+        }
+    }
+
+    if (digits == 0) {
+        return std::nullopt;
+    }
+
+    if (pos < str.size() && (str[pos] == 'e' || str[pos] == 'E')) {
+        pos++;
+        if (!scan_exponent(str, pos)) {
+            return std::nullopt;
+        }
+        is_float = true;
+    }
+
+    if (pos != str.size()) {
+        return std::nullopt;
+    }
+
+    if (!is_float) {
+        // the most negative integer has no positive counterpart
+        const std::uint64_t max = static_cast<std::uint64_t>(std::numeric_limits<Number::Int>::max()) +
+                                  (negative ? 1 : 0);
+        std::uint64_t value = 0;
+        bool overflow = false;
+        for (std::size_t i = 0; i < int_digits; ++i) {
+            const std::uint64_t digit = str[i] - '0';
+            if (value > (max - digit) / 10) { // NOLINT
+                overflow = true;
+                break;
+            }
+            value = value * 10 + digit; // NOLINT
+        }
+        if (!overflow) {
+            return static_cast<Number::Int>(negative ? 0U - value : value);
+        }
+        // integers that are too large are converted to floats
+    }
+
+    // the numeral is valid so strtod converts all of it (it needs a null
+    // terminated string)
+    Number::Float value = 0;
+    if (str.size() < FLOAT_BUFFER_SIZE) {
+        std::array<char, FLOAT_BUFFER_SIZE> buffer{};
+        str.copy(buffer.data(), str.size());
+        value = std::strtod(buffer.data(), nullptr);
+    } else {
+        value = std::strtod(std::string(str).c_str(), nullptr);
+    }
+    return negative ? -value : value;
+}
+
+auto scan_number(std::string_view str) -> std::optional<Number> {
+    str = trim(str);
+
+    bool negative = false;
+    if (!str.empty() && (str.front() == '-' || str.front() == '+')) {
+        negative = str.front() == '-';
+        str.remove_prefix(1);
+    }
+
+    if (str.size() >= 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) {
+        return scan_hex(str.substr(2), negative);
+    }
+    return scan_decimal(str, negative);
+}
+
+auto scan_integer(std::string_view str, int base) -> std::optional<Number::Int> {
+    str = trim(str);
+
+    bool negative = false;
+    if (!str.empty() && (str.front() == '-' || str.front() == '+')) {
+        negative = str.front() == '-';
+        str.remove_prefix(1);
+    }
+
+    if (str.empty()) {
+        return std::nullopt;
+    }
+
+    std::uint64_t value = 0;
+    for (char c : str) {
+        if (!std::isalnum(static_cast<unsigned char>(c))) {
+            return std::nullopt;
+        }
+        const int digit = digit_value(c);
+        if (digit >= base) {
+            return std::nullopt;
+        }
+        value = value * base + digit;
+    }
+
+    return static_cast<Number::Int>(negative ? 0U - value : value);
+}
+
+} // namespace minilua::details
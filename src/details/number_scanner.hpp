@@ -0,0 +1,36 @@
+#ifndef MINILUA_DETAILS_NUMBER_SCANNER_HPP
+#define MINILUA_DETAILS_NUMBER_SCANNER_HPP
+
+#include "MiniLua/values.hpp"
+
+#include <optional>
+#include <string_view>
+
+namespace minilua::details {
+
+/**
+ * Scans a lua numeral (like `tonumber` without a base).
+ *
+ * Supports decimal and hexadecimal integers and floats with an optional
+ * exponent (e.g. `42`, `-2.5e3`, `.5`, `0xff`, `0x1.8p4`). Leading and
+ * trailing whitespace and a sign are allowed.
+ *
+ * Like in lua decimal integers that don't fit into Number::Int are converted
+ * to floats and hexadecimal integers wrap around.
+ *
+ * Returns `std::nullopt` if the whole string is not a numeral. This does not
+ * allocate (except for decimal floats with more than 100 characters).
+ */
+auto scan_number(std::string_view str) -> std::optional<Number>;
+
+/**
+ * Scans an integer in the given base (2 to 36) like `tonumber` with a base.
+ *
+ * Leading and trailing whitespace and a sign (`-` or `+`) are allowed like in
+ * lua. Overflows wrap around.
+ */
+auto scan_integer(std::string_view str, int base) -> std::optional<Number::Int>;
+
+} // namespace minilua::details
+
+#endif
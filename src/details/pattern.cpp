@@ -0,0 +1,511 @@
+#include "pattern.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+namespace minilua::details {
+
+static const char ESCAPE = '%';
+static const std::size_t UNCLOSED = std::string_view::npos;
+
+// struct Capture
+auto Capture::view(std::string_view subject) const -> std::string_view {
+    return subject.substr(this->start, this->length);
+}
+
+// helpers for compiling
+static auto class_matches(char cls, unsigned char c) -> bool {
+    bool result = false;
+    switch (std::tolower(static_cast<unsigned char>(cls))) {
+    case 'a':
+        result = std::isalpha(c);
+        break;
+    case 'c':
+        result = std::iscntrl(c);
+        break;
+    case 'd':
+        result = std::isdigit(c);
+        break;
+    case 'g':
+        result = std::isgraph(c);
+        break;
+    case 'l':
+        result = std::islower(c);
+        break;
+    case 'p':
+        result = std::ispunct(c);
+        break;
+    case 's':
+        result = std::isspace(c);
+        break;
+    case 'u':
+        result = std::isupper(c);
+        break;
+    case 'w':
+        result = std::isalnum(c);
+        break;
+    case 'x':
+        result = std::isxdigit(c);
+        break;
+    default:
+        // escaped character (e.g. `%.`)
+        return static_cast<unsigned char>(cls) == c;
+    }
+    if (std::isupper(static_cast<unsigned char>(cls))) {
+        return !result;
+    }
+    return result;
+}
+
+static void add_class(std::bitset<256>& set, char cls) {
+    for (int c = 0; c < 256; ++c) { // NOLINT
+        if (class_matches(cls, c)) {
+            set.set(c);
+        }
+    }
+}
+
+// returns the index after the single character class starting at `p`
+static auto class_end(std::string_view pattern, std::size_t p) -> std::size_t {
+    switch (pattern[p++]) {
+    case ESCAPE:
+        if (p >= pattern.size()) {
+            throw std::runtime_error("malformed pattern (ends with '%')");
+        }
+        return p + 1;
+    case '[':
+        if (p < pattern.size() && pattern[p] == '^') {
+            p++;
+        }
+        // the first character is part of the set even if it is a ']'
+        do {
+            if (p >= pattern.size()) {
+                throw std::runtime_error("malformed pattern (missing ']')");
+            }
+            if (pattern[p++] == ESCAPE && p < pattern.size()) {
+                p++;
+            }
+        } while (p >= pattern.size() || pattern[p] != ']');
+        return p + 1;
+    default:
+        return p;
+    }
+}
+
+// compiles the set `[...]` from `p` (the '[') to `end` (the ']')
+static auto compile_set(std::string_view pattern, std::size_t p, std::size_t end)
+    -> std::bitset<256> {
+    std::bitset<256> set;
+    bool negate = false;
+
+    p++;
+    if (pattern[p] == '^') {
+        negate = true;
+        p++;
+    }
+
+    while (p < end) {
+        if (pattern[p] == ESCAPE) {
+            add_class(set, pattern[p + 1]);
+            p += 2;
+        } else if (pattern[p + 1] == '-' && p + 2 < end) {
+            const auto from = static_cast<unsigned char>(pattern[p]);
+            const auto to = static_cast<unsigned char>(pattern[p + 2]);
+            for (unsigned int c = from; c <= to; ++c) {
+                set.set(c);
+            }
+            p += 3;
+        } else {
+            set.set(static_cast<unsigned char>(pattern[p]));
+            p += 1;
+        }
+    }
+
+    if (negate) {
+        set.flip();
+    }
+    return set;
+}
+
+// compiles the single character class from `p` to `end`
+static auto compile_single(std::string_view pattern, std::size_t p, std::size_t end)
+    -> std::bitset<256> {
+    std::bitset<256> set;
+    switch (pattern[p]) {
+    case '.':
+        set.set();
+        break;
+    case ESCAPE:
+        add_class(set, pattern[p + 1]);
+        break;
+    case '[':
+        set = compile_set(pattern, p, end - 1);
+        break;
+    default:
+        set.set(static_cast<unsigned char>(pattern[p]));
+        break;
+    }
+    return set;
+}
+
+// class Pattern
+Pattern::Pattern(std::string_view pattern, bool allow_anchor) {
+    std::size_t p = 0;
+    if (allow_anchor && !pattern.empty() && pattern[0] == '^') {
+        this->anchored = true;
+        p++;
+    }
+
+    // indices of the captures that are not closed yet
+    std::vector<std::size_t> open_captures;
+
+    while (p < pattern.size()) {
+        Instruction instr;
+
+        switch (pattern[p]) {
+        case '(':
+            if (this->_num_captures >= MAX_CAPTURES) {
+                throw std::runtime_error("too many captures");
+            }
+            instr.capture = this->_num_captures++;
+            if (p + 1 < pattern.size() && pattern[p + 1] == ')') {
+                instr.kind = Kind::POSITION_CAPTURE;
+                p += 2;
+            } else {
+                instr.kind = Kind::OPEN_CAPTURE;
+                open_captures.push_back(instr.capture);
+                p += 1;
+            }
+            this->program.push_back(instr);
+            continue;
+        case ')':
+            if (open_captures.empty()) {
+                throw std::runtime_error("invalid pattern capture");
+            }
+            instr.kind = Kind::CLOSE_CAPTURE;
+            instr.capture = open_captures.back();
+            open_captures.pop_back();
+            this->program.push_back(instr);
+            p += 1;
+            continue;
+        case '$':
+            // only an anchor at the end of the pattern
+            if (p + 1 == pattern.size()) {
+                instr.kind = Kind::END_ANCHOR;
+                this->program.push_back(instr);
+                p += 1;
+                continue;
+            }
+            break;
+        case ESCAPE:
+            if (p + 1 >= pattern.size()) {
+                throw std::runtime_error("malformed pattern (ends with '%')");
+            }
+            if (pattern[p + 1] == 'b') {
+                if (p + 3 >= pattern.size()) {
+                    throw std::runtime_error("malformed pattern (missing arguments to '%b')");
+                }
+                instr.kind = Kind::BALANCE;
+                instr.open = pattern[p + 2];
+                instr.close = pattern[p + 3];
+                this->program.push_back(instr);
+                p += 4;
+                continue;
+            }
+            if (pattern[p + 1] == 'f') {
+                p += 2;
+                if (p >= pattern.size() || pattern[p] != '[') {
+                    throw std::runtime_error("missing '[' after '%f' in pattern");
+                }
+                std::size_t end = class_end(pattern, p);
+                instr.kind = Kind::FRONTIER;
+                instr.set = compile_set(pattern, p, end - 1);
+                this->program.push_back(instr);
+                p = end;
+                continue;
+            }
+            if (std::isdigit(static_cast<unsigned char>(pattern[p + 1]))) {
+                const int index = pattern[p + 1] - '1';
+                const bool is_open =
+                    std::find(open_captures.begin(), open_captures.end(), index) !=
+                    open_captures.end();
+                if (index < 0 || index >= static_cast<int>(this->_num_captures) || is_open) {
+                    throw std::runtime_error(
+                        std::string("invalid capture index %") + pattern[p + 1] + " in pattern");
+                }
+                instr.kind = Kind::BACK_REFERENCE;
+                instr.capture = index;
+                this->program.push_back(instr);
+                p += 2;
+                continue;
+            }
+            break;
+        default:
+            break;
+        }
+
+        // single character class with an optional quantifier
+        std::size_t end = class_end(pattern, p);
+        instr.kind = Kind::SINGLE;
+        instr.set = compile_single(pattern, p, end);
+        if (instr.set.count() == 1) {
+            for (int c = 0; c < 256; ++c) { // NOLINT
+                if (instr.set.test(c)) {
+                    instr.literal = c;
+                    break;
+                }
+            }
+        }
+
+        if (end < pattern.size()) {
+            switch (pattern[end]) {
+            case '?':
+                instr.repeat = Repeat::OPTIONAL;
+                end++;
+                break;
+            case '*':
+                instr.repeat = Repeat::STAR;
+                end++;
+                break;
+            case '+':
+                instr.repeat = Repeat::PLUS;
+                end++;
+                break;
+            case '-':
+                instr.repeat = Repeat::LAZY;
+                end++;
+                break;
+            default:
+                break;
+            }
+        }
+
+        this->program.push_back(instr);
+        p = end;
+    }
+
+    this->unfinished_capture = !open_captures.empty();
+
+    // captures don't consume characters so they don't end the prefix
+    for (const auto& instr : this->program) {
+        if (instr.kind == Kind::OPEN_CAPTURE || instr.kind == Kind::CLOSE_CAPTURE ||
+            instr.kind == Kind::POSITION_CAPTURE) {
+            continue;
+        }
+        if (instr.kind != Kind::SINGLE || instr.repeat != Repeat::ONE || instr.literal < 0) {
+            break;
+        }
+        this->prefix.push_back(static_cast<char>(instr.literal));
+    }
+}
+
+auto Pattern::do_match(
+    std::string_view subject, std::size_t s, std::size_t pc, std::vector<Capture>& captures) const
+    -> std::optional<std::size_t> {
+    // NOTE: patterns have no alternatives. So every instruction before the
+    // current one was matched on the way to `s` and the captures don't need to
+    // be restored when backtracking.
+    while (pc < this->program.size()) {
+        const Instruction& instr = this->program[pc];
+
+        switch (instr.kind) {
+        case Kind::OPEN_CAPTURE:
+            captures[instr.capture] = Capture{.start = s, .length = UNCLOSED};
+            break;
+        case Kind::POSITION_CAPTURE:
+            captures[instr.capture] = Capture{.start = s, .length = 0, .is_position = true};
+            break;
+        case Kind::CLOSE_CAPTURE:
+            captures[instr.capture].length = s - captures[instr.capture].start;
+            break;
+        case Kind::END_ANCHOR:
+            if (s != subject.size()) {
+                return std::nullopt;
+            }
+            break;
+        case Kind::BALANCE: {
+            if (s >= subject.size() || subject[s] != instr.open) {
+                return std::nullopt;
+            }
+            int depth = 1;
+            while (true) {
+                if (++s >= subject.size()) {
+                    return std::nullopt;
+                }
+                if (subject[s] == instr.close) {
+                    if (--depth == 0) {
+                        break;
+                    }
+                } else if (subject[s] == instr.open) {
+                    depth++;
+                }
+            }
+            s++;
+            break;
+        }
+        case Kind::FRONTIER: {
+            const auto previous = s == 0 ? '\0' : static_cast<unsigned char>(subject[s - 1]);
+            const auto current = s < subject.size() ? static_cast<unsigned char>(subject[s]) : '\0';
+            if (instr.set.test(previous) || !instr.set.test(current)) {
+                return std::nullopt;
+            }
+            break;
+        }
+        case Kind::BACK_REFERENCE: {
+            const auto captured = captures[instr.capture].view(subject);
+            if (subject.substr(s, captured.size()) != captured) {
+                return std::nullopt;
+            }
+            s += captured.size();
+            break;
+        }
+        case Kind::SINGLE: {
+            auto matches = [&subject, &instr](std::size_t i) {
+                return i < subject.size() && instr.set.test(static_cast<unsigned char>(subject[i]));
+            };
+
+            switch (instr.repeat) {
+            case Repeat::ONE:
+                if (!matches(s)) {
+                    return std::nullopt;
+                }
+                s++;
+                break;
+            case Repeat::OPTIONAL:
+                if (matches(s)) {
+                    if (auto end = this->do_match(subject, s + 1, pc + 1, captures)) {
+                        return end;
+                    }
+                }
+                break;
+            case Repeat::STAR:
+            case Repeat::PLUS: {
+                // match as many characters as possible and backtrack
+                const std::size_t min = instr.repeat == Repeat::PLUS ? 1 : 0;
+                std::size_t count = 0;
+                while (matches(s + count)) {
+                    count++;
+                }
+                while (true) {
+                    if (count < min) {
+                        return std::nullopt;
+                    }
+                    if (auto end = this->do_match(subject, s + count, pc + 1, captures)) {
+                        return end;
+                    }
+                    if (count == 0) {
+                        return std::nullopt;
+                    }
+                    count--;
+                }
+            }
+            case Repeat::LAZY:
+                // match as few characters as possible
+                while (true) {
+                    if (auto end = this->do_match(subject, s, pc + 1, captures)) {
+                        return end;
+                    }
+                    if (!matches(s)) {
+                        return std::nullopt;
+                    }
+                    s++;
+                }
+            }
+            break;
+        }
+        }
+
+        pc++;
+    }
+
+    return s;
+}
+
+auto Pattern::match_at(std::string_view subject, std::size_t init, std::vector<Capture>& captures)
+    const -> std::optional<std::size_t> {
+    auto end = this->do_match(subject, init, 0, captures);
+    if (end && this->unfinished_capture) {
+        throw std::runtime_error("unfinished capture");
+    }
+    return end;
+}
+
+auto Pattern::find(std::string_view subject, std::size_t init) const
+    -> std::optional<PatternMatch> {
+    std::vector<Capture> captures(this->_num_captures);
+
+    if (this->anchored) {
+        if (auto end = this->match_at(subject, init, captures)) {
+            return PatternMatch{.start = init, .end = *end, .captures = std::move(captures)};
+        }
+        return std::nullopt;
+    }
+
+    for (std::size_t s = init; s <= subject.size(); ++s) {
+        // skip to the next possible start of a match
+        if (this->prefix.size() == 1) {
+            const void* next = std::memchr(subject.data() + s, this->prefix[0], subject.size() - s);
+            if (next == nullptr) {
+                return std::nullopt;
+            }
+            s = static_cast<const char*>(next) - subject.data();
+        } else if (!this->prefix.empty()) {
+            s = subject.find(this->prefix, s);
+            if (s == std::string_view::npos) {
+                return std::nullopt;
+            }
+        }
+
+        if (auto end = this->match_at(subject, s, captures)) {
+            return PatternMatch{.start = s, .end = *end, .captures = std::move(captures)};
+        }
+    }
+
+    return std::nullopt;
+}
+
+auto Pattern::is_anchored() const -> bool { return this->anchored; }
+auto Pattern::num_captures() const -> std::size_t { return this->_num_captures; }
+
+auto is_plain_pattern(std::string_view pattern) -> bool {
+    return pattern.find_first_of("^$*+?.([%-") == std::string_view::npos;
+}
+
+// class PatternCache
+auto PatternCache::KeyHash::operator()(const Key& key) const -> std::size_t {
+    return std::hash<std::string>()(key.first) ^ static_cast<std::size_t>(key.second);
+}
+
+PatternCache::PatternCache(std::size_t capacity) : _capacity(capacity) {}
+
+auto PatternCache::get(std::string_view pattern, bool allow_anchor)
+    -> std::shared_ptr<const Pattern> {
+    Key key{std::string(pattern), allow_anchor};
+
+    auto it = this->index.find(key);
+    if (it != this->index.end()) {
+        // move to the front
+        this->entries.splice(this->entries.begin(), this->entries, it->second);
+        return it->second->second;
+    }
+
+    // compile first so malformed patterns are not added to the cache
+    auto compiled = std::make_shared<const Pattern>(pattern, allow_anchor);
+
+    if (this->entries.size() >= this->_capacity && !this->entries.empty()) {
+        this->index.erase(this->entries.back().first);
+        this->entries.pop_back();
+    }
+    this->entries.emplace_front(key, compiled);
+    this->index.emplace(std::move(key), this->entries.begin());
+
+    return compiled;
+}
+
+auto PatternCache::size() const -> std::size_t { return this->entries.size(); }
+auto PatternCache::capacity() const -> std::size_t { return this->_capacity; }
+
+} // namespace minilua::details
@@ -0,0 +1,184 @@
+#ifndef MINILUA_DETAILS_PATTERN_HPP
+#define MINILUA_DETAILS_PATTERN_HPP
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace minilua::details {
+
+/**
+ * A capture of a pattern match.
+ *
+ * The capture only references the subject string. The substring is copied
+ * when the capture is converted to a lua value.
+ */
+struct Capture {
+    std::size_t start = 0;
+    std::size_t length = 0;
+    /**
+     * Position captures (`()`) capture the position instead of a substring.
+     */
+    bool is_position = false;
+
+    [[nodiscard]] auto view(std::string_view subject) const -> std::string_view;
+};
+
+/**
+ * A successful match of a pattern. `end` is exclusive.
+ */
+struct PatternMatch {
+    std::size_t start = 0;
+    std::size_t end = 0;
+    std::vector<Capture> captures;
+};
+
+/**
+ * A compiled lua 5.3 pattern (as used by `string.find`, `string.match`,
+ * `string.gmatch` and `string.gsub`).
+ *
+ * The pattern is compiled once into a list of instructions. Every single
+ * character class (e.g. `a`, `.`, `%d` or `[%a_]`) is compiled into the set
+ * of characters it matches. So matching a character is a single lookup no
+ * matter how complex the class is.
+ *
+ * Matching works like in the reference implementation: the instructions are
+ * matched one after another and the quantifiers backtrack.
+ *
+ * If the pattern starts with literal characters a search skips directly to the
+ * next occurence of them (using `memchr` or `std::string_view::find`).
+ *
+ * Malformed patterns throw a `std::runtime_error` with the same message as the
+ * reference implementation.
+ */
+class Pattern {
+public:
+    static constexpr std::size_t MAX_CAPTURES = 32;
+
+private:
+    enum class Kind : std::uint8_t {
+        SINGLE,
+        OPEN_CAPTURE,
+        POSITION_CAPTURE,
+        CLOSE_CAPTURE,
+        BALANCE,
+        FRONTIER,
+        BACK_REFERENCE,
+        END_ANCHOR,
+    };
+
+    enum class Repeat : std::uint8_t {
+        ONE,
+        OPTIONAL, // ?
+        STAR,     // *
+        PLUS,     // +
+        LAZY,     // -
+    };
+
+    struct Instruction {
+        Kind kind = Kind::SINGLE;
+        Repeat repeat = Repeat::ONE;
+        // SINGLE and FRONTIER: the characters in the class
+        std::bitset<256> set; // NOLINT
+        // SINGLE: the character if the class only contains one character
+        int literal = -1;
+        // BALANCE: the opening and closing character
+        char open = 0;
+        char close = 0;
+        // *_CAPTURE and BACK_REFERENCE: the index of the capture
+        std::size_t capture = 0;
+    };
+
+    std::vector<Instruction> program;
+    bool anchored = false;
+    bool unfinished_capture = false;
+    std::size_t _num_captures = 0;
+    // the literal characters every match starts with
+    std::string prefix;
+
+    auto do_match(std::string_view subject, std::size_t s, std::size_t pc,
+                  std::vector<Capture>& captures) const -> std::optional<std::size_t>;
+
+public:
+    /**
+     * Compiles the pattern.
+     *
+     * If `allow_anchor` is false a `^` at the start of the pattern is not an
+     * anchor but a normal character (this is used by `string.gmatch`).
+     */
+    explicit Pattern(std::string_view pattern, bool allow_anchor = true);
+
+    /**
+     * Tries to match the pattern starting exactly at `init`.
+     *
+     * Returns the end of the match (exclusive). `captures` has to have
+     * Pattern::num_captures elements.
+     */
+    auto match_at(std::string_view subject, std::size_t init, std::vector<Capture>& captures) const
+        -> std::optional<std::size_t>;
+
+    /**
+     * Searches the first match that starts at or after `init`.
+     */
+    [[nodiscard]] auto find(std::string_view subject, std::size_t init = 0) const
+        -> std::optional<PatternMatch>;
+
+    [[nodiscard]] auto is_anchored() const -> bool;
+    [[nodiscard]] auto num_captures() const -> std::size_t;
+};
+
+/**
+ * Returns true if the pattern contains no special characters (i.e. it can be
+ * searched for like a normal string).
+ */
+auto is_plain_pattern(std::string_view pattern) -> bool;
+
+/**
+ * A cache of compiled patterns with a fixed capacity.
+ *
+ * When the cache is full the least recently used pattern is removed.
+ *
+ * The patterns are returned as `shared_ptr` so they stay valid when they are
+ * removed from the cache (e.g. the iterator returned by `string.gmatch` keeps
+ * its pattern).
+ */
+class PatternCache {
+public:
+    static constexpr std::size_t DEFAULT_CAPACITY = 64;
+
+private:
+    using Key = std::pair<std::string, bool>;
+    struct KeyHash {
+        auto operator()(const Key& key) const -> std::size_t;
+    };
+    using Entry = std::pair<Key, std::shared_ptr<const Pattern>>;
+
+    std::size_t _capacity;
+    // most recently used first
+    std::list<Entry> entries;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+
+public:
+    explicit PatternCache(std::size_t capacity = DEFAULT_CAPACITY);
+
+    /**
+     * Returns the compiled pattern. The pattern is only compiled if it is not
+     * already in the cache.
+     */
+    auto get(std::string_view pattern, bool allow_anchor = true) -> std::shared_ptr<const Pattern>;
+
+    [[nodiscard]] auto size() const -> std::size_t;
+    [[nodiscard]] auto capacity() const -> std::size_t;
+};
+
+} // namespace minilua::details
+
+#endif
@@ -0,0 +1,53 @@
+#include "profiler.hpp"
+
+#include <utility>
+
+namespace minilua::details {
+
+Profiler::Profiler(Profile& profile, std::size_t interval, std::chrono::microseconds period)
+    : profile(profile), interval(interval), countdown(interval) {
+    this->stack.push_back(this->profile.add_frame(Profile::Frame{"main chunk", std::nullopt}));
+
+    if (period.count() > 0) {
+        this->timer = std::thread([this, period]() {
+            std::unique_lock<std::mutex> lock(this->timer_mutex);
+            while (!this->timer_stop.wait_for(lock, period, [this]() { return this->stopped; })) {
+                this->pending_ticks.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+}
+
+Profiler::~Profiler() {
+    if (this->timer.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(this->timer_mutex);
+            this->stopped = true;
+        }
+        this->timer_stop.notify_one();
+        this->timer.join();
+    }
+}
+
+void Profiler::sample(std::size_t count) { this->profile.add_sample(this->stack, count); }
+
+void Profiler::take_pending_samples() {
+    auto ticks = this->pending_ticks.exchange(0, std::memory_order_relaxed);
+    if (ticks != 0) {
+        this->sample(ticks);
+    }
+}
+
+void Profiler::exit() {
+    // the time until now belongs to the called function (e.g. a long running
+    // native function that doesn't report any steps)
+    try {
+        this->take_pending_samples();
+    } catch (...) {
+        // this also runs while unwinding an exception, so losing a sample is
+        // better than terminating
+    }
+    this->stack.pop_back();
+}
+
+} // namespace minilua::details
@@ -0,0 +1,124 @@
+#ifndef MINILUA_DETAILS_PROFILER_HPP
+#define MINILUA_DETAILS_PROFILER_HPP
+
+#include "MiniLua/profile.hpp"
+#include "MiniLua/source_change.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+namespace minilua::details {
+
+/**
+ * Samples the lua call stack into a Profile while the interpreter runs (see
+ * InterpreterConfig::profile_interval and InterpreterConfig::profile_period).
+ *
+ * The interpreter reports every step (an executed instruction or a visited
+ * node) and every function call. A sample is taken
+ *
+ * - every `interval` steps and
+ * - at the next step, call or return after the timer fired (every `period`).
+ *
+ * The timer runs on its own thread but it only increments a counter. So the
+ * stack is only ever accessed by the thread of the interpreter.
+ *
+ * The frames are deduplicated by the location of the call. So the stack is
+ * just a list of indices and taking a sample doesn't format any strings.
+ */
+class Profiler {
+    Profile& profile;
+    std::size_t interval;
+    // number of steps until the next sample (0 if sampling by steps is disabled)
+    std::size_t countdown;
+
+    Profile::Stack stack;
+    std::unordered_map<Range, std::size_t> call_sites;
+
+    // number of times the timer fired since the last sample
+    std::atomic<std::size_t> pending_ticks = 0;
+    std::mutex timer_mutex;
+    std::condition_variable timer_stop;
+    bool stopped = false;
+    std::thread timer;
+
+    void sample(std::size_t count);
+    void take_pending_samples();
+
+public:
+    Profiler(Profile& profile, std::size_t interval, std::chrono::microseconds period);
+    ~Profiler();
+
+    Profiler(const Profiler&) = delete;
+    auto operator=(const Profiler&) -> Profiler& = delete;
+
+    /**
+     * Called for every executed instruction or visited node.
+     */
+    void step() {
+        if (this->countdown != 0 && --this->countdown == 0) {
+            this->countdown = this->interval;
+            this->sample(1);
+        }
+        if (this->pending_ticks.load(std::memory_order_relaxed) != 0) {
+            this->take_pending_samples();
+        }
+    }
+
+    /**
+     * Pushes the frame of a called function.
+     *
+     * `name()` returns the name of the function. It is only called the first
+     * time the call site is entered.
+     */
+    template <typename Name> void enter(const Range& location, Name name) {
+        // the time until now belongs to the caller
+        this->take_pending_samples();
+
+        auto [call_site, inserted] = this->call_sites.try_emplace(location, 0);
+        if (inserted) {
+            call_site->second = this->profile.add_frame(Profile::Frame{name(), location});
+        }
+        this->stack.push_back(call_site->second);
+    }
+
+    /**
+     * Pops the frame of the function that returned.
+     */
+    void exit();
+
+    /**
+     * Pushes a frame for the duration of a function call.
+     *
+     * Does nothing if the profiler is `nullptr` (i.e. profiling is disabled).
+     */
+    class Call {
+        Profiler* profiler;
+
+    public:
+        template <typename Name>
+        Call(Profiler* profiler, const Range& location, Name name) : profiler(profiler) {
+            if (this->profiler != nullptr) {
+                this->profiler->enter(location, std::move(name));
+            }
+        }
+        ~Call() {
+            if (this->profiler != nullptr) {
+                this->profiler->exit();
+            }
+        }
+
+        Call(const Call&) = delete;
+        auto operator=(const Call&) -> Call& = delete;
+    };
+};
+
+} // namespace minilua::details
+
+#endif
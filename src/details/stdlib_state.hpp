@@ -0,0 +1,38 @@
+#ifndef MINILUA_DETAILS_STDLIB_STATE_HPP
+#define MINILUA_DETAILS_STDLIB_STATE_HPP
+
+#include "MiniLua/allocator.hpp"
+#include "MiniLua/package.hpp"
+#include "pattern.hpp"
+
+#include <random>
+
+namespace minilua::details {
+
+/**
+ * The mutable state of the stdlib functions of one interpreter.
+ *
+ * It is owned by the Interpreter and every Env of the interpreter points to it
+ * (see Env::stdlib_state). Nothing in the stdlib is shared between
+ * interpreters so they can run on different threads at the same time.
+ *
+ * Environments that don't belong to an interpreter have no state. Then the
+ * functions fall back to per call or thread local defaults.
+ */
+struct StdlibState {
+    /**
+     * The compiled lua patterns (used by the string functions).
+     */
+    PatternCache pattern_cache;
+    /**
+     * The generator of `math.random` (seeded by `math.randomseed`).
+     */
+    std::default_random_engine random_engine;
+    package::State package;
+
+    explicit StdlibState(MemoryAllocator* allocator) : package(allocator) {}
+};
+
+} // namespace minilua::details
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef MINILUA_DETAILS_STRING_TABLE_HPP
+#define MINILUA_DETAILS_STRING_TABLE_HPP
+
+#include "MiniLua/allocator.hpp"
+#include "MiniLua/values.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace minilua {
+
+/**
+ * The shared buffer of a String.
+ *
+ * `table` is the StringTable the string is interned in (or `nullptr` if it
+ * is not interned).
+ */
+struct String::Data {
+    std::string value;
+    std::size_t hash;
+    mutable details::StringTable* table;
+};
+
+namespace details {
+
+/**
+ * The interned short strings of one MemoryAllocator (see String).
+ *
+ * Interned strings remove themselves from the table when the last reference
+ * is dropped. Strings that outlive the table are no longer interned.
+ *
+ * The table is not synchronized. Like the tables of the allocator it must
+ * only be used by one thread at a time (i.e. the thread that runs the
+ * interpreter owning the allocator).
+ */
+class StringTable {
+    struct Entry {
+        const String::Data* data;
+        std::weak_ptr<const String::Data> weak;
+    };
+    std::unordered_map<std::string_view, Entry> strings;
+
+    void remove(const String::Data* data);
+
+public:
+    StringTable() = default;
+    ~StringTable();
+
+    StringTable(const StringTable&) = delete;
+    auto operator=(const StringTable&) -> StringTable& = delete;
+
+    /**
+     * Returns the interned string with the given content. Creates it if it
+     * doesn't exist yet.
+     */
+    auto intern(std::string value, std::size_t hash) -> std::shared_ptr<const String::Data>;
+
+    /**
+     * The number of interned strings.
+     */
+    [[nodiscard]] auto size() const -> std::size_t;
+};
+
+/**
+ * Interns the short strings created by the current thread in the string
+ * table of `allocator` until the scope is destroyed.
+ *
+ * `nullptr` disables interning (e.g. for values that are shared between
+ * threads).
+ */
+class StringTableScope {
+    StringTable* previous;
+
+public:
+    explicit StringTableScope(MemoryAllocator* allocator);
+    ~StringTableScope();
+    StringTableScope(const StringTableScope&) = delete;
+    auto operator=(const StringTableScope&) -> StringTableScope& = delete;
+};
+
+/**
+ * The string table of the current thread (or `nullptr`).
+ */
+auto current_string_table() -> StringTable*;
+
+} // namespace details
+} // namespace minilua
+
+#endif
@@ -0,0 +1,205 @@
+#include "table_sort.hpp"
+#include "../table.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <variant>
+
+namespace minilua::details {
+
+// smaller ranges are sorted using insertion sort
+static const std::size_t INSERTION_SORT_THRESHOLD = 16;
+
+[[noreturn]] static void invalid_order_function() {
+    throw std::runtime_error("invalid order function for sorting");
+}
+
+template <typename Less> class Introsort {
+    TableImpl& table;
+    Less less;
+
+    // the order function can modify the table so every access is checked
+    auto at(std::size_t index) -> Value& {
+        if (index >= table.array.size()) {
+            invalid_order_function();
+        }
+        return table.array[index].second;
+    }
+
+    auto compare(std::size_t a, std::size_t b) -> bool { return less(at(a), at(b)); }
+
+    void swap(std::size_t a, std::size_t b) {
+        if (a != b) {
+            std::swap(at(a), at(b));
+        }
+    }
+
+    // `lo` and `hi` are inclusive
+    void insertion_sort(std::size_t lo, std::size_t hi) {
+        for (std::size_t i = lo + 1; i <= hi; ++i) {
+            for (std::size_t j = i; j > lo && compare(j, j - 1); --j) {
+                swap(j, j - 1);
+            }
+        }
+    }
+
+    void sift_down(std::size_t lo, std::size_t root, std::size_t size) {
+        std::size_t child = 0;
+        while ((child = 2 * root + 1) < size) {
+            if (child + 1 < size && compare(lo + child, lo + child + 1)) {
+                child++;
+            }
+            if (!compare(lo + root, lo + child)) {
+                return;
+            }
+            swap(lo + root, lo + child);
+            root = child;
+        }
+    }
+
+    void heap_sort(std::size_t lo, std::size_t hi) {
+        const std::size_t size = hi - lo + 1;
+        for (std::size_t root = size / 2; root-- > 0;) {
+            sift_down(lo, root, size);
+        }
+        for (std::size_t end = size - 1; end > 0; --end) {
+            swap(lo, lo + end);
+            sift_down(lo, 0, end);
+        }
+    }
+
+    // Partitions the range like the reference implementation and returns the
+    // final position of the pivot. Afterwards the elements before the pivot
+    // are not greater and the elements after it are not less than the pivot.
+    auto partition(std::size_t lo, std::size_t hi) -> std::size_t {
+        // sort lo, mid and hi so they are sentinels for the loops below
+        const std::size_t mid = lo + (hi - lo) / 2;
+        if (compare(hi, lo)) {
+            swap(lo, hi);
+        }
+        if (compare(mid, lo)) {
+            swap(mid, lo);
+        } else if (compare(hi, mid)) {
+            swap(mid, hi);
+        }
+
+        // the pivot stays at `hi - 1` until the end
+        const std::size_t pivot = hi - 1;
+        swap(mid, pivot);
+
+        std::size_t i = lo;
+        std::size_t j = pivot;
+        while (true) {
+            // a consistent order function stops at the pivot at the latest
+            while (compare(++i, pivot)) {
+                if (i == pivot) {
+                    invalid_order_function();
+                }
+            }
+            // a consistent order function stops at `lo` at the latest
+            while (compare(pivot, --j)) {
+                if (j < i) {
+                    invalid_order_function();
+                }
+            }
+            if (j < i) {
+                break;
+            }
+            swap(i, j);
+        }
+        swap(pivot, i);
+        return i;
+    }
+
+    void sort(std::size_t lo, std::size_t hi, std::size_t depth) {
+        while (hi - lo + 1 > INSERTION_SORT_THRESHOLD) {
+            if (depth == 0) {
+                heap_sort(lo, hi);
+                return;
+            }
+            depth--;
+
+            const std::size_t p = partition(lo, hi);
+            // recurse into the smaller half so the stack stays small
+            if (p - lo < hi - p) {
+                sort(lo, p - 1, depth);
+                lo = p + 1;
+            } else {
+                sort(p + 1, hi, depth);
+                hi = p - 1;
+            }
+        }
+        if (lo < hi) {
+            insertion_sort(lo, hi);
+        }
+    }
+
+public:
+    Introsort(TableImpl& table, Less less) : table(table), less(std::move(less)) {}
+
+    void sort(std::size_t size) {
+        if (size < 2) {
+            return;
+        }
+        std::size_t depth = 0;
+        for (std::size_t n = size; n > 1; n /= 2) {
+            depth += 2;
+        }
+        sort(0, size - 1, depth);
+    }
+};
+
+template <typename Less> static void introsort(TableImpl& table, std::size_t size, Less less) {
+    Introsort<Less>(table, std::move(less)).sort(size);
+}
+
+// the elements `1..#table` (they are all in the array part)
+static auto sort_size(const TableImpl& table) -> std::size_t {
+    return std::min<std::size_t>(table.calc_border(), table.array.size());
+}
+
+void TableSort::sort(Table& table) {
+    TableImpl& impl = *table.impl;
+    const std::size_t size = sort_size(impl);
+
+    bool all_numbers = true;
+    bool all_strings = true;
+    for (std::size_t i = 0; i < size; ++i) {
+        const Value& value = impl.array[i].second;
+        all_numbers = all_numbers && value.is_number();
+        all_strings = all_strings && value.is_string();
+    }
+
+    if (all_numbers) {
+        introsort(impl, size, [](const Value& a, const Value& b) {
+            return std::get<Number>(a.raw()) < std::get<Number>(b.raw());
+        });
+    } else if (all_strings) {
+        introsort(impl, size, [](const Value& a, const Value& b) {
+            return std::get<String>(a.raw()).view() < std::get<String>(b.raw()).view();
+        });
+    } else {
+        // mixed types (this throws unless there is only a single element)
+        introsort(impl, size, [](const Value& a, const Value& b) {
+            return std::get<Bool>(a.less_than(b)).value;
+        });
+    }
+}
+
+void TableSort::sort(Table& table, const Function& comp, const CallContext& ctx) {
+    // don't copy the arguments of `table.sort` into every call
+    const CallContext call_ctx = ctx.make_new(Vallist());
+
+    TableImpl& impl = *table.impl;
+    introsort(impl, sort_size(impl), [&comp, &call_ctx](const Value& a, const Value& b) {
+        auto result = comp.call(call_ctx.make_new(Vallist{a, b})).values().get(0);
+        if (const auto* value = std::get_if<Bool>(&result.raw())) {
+            return value->value;
+        }
+        invalid_order_function();
+    });
+}
+
+} // namespace minilua::details
@@ -0,0 +1,41 @@
+#ifndef MINILUA_DETAILS_TABLE_SORT_HPP
+#define MINILUA_DETAILS_TABLE_SORT_HPP
+
+#include "MiniLua/values.hpp"
+
+namespace minilua::details {
+
+/**
+ * Sorts the elements `1..#table` of a table in place (used by `table.sort`).
+ *
+ * The elements are always stored in the array part of the table (see
+ * TableImpl) so they are sorted directly in the storage of the table without
+ * copying them out and back in.
+ *
+ * The algorithm is an introsort: a quicksort with median-of-three pivots that
+ * switches to heapsort if the recursion gets too deep and to insertion sort
+ * for small ranges. All loops are bounded so an inconsistent order function
+ * throws "invalid order function for sorting" (like in the reference
+ * implementation) instead of reading past the array. Elements are only ever
+ * swapped so the table holds all of its elements even while the order
+ * function is running.
+ *
+ * Without an order function arrays that only contain numbers or only contain
+ * strings are compared directly instead of through Value::less_than.
+ */
+class TableSort {
+public:
+    /**
+     * Sorts using the `<` operator.
+     */
+    static void sort(Table& table);
+
+    /**
+     * Sorts using the order function `comp`. It has to return a boolean.
+     */
+    static void sort(Table& table, const Function& comp, const CallContext& ctx);
+};
+
+} // namespace minilua::details
+
+#endif
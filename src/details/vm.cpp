@@ -0,0 +1,700 @@
+#include "MiniLua/environment.hpp"
+#include "MiniLua/exceptions.hpp"
+#include "MiniLua/metatables.hpp"
+#include "bytecode.hpp"
+#include "concat.hpp"
+#include "interpreter.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace minilua::details {
+
+using bytecode::Instruction;
+using bytecode::OpCode;
+
+// helper functions
+
+/**
+ * Collects the values of a value list (see bytecode::OpCode).
+ */
+static auto collect_values(
+    const std::vector<Value>& registers, std::uint32_t first, std::uint32_t count, bool multi,
+    const Vallist& multi_values) -> std::vector<Value> {
+    std::vector<Value> values;
+    values.reserve(count + (multi ? multi_values.size() : 0));
+    std::copy(
+        registers.begin() + first, registers.begin() + first + count, std::back_inserter(values));
+    if (multi) {
+        std::copy(multi_values.begin(), multi_values.end(), std::back_inserter(values));
+    }
+    return values;
+}
+
+/**
+ * The upvalues that still point to the registers of a running function.
+ *
+ * All of them are closed when the function returns (or throws).
+ */
+class OpenUpvalues {
+    std::vector<std::pair<std::uint32_t, std::shared_ptr<Upvalue>>> upvalues;
+
+public:
+    OpenUpvalues() = default;
+    OpenUpvalues(const OpenUpvalues&) = delete;
+    auto operator=(const OpenUpvalues&) -> OpenUpvalues& = delete;
+    ~OpenUpvalues() { this->close(0); }
+
+    /**
+     * Returns the open upvalue for the register or creates a new one.
+     */
+    auto get(std::vector<Value>& registers, std::uint32_t index) -> std::shared_ptr<Upvalue> {
+        for (const auto& [register_index, upvalue] : this->upvalues) {
+            if (register_index == index) {
+                return upvalue;
+            }
+        }
+        auto upvalue = std::make_shared<Upvalue>(&registers[index]);
+        this->upvalues.emplace_back(index, upvalue);
+        return upvalue;
+    }
+
+    /**
+     * Closes all upvalues pointing to registers `>= level`.
+     */
+    void close(std::uint32_t level) {
+        auto first_closed = std::remove_if(
+            this->upvalues.begin(), this->upvalues.end(), [level](const auto& entry) {
+                if (entry.first >= level) {
+                    entry.second->close();
+                    return true;
+                }
+                return false;
+            });
+        this->upvalues.erase(first_closed, this->upvalues.end());
+    }
+};
+
+/**
+ * Registers a running function for the garbage collector (see Frame).
+ */
+class ActiveFrame {
+    std::vector<const Frame*>& frames;
+
+public:
+    ActiveFrame(std::vector<const Frame*>& frames, const Frame& frame) : frames(frames) {
+        this->frames.push_back(&frame);
+    }
+    ActiveFrame(const ActiveFrame&) = delete;
+    auto operator=(const ActiveFrame&) -> ActiveFrame& = delete;
+    ~ActiveFrame() { this->frames.pop_back(); }
+};
+
+/**
+ * Looks up the field `N[c]` of the value using the inline cache of the
+ * instruction (see FieldCache).
+ *
+ * Returns `nullptr` if the value is not a table or if the lookup can't be
+ * cached. Then `mt::index` has to be used.
+ */
+static auto find_cached_field(FieldCache& cache, const Value& value, const Value& key) -> Value* {
+    const auto* table = std::get_if<Table>(&value.raw());
+    if (table == nullptr) {
+        return nullptr;
+    }
+
+    if (Value* entry = cache.find(*table)) {
+        return entry;
+    }
+    return cache.update(*table, key);
+}
+
+static auto is_bytecode_function(const Value& value) -> bool {
+    const auto* function = std::get_if<Function>(&value.raw());
+    return function != nullptr && function->target<BytecodeFunction>() != nullptr;
+}
+
+auto Interpreter::call_metamethod(
+    CallResult (*f)(const CallContext&, std::optional<Range>), const std::string& name,
+    Vallist args, const Range& location, Env& env) -> CallResult {
+    this->trace_metamethod_call(name, args);
+
+    NativeCall native_call(*this);
+
+    BorrowedContext ctx(env);
+
+    auto call_result = with_call_stack(
+        [&f, &ctx, &args, &location]() { return f(ctx.make_new(std::move(args)), location); },
+        [&name, &location]() { return describe_metamethod_call(name, location); });
+    return call_result.one_value();
+}
+
+auto Interpreter::call_function(
+    const Value& function, Vallist arguments, const Range& location, Env& env) -> CallResult {
+    BorrowedContext ctx(env);
+
+    if (const auto* raw_function = std::get_if<Function>(&function.raw())) {
+        // copy the function because the call could overwrite the value it is
+        // stored in (e.g. through an upvalue)
+        Function callee = *raw_function;
+        return callee.call(ctx.make_new(std::move(arguments), location));
+    }
+
+    // metamethod __call gets the called object as first argument
+    std::vector<Value> meta_arguments;
+    meta_arguments.reserve(arguments.size() + 1);
+    meta_arguments.push_back(function);
+    std::copy(arguments.begin(), arguments.end(), std::back_inserter(meta_arguments));
+    return mt::call(ctx.make_new(std::move(meta_arguments), location));
+}
+
+auto Interpreter::is_plain_number_operation(const Value& lhs, const Value& rhs) const -> bool {
+    // NOTE: metamethod calls are still traced if requested
+    return lhs.is_number() && rhs.is_number() && !this->config.trace_metamethod_calls;
+}
+
+auto Interpreter::concat(Value* values, std::size_t count, const Range* locations, Env& env)
+    -> CallResult {
+    // NOTE: metamethod calls are still traced if requested
+    const bool plain = !this->config.trace_metamethod_calls;
+
+    std::optional<SourceChangeTree> source_changes;
+    auto value = concat_chain(
+        values, count, plain,
+        [this, plain, locations, &env,
+         &source_changes](std::size_t i, const Value& lhs, const Value& rhs) -> Value {
+            auto location = locations[i].with_file(env.get_file());
+            if (plain && is_concatenable(lhs) && is_concatenable(rhs)) {
+                return lhs.concat(rhs, location);
+            }
+            auto call_result =
+                this->call_metamethod(mt::concat, "concat", Vallist{lhs, rhs}, location, env);
+            append_source_change(source_changes, call_result.source_change());
+            return call_result.values().get(0);
+        },
+        [locations, &env](std::size_t i, const Value* run, std::size_t length) {
+            return concat_flattened(run, length, locations[i].with_file(env.get_file()));
+        });
+    return CallResult(Vallist(std::move(value)), std::move(source_changes));
+}
+
+auto Interpreter::field_caches_of(const bytecode::Proto& proto) -> FieldCache* {
+    if (proto.num_field_caches == 0) {
+        return nullptr;
+    }
+
+    auto [caches, inserted] = this->field_caches.try_emplace(proto.id);
+    if (inserted) {
+        caches->second.resize(proto.num_field_caches);
+    }
+    return caches->second.data();
+}
+
+auto Interpreter::execute(
+    const bytecode::Proto& proto, Env& env, const Upvalues& upvalues, const Vallist& arguments)
+    -> EvalResult {
+    EvalResult result;
+
+    // NOTE the vector is not resized after it was created so the pointer stays valid
+    FieldCache* field_caches = this->field_caches_of(proto);
+
+    std::vector<Value> registers(proto.num_registers);
+    Vallist multi;
+
+    for (std::size_t i = 0; i < proto.parameters.size(); ++i) {
+        registers[i] = arguments.get(i);
+    }
+
+    // NOTE has to be destroyed before the registers
+    OpenUpvalues open_upvalues;
+
+    Frame frame{
+        .registers = registers,
+        .multi = multi,
+        .result = result.values,
+        .upvalues = upvalues,
+        .env = env,
+    };
+    ActiveFrame active_frame(this->frames, frame);
+
+    auto add_source_change = [&result](const std::optional<SourceChangeTree>& source_change) {
+        append_source_change(result.source_change, source_change);
+    };
+
+    std::size_t pc = 0;
+    while (true) {
+        const Instruction& ins = proto.code[pc];
+        pc++;
+
+        if (this->profiler != nullptr) {
+            this->profiler->step();
+        }
+        if (this->config.trace_nodes) {
+            this->tracer() << "Execute: " << ins << "\n";
+        }
+
+        switch (ins.op) {
+        case OpCode::LOAD_NIL:
+            std::fill_n(registers.begin() + ins.a, ins.b, Value());
+            break;
+        case OpCode::LOAD_CONST: {
+            if (this->config.origin_tracking == OriginTracking::OFF) {
+                registers[ins.a] = proto.constants[ins.b];
+                break;
+            }
+            auto origin = LiteralOrigin{.location = proto.locations[ins.loc]};
+            origin.location.file = env.get_file();
+            registers[ins.a] = proto.constants[ins.b].with_origin(origin);
+            break;
+        }
+        case OpCode::LOAD_LITERAL: {
+            const auto& content = proto.names[ins.b];
+            Value value =
+                ins.c == 0 ? parse_number_literal(content) : parse_string_literal(content);
+
+            auto origin = LiteralOrigin{.location = proto.locations[ins.loc]};
+            origin.location.file = env.get_file();
+            registers[ins.a] = value.with_origin(origin);
+            break;
+        }
+        case OpCode::LOAD_FOLDED:
+            registers[ins.a] = proto.constants[ins.b];
+            break;
+        case OpCode::MOVE:
+            registers[ins.a] = registers[ins.b];
+            break;
+        case OpCode::UNPACK:
+            for (std::uint32_t i = 0; i < ins.b; ++i) {
+                registers[ins.a + i] = multi.get(i);
+            }
+            break;
+
+        case OpCode::GET_GLOBAL:
+            registers[ins.a] = env.get_global(proto.name_values[ins.b]);
+            break;
+        case OpCode::SET_GLOBAL:
+            env.set_global(proto.name_values[ins.b], registers[ins.a]);
+            break;
+        case OpCode::GET_UPVALUE:
+            registers[ins.a] = *upvalues[ins.b]->value;
+            break;
+        case OpCode::SET_UPVALUE:
+            *upvalues[ins.b]->value = registers[ins.a];
+            break;
+        case OpCode::CLOSE:
+            open_upvalues.close(ins.a);
+            break;
+
+        case OpCode::GET_INDEX:
+        case OpCode::GET_FIELD: {
+            const Value& key =
+                ins.op == OpCode::GET_INDEX ? registers[ins.c] : proto.name_values[ins.c];
+
+            if (ins.op == OpCode::GET_FIELD) {
+                if (const Value* entry =
+                        find_cached_field(field_caches[ins.cache], registers[ins.b], key)) {
+                    registers[ins.a] = *entry;
+                    break;
+                }
+            }
+
+            if (auto value = raw_index(registers[ins.b], key)) {
+                registers[ins.a] = std::move(*value);
+                break;
+            }
+
+            NativeCall native_call(*this);
+
+            BorrowedContext ctx(env);
+
+            auto index_call_result = mt::index(ctx.make_new({registers[ins.b], key}));
+            add_source_change(index_call_result.source_change());
+            registers[ins.a] = index_call_result.values().get(0);
+            break;
+        }
+        case OpCode::SET_INDEX:
+        case OpCode::SET_FIELD: {
+            const Value& key =
+                ins.op == OpCode::SET_INDEX ? registers[ins.b] : proto.name_values[ins.b];
+
+            // existing fields are overwritten without looking at the metatable
+            if (ins.op == OpCode::SET_FIELD) {
+                Value* entry = find_cached_field(field_caches[ins.cache], registers[ins.a], key);
+                if (entry != nullptr && field_caches[ins.cache].is_own_entry()) {
+                    *entry = registers[ins.c];
+                    break;
+                }
+            }
+
+            if (raw_newindex(registers[ins.a], key, registers[ins.c])) {
+                break;
+            }
+
+            NativeCall native_call(*this);
+
+            BorrowedContext ctx(env);
+
+            auto newindex_call_result =
+                mt::newindex(ctx.make_new({registers[ins.a], key, registers[ins.c]}));
+            add_source_change(newindex_call_result.source_change());
+            break;
+        }
+
+        case OpCode::NEW_TABLE:
+            registers[ins.a] = Table(env.allocator());
+            this->step_garbage_collector(env);
+            break;
+        case OpCode::TABLE_SET:
+            std::get<Table>(registers[ins.a].raw()).set(registers[ins.b], registers[ins.c]);
+            break;
+        case OpCode::TABLE_SET_FIELD:
+            std::get<Table>(registers[ins.a].raw()).set(proto.name_values[ins.b], registers[ins.c]);
+            break;
+        case OpCode::TABLE_APPEND: {
+            auto& table = std::get<Table>(registers[ins.a].raw());
+            if (ins.multi) {
+                int key = static_cast<int>(ins.b);
+                for (const auto& value : multi) {
+                    table.set(key, value);
+                    key++;
+                }
+            } else {
+                table.set(static_cast<int>(ins.b), registers[ins.c]);
+            }
+            break;
+        }
+
+            // operators supporting metamethods
+#define IMPL_MT(op, function, name)                                                                \
+    case OpCode::op: {                                                                             \
+        auto origin = proto.locations[ins.loc].with_file(env.get_file());                          \
+        auto call_result = this->call_metamethod(                                                  \
+            function, name, Vallist{registers[ins.b], registers[ins.c]}, origin, env);             \
+        add_source_change(call_result.source_change());                                            \
+        registers[ins.a] = call_result.values().get(0);                                            \
+        break;                                                                                     \
+    }
+
+            // operators supporting metamethods with a fast path for numbers
+#define IMPL_NUMERIC_MT(op, function, name, method)                                                \
+    case OpCode::op: {                                                                             \
+        const Value& lhs = registers[ins.b];                                                       \
+        const Value& rhs = registers[ins.c];                                                       \
+        auto origin = proto.locations[ins.loc].with_file(env.get_file());                          \
+        if (this->is_plain_number_operation(lhs, rhs)) {                                           \
+            registers[ins.a] = lhs.method(rhs, origin);                                            \
+            break;                                                                                 \
+        }                                                                                          \
+        auto call_result = this->call_metamethod(function, name, Vallist{lhs, rhs}, origin, env);  \
+        add_source_change(call_result.source_change());                                            \
+        registers[ins.a] = call_result.values().get(0);                                            \
+        break;                                                                                     \
+    }
+
+            // arithmetic
+            IMPL_NUMERIC_MT(ADD, mt::add, "add", add)
+            IMPL_NUMERIC_MT(SUB, mt::sub, "sub", sub)
+            IMPL_NUMERIC_MT(MUL, mt::mul, "mul", mul)
+            IMPL_NUMERIC_MT(DIV, mt::div, "div", div)
+            IMPL_NUMERIC_MT(MOD, mt::mod, "mod", mod)
+            IMPL_NUMERIC_MT(POW, mt::pow, "pow", pow)
+            IMPL_NUMERIC_MT(INT_DIV, mt::idiv, "idiv", int_div)
+
+            // bitwise
+            IMPL_MT(BIT_AND, mt::band, "band")
+            IMPL_MT(BIT_OR, mt::bor, "bor")
+            IMPL_MT(BIT_XOR, mt::bxor, "bxor")
+            IMPL_MT(SHIFT_LEFT, mt::shl, "shl")
+            IMPL_MT(SHIFT_RIGHT, mt::shr, "shr")
+
+            // comparison
+            IMPL_NUMERIC_MT(EQ, mt::eq, "eq", equals)
+            IMPL_NUMERIC_MT(LT, mt::lt, "lt", less_than)
+            IMPL_NUMERIC_MT(LEQ, mt::le, "le", less_than_or_equal)
+
+#undef IMPL_MT
+#undef IMPL_NUMERIC_MT
+
+            // the following operators have to be converted to other metamethods
+        case OpCode::GT:
+        case OpCode::GEQ: {
+            // gt: "x > y" == "y < x"
+            // geq: "x >= y" == "y <= x"
+            auto origin = proto.locations[ins.loc].with_file(env.get_file());
+            if (this->is_plain_number_operation(registers[ins.c], registers[ins.b])) {
+                registers[ins.a] =
+                    ins.op == OpCode::GT
+                        ? registers[ins.c].less_than(registers[ins.b], origin)
+                        : registers[ins.c].less_than_or_equal(registers[ins.b], origin);
+                break;
+            }
+            auto call_result = ins.op == OpCode::GT
+                                   ? this->call_metamethod(
+                                         mt::lt, "gt", Vallist{registers[ins.c], registers[ins.b]},
+                                         origin, env)
+                                   : this->call_metamethod(
+                                         mt::le, "geq", Vallist{registers[ins.c], registers[ins.b]},
+                                         origin, env);
+            add_source_change(call_result.source_change());
+            registers[ins.a] = call_result.values().get(0);
+            break;
+        }
+        case OpCode::NEQ: {
+            // neq: "x ~= y" == "not (x == y)"
+            auto origin = proto.locations[ins.loc].with_file(env.get_file());
+            if (this->is_plain_number_operation(registers[ins.b], registers[ins.c])) {
+                registers[ins.a] = registers[ins.b].equals(registers[ins.c], origin).invert();
+                break;
+            }
+            auto call_result = this->call_metamethod(
+                mt::eq, "eq", Vallist{registers[ins.b], registers[ins.c]}, origin, env);
+            add_source_change(call_result.source_change());
+            registers[ins.a] = call_result.values().get(0).invert();
+            break;
+        }
+
+            // these don't have metamethods
+            //
+            // NOTE both operands are already evaluated (like in the tree
+            // walking interpreter). Short circuiting would make the programs
+            // behave differently depending on the engine.
+        case OpCode::AND: {
+            auto origin = proto.locations[ins.loc].with_file(env.get_file());
+            registers[ins.a] = registers[ins.b].logic_and(registers[ins.c], origin);
+            break;
+        }
+        case OpCode::OR: {
+            auto origin = proto.locations[ins.loc].with_file(env.get_file());
+            registers[ins.a] = registers[ins.b].logic_or(registers[ins.c], origin);
+            break;
+        }
+
+        case OpCode::CONCAT: {
+            auto call_result =
+                this->concat(&registers[ins.b], ins.c, &proto.locations[ins.loc], env);
+            add_source_change(call_result.source_change());
+            registers[ins.a] = call_result.values().get(0);
+            break;
+        }
+
+#define IMPL_MT(op, function, name)                                                                \
+    case OpCode::op: {                                                                             \
+        auto range = proto.locations[ins.loc].with_file(env.get_file());                           \
+        auto call_result =                                                                         \
+            this->call_metamethod(function, name, Vallist{registers[ins.b]}, range, env);          \
+        add_source_change(call_result.source_change());                                            \
+        registers[ins.a] = call_result.values().get(0);                                            \
+        break;                                                                                     \
+    }
+
+            IMPL_MT(NEG, mt::unm, "unm")
+            IMPL_MT(BWNOT, mt::bnot, "bnot")
+            IMPL_MT(LEN, mt::len, "len")
+
+#undef IMPL_MT
+
+        case OpCode::NOT: {
+            auto range = proto.locations[ins.loc].with_file(env.get_file());
+            registers[ins.a] = registers[ins.b].invert(range);
+            break;
+        }
+
+        case OpCode::CLOSURE: {
+            const auto& function_proto = proto.protos[ins.b];
+
+            Upvalues captured;
+            captured.reserve(function_proto->upvalues.size());
+            for (const auto& upvalue : function_proto->upvalues) {
+                if (upvalue.in_register) {
+                    captured.push_back(open_upvalues.get(registers, upvalue.index));
+                } else {
+                    captured.push_back(upvalues[upvalue.index]);
+                }
+            }
+
+            registers[ins.a] = Function(BytecodeFunction{
+                .proto = function_proto,
+                .env = Env(env),
+                .upvalues = std::move(captured),
+                .interpreter = *this,
+            });
+            if (this->defined_functions != nullptr) {
+                this->defined_functions->emplace(registers[ins.a], function_proto);
+            }
+            break;
+        }
+        case OpCode::VARARG: {
+            auto varargs = env.get_varargs();
+
+            if (!varargs.has_value()) {
+                throw InterpreterException("cannot use '...' outside a vararg function");
+            }
+
+            if (this->config.trace_varargs) {
+                this->tracer() << "varargs: " << *varargs << "\n";
+            }
+
+            if (ins.multi) {
+                multi = *varargs;
+            } else {
+                registers[ins.a] = varargs->get(0);
+            }
+            break;
+        }
+        case OpCode::CALL:
+        case OpCode::TAIL_CALL: {
+            const auto& function_name = proto.names[ins.c];
+
+            auto arguments = collect_values(registers, ins.a + 1, ins.b, ins.multi, multi);
+            this->trace_function_call(function_name, arguments);
+
+            // call function
+            // this will produce an error if the obj is not callable
+            const auto& obj = registers[ins.a];
+
+            if (ins.op == OpCode::TAIL_CALL && is_bytecode_function(obj)) {
+                // the calling BytecodeFunction executes the function after
+                // this one returned
+                result.values = Vallist();
+                result.tail_call = TailCall{
+                    .function = std::get<Function>(obj.raw()),
+                    .arguments = Vallist(std::move(arguments)),
+                };
+                if (TailCalls::needs_call_info(*this)) {
+                    result.tail_call->name = function_name;
+                    result.tail_call->location =
+                        proto.locations[ins.loc].with_file(env.get_file());
+                }
+                return result;
+            }
+
+            auto call_range = proto.locations[ins.loc].with_file(env.get_file());
+
+            auto call_result = [&]() {
+                // bytecode functions register their own frame
+                NativeCall native_call(*this, !is_bytecode_function(obj));
+                Profiler::Call profiler_call(
+                    this->profiler.get(), call_range, [&function_name]() { return function_name; });
+                return with_call_stack(
+                    [&]() {
+                        return this->call_function(obj, std::move(arguments), call_range, env);
+                    },
+                    [&function_name, &call_range]() {
+                        return describe_function_call(function_name, call_range);
+                    });
+            }();
+            add_source_change(call_result.source_change());
+
+            this->trace_function_call_result(function_name, call_result);
+
+            if (ins.op == OpCode::TAIL_CALL) {
+                result.values = call_result.values();
+                return result;
+            }
+
+            multi = call_result.values();
+            registers[ins.a] = multi.get(0);
+            this->step_garbage_collector(env);
+            break;
+        }
+
+        case OpCode::ENTER_BLOCK:
+            this->trace_enter_block(env);
+            break;
+
+        case OpCode::JMP:
+            pc = ins.b;
+            break;
+        case OpCode::JMP_IF_NOT:
+            if (!registers[ins.a]) {
+                pc = ins.b;
+            }
+            break;
+        case OpCode::BREAK:
+            if (this->config.trace_break) {
+                this->tracer() << "break\n";
+            }
+            open_upvalues.close(ins.a);
+            pc = ins.b;
+            break;
+
+        case OpCode::RETURN:
+            result.values = collect_values(registers, ins.a, ins.b, ins.multi, multi);
+            return result;
+        case OpCode::SET_RESULT:
+            result.values = collect_values(registers, ins.a, ins.b, ins.multi, multi);
+            break;
+        case OpCode::CLEAR_RESULT:
+            result.values = Vallist();
+            break;
+        case OpCode::HALT:
+            return result;
+
+        case OpCode::ERROR:
+            throw InterpreterException(proto.names[ins.b]);
+        }
+    }
+}
+
+// struct BytecodeFunction
+auto BytecodeFunction::operator()(const CallContext& ctx) -> CallResult {
+    Interpreter::CallDepth call_depth(this->interpreter);
+    Interpreter::LuaCall lua_call(this->interpreter, ctx.arguments());
+    Interpreter::TailCalls tail_calls(this->interpreter);
+
+    const BytecodeFunction* function = this;
+    const Vallist* arguments = &ctx.arguments();
+    std::optional<SourceChangeTree> source_change;
+
+    // keeps the function and arguments of the current tail call alive
+    std::optional<TailCall> tail_call;
+
+    while (true) {
+        auto result = function->execute(*arguments);
+        append_source_change(source_change, std::move(result.source_change));
+
+        if (!result.tail_call) {
+            auto call_result = CallResult(std::move(result.values), std::move(source_change));
+            tail_calls.trace_results(call_result);
+            lua_call.keep_results(call_result.values());
+            return call_result;
+        }
+
+        tail_call = std::move(result.tail_call);
+        tail_calls.enter(*tail_call);
+        function = tail_call->function.target<BytecodeFunction>();
+        arguments = &tail_call->arguments;
+    }
+}
+
+auto BytecodeFunction::execute(const Vallist& arguments) const -> EvalResult {
+    const auto& parameters = this->proto->parameters;
+
+    auto env = Env(this->env);
+
+    // add varargs to the environment
+    if (this->proto->vararg) {
+        std::vector<Value> varargs;
+        if (parameters.size() < arguments.size()) {
+            varargs.reserve(arguments.size() - parameters.size());
+            std::copy(
+                arguments.begin() + parameters.size(), arguments.end(),
+                std::back_inserter(varargs));
+        }
+        env.set_varargs(varargs);
+    } else {
+        // explicitly unset varargs because it is only allowed to use the
+        // expression `...` directly inside the vararg function and not
+        // in nested functions
+        env.set_varargs(std::nullopt);
+    }
+
+    interpreter.trace_enter_block(env);
+
+    // execute the actual function in the correct environment
+    return interpreter.execute(*this->proto, env, this->upvalues, arguments);
+}
+
+} // namespace minilua::details
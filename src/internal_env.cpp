@@ -6,12 +6,39 @@
 namespace minilua {
 
 // struct Environment::Impl
-Environment::Impl::Impl(Env env) : inner(std::move(env)) {}
-Environment::Impl::Impl(MemoryAllocator* allocator) : inner(Env(allocator)) {}
+Environment::Impl::Impl(Env env) : owned(std::move(env)), env(&*this->owned) {}
+Environment::Impl::Impl(MemoryAllocator* allocator) : Impl(Env(allocator)) {}
+Environment::Impl::Impl(Env* env) : env(env) {}
+Environment::Impl::Impl(const Impl& other) : Impl(other.inner()) {}
+Environment::Impl::Impl(Impl&& other) noexcept
+    : owned(std::move(other.owned)), env(this->owned ? &*this->owned : other.env) {}
+auto Environment::Impl::operator=(const Impl& other) -> Impl& {
+    if (this != &other) {
+        this->owned = other.inner();
+        this->env = &*this->owned;
+    }
+    return *this;
+}
+auto Environment::Impl::operator=(Impl&& other) noexcept -> Impl& {
+    this->owned = std::move(other.owned);
+    this->env = this->owned ? &*this->owned : other.env;
+    return *this;
+}
+auto Environment::Impl::borrow(Env& env) -> Impl { return Impl(&env); }
+auto Environment::Impl::inner() -> Env& { return *this->env; }
+auto Environment::Impl::inner() const -> const Env& { return *this->env; }
+
+// class BorrowedContext
+BorrowedContext::BorrowedContext(Env& env)
+    : environment(Environment::Impl::borrow(env)), ctx(&this->environment) {}
+auto BorrowedContext::make_new(Vallist args, std::optional<Range> location) const -> CallContext {
+    return this->ctx.make_new(std::move(args), std::move(location));
+}
 
 Env::Env() : Env(&GLOBAL_ALLOCATOR) {}
 Env::Env(MemoryAllocator* allocator)
-    : _allocator(allocator), in(&std::cin), out(&std::cout), err(&std::cerr) {}
+    : _allocator(allocator), _global(allocator), in(&std::cin), out(&std::cout),
+      err(&std::cerr) {}
 Env::operator Environment() const { return Environment(Environment::Impl{*this}); }
 
 auto Env::make_table() const -> Table { return Table(this->allocator()); }
@@ -40,10 +67,10 @@ auto Env::is_local(const std::string& name) -> bool {
     return this->local().find(name) != this->local().end();
 }
 
-void Env::set_global(const std::string& name, Value value) {
+void Env::set_global(const Value& name, Value value) {
     this->global().set(name, std::move(value));
 }
-auto Env::get_global(const std::string& name) -> Value { return this->global().get(name); }
+auto Env::get_global(const Value& name) -> Value { return this->global().get(name); }
 
 void Env::set_var(const std::string& name, Value value) {
     if (this->is_local(name)) {
@@ -60,7 +87,7 @@ auto Env::get_var(const std::string& name) -> Value {
     }
 }
 void Env::set_varargs(std::optional<Vallist> vallist) { this->varargs = std::move(vallist); }
-auto Env::get_varargs() const -> std::optional<Vallist> { return this->varargs; }
+auto Env::get_varargs() const -> const std::optional<Vallist>& { return this->varargs; }
 
 void Env::set_stdin(std::istream* in) {
     if (in == nullptr) {
@@ -90,6 +117,9 @@ auto Env::get_file() const -> std::optional<std::shared_ptr<std::string>> { retu
 
 auto Env::allocator() const -> MemoryAllocator* { return this->_allocator; }
 
+void Env::set_stdlib_state(details::StdlibState* state) { this->_stdlib_state = state; }
+auto Env::stdlib_state() const -> details::StdlibState* { return this->_stdlib_state; }
+
 auto operator<<(std::ostream& os, const Env& self) -> std::ostream& {
     os << "Env{ .global = " << self.global() << ", .local = {";
 
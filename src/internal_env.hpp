@@ -1,6 +1,7 @@
 #ifndef MINILUA_INTERNAL_ENV
 #define MINILUA_INTERNAL_ENV
 
+#include <optional>
 #include <unordered_map>
 
 #include <MiniLua/environment.hpp>
@@ -8,6 +9,10 @@
 
 namespace minilua {
 
+namespace details {
+struct StdlibState;
+} // namespace details
+
 /**
  * Type used for the local environment.
  *
@@ -49,6 +54,8 @@ class Env {
     std::ostream* out;
     std::ostream* err;
 
+    details::StdlibState* _stdlib_state = nullptr;
+
 public:
     Env();
     Env(MemoryAllocator* allocator);
@@ -97,13 +104,15 @@ public:
 
     /**
      * Sets the value of a global variable.
+     *
+     * The name is a Value so callers can reuse (interned) name strings.
      */
-    void set_global(const std::string&, Value);
+    void set_global(const Value& name, Value);
 
     /**
-     * Gets the value of a local variable or Nil if it was not defined.
+     * Gets the value of a global variable or Nil if it was not defined.
      */
-    auto get_global(const std::string&) -> Value;
+    auto get_global(const Value& name) -> Value;
 
     /**
      * Set a variable named `name` to `value`.
@@ -124,7 +133,7 @@ public:
      * function.
      */
     void set_varargs(std::optional<Vallist> vallist);
-    auto get_varargs() const -> std::optional<Vallist>;
+    auto get_varargs() const -> const std::optional<Vallist>&;
 
     /**
      * Sets stdin/out/err stream to use in lua code.
@@ -152,15 +161,75 @@ public:
     auto get_file() const -> std::optional<std::shared_ptr<std::string>>;
 
     [[nodiscard]] auto allocator() const -> MemoryAllocator*;
+
+    /**
+     * Sets the state of the stdlib functions (e.g. the cache for compiled lua
+     * patterns and the random number generator).
+     *
+     * The state is owned by the interpreter. It is `nullptr` for environments
+     * that don't belong to an interpreter (see details::StdlibState).
+     */
+    void set_stdlib_state(details::StdlibState* state);
+    [[nodiscard]] auto stdlib_state() const -> details::StdlibState*;
 };
 
 auto operator<<(std::ostream&, const Env&) -> std::ostream&;
 
 struct Environment::Impl {
-    Env inner;
+    // only set if the Env is not borrowed (see Environment::Impl::borrow)
+    std::optional<Env> owned;
+    Env* env;
 
     Impl(Env env);
     Impl(MemoryAllocator* allocator);
+
+    /**
+     * Copies of a borrowed environment own a copy of the Env.
+     */
+    Impl(const Impl&);
+    Impl(Impl&&) noexcept;
+    auto operator=(const Impl&) -> Impl&;
+    auto operator=(Impl&&) noexcept -> Impl&;
+    ~Impl() = default;
+
+    /**
+     * Creates an environment that refers to the given Env instead of owning
+     * a copy of it. Changes made through the Environment are visible in the
+     * Env.
+     *
+     * The Env has to outlive the Environment.
+     */
+    static auto borrow(Env& env) -> Impl;
+
+    auto inner() -> Env&;
+    [[nodiscard]] auto inner() const -> const Env&;
+
+private:
+    Impl(Env* env);
+};
+
+/**
+ * A CallContext for calls from inside the interpreter (e.g. metamethods).
+ *
+ * It borrows the Env (see Environment::Impl::borrow) instead of copying it
+ * into a new Environment. So creating it is cheap.
+ *
+ * The Env has to outlive the BorrowedContext.
+ */
+class BorrowedContext {
+    Environment environment;
+    CallContext ctx;
+
+public:
+    BorrowedContext(Env& env);
+    BorrowedContext(const BorrowedContext&) = delete;
+    auto operator=(const BorrowedContext&) -> BorrowedContext& = delete;
+
+    /**
+     * Creates a CallContext with the given arguments.
+     */
+    [[nodiscard]] auto make_new(Vallist args, std::optional<Range> location = std::nullopt) const
+        -> CallContext;
 };
 
 }; // namespace minilua
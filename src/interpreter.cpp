@@ -1,7 +1,9 @@
 #include "MiniLua/interpreter.hpp"
 #include "details/interpreter.hpp"
+#include "details/stdlib_state.hpp"
 #include "details/tree_sitter_interop.hpp"
 #include "tree_sitter/tree_sitter.hpp"
+#include "internal_env.hpp"
 #include "tree_sitter_lua.hpp"
 
 #include <algorithm>
@@ -35,7 +37,12 @@ auto operator<<(std::ostream& o, const EvalResult& self) -> std::ostream& {
 }
 
 // struct InterpreterConfig
-InterpreterConfig::InterpreterConfig() : target(&std::cerr) { this->all(false); }
+InterpreterConfig::InterpreterConfig()
+    : target(&std::cerr), engine(Engine::BYTECODE), gc_threshold(10000), // NOLINT
+      origin_tracking(OriginTracking::FULL), max_call_depth(0), profile_interval(0), // NOLINT
+      profile_period(0) {
+    this->all(false);
+}
 InterpreterConfig::InterpreterConfig(bool def) : InterpreterConfig() { this->all(def); }
 void InterpreterConfig::all(bool def) {
     this->trace_nodes = def;
@@ -52,12 +59,17 @@ struct Interpreter::Impl {
     std::string source_code;
     ts::Tree tree;
     std::unique_ptr<MemoryAllocator> allocator;
+    details::StdlibState stdlib_state;
     Environment env;
+    Profile profile;
 
     Impl(std::string initial_source_code)
         : parser(ts::LUA_LANGUAGE), source_code(std::move(initial_source_code)),
           tree(parser.parse_string(this->source_code)),
-          allocator(std::make_unique<MemoryAllocator>()), env(allocator.get()) {}
+          allocator(std::make_unique<MemoryAllocator>()), stdlib_state(allocator.get()),
+          env(allocator.get()) {
+        this->env.get_raw_impl().inner().set_stdlib_state(&this->stdlib_state);
+    }
 
     ~Impl() { allocator->free_all(); }
 };
@@ -144,8 +156,11 @@ auto Interpreter::parse_file(const std::string& path) -> ParseResult {
 }
 
 auto Interpreter::evaluate() -> EvalResult {
-    details::Interpreter interpreter{this->config(), this->impl->parser};
-    return interpreter.run(this->impl->tree, this->impl->env.get_raw_impl().inner);
+    this->impl->profile.clear();
+    details::Interpreter interpreter{this->config(), this->impl->parser, &this->impl->profile};
+    return interpreter.run(this->impl->tree, this->impl->env.get_raw_impl().inner());
 }
 
+auto Interpreter::profile() const -> const Profile& { return this->impl->profile; }
+
 } // namespace minilua
@@ -3,6 +3,7 @@
 #include <cstdio>
 #include <iostream>
 #include <istream>
+#include <memory>
 #include <ostream>
 #include <regex>
 #include <stdexcept>
@@ -229,7 +230,19 @@ public:
     }
 };
 
-auto static make_file_table(MemoryAllocator* allocator, CFileHandle* file) -> Value {
+/**
+ * Creates the lua table for the file.
+ *
+ * If `owned` is set the file will be closed when the table is garbage
+ * collected. The standard streams are shared by all interpreters and are never
+ * closed.
+ *
+ * The functions in the table share the ownership of the file handle. So they
+ * can still be called after the table was garbage collected.
+ */
+auto static make_file_table(
+    MemoryAllocator* allocator, const std::shared_ptr<CFileHandle>& file, bool owned = true)
+    -> Value {
     Table table(allocator);
 
     table.set("close", [file](const CallContext& /*unused*/) -> Value { return file->close(); });
@@ -237,32 +250,45 @@ auto static make_file_table(MemoryAllocator* allocator, CFileHandle* file) -> Va
     table.set("write", [file](const CallContext& ctx) -> Vallist { return file->write(ctx); });
     table.set("read", [file](const CallContext& ctx) -> Vallist { return file->read(ctx); });
     table.set("seek", [file](const CallContext& ctx) -> Vallist { return file->seek(ctx); });
-    table.set("lines", [file](const CallContext& ctx) -> Value { return file->lines(ctx); });
+    table.set("lines", [file](const CallContext& ctx) -> Vallist {
+        Function iterator = std::get<Function>(file->lines(ctx));
+        // NOTE the file table is also returned (as the state of a generic for
+        // loop) so it stays reachable while iterating and is not closed
+        return Vallist(
+            {Function([file, iterator](const CallContext& ctx) { return iterator.call(ctx); }),
+             ctx.arguments().get(0)});
+    });
     table.set("setvbuf", [file](const CallContext& ctx) -> Value { return file->setvbuf(ctx); });
     table.set("type", [file](const CallContext& ctx) -> Value { return file->type(ctx); });
 
-    Table metatable(allocator);
-    metatable.set("__gc", [file](const CallContext& /*ctx*/) { delete file; });
+    if (owned) {
+        Table metatable(allocator);
+        metatable.set("__gc", [file](const CallContext& /*ctx*/) {
+            if (file->is_open()) {
+                file->close();
+            }
+        });
 
-    table.set_metatable(metatable);
+        table.set_metatable(metatable);
+    }
 
     return table;
 }
 
 // TODO these should be taken from the environment
 auto _stdin(MemoryAllocator* allocator) -> Value {
-    static std::unique_ptr<CFileHandle> free_guard(new CFileHandle(stdin, false));
-    return make_file_table(allocator, &*free_guard);
+    static auto file = std::make_shared<CFileHandle>(stdin, false);
+    return make_file_table(allocator, file, false);
 }
 auto _stdin(const CallContext& ctx) -> Value { return _stdin(ctx.environment().allocator()); }
 auto _stdout(MemoryAllocator* allocator) -> Value {
-    static std::unique_ptr<CFileHandle> free_guard(new CFileHandle(stdout, false));
-    return make_file_table(allocator, &*free_guard);
+    static auto file = std::make_shared<CFileHandle>(stdout, false);
+    return make_file_table(allocator, file, false);
 }
 auto _stdout(const CallContext& ctx) -> Value { return _stdout(ctx.environment().allocator()); }
 auto _stderr(MemoryAllocator* allocator) -> Value {
-    static std::unique_ptr<CFileHandle> free_guard{new CFileHandle(stderr, false)};
-    return make_file_table(allocator, &*free_guard);
+    static auto file = std::make_shared<CFileHandle>(stderr, false);
+    return make_file_table(allocator, file, false);
 }
 auto _stderr(const CallContext& ctx) -> Value { return _stderr(ctx.environment().allocator()); }
 
@@ -272,7 +298,7 @@ static auto handle_file_open_error(const FileOpenError& error) {
 
 auto static open_file(const CallContext& ctx, const String& path, const String& mode) -> Vallist {
     try {
-        auto* file = new CFileHandle(path.value, mode.value);
+        auto file = std::make_shared<CFileHandle>(path.value, mode.value);
         Value table = make_file_table(ctx.environment().allocator(), file);
         return Vallist(table);
     } catch (const FileOpenError& error) {
@@ -328,13 +354,19 @@ auto FileHandle::read(const std::vector<Value>& formats, bool throw_on_eof) -> V
         Value result = std::visit(
             overloaded{
                 [this, i](const String& format) {
-                    if (string_starts_with(format.value, 'n')) {
+                    // skip the optional '*' (for compatibility with lua 5.1)
+                    std::string kind = format.value;
+                    if (string_starts_with(kind, '*')) {
+                        kind.erase(0, 1);
+                    }
+
+                    if (string_starts_with(kind, 'n')) {
                         return this->read_num();
-                    } else if (string_starts_with(format.value, 'a')) {
+                    } else if (string_starts_with(kind, 'a')) {
                         return this->read_all();
-                    } else if (string_starts_with(format.value, 'l')) {
+                    } else if (string_starts_with(kind, 'l')) {
                         return this->read_line();
-                    } else if (string_starts_with(format.value, 'L')) {
+                    } else if (string_starts_with(kind, 'L')) {
                         return this->read_line_with_newline();
                     } else {
                         throw std::runtime_error(
@@ -447,15 +479,15 @@ auto FileHandle::write(const CallContext& ctx) -> Vallist {
 auto FileHandle::lines(const CallContext& ctx) -> Value {
     this->ensure_file_is_open();
 
-    auto table = ctx.arguments().get(0);
     auto format = ctx.arguments().get(1);
 
     if (format.is_nil()) {
         format = "l";
     }
 
-    return Function([this, table, format](const CallContext& ctx) {
-        return this->read(ctx.make_new({table, format}));
+    // NOTE the first argument of read is the file table (but it is not used)
+    return Function([this, format](const CallContext& ctx) {
+        return this->read(ctx.make_new({Nil(), format}));
     });
 }
 auto FileHandle::type(const CallContext& /*ctx*/) -> Value {
@@ -508,7 +540,7 @@ public:
 
 auto tmpfile(const CallContext& ctx) -> Vallist {
     try {
-        auto* file = new TmpFile();
+        auto file = std::make_shared<TmpFile>();
         Value table = make_file_table(ctx.environment().allocator(), file);
         return Vallist(table);
     } catch (const FileOpenError& error) {
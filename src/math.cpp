@@ -3,7 +3,6 @@
 #include <memory>
 #include <optional>
 #include <random>
-#include <regex>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
@@ -16,6 +15,9 @@
 #include "MiniLua/stdlib.hpp"
 #include "MiniLua/utils.hpp"
 #include "MiniLua/values.hpp"
+#include "details/number_scanner.hpp"
+#include "details/stdlib_state.hpp"
+#include "internal_env.hpp"
 
 namespace minilua {
 
@@ -54,12 +56,20 @@ auto create_math_table(MemoryAllocator* allocator) -> Table {
 
 namespace math {
 
-std::default_random_engine random_seed;
-static const std::string pattern_number(R"(\s*-?\d+)");
-static const std::string pattern_hex(R"(\s*-?0[xX][\dA-Fa-f]+)");
-static const std::string pattern_exp(R"(\s*-?\d+\.?\d*[eE]\d+)");
-static const std::regex
-    pattern_all_number_variants(pattern_number + "|" + pattern_hex + "|" + pattern_exp);
+/**
+ * Returns the random number generator of the interpreter.
+ *
+ * Environments that don't belong to an interpreter share a generator per
+ * thread.
+ */
+static auto random_engine(const CallContext& ctx) -> std::default_random_engine& {
+    auto* state = ctx.environment().get_raw_impl().inner().stdlib_state();
+    if (state == nullptr) {
+        thread_local std::default_random_engine engine;
+        return engine;
+    }
+    return state->random_engine;
+}
 
 // functions to reduce the duplicate code because almost every math-function does the same thing
 // except the function that is called to determine the new value
@@ -494,28 +504,29 @@ auto random(const CallContext& ctx) -> Value {
     // A random value can't be forced. thats why random has no origin
     auto x = ctx.arguments().get(0);
     auto y = ctx.arguments().get(1);
+    auto& engine = random_engine(ctx);
 
     return std::visit(
         overloaded{
-            [](Nil /*unused*/, Nil /*unused*/) {
-                return Value(std::uniform_real_distribution<double>(0, 1)(random_seed));
+            [&engine](Nil /*unused*/, Nil /*unused*/) {
+                return Value(std::uniform_real_distribution<double>(0, 1)(engine));
             },
-            [ctx](auto /*unused*/, Nil /*unused*/) {
+            [ctx, &engine](auto /*unused*/, Nil /*unused*/) {
                 return math_helper(
                     ctx,
-                    [](Number value) {
+                    [&engine](Number value) {
                         return std::uniform_int_distribution<int>(1, value.try_as_int())(
-                            random_seed);
+                            engine);
                     },
                     "random");
             },
-            [ctx](auto /*unused*/, auto /*unused*/) -> Value {
+            [ctx, &engine](auto /*unused*/, auto /*unused*/) -> Value {
                 return math_helper<int>(
                     ctx,
-                    [](Number x, Number y) {
+                    [&engine](Number x, Number y) {
                         if (x <= y) {
                             return std::uniform_int_distribution<int>(
-                                x.try_as_int(), y.try_as_int())(random_seed);
+                                x.try_as_int(), y.try_as_int())(engine);
                         } else {
                             throw std::runtime_error(
                                 "bad argument #1 to 'random' (interval is empty)");
@@ -534,7 +545,7 @@ void randomseed(const CallContext& ctx) {
     if (x != Nil()) {
         Number num = std::get<Number>(x);
 
-        random_seed = std::default_random_engine((unsigned int)num.try_as_int());
+        random_engine(ctx) = std::default_random_engine((unsigned int)num.try_as_int());
     } else {
         throw std::runtime_error(
             "bad argument #1 to 'randomseed' (number expected, got " +
@@ -599,8 +610,18 @@ auto to_integer(const CallContext& ctx) -> Value {
                        }
                    },
                    [](const String& s) -> Value {
-                       if (std::regex_match(s.value, pattern_all_number_variants)) {
-                           return Value(std::stoi(s.value, nullptr, 0));
+                       auto number = details::scan_number(s.view());
+                       if (!number) {
+                           return Nil();
+                       }
+                       if (number->is_int()) {
+                           return *number;
+                       }
+                       // NOTE: floats outside of [-2^63, 2^63) (and inf) have no integer
+                       // representation and converting them would be undefined behaviour
+                       double value = number->as_float();
+                       if (std::modf(value, &value) == 0 && value >= -0x1p63 && value < 0x1p63) {
+                           return Value(number->try_as_int());
                        } else {
                            return Nil();
                        }
@@ -647,7 +668,9 @@ auto ult(const CallContext& ctx) -> Value {
     return m_int < n_int;
 }
 
-auto get_random_seed() -> std::default_random_engine { return random_seed; }
+auto get_random_seed(const CallContext& ctx) -> std::default_random_engine {
+    return random_engine(ctx);
+}
 
 } // namespace math
 } // namespace minilua
@@ -1,8 +1,11 @@
 #include "MiniLua/values.hpp"
+#include "details/stdlib_state.hpp"
+#include "internal_env.hpp"
 #include <MiniLua/package.hpp>
 #include <cstddef>
 #include <memory>
 #include <regex>
+#include <stdexcept>
 #include <string>
 
 namespace minilua {
@@ -15,6 +18,17 @@ auto create_package_table(MemoryAllocator* allocator) -> Table {
 
 namespace package {
 
+/**
+ * Returns the package state of the interpreter the function is called from.
+ */
+static auto package_state(const CallContext& ctx) -> State& {
+    auto* state = ctx.environment().get_raw_impl().inner().stdlib_state();
+    if (state == nullptr) {
+        throw std::runtime_error("the package library can only be used in an interpreter");
+    }
+    return state->package;
+}
+
 #ifndef _WIN64
 static Value config = "\\\n"
                       ";\n"
@@ -28,22 +42,24 @@ static Value config = "/\n"
                       "!\n"
                       "-";
 #endif
-Table LOADED;
-Table PRELOAD;
-std::unique_ptr<Table> SEARCHERS = std::unique_ptr<Table>(new Table(
-    {{1,
-      [](const CallContext& ctx) -> Value {
-          auto name = ctx.arguments().get(0);
-          return PRELOAD.get(name);
-      }},
-     {2, [](CallContext ctx) -> Value {
-          ctx = ctx.make_new({ctx.arguments().get(0), PATH});
-          auto paths = searchpath(ctx);
-          if (paths.get(0).is_nil()) {
-              // TODO: print paths.get(1)
-          }
-          return paths.get(0);
-      }}}));
+
+State::State(MemoryAllocator* allocator)
+    : loaded(allocator), preload(allocator),
+      searchers(
+          {{1,
+            [](const CallContext& ctx) -> Value {
+                auto name = ctx.arguments().get(0);
+                return package_state(ctx).preload.get(name);
+            }},
+           {2, [](CallContext ctx) -> Value {
+                ctx = ctx.make_new({ctx.arguments().get(0), PATH});
+                auto paths = searchpath(ctx);
+                if (paths.get(0).is_nil()) {
+                    // TODO: print paths.get(1)
+                }
+                return paths.get(0);
+            }}},
+          allocator) {}
 
 auto static split_string(std::string text, const std::string& sep) -> std::vector<std::string> {
     std::vector<std::string> parts;
@@ -74,7 +90,7 @@ auto searchpath(const CallContext& ctx) -> Vallist {
     }
     if (rep.is_nil()) {
         // default value is the system directory seperator
-        rep = std::get<String>(config).value[0];
+        rep = std::get<String>(config).view()[0];
     }
     // type handling
     if (name.is_number()) {
@@ -119,7 +135,7 @@ auto searchpath(const CallContext& ctx) -> Vallist {
 auto find_loader(const CallContext& ctx) -> Vallist {
     String modname = std::get<String>(ctx.arguments().get(0));
     std::string error_msg;
-    for (const auto& p : *package::SEARCHERS) {
+    for (const auto& p : package::package_state(ctx).searchers) {
         Value searcher = p.second;
 
         if (searcher.is_function()) {
@@ -147,8 +163,9 @@ auto require(const CallContext& ctx) -> Value {
         throw std::runtime_error(
             "bad argument #1 to 'require' (string expected, got " + modname.type() + ")");
     }
-    if (package::LOADED.has(modname)) {
-        return package::LOADED.get(modname);
+    auto& loaded = package::package_state(ctx).loaded;
+    if (loaded.has(modname)) {
+        return loaded.get(modname);
     } else {
         // Search for loader in package.searchers
         auto tmp = find_loader(ctx);
@@ -156,14 +173,14 @@ auto require(const CallContext& ctx) -> Value {
         const Value& extra_value = tmp.get(1);
         auto erg = loader.call(ctx.make_new({modname, extra_value})).values().get(0);
         if (!erg.is_nil()) {
-            package::LOADED.set(modname, erg);
-        } else if (package::LOADED.get(modname).is_nil()) {
+            loaded.set(modname, erg);
+        } else if (loaded.get(modname).is_nil()) {
             // true is assigned because it's defined this way in the lua documentation.
             // It's probably to prevent repeatedly trying to load the same module if it fails once.
-            package::LOADED.set(modname, true);
+            loaded.set(modname, true);
         }
     }
-    return package::LOADED.get(modname);
+    return loaded.get(modname);
 }
 
 } // end namespace minilua
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "MiniLua/profile.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace minilua {
+
+// class Profile
+auto Profile::add_frame(Frame frame) -> std::size_t {
+    this->_frames.push_back(std::move(frame));
+    return this->_frames.size() - 1;
+}
+
+void Profile::add_sample(const Stack& stack, std::size_t count) {
+    this->_samples[stack] += count;
+    this->_num_samples += count;
+}
+
+auto Profile::frames() const -> const std::vector<Frame>& { return this->_frames; }
+auto Profile::samples() const -> const std::map<Stack, std::size_t>& { return this->_samples; }
+auto Profile::num_samples() const -> std::size_t { return this->_num_samples; }
+auto Profile::empty() const -> bool { return this->_num_samples == 0; }
+
+void Profile::clear() {
+    this->_frames.clear();
+    this->_samples.clear();
+    this->_num_samples = 0;
+}
+
+auto Profile::frame_label(std::size_t index) const -> std::string {
+    const auto& frame = this->_frames.at(index);
+
+    std::string label = frame.name;
+    if (frame.location) {
+        label += " (";
+        if (frame.location->file && *frame.location->file != nullptr) {
+            label += **frame.location->file;
+        } else {
+            label += "<unknown>";
+        }
+        label += ":" + std::to_string(frame.location->start.line + 1) + ")";
+    }
+
+    // `;` separates the frames and a line is one stack
+    std::replace(label.begin(), label.end(), ';', ',');
+    std::replace(label.begin(), label.end(), '\n', ' ');
+    return label;
+}
+
+void Profile::write_folded(std::ostream& os) const {
+    std::vector<std::string> labels;
+    labels.reserve(this->_frames.size());
+    for (std::size_t i = 0; i < this->_frames.size(); ++i) {
+        labels.push_back(this->frame_label(i));
+    }
+
+    for (const auto& [stack, count] : this->_samples) {
+        for (std::size_t i = 0; i < stack.size(); ++i) {
+            if (i > 0) {
+                os << ";";
+            }
+            os << labels[stack[i]];
+        }
+        os << " " << count << "\n";
+    }
+}
+
+} // namespace minilua
@@ -2,6 +2,7 @@
 #include <utility>
 
 #include "MiniLua/source_change.hpp"
+#include "MiniLua/utils.hpp"
 
 namespace minilua {
 
@@ -115,6 +116,29 @@ auto combine_source_changes(
     }
 }
 
+void append_source_change(
+    std::optional<SourceChangeTree>& target, std::optional<SourceChangeTree> change) {
+    if (!change.has_value()) {
+        return;
+    }
+    if (!target.has_value()) {
+        target = std::move(change);
+        return;
+    }
+
+    auto* combination = target->visit(overloaded{
+        [](SourceChangeCombination& combination) -> SourceChangeCombination* {
+            return &combination;
+        },
+        [](auto& /*unused*/) -> SourceChangeCombination* { return nullptr; },
+    });
+    if (combination != nullptr && combination->origin.empty() && combination->hint.empty()) {
+        combination->add(std::move(*change));
+    } else {
+        target = SourceChangeCombination({std::move(*target), std::move(*change)});
+    }
+}
+
 // struct SCSingle
 SourceChange::SourceChange(Range range, std::string replacement)
     : range(std::move(range)), replacement(std::move(replacement)) {}
@@ -3,7 +3,6 @@
 #include <exception>
 #include <iostream>
 #include <iterator>
-#include <regex>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -14,6 +13,7 @@
 #include "MiniLua/environment.hpp"
 #include "MiniLua/interpreter.hpp"
 #include "MiniLua/io.hpp"
+#include "MiniLua/metatables.hpp"
 #include "MiniLua/source_change.hpp"
 #include "MiniLua/stdlib.hpp"
 #include "MiniLua/utils.hpp"
@@ -58,6 +58,8 @@ void add_stdlib(Table& table) {
     table.set("tonumber", to_number);
     table.set("type", type);
     table.set("next", next);
+    table.set("pairs", pairs);
+    table.set("ipairs", ipairs);
     table.set("select", select);
     table.set("print", print);
     table.set("error", error);
@@ -154,6 +156,55 @@ auto next(const CallContext& ctx) -> Vallist {
     }
 }
 
+auto pairs(const CallContext& ctx) -> CallResult {
+    const auto& table = ctx.arguments().get(0);
+    if (!table.is_table()) {
+        throw std::runtime_error(
+            "bad argument #1 to 'pairs' (table expected, got " + table.type() + ")");
+    }
+
+    auto metamethod = std::get<Table>(table.raw()).get_metamethod("__pairs");
+    if (!metamethod.is_nil()) {
+        auto result = metamethod.call(ctx.make_new({table}));
+        const auto& values = result.values();
+        return CallResult({values.get(0), values.get(1), values.get(2)}, result.source_change());
+    }
+
+    // the native `next` already continues at the slot of the previous key
+    // (see Table::next) so it is used directly as the iterator
+    return CallResult({Value(Function(next, "next")), table, Nil()});
+}
+
+/**
+ * The iterator function returned by `ipairs`.
+ */
+static auto ipairs_next(const CallContext& ctx) -> Vallist {
+    const auto& table = ctx.arguments().get(0);
+    // NOTE the iterator can also be called directly with any control value
+    auto index = std::get<Number>(ctx.expect_argument<Number>(1).raw()).try_as_int() + 1;
+
+    Value value;
+    if (const auto* raw_table = std::get_if<Table>(&table.raw());
+        raw_table != nullptr && !raw_table->get_metatable()) {
+        value = raw_table->get(index);
+    } else {
+        value = mt::index(ctx.make_new({table, Value(index)})).values().get(0);
+    }
+
+    if (value.is_nil()) {
+        return Vallist();
+    }
+    return Vallist({index, std::move(value)});
+}
+
+auto ipairs(const CallContext& ctx) -> Vallist {
+    const auto& table = ctx.arguments().get(0);
+    if (table.is_nil()) {
+        throw std::runtime_error("bad argument #1 to 'ipairs' (table expected, got nil)");
+    }
+    return Vallist({Function(ipairs_next, "ipairs_next"), table, 0});
+}
+
 auto select(const CallContext& ctx) -> Vallist {
     auto index = ctx.arguments().get(0);
     std::vector<Value> args;
@@ -220,10 +271,10 @@ auto print(const CallContext& ctx) -> CallResult {
 
     for (const auto& arg : ctx.arguments()) {
         const CallResult result = to_string(ctx.make_new({arg}));
-        source_changes = combine_source_changes(source_changes, result.source_change());
+        append_source_change(source_changes, result.source_change());
 
         if (result.values().get(0).is_string()) {
-            *stdout << gap << std::get<String>(result.values().get(0)).value;
+            *stdout << gap << std::get<String>(result.values().get(0)).view();
             gap = "\t";
         }
     }
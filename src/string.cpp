@@ -14,10 +14,14 @@
 #include <variant>
 #include <vector>
 
+#include "MiniLua/metatables.hpp"
 #include "MiniLua/source_change.hpp"
 #include "MiniLua/string.hpp"
 #include "MiniLua/utils.hpp"
 #include "MiniLua/values.hpp"
+#include "details/pattern.hpp"
+#include "details/stdlib_state.hpp"
+#include "internal_env.hpp"
 
 namespace minilua {
 template <class Result>
@@ -200,19 +204,179 @@ auto static parse_string(const std::string& str, std::vector<Value> args) -> std
     return ss.str();
 }
 
+/**
+ * Returns the compiled pattern. It is taken from the pattern cache of the
+ * interpreter if there is one.
+ */
+static auto compile_pattern(
+    const CallContext& ctx, std::string_view pattern, bool allow_anchor = true)
+    -> std::shared_ptr<const details::Pattern> {
+    auto* state = ctx.environment().get_raw_impl().inner().stdlib_state();
+    if (state == nullptr) {
+        return std::make_shared<const details::Pattern>(pattern, allow_anchor);
+    }
+    return state->pattern_cache.get(pattern, allow_anchor);
+}
+
+/**
+ * Converts a (relative) 1-based start position to a 0-based index.
+ *
+ * Negative positions count from the end of the string. The result is at
+ * least 0 but can be larger than the length of the string.
+ */
+static auto start_index(
+    const Value& init, std::size_t length, const std::string& method_name, int arg_index)
+    -> std::size_t {
+    if (init.is_nil()) {
+        return 0;
+    }
+    auto pos = try_value_as<Number::Int>(init, method_name, arg_index, true);
+    if (pos < 0) {
+        pos = static_cast<Number::Int>(length) + pos + 1;
+    }
+    return pos < 1 ? 0 : pos - 1;
+}
+
+static auto capture_value(std::string_view subject, const details::Capture& capture) -> Value {
+    if (capture.is_position) {
+        return static_cast<Number::Int>(capture.start + 1);
+    }
+    return std::string(capture.view(subject));
+}
+
+/**
+ * Appends the values of the captures. If the pattern has no captures and
+ * `whole_match` is true the whole match is appended instead.
+ */
+static void push_captures(
+    std::vector<Value>& values, std::string_view subject, const details::PatternMatch& match,
+    bool whole_match) {
+    if (match.captures.empty()) {
+        if (whole_match) {
+            values.emplace_back(std::string(subject.substr(match.start, match.end - match.start)));
+        }
+        return;
+    }
+    for (const auto& capture : match.captures) {
+        values.push_back(capture_value(subject, capture));
+    }
+}
+
+/**
+ * Common implementation of `string.find` and `string.match`.
+ */
+static auto find_aux(const CallContext& ctx, bool find) -> Vallist {
+    const std::string method_name = find ? "find" : "match";
+    const auto subject_value = try_value_is_string(ctx.arguments().get(0), method_name, 1);
+    const auto pattern_value = try_value_is_string(ctx.arguments().get(1), method_name, 2);
+    const std::string_view subject = std::get<String>(subject_value).view();
+    const std::string_view pattern = std::get<String>(pattern_value).view();
+
+    const auto init = start_index(ctx.arguments().get(2), subject.size(), method_name, 3);
+    if (init > subject.size()) {
+        return Vallist(Nil());
+    }
+
+    // search for the plain string without compiling the pattern
+    if (find && (static_cast<bool>(ctx.arguments().get(3)) || details::is_plain_pattern(pattern))) {
+        const auto start = subject.find(pattern, init);
+        if (start == std::string_view::npos) {
+            return Vallist(Nil());
+        }
+        return Vallist{
+            static_cast<Number::Int>(start + 1),
+            static_cast<Number::Int>(start + pattern.size())};
+    }
+
+    const auto match = compile_pattern(ctx, pattern)->find(subject, init);
+    if (!match) {
+        return Vallist(Nil());
+    }
+
+    std::vector<Value> values;
+    if (find) {
+        values.emplace_back(static_cast<Number::Int>(match->start + 1));
+        values.emplace_back(static_cast<Number::Int>(match->end));
+    }
+    push_captures(values, subject, *match, !find);
+    return Vallist(values);
+}
+
+/**
+ * Appends the replacement of a match for `string.gsub`.
+ */
+static void add_replacement(
+    std::string& result, const CallContext& ctx, std::string_view subject,
+    const details::PatternMatch& match, const Value& replacement) {
+    const auto whole_match = subject.substr(match.start, match.end - match.start);
+
+    if (replacement.is_string() || replacement.is_number()) {
+        const auto repl_value = replacement.to_string();
+        const std::string_view repl = std::get<String>(repl_value).view();
+        for (std::size_t i = 0; i < repl.size(); ++i) {
+            if (repl[i] != '%') {
+                result.push_back(repl[i]);
+                continue;
+            }
+
+            ++i;
+            if (i < repl.size() && repl[i] == '%') {
+                result.push_back('%');
+            } else if (i < repl.size() && repl[i] == '0') {
+                result.append(whole_match);
+            } else if (i < repl.size() && std::isdigit(static_cast<unsigned char>(repl[i]))) {
+                const std::size_t index = repl[i] - '1';
+                if (index < match.captures.size()) {
+                    result.append(std::get<String>(
+                                      capture_value(subject, match.captures[index]).to_string())
+                                      .view());
+                } else if (index == 0 && match.captures.empty()) {
+                    result.append(whole_match);
+                } else {
+                    throw std::runtime_error(
+                        std::string("invalid capture index %") + repl[i] +
+                        " in replacement string");
+                }
+            } else {
+                throw std::runtime_error("invalid use of '%' in replacement string");
+            }
+        }
+        return;
+    }
+
+    std::vector<Value> captures;
+    push_captures(captures, subject, match, true);
+
+    Value value;
+    if (replacement.is_table()) {
+        value = mt::index(ctx.make_new({replacement, captures[0]})).values().get(0);
+    } else {
+        value = std::get<Function>(replacement).call(ctx.make_new(Vallist(captures))).values().get(0);
+    }
+
+    if (!value) {
+        // keep the original text
+        result.append(whole_match);
+    } else if (value.is_string() || value.is_number()) {
+        result.append(std::get<String>(value.to_string()).view());
+    } else {
+        throw std::runtime_error("invalid replacement value (a " + value.type() + ")");
+    }
+}
+
 auto create_string_table(MemoryAllocator* allocator) -> Table {
     std::unordered_map<Value, Value> string_functions;
     Table string(allocator);
     string.set("byte", string::byte);
     string.set("char", string::lua_char);
     // string.set("dump", string::dump);
-    // string.set("find", string::find);
+    string.set("find", string::find);
     string.set("format", string::format);
-    // string.set("gmatch", string::gmatch);
-    // string.set("gsub", string::gsub);
+    string.set("gmatch", string::gmatch);
+    string.set("gsub", string::gsub);
     string.set("len", string::len);
     string.set("lower", string::lower);
-    // string.set("match", string::match);
+    string.set("match", string::match);
     // string.set("pack", string::pack);
     // string.set("packsize", string::packsize);
     string.set("rep", string::rep);
@@ -416,7 +580,7 @@ auto lua_char(const CallContext& ctx) -> Value {
             if (!new_value.is_string()) {
                 return std::nullopt;
             }
-            auto new_string = std::get<String>(new_value).value;
+            auto new_string = std::get<String>(new_value).view();
             if (new_string.length() != args.size()) {
                 return std::nullopt;
             }
@@ -445,6 +609,8 @@ auto lua_char(const CallContext& ctx) -> Value {
     return Value(std::string(result.begin(), result.end())).with_origin(origin);
 }
 
+auto find(const CallContext& ctx) -> Vallist { return find_aux(ctx, true); }
+
 auto format(const CallContext& ctx) -> Value {
     auto formatstring = ctx.arguments().get(0);
     std::vector<Value> args(ctx.arguments().size() - 1);
@@ -457,7 +623,104 @@ auto format(const CallContext& ctx) -> Value {
     // remove first argument formatstring from arguments-list
     std::copy(ctx.arguments().begin() + 1, ctx.arguments().end(), args.begin());
 
-    return Value(parse_string(std::get<String>(formatstring).value, args)).with_origin(NoOrigin());
+    return Value(parse_string(std::get<String>(formatstring).value, args))
+        .with_origin(NoOrigin());
+}
+
+auto gmatch(const CallContext& ctx) -> Value {
+    const auto subject_value = try_value_is_string(ctx.arguments().get(0), "gmatch", 1);
+    const auto pattern_value = try_value_is_string(ctx.arguments().get(1), "gmatch", 2);
+    // the String shares its buffer so the subject is not copied
+    String subject = std::get<String>(subject_value);
+    // NOTE: '^' is not an anchor in gmatch because it would stop the iteration
+    auto pattern = compile_pattern(ctx, std::get<String>(pattern_value).view(), false);
+
+    struct State {
+        std::size_t position = 0;
+        // the end of the last match (empty matches are not allowed there)
+        std::optional<std::size_t> last_match;
+    };
+    auto state = std::make_shared<State>();
+
+    return Function([subject = std::move(subject), pattern,
+                     state](const CallContext& /*unused*/) -> Vallist {
+        auto position = state->position;
+        while (position <= subject.view().size()) {
+            const auto match = pattern->find(subject.view(), position);
+            if (!match) {
+                break;
+            }
+            if (match->end == state->last_match) {
+                position = match->start + 1;
+                continue;
+            }
+
+            state->position = match->end;
+            state->last_match = match->end;
+
+            std::vector<Value> values;
+            push_captures(values, subject.view(), *match, true);
+            return Vallist(values);
+        }
+
+        state->position = subject.view().size() + 1;
+        return Vallist();
+    });
+}
+
+auto gsub(const CallContext& ctx) -> Vallist {
+    const auto subject_value = try_value_is_string(ctx.arguments().get(0), "gsub", 1);
+    const auto pattern_value = try_value_is_string(ctx.arguments().get(1), "gsub", 2);
+    const std::string_view subject = std::get<String>(subject_value).view();
+    const auto replacement = ctx.arguments().get(2);
+    if (!replacement.is_string() && !replacement.is_number() && !replacement.is_table() &&
+        !replacement.is_function()) {
+        throw std::runtime_error(
+            "bad argument #3 to 'gsub' (string/function/table expected)");
+    }
+    Number::Int max_replacements = subject.size() + 1;
+    if (!ctx.arguments().get(3).is_nil()) {
+        max_replacements = try_value_as<Number::Int>(ctx.arguments().get(3), "gsub", 4, true);
+    }
+
+    auto pattern = compile_pattern(ctx, std::get<String>(pattern_value).view());
+
+    std::string result;
+    result.reserve(subject.size());
+    std::size_t position = 0;
+    std::optional<std::size_t> last_match;
+    Number::Int count = 0;
+
+    while (count < max_replacements) {
+        const auto match = pattern->find(subject, position);
+        if (!match) {
+            break;
+        }
+
+        if (match->end == last_match) {
+            // empty match directly after the last match: skip one character
+            if (position >= subject.size()) {
+                break;
+            }
+            result.push_back(subject[position++]);
+        } else {
+            result.append(subject.substr(position, match->start - position));
+            add_replacement(result, ctx, subject, *match, replacement);
+            count++;
+            position = match->end;
+            last_match = match->end;
+        }
+
+        if (pattern->is_anchored()) {
+            break;
+        }
+    }
+
+    if (position < subject.size()) {
+        result.append(subject.substr(position));
+    }
+
+    return Vallist{result, count};
 }
 
 auto len(const CallContext& ctx) -> Value {
@@ -467,7 +730,7 @@ auto len(const CallContext& ctx) -> Value {
     // can't reverse length because with the change of the result more characters have to be added
     // to the string. Or if the string is shorter than previously, characters have to be removed.
     // But it is not clear where in the string.
-    return Value((long)str.value.length()).with_origin(NoOrigin());
+    return Value((long)str.view().length()).with_origin(NoOrigin());
 }
 
 auto lower(const CallContext& ctx) -> Value {
@@ -479,6 +742,8 @@ auto lower(const CallContext& ctx) -> Value {
     return Value(str).with_origin(NoOrigin());
 }
 
+auto match(const CallContext& ctx) -> Vallist { return find_aux(ctx, false); }
+
 auto rep(const CallContext& ctx) -> Value {
     auto s = ctx.arguments().get(0);
     auto n = ctx.arguments().get(1);
@@ -488,7 +753,7 @@ auto rep(const CallContext& ctx) -> Value {
     std::string sep;
     int reps = try_value_as<Number::Int>(n, "rep", 2, true);
     if (!seperator.is_nil()) {
-        sep = std::get<String>(try_value_is_string(seperator, "rep", 3)).value;
+        sep = std::get<String>(try_value_is_string(seperator, "rep", 3)).view();
     }
 
     if (reps <= 0) {
@@ -2,81 +2,356 @@
 #include <MiniLua/allocator.hpp>
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
 #include <set>
 #include <utility>
 
 namespace minilua {
 
+// class HashPart
+auto HashPart::find(const Value& key) -> Value* {
+    auto slot = this->index.find(key);
+    if (slot == this->index.end()) {
+        return nullptr;
+    }
+    return &this->slots[slot->second]->second;
+}
+auto HashPart::find(const Value& key) const -> const Value* {
+    auto slot = this->index.find(key);
+    if (slot == this->index.end()) {
+        return nullptr;
+    }
+    return &this->slots[slot->second]->second;
+}
+
+auto HashPart::slot(const Value& key) const -> std::optional<std::size_t> {
+    auto slot = this->index.find(key);
+    if (slot == this->index.end()) {
+        return std::nullopt;
+    }
+    return slot->second;
+}
+
+auto HashPart::try_emplace(const Value& key) -> std::pair<Value*, bool> {
+    auto [slot, inserted] = this->index.try_emplace(key, this->slots.size());
+    if (inserted) {
+        this->slots.emplace_back(std::in_place, key, Nil());
+    }
+    return {&this->slots[slot->second]->second, inserted};
+}
+
+auto HashPart::insert_or_assign(const Value& key, Value value) -> bool {
+    auto [entry, inserted] = this->try_emplace(key);
+    *entry = std::move(value);
+    return inserted;
+}
+
+auto HashPart::take(const Value& key) -> std::optional<Value> {
+    auto slot = this->index.find(key);
+    if (slot == this->index.end()) {
+        return std::nullopt;
+    }
+    auto& entry = this->slots[slot->second];
+    Value value = std::move(entry->second);
+    entry.reset();
+    ++this->num_empty;
+    this->index.erase(slot);
+
+    // the empty slots at the end can just be dropped
+    while (!this->slots.empty() && !this->slots.back()) {
+        this->slots.pop_back();
+        --this->num_empty;
+    }
+    if (this->num_empty * 2 >= this->slots.size()) {
+        this->compact();
+    }
+    return value;
+}
+
+void HashPart::compact() {
+    std::size_t next = 0;
+    for (auto& slot : this->slots) {
+        if (!slot) {
+            continue;
+        }
+        this->index.find(slot->first)->second = next;
+        if (&this->slots[next] != &slot) {
+            // NOTE: the key is const so the entry has to be reconstructed
+            this->slots[next].emplace(std::move(*slot));
+            slot.reset();
+        }
+        ++next;
+    }
+    this->slots.resize(next);
+    this->num_empty = 0;
+}
+
 // struct TableImpl
-void TableImpl::set(const Value& key, Value value) { this->value[key] = std::move(value); }
 
-auto TableImpl::calc_border() const -> int {
-    auto has_value = [this](int key) -> bool {
-        auto value = this->value.find(key);
-        return value != this->value.end() && value->second != Nil();
-    };
+/**
+ * Returns `key - 1` if the key is a positive integer (or a float with an
+ * integer value).
+ */
+static auto integer_key_index(const Value& key) -> std::optional<std::size_t> {
+    const auto* number = std::get_if<Number>(&key.raw());
+    if (number == nullptr) {
+        return std::nullopt;
+    }
 
-    if (!has_value(1)) {
-        return 0;
+    return std::visit(
+        overloaded{
+            [](Number::Int value) -> std::optional<std::size_t> {
+                if (value < 1) {
+                    return std::nullopt;
+                }
+                return static_cast<std::size_t>(value - 1);
+            },
+            [](Number::Float value) -> std::optional<std::size_t> {
+                // NOTE this also excludes NaN
+                if (!(value >= 1) || std::floor(value) != value ||
+                    value > static_cast<Number::Float>(std::numeric_limits<Number::Int>::max())) {
+                    return std::nullopt;
+                }
+                return static_cast<std::size_t>(value) - 1;
+            }},
+        number->raw());
+}
+
+auto TableImpl::array_index(const Value& key) const -> std::optional<std::size_t> {
+    auto index = integer_key_index(key);
+    if (index && *index < this->array.size()) {
+        return index;
+    }
+    return std::nullopt;
+}
+
+auto TableImpl::find(const Value& key) const -> const Value* {
+    if (auto index = this->array_index(key)) {
+        return &this->array[*index].second;
+    }
+
+    return this->hash.find(key);
+}
+
+auto TableImpl::get_or_insert(const Value& key) -> Value& {
+    if (auto index = this->array_index(key)) {
+        return this->array[*index].second;
+    }
+
+    auto index = integer_key_index(key);
+    if (index && *index == this->array.size()) {
+        this->append(key, Nil());
+        return this->array[*index].second;
+    }
+
+    auto [entry, inserted] = this->hash.try_emplace(key);
+    if (inserted) {
+        this->version = TableImpl::next_version();
+    }
+    return *entry;
+}
+
+void TableImpl::set(const Value& key, Value value) {
+    if (auto index = this->array_index(key)) {
+        this->array[*index].second = std::move(value);
+        this->update_border(*index);
+        return;
+    }
+
+    auto index = integer_key_index(key);
+    if (index && *index == this->array.size()) {
+        this->append(key, std::move(value));
+    } else if (this->hash.insert_or_assign(key, std::move(value))) {
+        this->version = TableImpl::next_version();
     }
+}
 
-    // Binary search (slightly modified)
-    // to find the integer key where the predicate for the border is true
-    //   (border == 0 or t[border] ~= nil) and t[border + 1] == nil
+void TableImpl::append(const Value& key, Value value) {
+    this->version = TableImpl::next_version();
+    this->array.emplace_back(key, std::move(value));
+    this->update_border(this->array.size() - 1);
+
+    // take over the following keys from the hash part
+    while (!this->hash.empty()) {
+        Value next_key = Number(static_cast<Number::Int>(this->array.size() + 1));
+        auto next = this->hash.take(next_key);
+        if (!next) {
+            break;
+        }
+        this->array.emplace_back(std::move(next_key), std::move(*next));
+        this->update_border(this->array.size() - 1);
+    }
+}
+
+void TableImpl::remove(const Value& key) {
+    this->version = TableImpl::next_version();
+
+    auto index = this->array_index(key);
+    if (!index) {
+        this->hash.take(key);
+        return;
+    }
+
+    // keep the array part without gaps by moving the following entries to the hash part
+    for (auto i = *index + 1; i < this->array.size(); ++i) {
+        this->hash.insert_or_assign(this->array[i].first, std::move(this->array[i].second));
+    }
+    while (this->array.size() > *index) {
+        this->array.pop_back();
+    }
+    this->border = std::min(this->border, *index);
+}
+
+void TableImpl::remove_shifting(std::size_t index, std::size_t border) {
+    // NOTE: a border is never larger than the array part (see calc_border) so
+    // all moved values stay in the array part
+    for (auto i = index; i + 1 < border; ++i) {
+        this->array[i].second = std::move(this->array[i + 1].second);
+    }
+
+    if (border == this->array.size()) {
+        this->version = TableImpl::next_version();
+        this->array.pop_back();
+    } else {
+        this->array[border - 1].second = Nil();
+    }
+    this->border = border - 1;
+}
+
+void TableImpl::set_metatable(std::optional<Table> metatable) {
+    this->metatable = std::move(metatable);
+    this->version = TableImpl::next_version();
+}
+
+auto TableImpl::next_version() -> std::uint64_t {
+    // NOTE: the versions only have to be unique so relaxed ordering is enough.
+    // Every thread reserves a block of versions so interpreters on different
+    // threads don't contend for the shared counter.
+    constexpr std::uint64_t BLOCK_SIZE = 1024;
+    static std::atomic<std::uint64_t> next_block{0};
+    thread_local std::uint64_t next = 0;
+    thread_local std::uint64_t block_end = 0;
+    if (next == block_end) {
+        next = next_block.fetch_add(BLOCK_SIZE, std::memory_order_relaxed);
+        block_end = next + BLOCK_SIZE;
+    }
+    return next++;
+}
+
+auto TableImpl::size() const -> std::size_t { return this->array.size() + this->hash.size(); }
+
+void TableImpl::update_border(std::size_t index) {
+    if (this->array[index].second.is_nil()) {
+        if (index < this->border) {
+            this->border = index;
+        }
+    } else if (index == this->border) {
+        this->border = index + 1;
+    }
+}
+
+auto TableImpl::calc_border() const -> int {
+    // NOTE: the key `array.size() + 1` is never in the hash part (see TableImpl)
+    // so we only have to look at the array part
     //
     // This does not in all cases return the same border as the official lua
     // interpreter. But this is premitted.
     // See: https://www.lua.org/manual/5.3/manual.html#3.4.7
-    int lower = 1;
-    int upper = this->value.size();
-
-    while (lower <= upper) {
-        int border = (upper + lower) / 2;
-
-        bool it_has = has_value(border);
-        bool next_has = has_value(border + 1);
+    auto has_value = [this](std::size_t key) -> bool {
+        return !this->array[key - 1].second.is_nil();
+    };
+    auto is_border = [this, &has_value](std::size_t border) -> bool {
+        return border <= this->array.size() && (border == 0 || has_value(border)) &&
+               (border == this->array.size() || !has_value(border + 1));
+    };
 
-        if (it_has && next_has) {
-            lower = border + 1;
-        } else if (!it_has) {
-            upper = border - 1;
-        } else if (it_has && !next_has) {
-            return border;
+    // the border is usually kept up to date by TableImpl::set but values can
+    // also be changed through references (e.g. Table::operator[])
+    if (!is_border(this->border)) {
+        if (has_value(this->array.size())) {
+            this->border = this->array.size();
+        } else {
+            // Binary search for the border
+            //   lower == 0 or t[lower] ~= nil
+            //   t[upper] == nil
+            std::size_t lower = 0;
+            std::size_t upper = this->array.size();
+            while (upper - lower > 1) {
+                auto middle = (lower + upper) / 2;
+                if (has_value(middle)) {
+                    lower = middle;
+                } else {
+                    upper = middle;
+                }
+            }
+            this->border = lower;
         }
     }
 
-    throw std::runtime_error("implemented of operator # has a bug");
+    return static_cast<int>(this->border);
 }
 
 // struct Table
+
+/**
+ * Moves the iterator to the next entry of the hash part starting at the
+ * current slot or to the end.
+ */
+template <typename Impl> static void skip_empty_slots(Impl& impl) {
+    impl.hash_slot = impl.hash->next_slot(impl.hash_slot);
+    if (impl.hash_slot == impl.hash->num_slots()) {
+        impl.hash = nullptr;
+        impl.hash_slot = 0;
+    }
+}
+
 Table::iterator::iterator() = default;
 Table::iterator::iterator(const Table::iterator&) = default;
 Table::iterator::~iterator() = default;
 
 auto Table::iterator::operator=(const Table::iterator&) -> Table::iterator& = default;
 auto Table::iterator::operator==(const Table::iterator& other) const -> bool {
-    return this->impl->iter == other.impl->iter;
+    return this->impl->array_iter == other.impl->array_iter &&
+           this->impl->hash == other.impl->hash &&
+           this->impl->hash_slot == other.impl->hash_slot;
 }
 auto Table::iterator::operator!=(const Table::iterator& other) const -> bool {
     return !(*this == other);
 }
 auto Table::iterator::operator++() -> Table::iterator& {
-    this->impl->iter++;
+    if (this->impl->array_iter != nullptr) {
+        if (++this->impl->array_iter == this->impl->array_end) {
+            this->impl->array_iter = nullptr;
+            this->impl->array_end = nullptr;
+        }
+    } else {
+        ++this->impl->hash_slot;
+        skip_empty_slots(*this->impl);
+    }
     return *this;
 }
 auto Table::iterator::operator++(int) -> Table::iterator {
     auto tmp = *this;
-    ++(this->impl->iter);
+    ++(*this);
     return tmp;
 }
 
-auto Table::iterator::operator*() const -> Table::iterator::reference { return *this->impl->iter; }
-auto Table::iterator::operator->() const -> Table::iterator::pointer {
-    return this->impl->iter.operator->();
+auto Table::iterator::operator*() const -> Table::iterator::reference {
+    if (this->impl->array_iter != nullptr) {
+        return *this->impl->array_iter;
+    }
+    return this->impl->hash->entry(this->impl->hash_slot);
 }
+auto Table::iterator::operator->() const -> Table::iterator::pointer { return &**this; }
 
 struct Table::const_iterator::Impl {
-    std::unordered_map<Value, Value>::const_iterator iter;
+    // see Table::iterator::Impl
+    const TableImpl::Entry* array_iter = nullptr;
+    const TableImpl::Entry* array_end = nullptr;
+    const HashPart* hash = nullptr;
+    std::size_t hash_slot = 0;
 };
 Table::const_iterator::const_iterator() = default;
 Table::const_iterator::const_iterator(const Table::const_iterator&) = default;
@@ -85,26 +360,39 @@ Table::const_iterator::~const_iterator() = default;
 auto Table::const_iterator::operator=(const Table::const_iterator&)
     -> Table::const_iterator& = default;
 auto Table::const_iterator::operator==(const Table::const_iterator& other) const -> bool {
-    return this->impl->iter == other.impl->iter;
+    return this->impl->array_iter == other.impl->array_iter &&
+           this->impl->hash == other.impl->hash &&
+           this->impl->hash_slot == other.impl->hash_slot;
 }
 auto Table::const_iterator::operator!=(const Table::const_iterator& other) const -> bool {
     return !(*this == other);
 }
 auto Table::const_iterator::operator++() -> Table::const_iterator& {
-    this->impl->iter++;
+    if (this->impl->array_iter != nullptr) {
+        if (++this->impl->array_iter == this->impl->array_end) {
+            this->impl->array_iter = nullptr;
+            this->impl->array_end = nullptr;
+        }
+    } else {
+        ++this->impl->hash_slot;
+        skip_empty_slots(*this->impl);
+    }
     return *this;
 }
 auto Table::const_iterator::operator++(int) -> Table::const_iterator {
     auto tmp = *this;
-    ++(this->impl->iter);
+    ++(*this);
     return tmp;
 }
 
 auto Table::const_iterator::operator*() const -> Table::const_iterator::reference {
-    return *this->impl->iter;
+    if (this->impl->array_iter != nullptr) {
+        return *this->impl->array_iter;
+    }
+    return this->impl->hash->entry(this->impl->hash_slot);
 }
 auto Table::const_iterator::operator->() const -> Table::const_iterator::pointer {
-    return this->impl->iter.operator->();
+    return &**this;
 }
 
 Table::Table() : Table(&GLOBAL_ALLOCATOR) {}
@@ -132,10 +420,12 @@ Table::Table(const Table& other, MemoryAllocator* allocator) : Table(allocator)
 }
 
 Table::Table(const Table& other) = default;
-Table::Table(Table&& other) noexcept : Table() {
+Table::Table(Table&& other) noexcept : Table(other._allocator) {
     // NOTE: it is very important to make sure `this` is a valid object before
     // calling `swap`. Otherwise accessing other after calling this constructor
     // will be undefined behaviour (and likely segfaults).
+    // The placeholder uses the allocator of `other` and not the (shared)
+    // GLOBAL_ALLOCATOR so interpreters on different threads don't race.
     swap(*this, other);
 };
 Table::~Table() noexcept = default;
@@ -158,16 +448,14 @@ auto Table::contains_function() const -> bool {
 }
 
 auto Table::get(const Value& key) const -> Value {
-    auto value = impl->value.find(key);
-    if (value == impl->value.end()) {
+    const auto* value = impl->find(key);
+    if (value == nullptr) {
         return Nil();
     } else {
-        return Value(value->second);
+        return Value(*value);
     }
 }
-auto Table::has(const Value& key) const -> bool {
-    return impl->value.find(key) != impl->value.end();
-}
+auto Table::has(const Value& key) const -> bool { return impl->find(key) != nullptr; }
 void Table::set(const Value& key, Value value) {
     if (key.is_nil()) {
         throw std::runtime_error("table index is nil");
@@ -185,21 +473,27 @@ void Table::set_all(const Table& other) {
         this->set(key, value);
     }
 }
-[[nodiscard]] auto Table::size() const -> size_t { return impl->value.size(); }
+[[nodiscard]] auto Table::size() const -> size_t { return impl->size(); }
 
 auto Table::begin() -> Table::iterator {
     Table::iterator iterator;
-    iterator.impl->iter = this->impl->value.begin();
-    return iterator;
-}
-[[nodiscard]] auto Table::begin() const -> Table::const_iterator {
-    Table::const_iterator iterator;
-    iterator.impl->iter = this->impl->value.cbegin();
+    if (!this->impl->array.empty()) {
+        iterator.impl->array_iter = this->impl->array.data();
+        iterator.impl->array_end = this->impl->array.data() + this->impl->array.size();
+    }
+    iterator.impl->hash = &this->impl->hash;
+    skip_empty_slots(*iterator.impl);
     return iterator;
 }
+[[nodiscard]] auto Table::begin() const -> Table::const_iterator { return this->cbegin(); }
 [[nodiscard]] auto Table::cbegin() const -> Table::const_iterator {
     Table::const_iterator iterator;
-    iterator.impl->iter = this->impl->value.cbegin();
+    if (!this->impl->array.empty()) {
+        iterator.impl->array_iter = this->impl->array.data();
+        iterator.impl->array_end = this->impl->array.data() + this->impl->array.size();
+    }
+    iterator.impl->hash = &this->impl->hash;
+    skip_empty_slots(*iterator.impl);
     return iterator;
 }
 
@@ -233,7 +527,7 @@ auto Table::end() -> Table::iterator { return Table::iterator(); }
 
         const char* sep = " ";
 
-        for (const auto& [key, value] : table.impl->value) {
+        for (const auto& [key, value] : table) {
             if (value.is_nil()) {
                 continue;
             }
@@ -242,7 +536,7 @@ auto Table::end() -> Table::iterator { return Table::iterator(); }
 
             // use strings directly as identifiers if possible
             if (key.is_valid_identifier()) {
-                str.append(std::get<String>(key.raw()).value);
+                str.append(std::get<String>(key.raw()).view());
             } else {
                 str.append("[");
                 str.append(visit_nested(key));
@@ -254,7 +548,7 @@ auto Table::end() -> Table::iterator { return Table::iterator(); }
             sep = ", ";
         }
 
-        if (!table.impl->value.empty()) {
+        if (table.impl->size() != 0) {
             str.append(" ");
         }
 
@@ -265,8 +559,10 @@ auto Table::end() -> Table::iterator { return Table::iterator(); }
     return table_to_literal(*this, table_to_literal);
 }
 
-auto Table::operator[](const Value& index) -> Value& { return impl->value[index]; }
-auto Table::operator[](const Value& index) const -> const Value& { return impl->value[index]; }
+auto Table::operator[](const Value& index) -> Value& { return impl->get_or_insert(index); }
+auto Table::operator[](const Value& index) const -> const Value& {
+    return impl->get_or_insert(index);
+}
 
 Table::operator bool() const { return true; }
 
@@ -274,48 +570,49 @@ auto operator==(const Table& a, const Table& b) noexcept -> bool { return a.impl
 auto operator!=(const Table& a, const Table& b) noexcept -> bool { return !(a == b); }
 auto operator<<(std::ostream& os, const Table& self) -> std::ostream& {
     os << "Table { ";
-    for (const auto& [key, value] : self.impl->value) {
+    for (const auto& [key, value] : self) {
         os << "[" << key << "] = " << value << ", ";
     }
     return os << " }";
 }
 
 auto Table::next(const Value& key) const -> Vallist {
-    return std::visit(
-        overloaded{
-            [this](Nil /*unused*/) {
-                auto it = impl->value.begin();
-                if (it != impl->value.end()) {
-                    std::pair<Value, Value> p = *it;
-                    return Vallist({p.first, p.second});
-                } else {
-                    return Vallist();
-                }
-            },
-            [this](auto key) {
-                auto it = impl->value.find(key);
-                if (it != impl->value.end()) {
-                    // key in table, but last eleement of table
-                    if (++it == impl->value.end()) {
-                        return Vallist();
-                    } else {
-                        // key is somewhere in the table
-                        std::pair<Value, Value> p = *it;
-                        return Vallist({p.first, p.second});
-                    }
-                    // Key not in table
-                } else {
-                    throw std::runtime_error("Invalid key to 'next'");
-                }
-            }},
-        key.raw());
+    // the traversal continues at the slot after the key so it doesn't depend on
+    // the layout of the hash map (and a full traversal is linear)
+    std::size_t slot = 0;
+    if (key.is_nil()) {
+        if (!impl->array.empty()) {
+            const auto& [first_key, first_value] = impl->array.front();
+            return Vallist({first_key, first_value});
+        }
+    } else if (auto index = impl->array_index(key)) {
+        if (*index + 1 < impl->array.size()) {
+            const auto& [next_key, next_value] = impl->array[*index + 1];
+            return Vallist({next_key, next_value});
+        }
+        // key is the last element of the array part
+    } else if (auto key_slot = impl->hash.slot(key)) {
+        slot = *key_slot + 1;
+    } else {
+        throw std::runtime_error("Invalid key to 'next'");
+    }
+
+    slot = impl->hash.next_slot(slot);
+    if (slot == impl->hash.num_slots()) {
+        return Vallist();
+    }
+    const auto& [next_key, next_value] = impl->hash.entry(slot);
+    return Vallist({next_key, next_value});
 }
 
-void Table::remove(const Value& key) { this->impl->value.erase(key); }
+void Table::remove(const Value& key) { this->impl->remove(key); }
+void Table::remove_shifting(int pos, int border) {
+    this->impl->remove_shifting(pos - 1, border);
+}
 
 auto Table::get_metatable() const -> std::optional<Table> { return this->impl->metatable; }
 void Table::set_metatable(std::optional<Table> metatable) {
-    this->impl->metatable = std::move(metatable);
+    this->impl->set_metatable(std::move(metatable));
 }
 
 auto Table::get_metamethod(const std::string& metamethod) const -> Value {
@@ -3,22 +3,171 @@
 
 #include <MiniLua/values.hpp>
 
+#include <cstddef>
+#include <cstdint>
 #include <optional>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace minilua {
 
+/**
+ * The hash part of a Table.
+ *
+ * The entries are stored in slots in the order they were inserted and a hash
+ * map only maps the keys to their slot. So a traversal (see Table::next) can
+ * continue at the slot after the previous key and the order doesn't change
+ * when the hash map grows.
+ *
+ * Removing a key leaves an empty slot. When at least half of the slots are
+ * empty the remaining entries are moved together.
+ *
+ * Like in the array part the entries move when a key is added or removed.
+ */
+class HashPart {
+public:
+    using Entry = std::pair<const Value, Value>;
+
+private:
+    std::vector<std::optional<Entry>> slots;
+    std::unordered_map<Value, std::size_t> index;
+    std::size_t num_empty = 0;
+
+    void compact();
+
+public:
+    [[nodiscard]] auto find(const Value& key) -> Value*;
+    [[nodiscard]] auto find(const Value& key) const -> const Value*;
+    /**
+     * Returns the slot of the entry or `std::nullopt` if there is no entry for
+     * the key.
+     */
+    [[nodiscard]] auto slot(const Value& key) const -> std::optional<std::size_t>;
+    /**
+     * Returns the value of the entry and whether it was inserted (with the
+     * value `Nil`).
+     */
+    auto try_emplace(const Value& key) -> std::pair<Value*, bool>;
+    /**
+     * Returns `true` if the entry was inserted.
+     */
+    auto insert_or_assign(const Value& key, Value value) -> bool;
+    /**
+     * Removes the entry and returns its value.
+     */
+    auto take(const Value& key) -> std::optional<Value>;
+
+    [[nodiscard]] auto size() const -> std::size_t { return this->index.size(); }
+    [[nodiscard]] auto empty() const -> bool { return this->index.empty(); }
+
+    /**
+     * The number of slots including the empty ones.
+     */
+    [[nodiscard]] auto num_slots() const -> std::size_t { return this->slots.size(); }
+    /**
+     * Returns the first slot at or after `slot` that holds an entry
+     * (`num_slots()` if there is none).
+     */
+    [[nodiscard]] auto next_slot(std::size_t slot) const -> std::size_t {
+        while (slot < this->slots.size() && !this->slots[slot]) {
+            ++slot;
+        }
+        return slot;
+    }
+    // NOTE: the slot has to hold an entry
+    [[nodiscard]] auto entry(std::size_t slot) -> Entry& { return *this->slots[slot]; }
+    [[nodiscard]] auto entry(std::size_t slot) const -> const Entry& {
+        return *this->slots[slot];
+    }
+};
+
+/**
+ * The storage of a Table.
+ *
+ * Like in the reference implementation the table consists of an *array part*
+ * for the keys `1..n` and a *hash part* for all other keys.
+ *
+ * The array part never has gaps: every slot is an entry of the table (but it
+ * might hold `Nil`, like entries in the hash part). It grows when the key
+ * `n + 1` is set and then takes over all following integer keys from the hash
+ * part. So the hash part never contains the key `n + 1`.
+ *
+ * The keys are stored in the array part as well so the iterators can hand out
+ * references to `std::pair<const Value, Value>`.
+ */
 struct TableImpl {
-    std::unordered_map<Value, Value> value;
+    using Entry = HashPart::Entry;
+
+    std::vector<Entry> array;
+    HashPart hash;
+
+    /**
+     * A border of the array part (see TableImpl::calc_border).
+     *
+     * This is updated when setting values in the array part and only
+     * recomputed if it is no longer valid.
+     */
+    mutable std::size_t border = 0;
 
     std::optional<Table> metatable;
 
+    /**
+     * Changes whenever a key is added or removed or the metatable is replaced.
+     *
+     * Changing the value of an existing key does not change the version.
+     *
+     * Versions are unique across all tables. So a stale version can't match a
+     * new table that reuses the memory of a freed table (see
+     * details::FieldCache).
+     */
+    std::uint64_t version = TableImpl::next_version();
+
+    // used by the garbage collector (see details/gc.hpp)
+    bool marked = false;
+    bool finalized = false;
+
+    /**
+     * Returns the index into the array part if the key is stored there.
+     */
+    [[nodiscard]] auto array_index(const Value& key) const -> std::optional<std::size_t>;
+
+    /**
+     * Returns a pointer to the value of the entry or `nullptr` if there is no
+     * entry for the key.
+     */
+    [[nodiscard]] auto find(const Value& key) const -> const Value*;
+    /**
+     * Returns the value of the entry and inserts `Nil` if there is no entry
+     * for the key.
+     */
+    auto get_or_insert(const Value& key) -> Value&;
     void set(const Value& key, Value value);
+    void remove(const Value& key);
+    /**
+     * Removes the value at `index` (of the array part) and moves the values
+     * `index + 1 .. border - 1` down by one (see Table::remove_shifting).
+     */
+    void remove_shifting(std::size_t index, std::size_t border);
+    [[nodiscard]] auto size() const -> std::size_t;
     auto calc_border() const -> int;
+    void set_metatable(std::optional<Table> metatable);
+
+    static auto next_version() -> std::uint64_t;
+
+private:
+    void append(const Value& key, Value value);
+    void update_border(std::size_t index);
 };
 
 struct Table::iterator::Impl {
-    std::unordered_map<Value, Value>::iterator iter;
+    // iterates the array part first and then the slots of the hash part
+    // (both array pointers are nullptr when the array part is done and the
+    // hash part is nullptr when it is done as well)
+    TableImpl::Entry* array_iter = nullptr;
+    TableImpl::Entry* array_end = nullptr;
+    HashPart* hash = nullptr;
+    std::size_t hash_slot = 0;
 };
 
 } // namespace minilua
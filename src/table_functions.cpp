@@ -1,18 +1,23 @@
+#include "MiniLua/environment.hpp"
 #include "MiniLua/table_functions.hpp"
 #include "MiniLua/utils.hpp"
 #include "MiniLua/values.hpp"
+#include "details/concat.hpp"
+#include "details/table_sort.hpp"
 #include <algorithm>
 #include <cmath>
 #include <future>
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <variant>
 #include <vector>
 
 namespace minilua {
-auto static try_value_is_int(Value s, const std::string& method_name, int arg_index) -> int {
+auto static try_value_is_int(Value s, const std::string& method_name, int arg_index)
+    -> Number::Int {
     try {
         if (s.is_number()) {
             return std::get<Number>(s).try_as_int();
@@ -62,111 +67,70 @@ auto create_table_table(MemoryAllocator* allocator) -> Table {
 }
 
 namespace table {
+// Concatenates the elements `first..last`. All elements are collected first so
+// the exact length is known and the result is only allocated once.
+static auto concat_elements(
+    const Table& list, std::string_view sep, Number::Int first, Number::Int last, bool check_nil)
+    -> Value {
+    std::vector<Value> elements;
+    // `first` and `last` can be any integer and are not necessarily in the
+    // table (this is checked below). So only the elements up to the border are
+    // reserved and the range is clamped first so it can't overflow.
+    const Number::Int reserve_first = std::max<Number::Int>(first, 1);
+    const Number::Int reserve_last = std::min<Number::Int>(last, list.border());
+    if (reserve_first <= reserve_last) {
+        elements.reserve(reserve_last - reserve_first + 1);
+    }
+    for (Number::Int m = first; m <= last; m++) {
+        if (check_nil && !list.has(m)) {
+            throw std::runtime_error(
+                "invalid value (nil) at index " + std::to_string(m) + " for 'concat'");
+        }
+        Value v = list.get(m);
+        if (!v.is_number() && !v.is_string()) {
+            throw std::runtime_error("Invalid value (" + v.type() + ") in table for 'concat'!");
+        }
+        elements.push_back(std::move(v));
+    }
+    return details::concat_strings(elements.data(), elements.size(), sep);
+}
+
 auto concat(const CallContext& ctx) -> Value {
     // Didn't add an origin because i have no idea how i should reverse this because i would need
     // the seperator to split it back up
-    std::string result;
     auto list = ctx.arguments().get(0);
     auto sep = ctx.arguments().get(1);
     auto i = ctx.arguments().get(2);
     auto j = ctx.arguments().get(3);
 
+    auto separator = [&sep]() -> String {
+        if (!sep.is_number() && !sep.is_string()) {
+            throw std::runtime_error(
+                "bad argument #2 to 'concat' (string expected, got " + sep.type() + ")");
+        }
+        return std::get<String>(sep.to_string());
+    };
+
     return std::visit(
         overloaded{
-            [&result](const Table& list, Nil /*unused*/, Nil /*unused*/, Nil /*unused*/) -> Value {
-                for (int m = 1; m <= list.border(); m++) {
-                    Value v = list.get(m);
-                    if (!v.is_number() && !v.is_string()) {
-                        throw std::runtime_error(
-                            "Invalid value (" + v.type() + ") in table for 'concat'!");
-                    }
-                    String vs = std::get<String>(v.to_string());
-                    result += vs.value;
-                }
-                return Value(result);
+            [](const Table& list, Nil /*unused*/, Nil /*unused*/, Nil /*unused*/) -> Value {
+                return concat_elements(list, "", 1, list.border(), false);
             },
-            [&result,
-             &sep](const Table& list, auto /*sep*/, Nil /*unused*/, Nil /*unused*/) -> Value {
-                if (!sep.is_number() && !sep.is_string()) {
-                    throw std::runtime_error(
-                        "bad argument #2 to 'concat' (string expected, got " + sep.type() + ")");
-                }
-                String s = std::get<String>(sep.to_string());
-                for (int m = 1; m <= list.border(); m++) {
-                    Value v = list.get(m);
-                    if (!v.is_number() && !v.is_string()) {
-                        throw std::runtime_error(
-                            "Invalid value (" + v.type() + ") in table for 'concat'!");
-                    }
-                    String vs = std::get<String>(v.to_string());
-                    result += vs.value;
-                    if (m != list.border()) {
-                        result += s.value;
-                    }
-                }
-                return Value(result);
+            [&separator](
+                const Table& list, auto /*sep*/, Nil /*unused*/, Nil /*unused*/) -> Value {
+                String s = separator();
+                return concat_elements(list, s.view(), 1, list.border(), false);
             },
-            [&result, &sep,
-             &i](const Table& list, auto /*sep*/, auto /*i*/, Nil /*unused*/) -> Value {
-                if (!sep.is_number() && !sep.is_string()) {
-                    throw std::runtime_error(
-                        "bad argument #2 to 'concat' (string expected, got " + sep.type() + ")");
-                }
-                String s = std::get<String>(sep.to_string());
-
-                int m = try_value_is_int(std::move(i), "concat", 3);
-
-                for (; m <= list.border(); m++) {
-                    Value v;
-                    if (list.has(m)) {
-                        v = list.get(m);
-                    } else {
-                        throw std::runtime_error(
-                            "invalid value (nil) at index " + std::to_string(m) + " for 'concat'");
-                    }
-                    if (!v.is_number() && !v.is_string()) {
-                        throw std::runtime_error(
-                            "Invalid value (" + v.type() + ") in table for 'concat'!");
-                    }
-                    String vs = std::get<String>(v.to_string());
-                    result += vs.value;
-                    if (m != list.border()) {
-                        result += s.value;
-                    }
-                }
-
-                return Value(result);
+            [&separator, &i](const Table& list, auto /*sep*/, auto /*i*/, Nil /*unused*/) -> Value {
+                String s = separator();
+                Number::Int m = try_value_is_int(std::move(i), "concat", 3);
+                return concat_elements(list, s.view(), m, list.border(), true);
             },
-            [&result, &sep, &i,
-             &j](const Table& list, auto /*sep*/, auto /*i*/, auto /*j*/) -> Value {
-                if (!sep.is_number() && !sep.is_string()) {
-                    throw std::runtime_error(
-                        "bad argument #2 to 'concat' (string expected, got " + sep.type() + ")");
-                }
-                String s = std::get<String>(sep.to_string());
-
-                int m = try_value_is_int(std::move(i), "concat", 3);
-                int j_int = try_value_is_int(std::move(j), "concat", 4);
-                ;
-                for (; m <= j_int; m++) {
-                    Value v;
-                    if (list.has(m)) {
-                        v = list.get(m);
-                    } else {
-                        throw std::runtime_error(
-                            "invalid value (nil) at index " + std::to_string(m) + " for 'concat'");
-                    }
-                    if (!v.is_number() && !v.is_string()) {
-                        throw std::runtime_error(
-                            "Invalid value (" + v.type() + ") in table for 'concat'!");
-                    }
-                    String vs = std::get<String>(v.to_string());
-                    result += vs.value;
-                    if (m != j_int) {
-                        result += s.value;
-                    }
-                }
-                return Value(result);
+            [&separator, &i, &j](const Table& list, auto /*sep*/, auto /*i*/, auto /*j*/) -> Value {
+                String s = separator();
+                Number::Int m = try_value_is_int(std::move(i), "concat", 3);
+                Number::Int j_int = try_value_is_int(std::move(j), "concat", 4);
+                return concat_elements(list, s.view(), m, j_int, true);
             },
             [](auto list, auto /*unused*/, auto /*unused*/, auto /*unused*/) -> Value {
                 throw std::runtime_error(
@@ -184,7 +148,11 @@ void insert(const CallContext& ctx) {
     // Casulty because we return nil if no argument is given, but nil could be inserted. This edge
     // case throws an error in our program, in lua the insertion works as intended I don't have an
     // idea how to do that besides this way.
-    if (ctx.arguments().size() < 3) {
+    if (ctx.arguments().size() == 2) {
+        // table.insert(list, value) appends the value
+        value = pos;
+        pos = Nil();
+    } else if (ctx.arguments().size() < 3) {
         throw std::runtime_error("wrong number of arguments to 'insert'");
     }
 
@@ -283,7 +251,7 @@ auto pack(const CallContext& ctx) -> Value {
 
             return SourceChangeTree(trees);
         }});
-    Table t = Table();
+    Table t(ctx.environment().allocator());
     int i = 1;
 
     for (const auto& a : ctx.arguments()) {
@@ -301,26 +269,28 @@ auto remove(const CallContext& ctx) -> Value {
     return std::visit(
         overloaded{
             [](Table list, Nil /*unused*/) -> Value {
-                auto tmp = list.get(list.border());
-                list.remove(list.border());
+                const auto border = list.border();
+                auto tmp = list.get(border);
+                if (border == 0) {
+                    list.remove(border);
+                } else {
+                    list.remove_shifting(border, border);
+                }
                 return tmp;
             },
             [&pos](Table list, auto /*pos*/) -> Value {
-                int posi = try_value_is_int(pos, "remove", 2);
-                if (posi > list.border() + 1 || (posi < 1 && list.border() != 0)) {
+                const auto border = list.border();
+                const auto posi = try_value_is_int(pos, "remove", 2);
+                if (posi > border + 1 || (posi < 1 && border != 0)) {
                     throw std::runtime_error(
                         "bad argument #2 to 'remove' (position out of bounds)");
                 }
                 auto tmp = list.get(posi);
-                if (posi == list.border() + 1) {
+                if (posi == border + 1 || border == 0) {
                     list.remove(posi);
                     return tmp;
                 }
-                for (int i = posi + 1; i <= list.border(); i++) {
-                    list.set(posi, list.get(i));
-                    posi++;
-                }
-                list.remove(list.border());
+                list.remove_shifting(static_cast<int>(posi), border);
                 return tmp;
             },
             [](auto list, auto /*unused*/) -> Value {
@@ -337,40 +307,9 @@ void sort(const CallContext& ctx) {
 
     std::visit(
         overloaded{
-            [](Table list, Nil /*unused*/) {
-                std::vector<Value> content;
-                for (int i = 1; i <= list.border(); i++) {
-                    content.push_back(list.get(i));
-                }
-                std::sort(content.begin(), content.end(), [](const Value& a, const Value& b) {
-                    return std::get<Bool>(a.less_than(b)).value;
-                });
-                for (int i = 1; i <= list.border(); i++) {
-                    list.set(i, content.at(i - 1));
-                }
-            },
+            [](Table list, Nil /*unused*/) { details::TableSort::sort(list); },
             [&ctx](Table list, const Function& comp) {
-                std::vector<Value> content;
-                for (int i = 1; i <= list.border(); i++) {
-                    content.push_back(list.get(i));
-                }
-                std::sort(
-                    content.begin(), content.end(),
-                    [&ctx, &comp](const Value& a, const Value& b) -> bool {
-                        auto c = ctx.make_new(Vallist{a, b});
-                        auto erg = comp.call(c).values().get(0);
-
-                        // More arguments than 2 are possible, but they are always Nil.
-                        // 2 arguments must be there always since we must compare two values
-                        if (ctx.arguments().size() >= 2 && erg.type() == "boolean") {
-                            return std::get<Bool>(erg).value;
-                        } else {
-                            throw std::runtime_error("invalid order function for sorting");
-                        }
-                    });
-                for (int i = 1; i <= list.border(); i++) {
-                    list.set(i, content.at(i - 1));
-                }
+                details::TableSort::sort(list, comp, ctx);
             },
             [](const Table& /*unused*/, auto a) {
                 throw std::runtime_error(
@@ -395,15 +334,17 @@ auto unpack(const CallContext& ctx) -> Vallist {
     return std::visit(
         overloaded{
             [&vector](const Table& list, Nil /*unused*/, Nil /*unused*/) -> Vallist {
-                for (int i = 1; i <= list.border(); i++) {
-                    auto v = list.get(i);
-                    vector.push_back(v);
+                const int border = list.border();
+                vector.reserve(border);
+                for (int i = 1; i <= border; i++) {
+                    vector.push_back(list.get(i));
                 }
                 return Vallist(vector);
             },
             [&vector, &i](const Table& list, auto /*i*/, Nil /*unused*/) {
                 int i_int = try_value_is_int(i, "unpack", 2);
-                for (; i_int <= list.border(); i_int++) {
+                const int border = list.border();
+                for (; i_int <= border; i_int++) {
                     vector.push_back(list.get(i_int));
                 }
                 return Vallist(vector);
@@ -4,16 +4,26 @@
 #include "MiniLua/source_change.hpp"
 #include "MiniLua/stdlib.hpp"
 #include "MiniLua/utils.hpp"
+#include "details/number_scanner.hpp"
+#include "details/string_table.hpp"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstdint>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <new>
 #include <regex>
 #include <set>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -207,14 +217,90 @@ auto escape_char(char c) -> std::string {
     }
 }
 
+// class StringTable
+namespace details {
+
+StringTable::~StringTable() {
+    // the remaining strings are still valid but no longer interned
+    for (auto& [_, entry] : this->strings) {
+        entry.data->table = nullptr;
+    }
+}
+
+auto StringTable::intern(std::string value, std::size_t hash)
+    -> std::shared_ptr<const String::Data> {
+    if (auto iter = this->strings.find(value); iter != this->strings.end()) {
+        if (auto data = iter->second.weak.lock()) {
+            return data;
+        }
+        this->strings.erase(iter);
+    }
+
+    // interned strings remove themselves from the table when the last
+    // reference is dropped
+    auto deleter = [](const String::Data* data) {
+        if (data->table != nullptr) {
+            data->table->remove(data);
+        }
+        delete data; // NOLINT
+    };
+    std::shared_ptr<const String::Data> data(
+        new String::Data{std::move(value), hash, this}, deleter);
+    this->strings.emplace(data->value, Entry{data.get(), data});
+    return data;
+}
+
+void StringTable::remove(const String::Data* data) {
+    auto iter = this->strings.find(data->value);
+    if (iter != this->strings.end() && iter->second.data == data) {
+        this->strings.erase(iter);
+    }
+}
+
+auto StringTable::size() const -> std::size_t { return this->strings.size(); }
+
+static thread_local StringTable* current_table = nullptr;
+
+auto current_string_table() -> StringTable* { return current_table; }
+
+StringTableScope::StringTableScope(MemoryAllocator* allocator) : previous(current_table) {
+    current_table = allocator != nullptr ? &allocator->string_table() : nullptr;
+}
+StringTableScope::~StringTableScope() { current_table = this->previous; }
+
+} // namespace details
+
 // struct String
-String::String(std::string value) : value(std::move(value)) {}
+auto String::make_data(std::string value) -> std::shared_ptr<const Data> {
+    auto hash = std::hash<std::string_view>()(value);
+    auto* table = details::current_string_table();
+    if (table == nullptr || value.size() > MAX_INTERNED_LENGTH) {
+        return std::make_shared<const Data>(Data{std::move(value), hash, nullptr});
+    }
+    return table->intern(std::move(value), hash);
+}
+
+String::String(std::string value)
+    : data(make_data(std::move(value))), value(this->data->value) {}
+String::String(const char* value) : String(std::string(value)) {}
+String::String(const String& other) noexcept : data(other.data), value(this->data->value) {}
+auto String::operator=(const String& other) noexcept -> String& {
+    if (this != &other) {
+        // the reference to the buffer can't be rebound so the string is
+        // created again
+        this->~String();
+        new (this) String(other);
+    }
+    return *std::launder(this);
+}
+auto String::view() const noexcept -> std::string_view { return this->data->value; }
+auto String::hash() const noexcept -> std::size_t { return this->data->hash; }
 
 [[nodiscard]] auto String::to_literal() const -> std::string {
     // TODO this can probably be implemented more efficiently (and more clearly)
 
     std::string str;
-    str.reserve(this->value.size() + 2);
+    str.reserve(this->data->value.size() + 2);
 
     /*
     characters to replace
@@ -233,7 +319,7 @@ String::String(std::string value) : value(std::move(value)) {}
 
     str.append("\"");
 
-    for (char c : this->value) {
+    for (char c : this->data->value) {
         str.append(escape_char(c));
     }
 
@@ -252,12 +338,25 @@ String::String(std::string value) : value(std::move(value)) {}
 
 String::operator bool() const { return true; }
 
-void swap(String& self, String& other) { std::swap(self.value, other.value); }
+void swap(String& self, String& other) {
+    String tmp = self;
+    self = other;
+    other = tmp;
+}
 
-auto operator==(const String& a, const String& b) noexcept -> bool { return a.value == b.value; }
+auto operator==(const String& a, const String& b) noexcept -> bool {
+    if (a.data == b.data) {
+        return true;
+    }
+    // there is only one copy of every string interned in the same table
+    if (a.data->table != nullptr && a.data->table == b.data->table) {
+        return false;
+    }
+    return a.data->hash == b.data->hash && a.data->value == b.data->value;
+}
 auto operator!=(const String& a, const String& b) noexcept -> bool { return !(a == b); }
 auto operator<<(std::ostream& os, const String& self) -> std::ostream& {
-    return os << "String(\"" << self.value << "\")";
+    return os << "String(\"" << self.view() << "\")";
 }
 
 // class CallContext
@@ -406,7 +505,8 @@ CallResult::CallResult(Vallist vallist, std::optional<SourceChangeTree> sc)
 }
 
 auto CallResult::combine(const CallResult& other) const -> CallResult {
-    auto source_changes = combine_source_changes(this->source_change(), other.source_change());
+    auto source_changes = this->source_change();
+    append_source_change(source_changes, other.source_change());
     return CallResult(other.values(), source_changes);
 }
 
@@ -438,6 +538,8 @@ auto Function::call(CallContext call_context) const -> CallResult {
 
 Function::operator bool() const { return true; }
 void swap(Function& self, Function& other) { std::swap(self.func, other.func); }
+auto operator==(const Function& a, const Function& b) noexcept -> bool { return a.func == b.func; }
+auto operator!=(const Function& a, const Function& b) noexcept -> bool { return !(a == b); }
 
 // class Origin
 Origin::Origin() = default;
@@ -448,6 +550,7 @@ Origin::Origin(LiteralOrigin origin) : origin(origin) {}
 Origin::Origin(BinaryOrigin origin) : origin(origin) {}
 Origin::Origin(UnaryOrigin origin) : origin(origin) {}
 Origin::Origin(MultipleArgsOrigin origin) : origin(origin) {}
+Origin::Origin(ArithmeticOrigin origin) : origin(std::move(origin)) {}
 
 [[nodiscard]] auto Origin::raw() const -> const Type& { return this->origin; }
 auto Origin::raw() -> Type& { return this->origin; }
@@ -467,6 +570,9 @@ auto Origin::raw() -> Type& { return this->origin; }
 [[nodiscard]] auto Origin::is_unary() const -> bool {
     return std::holds_alternative<UnaryOrigin>(this->raw());
 }
+[[nodiscard]] auto Origin::is_arithmetic() const -> bool {
+    return std::holds_alternative<ArithmeticOrigin>(this->raw());
+}
 
 [[nodiscard]] auto Origin::force(const Value& new_value) const -> std::optional<SourceChangeTree> {
     return ::minilua::simplify(std::visit(
@@ -480,6 +586,10 @@ auto Origin::raw() -> Type& { return this->origin; }
             [&new_value](const MultipleArgsOrigin& origin) -> std::optional<SourceChangeTree> {
                 return origin.reverse(new_value, *origin.values);
             },
+            [&new_value](const ArithmeticOrigin& origin) -> std::optional<SourceChangeTree> {
+                auto binary = origin.materialize();
+                return binary.reverse(new_value, *binary.lhs, *binary.rhs);
+            },
             [&new_value](const LiteralOrigin& origin) -> std::optional<SourceChangeTree> {
                 return SourceChange(origin.location, new_value.to_literal());
             },
@@ -505,6 +615,11 @@ void Origin::set_file(std::optional<std::shared_ptr<std::string>> file) {
                     origin.location->file = file;
                 }
             },
+            [&file](ArithmeticOrigin& origin) {
+                if (origin.location) {
+                    origin.location->file = file;
+                }
+            },
             [&file](LiteralOrigin& origin) { origin.location.file = file; },
             [](NoOrigin& /*unused*/) {}, [](ExternalOrigin& /*unused*/) {}, [](auto /*unused*/) {}},
         this->origin);
@@ -548,6 +663,17 @@ auto Origin::simplify() const -> Origin {
                 *new_origin.values = new_values;
                 return new_origin;
             },
+            [&range_map](const ArithmeticOrigin& origin) -> Origin {
+                auto update = [&range_map](const std::shared_ptr<Origin>& origin) {
+                    return origin ? std::make_shared<Origin>(origin->with_updated_ranges(range_map))
+                                  : nullptr;
+                };
+
+                auto new_origin = origin;
+                new_origin.lhs_origin = update(origin.lhs_origin);
+                new_origin.rhs_origin = update(origin.rhs_origin);
+                return new_origin;
+            },
             [](const auto& origin) -> Origin { return origin; },
         },
         this->origin);
@@ -563,6 +689,42 @@ auto operator<<(std::ostream& os, const Origin& self) -> std::ostream& {
     return os << ")";
 }
 
+// enum OriginTracking
+static thread_local OriginTracking current_origin_tracking = OriginTracking::FULL;
+
+auto origin_tracking() -> OriginTracking { return current_origin_tracking; }
+
+OriginTrackingScope::OriginTrackingScope(OriginTracking tracking)
+    : previous(current_origin_tracking) {
+    current_origin_tracking = tracking;
+}
+OriginTrackingScope::~OriginTrackingScope() { current_origin_tracking = this->previous; }
+
+// Returns true if the result of an operation on the given operands needs an
+// origin (see OriginTracking::LAZY).
+static auto needs_origin(const Value& value) -> bool {
+    switch (current_origin_tracking) {
+    case OriginTracking::OFF:
+        return false;
+    case OriginTracking::LAZY:
+        return value.has_origin();
+    case OriginTracking::FULL:
+    default:
+        return true;
+    }
+}
+static auto needs_origin(const Value& lhs, const Value& rhs) -> bool {
+    switch (current_origin_tracking) {
+    case OriginTracking::OFF:
+        return false;
+    case OriginTracking::LAZY:
+        return lhs.has_origin() || rhs.has_origin();
+    case OriginTracking::FULL:
+    default:
+        return true;
+    }
+}
+
 // struct NoOrigin
 auto NoOrigin::simplify() const -> Origin { return *this; }
 
@@ -752,36 +914,170 @@ auto operator<<(std::ostream& os, const MultipleArgsOrigin& self) -> std::ostrea
     return os;
 }
 
-// class Value
-struct Value::Impl {
-    Type val;
-    Origin origin;
-};
+// struct ArithmeticOrigin
+// The reverse functions are only created once per operator and are shared by
+// all materialized origins.
+static auto shared_arithmetic_reverse(ArithmeticOrigin::Operator op)
+    -> const std::function<BinaryOrigin::ReverseFn>& {
+    switch (op) {
+    case ArithmeticOrigin::Operator::ADD: {
+        static const std::function<BinaryOrigin::ReverseFn> reverse = binary_num_reverse(
+            [](Number new_value, Number rhs) { return new_value - rhs; },
+            [](Number new_value, Number lhs) { return new_value - lhs; }, "add");
+        return reverse;
+    }
+    case ArithmeticOrigin::Operator::SUB: {
+        static const std::function<BinaryOrigin::ReverseFn> reverse = binary_num_reverse(
+            [](Number new_value, Number rhs) { return new_value + rhs; },
+            [](Number new_value, Number lhs) { return lhs - new_value; }, "sub");
+        return reverse;
+    }
+    case ArithmeticOrigin::Operator::MUL: {
+        static const std::function<BinaryOrigin::ReverseFn> reverse = binary_num_reverse(
+            [](Number new_value, Number rhs) -> std::optional<Number> {
+                if (rhs != 0) {
+                    return new_value / rhs;
+                } else {
+                    return std::nullopt;
+                }
+            },
+            [](Number new_value, Number lhs) -> std::optional<Number> {
+                if (lhs != 0) {
+                    return new_value / lhs;
+                } else {
+                    return std::nullopt;
+                }
+            },
+            "mul");
+        return reverse;
+    }
+    case ArithmeticOrigin::Operator::DIV: {
+        static const std::function<BinaryOrigin::ReverseFn> reverse = binary_num_reverse(
+            [](Number new_value, Number rhs) { return new_value * rhs; },
+            [](Number new_value, Number lhs) { return lhs / new_value; }, "div");
+        return reverse;
+    }
+    case ArithmeticOrigin::Operator::INT_DIV: {
+        static const std::function<BinaryOrigin::ReverseFn> reverse = binary_num_reverse(
+            [](Number new_value, Number rhs) { return new_value * rhs; },
+            [](Number new_value, Number lhs) { return lhs.int_div(new_value); }, "intdiv");
+        return reverse;
+    }
+    case ArithmeticOrigin::Operator::POW:
+    default: {
+        static const std::function<BinaryOrigin::ReverseFn> reverse = binary_num_reverse(
+            [](Number new_value, Number rhs) {
+                return std::pow(new_value.as_float(), 1 / rhs.as_float());
+            },
+            [](Number new_value, Number lhs) {
+                return std::log(new_value.as_float()) / std::log(lhs.as_float());
+            },
+            "pow");
+        return reverse;
+    }
+    }
+}
+
+// The origins only get a pointer to the shared reverse function which fits
+// into the std::function without allocating.
+static auto arithmetic_reverse(ArithmeticOrigin::Operator op)
+    -> std::function<BinaryOrigin::ReverseFn> {
+    return [reverse = &shared_arithmetic_reverse(op)](
+               const Value& new_value, const Value& old_lhs, const Value& old_rhs) {
+        return (*reverse)(new_value, old_lhs, old_rhs);
+    };
+}
+
+ArithmeticOrigin::ArithmeticOrigin(
+    Operator op, const Value& lhs, const Value& rhs, std::optional<Range> location)
+    : op(op), lhs(std::get<Number>(lhs.raw())), rhs(std::get<Number>(rhs.raw())),
+      lhs_origin(lhs._origin), rhs_origin(rhs._origin), location(std::move(location)) {}
+
+auto ArithmeticOrigin::materialize() const -> BinaryOrigin {
+    auto operands =
+        std::make_shared<std::array<Value, 2>>(std::array<Value, 2>{this->lhs, this->rhs});
+    (*operands)[0]._origin = this->lhs_origin;
+    (*operands)[1]._origin = this->rhs_origin;
+    return BinaryOrigin{
+        .lhs = std::shared_ptr<Value>(operands, &(*operands)[0]),
+        .rhs = std::shared_ptr<Value>(operands, &(*operands)[1]),
+        .location = this->location,
+        .reverse = arithmetic_reverse(this->op),
+    };
+}
+
+auto ArithmeticOrigin::simplify() const -> Origin {
+    if (this->lhs_origin && this->rhs_origin) {
+        return *this;
+    } else {
+        return NoOrigin();
+    }
+}
+
+auto operator==(const ArithmeticOrigin& lhs, const ArithmeticOrigin& rhs) noexcept -> bool {
+    return lhs.op == rhs.op && lhs.lhs == rhs.lhs && lhs.rhs == rhs.rhs &&
+           lhs.lhs_origin == rhs.lhs_origin && lhs.rhs_origin == rhs.rhs_origin &&
+           lhs.location == rhs.location;
+}
+auto operator!=(const ArithmeticOrigin& lhs, const ArithmeticOrigin& rhs) noexcept -> bool {
+    return !(lhs == rhs);
+}
+auto operator<<(std::ostream& os, const ArithmeticOrigin::Operator& self) -> std::ostream& {
+    switch (self) {
+    case ArithmeticOrigin::Operator::ADD:
+        return os << "ADD";
+    case ArithmeticOrigin::Operator::SUB:
+        return os << "SUB";
+    case ArithmeticOrigin::Operator::MUL:
+        return os << "MUL";
+    case ArithmeticOrigin::Operator::DIV:
+        return os << "DIV";
+    case ArithmeticOrigin::Operator::INT_DIV:
+        return os << "INT_DIV";
+    case ArithmeticOrigin::Operator::POW:
+        return os << "POW";
+    default:
+        return os << "UNKNOWN";
+    }
+}
+auto operator<<(std::ostream& os, const ArithmeticOrigin& self) -> std::ostream& {
+    os << "ArithmeticOrigin{ "
+       << ".op = " << self.op << ", "
+       << ".lhs = " << self.lhs << ", "
+       << ".rhs = " << self.rhs << ", "
+       << ".lhs_origin = " << self.lhs_origin << ", "
+       << ".rhs_origin = " << self.rhs_origin << ", "
+       << ".location = ";
+    if (self.location) {
+        os << self.location.value();
+    } else {
+        os << "nullopt";
+    }
+    return os << " }";
+}
 
+// class Value
 Value::Value() = default;
-Value::Value(Value::Type val) : impl(make_owning<Impl>(Impl{.val = std::move(val)})) {}
-Value::Value(Nil val) : impl(make_owning<Impl>(Impl{.val = val})) {}
-Value::Value(Bool val) : impl(make_owning<Impl>(Impl{.val = val})) {}
+Value::Value(Value::Type val) : val(std::move(val)) {}
+Value::Value(Nil val) : val(val) {}
+Value::Value(Bool val) : val(val) {}
 Value::Value(bool val) : Value(Bool(val)) {}
-Value::Value(Number val) : impl(make_owning<Impl>(Impl{.val = val})) {}
+Value::Value(Number val) : val(val) {}
 Value::Value(int val) : Value(Number(val)) {}
 Value::Value(long val) : Value(Number(val)) {}
 Value::Value(double val) : Value(Number(val)) {}
-Value::Value(String val) : impl(make_owning<Impl>(Impl{.val = val})) {}
+Value::Value(String val) : val(std::move(val)) {}
 Value::Value(std::string val) : Value(String(std::move(val))) {}
 Value::Value(const char* val) : Value(String(val)) {}
-Value::Value(Table val) : impl(make_owning<Impl>(Impl{.val = val})) {}
-Value::Value(Function val) : impl(make_owning<Impl>(Impl{.val = val})) {}
+Value::Value(Table val) : val(val) {}
+Value::Value(Function val) : val(std::move(val)) {}
 
 Value::Value(const Value& val, MemoryAllocator* allocator)
-    : impl(make_owning<Impl>(Impl{
-          .val = std::visit(
-              overloaded{
-                  [allocator](const Table& value) -> Value::Type {
-                      return Table(value, allocator);
-                  },
-                  [](const auto& value) -> Value::Type { return value; }},
-              val.raw())})) {}
+    : val(std::visit(
+          overloaded{
+              [allocator](const Table& value) -> Value::Type { return Table(value, allocator); },
+              [](const auto& value) -> Value::Type { return value; }},
+          val.raw())) {}
 
 Value::Value(const Value& other) = default;
 // NOLINTNEXTLINE
@@ -790,10 +1086,13 @@ Value::~Value() = default;
 auto Value::operator=(const Value& other) -> Value& = default;
 // NOLINTNEXTLINE
 auto Value::operator=(Value&& other) -> Value& = default;
-void swap(Value& self, Value& other) { std::swap(self.impl, other.impl); }
+void swap(Value& self, Value& other) {
+    std::swap(self.val, other.val);
+    std::swap(self._origin, other._origin);
+}
 
-auto Value::raw() -> Value::Type& { return impl->val; }
-auto Value::raw() const -> const Value::Type& { return impl->val; }
+auto Value::raw() -> Value::Type& { return this->val; }
+auto Value::raw() const -> const Value::Type& { return this->val; }
 
 [[nodiscard]] auto Value::to_literal() const -> std::string {
     return std::visit([](auto value) -> std::string { return value.to_literal(); }, this->raw());
@@ -836,17 +1135,36 @@ auto Value::contains_function() const -> bool {
     }
 }
 
-[[nodiscard]] auto Value::has_origin() const -> bool { return !this->impl->origin.is_none(); }
+[[nodiscard]] auto Value::has_origin() const -> bool {
+    return this->_origin && !this->_origin->is_none();
+}
 
-[[nodiscard]] auto Value::origin() const -> const Origin& { return this->impl->origin; }
-[[nodiscard]] auto Value::origin() -> Origin& { return this->impl->origin; }
+[[nodiscard]] auto Value::origin() const -> const Origin& {
+    static const Origin no_origin;
+    return this->_origin ? *this->_origin : no_origin;
+}
+[[nodiscard]] auto Value::origin() -> Origin& {
+    // the origin might be shared with copies of this value
+    if (!this->_origin) {
+        this->_origin = std::make_shared<Origin>();
+    } else if (this->_origin.use_count() > 1) {
+        this->_origin = std::make_shared<Origin>(*this->_origin);
+    }
+    return *this->_origin;
+}
 
 [[nodiscard]] auto Value::remove_origin() const -> Value {
-    return this->with_origin(Origin{NoOrigin()});
+    Value new_value{*this};
+    new_value._origin = nullptr;
+    return new_value;
 }
 [[nodiscard]] auto Value::with_origin(Origin new_origin) const -> Value {
     Value new_value{*this};
-    new_value.impl->origin = std::move(new_origin);
+    if (new_origin.is_none()) {
+        new_value._origin = nullptr;
+    } else {
+        new_value._origin = std::make_shared<Origin>(std::move(new_origin));
+    }
     return new_value;
 }
 
@@ -916,7 +1234,7 @@ auto Value::operator[](const Value& index) -> Value& {
                 throw std::runtime_error("can't index into " + std::string(value.TYPE));
             },
         },
-        this->impl->val);
+        this->val);
 }
 auto Value::operator[](const Value& index) const -> const Value& {
     return std::visit(
@@ -926,11 +1244,11 @@ auto Value::operator[](const Value& index) const -> const Value& {
                 throw std::runtime_error("can't index into " + std::string(value.TYPE));
             },
         },
-        this->impl->val);
+        this->val);
 }
 
 Value::operator bool() const {
-    return std::visit([](const auto& value) { return bool(value); }, this->impl->val);
+    return std::visit([](const auto& value) { return bool(value); }, this->val);
 }
 
 auto Value::to_number(const Value& base, std::optional<Range> location) const -> Value {
@@ -955,8 +1273,6 @@ auto Value::to_number(const Value& base, std::optional<Range> location) const ->
             },
             [this, base_value = base,
              &location](const String& number, const Number& base) -> Value {
-                static std::regex to_number_int_pattern(R"(\s*-?[a-zA-Z0-9]+)");
-
                 // NOTE: we only parse ints when we get a base
                 // the base (has) to be between 2 adn 35 (because numbers with other bases
                 // are not representable strings)
@@ -969,46 +1285,35 @@ auto Value::to_number(const Value& base, std::optional<Range> location) const ->
                 }
 
                 // number must be interpreted as an integer numeral in that base
-                if (std::regex_match(number.value, to_number_int_pattern)) {
-                    try {
-                        auto origin = BinaryOrigin{
-                            .lhs = std::make_shared<Value>(*this),
-                            .rhs = std::make_shared<Value>(base_value),
-                            .location = location,
-                            .reverse =
-                                [](const Value& new_value, const Value& old_lhs,
-                                   const Value& old_base) -> std::optional<SourceChangeTree> {
-                                if (new_value.is_number()) {
-                                    // old_base is a number because otherwise to_number throws an
-                                    // error
-                                    Number base = std::get<Number>(old_base);
-                                    Number new_number = std::get<Number>(new_value);
-                                    if (new_number.is_int()) {
-                                        return old_lhs.force(to_string_with_base(
-                                            new_number.try_as_int(), base.try_as_int()));
-                                    } else {
-                                        return std::nullopt;
-                                    }
-                                } else {
-                                    return std::nullopt;
-                                }
-                            }};
-
-                        // try to parse as int and check if whole input is consumed
-                        std::size_t last_pos;
-                        Number::Int value = std::stoi(number.value, &last_pos, base.try_as_int());
-                        if (last_pos != number.value.size()) {
-                            return Nil();
-                        }
-
-                        return Value(value).with_origin(origin);
-                    } catch (const std::invalid_argument& /*unused*/) {
-                        // invalid base returns nil
-                        return Nil();
-                    }
-                } else {
+                auto value = details::scan_integer(number.view(), base.try_as_int());
+                if (!value) {
                     return Nil();
                 }
+
+                auto origin = BinaryOrigin{
+                    .lhs = std::make_shared<Value>(*this),
+                    .rhs = std::make_shared<Value>(base_value),
+                    .location = location,
+                    .reverse =
+                        [](const Value& new_value, const Value& old_lhs,
+                           const Value& old_base) -> std::optional<SourceChangeTree> {
+                        if (new_value.is_number()) {
+                            // old_base is a number because otherwise to_number throws an
+                            // error
+                            Number base = std::get<Number>(old_base);
+                            Number new_number = std::get<Number>(new_value);
+                            if (new_number.is_int()) {
+                                return old_lhs.force(to_string_with_base(
+                                    new_number.try_as_int(), base.try_as_int()));
+                            } else {
+                                return std::nullopt;
+                            }
+                        } else {
+                            return std::nullopt;
+                        }
+                    }};
+
+                return Value(*value).with_origin(origin);
             },
             [this](const Number& /*number*/, const Nil& /*unused*/) -> Value { return *this; },
             [](const auto& /*a*/, const auto& /*b*/) -> Value { return Nil(); }},
@@ -1020,7 +1325,7 @@ auto Value::to_string(std::optional<Range> /*location*/) const -> Value {
         overloaded{
             [](Bool b) -> Value { return b.value ? "true" : "false"; },
             [](Number n) -> Value { return n.to_literal(); },
-            [](const String& s) -> Value { return s.value; },
+            [](const String& s) -> Value { return s; },
             [](Table t) -> Value { // TODO: maybe improve the way to get the address.
                 // at the moment it could be that every time you call it the
                 // address has changed because of the change in the stack
@@ -1044,24 +1349,92 @@ auto Value::to_bool(std::optional<Range> /*location*/) const -> Value {
     return bool(*this);
 }
 
-template <typename Fn, typename FnRev>
+// Creates a BinaryOrigin where both operands share one allocation.
+// NOTE: returns NoOrigin if the origin is not needed (see OriginTracking)
+static auto make_binary_origin(
+    const Value& lhs, const Value& rhs, std::optional<Range> location,
+    std::function<BinaryOrigin::ReverseFn> reverse) -> Origin {
+    if (!needs_origin(lhs, rhs)) {
+        return Origin();
+    }
+
+    auto operands = std::make_shared<std::array<Value, 2>>(std::array<Value, 2>{lhs, rhs});
+    return BinaryOrigin{
+        .lhs = std::shared_ptr<Value>(operands, &(*operands)[0]),
+        .rhs = std::shared_ptr<Value>(operands, &(*operands)[1]),
+        .location = std::move(location),
+        .reverse = std::move(reverse),
+    };
+}
+
+// NOTE: returns NoOrigin if the origin is not needed (see OriginTracking)
+static auto make_unary_origin(
+    const Value& value, std::optional<Range> location,
+    std::function<UnaryOrigin::ReverseFn> reverse) -> Origin {
+    if (!needs_origin(value)) {
+        return Origin();
+    }
+
+    return UnaryOrigin{
+        .val = std::make_shared<Value>(value),
+        .location = std::move(location),
+        .reverse = std::move(reverse),
+    };
+}
+
+// Like make_binary_origin but for operations that can't be reversed. Their
+// origins can never produce a source change so they are only recorded with
+// OriginTracking::FULL.
+static auto make_irreversible_binary_origin(
+    const Value& lhs, const Value& rhs, std::optional<Range> location) -> Origin {
+    if (current_origin_tracking != OriginTracking::FULL) {
+        return Origin();
+    }
+
+    return make_binary_origin(
+        lhs, rhs, std::move(location),
+        [](const Value& /*new_value*/, const Value& /*old_lhs*/,
+           const Value& /*old_rhs*/) -> std::optional<SourceChangeTree> {
+            // can't reverse the operation in almost all cases
+            // TODO implement the few that could be reversed
+            return std::nullopt;
+        });
+}
+
+// `arithmetic_op` is the operator recorded in the origin. Operations without
+// one can't be reversed.
+template <typename Fn>
 static inline auto num_op_helper(
-    const Value& lhs, const Value& rhs, Fn op, std::string err_info, FnRev reverse,
+    const Value& lhs, const Value& rhs, Fn op, const char* err_info,
+    std::optional<ArithmeticOrigin::Operator> arithmetic_op,
     const std::optional<Range>& location) -> Value {
     static_assert(
         std::is_invocable_v<Fn, Number, Number>, "op is not invocable with two Number arguments");
 
-    auto origin = Origin(BinaryOrigin{
-        .lhs = std::make_shared<Value>(lhs),
-        .rhs = std::make_shared<Value>(rhs),
-        .location = location,
-        .reverse = reverse,
-    });
-
     return std::visit(
         overloaded{
-            [op, &origin](const Number& lhs, const Number& rhs) -> Value {
-                return Value(op(lhs, rhs)).with_origin(origin);
+            [op, arithmetic_op, &lhs_value = lhs, &rhs_value = rhs, &location](
+                const Number& lhs, const Number& rhs) -> Value {
+                Value result = op(lhs, rhs);
+                if (!arithmetic_op) {
+                    return result.with_origin(
+                        make_irreversible_binary_origin(lhs_value, rhs_value, location));
+                }
+
+                switch (current_origin_tracking) {
+                case OriginTracking::OFF:
+                    return result;
+                case OriginTracking::LAZY:
+                    if (!lhs_value.has_origin() && !rhs_value.has_origin()) {
+                        return result;
+                    }
+                    return result.with_origin(
+                        ArithmeticOrigin(*arithmetic_op, lhs_value, rhs_value, location));
+                case OriginTracking::FULL:
+                default:
+                    return result.with_origin(make_binary_origin(
+                        lhs_value, rhs_value, location, arithmetic_reverse(*arithmetic_op)));
+                }
             },
             [&err_info](const auto& lhs, const auto& rhs) -> Value {
                 std::string msg = "Can not ";
@@ -1077,15 +1450,13 @@ static inline auto num_op_helper(
 }
 
 [[nodiscard]] auto Value::negate(std::optional<Range> location) const -> Value {
-    auto origin = Origin(UnaryOrigin{
-        .val = std::make_shared<Value>(*this),
-        .location = std::move(location),
-        .reverse = [](const Value& new_value,
-                      const Value& old_value) -> std::optional<SourceChangeTree> {
+    auto origin = make_unary_origin(
+        *this, std::move(location),
+        [](const Value& new_value, const Value& old_value) -> std::optional<SourceChangeTree> {
             // Number n = std::get<Number>(new_value);
             std::cout << "reverse - with negate-function to " << new_value.type() << std::endl;
             return old_value.force(-new_value);
-        }});
+        });
 
     return std::visit(
                overloaded{
@@ -1103,121 +1474,78 @@ static inline auto num_op_helper(
 [[nodiscard]] auto Value::add(const Value& rhs, std::optional<Range> location) const -> Value {
     return num_op_helper(
         *this, rhs, [](Number lhs, Number rhs) { return lhs + rhs; }, "add",
-        binary_num_reverse(
-            [](Number new_value, Number rhs) { return new_value - rhs; },
-            [](Number new_value, Number lhs) { return new_value - lhs; }, "add"),
-        location);
+        ArithmeticOrigin::Operator::ADD, location);
 }
 [[nodiscard]] auto Value::sub(const Value& rhs, std::optional<Range> location) const -> Value {
     return num_op_helper(
         *this, rhs, [](Number lhs, Number rhs) { return lhs - rhs; }, "subtract",
-        binary_num_reverse(
-            [](Number new_value, Number rhs) { return new_value + rhs; },
-            [](Number new_value, Number lhs) { return lhs - new_value; }, "sub"),
-        location);
+        ArithmeticOrigin::Operator::SUB, location);
 }
 [[nodiscard]] auto Value::mul(const Value& rhs, std::optional<Range> location) const -> Value {
     return num_op_helper(
         *this, rhs, [](Number lhs, Number rhs) { return lhs * rhs; }, "multiply",
-        binary_num_reverse(
-            [](Number new_value, Number rhs) -> std::optional<Number> {
-                if (rhs != 0) {
-                    return new_value / rhs;
-                } else {
-                    return std::nullopt;
-                }
-            },
-            [](Number new_value, Number lhs) -> std::optional<Number> {
-                if (lhs != 0) {
-                    return new_value / lhs;
-                } else {
-                    return std::nullopt;
-                }
-            },
-            "mul"),
-        location);
+        ArithmeticOrigin::Operator::MUL, location);
 }
 [[nodiscard]] auto Value::div(const Value& rhs, std::optional<Range> location) const -> Value {
     return num_op_helper(
         *this, rhs, [](Number lhs, Number rhs) { return lhs / rhs; }, "divide",
-        binary_num_reverse(
-            [](Number new_value, Number rhs) { return new_value * rhs; },
-            [](Number new_value, Number lhs) { return lhs / new_value; }, "div"),
-        location);
+        ArithmeticOrigin::Operator::DIV, location);
 }
 auto Value::int_div(const Value& rhs, std::optional<Range> location) const -> Value {
     return num_op_helper(
         *this, rhs, [](Number lhs, Number rhs) { return lhs.int_div(rhs); }, "int divide",
-        binary_num_reverse(
-            [](Number new_value, Number rhs) { return new_value * rhs; },
-            [](Number new_value, Number lhs) { return lhs.int_div(new_value); }, "intdiv"),
-        location);
+        ArithmeticOrigin::Operator::INT_DIV, location);
 }
 [[nodiscard]] auto Value::pow(const Value& rhs, std::optional<Range> location) const -> Value {
     return num_op_helper(
         *this, rhs, [](Number lhs, Number rhs) { return lhs.pow(rhs); }, "attempt to pow",
-        binary_num_reverse(
-            [](Number new_value, Number rhs) {
-                return std::pow(new_value.as_float(), 1 / rhs.as_float());
-            },
-            [](Number new_value, Number lhs) {
-                return std::log(new_value.as_float()) / std::log(lhs.as_float());
-            },
-            "pow"),
-        location);
+        ArithmeticOrigin::Operator::POW, location);
 }
 [[nodiscard]] auto Value::mod(const Value& rhs, std::optional<Range> location) const -> Value {
     return num_op_helper(
         *this, rhs, [](Number lhs, Number rhs) { return lhs.mod(rhs); }, "take modulo of",
-        [](auto...) { return std::nullopt; },
-        location); // TODO reverse
+        std::nullopt, location); // TODO reverse
 }
 [[nodiscard]] auto Value::bit_and(const Value& rhs, std::optional<Range> location) const -> Value {
     return num_op_helper(
         *this, rhs, [](Number lhs, Number rhs) { return lhs.bit_and(rhs); }, "bitwise and",
-        [](auto...) { return std::nullopt; },
-        location); // TODO reverse
+        std::nullopt, location); // TODO reverse
 }
 [[nodiscard]] auto Value::bit_or(const Value& rhs, std::optional<Range> location) const -> Value {
     return num_op_helper(
         *this, rhs, [](Number lhs, Number rhs) { return lhs.bit_or(rhs); }, "bitwise or",
-        [](auto...) { return std::nullopt; },
-        location); // TODO reverse
+        std::nullopt, location); // TODO reverse
 }
 auto Value::bit_xor(const Value& rhs, std::optional<Range> location) const -> Value {
     return num_op_helper(
         *this, rhs, [](Number lhs, Number rhs) { return lhs.bit_xor(rhs); }, "bitwise xor",
-        [](auto...) { return std::nullopt; },
-        location); // TODO reverse
+        std::nullopt, location); // TODO reverse
 }
 auto Value::bit_shl(const Value& rhs, std::optional<Range> location) const -> Value {
     return num_op_helper(
         *this, rhs, [](Number lhs, Number rhs) { return lhs.bit_shl(rhs); }, "bitwise shift left",
-        [](auto...) { return std::nullopt; },
-        location); // TODO reverse
+        std::nullopt, location); // TODO reverse
 }
 auto Value::bit_shr(const Value& rhs, std::optional<Range> location) const -> Value {
     return num_op_helper(
         *this, rhs, [](Number lhs, Number rhs) { return lhs.bit_shr(rhs); }, "bitwise shift right",
-        [](auto...) { return std::nullopt; },
-        location); // TODO reverse
+        std::nullopt, location); // TODO reverse
 }
 auto Value::bit_not(std::optional<Range> location) const -> Value {
     return std::visit(
         overloaded{
             [this, &location](Number number) {
-                auto origin = Origin(UnaryOrigin{
-                    .val = std::make_shared<Value>(*this),
-                    .location = location,
-                    .reverse = [](const Value& new_value,
-                                  const Value& old_value) -> std::optional<SourceChangeTree> {
+                auto origin = make_unary_origin(
+                    *this, location,
+                    [](const Value& new_value,
+                       const Value& old_value) -> std::optional<SourceChangeTree> {
                         if (old_value.is_number() && new_value.is_number()) {
                             Number new_number = std::get<Number>(new_value);
                             return old_value.force(new_number.bit_not());
                         }
 
                         return std::nullopt;
-                    }});
+                    });
                 return Value(number.bit_not()).with_origin(origin);
             },
             [](const auto& value) -> Value {
@@ -1231,19 +1559,17 @@ auto Value::bit_not(std::optional<Range> location) const -> Value {
 [[nodiscard]] auto Value::logic_and(const Value& rhs, std::optional<Range> location) const
     -> Value {
     // return lhs if it is falsey and rhs otherwise
-    auto origin = Origin(BinaryOrigin{
-        .lhs = std::make_shared<Value>(*this),
-        .rhs = std::make_shared<Value>(rhs),
-        .location = location,
-        .reverse = [](const Value& new_value, const Value& old_lhs,
-                      const Value& old_rhs) -> std::optional<SourceChangeTree> {
+    auto origin = make_binary_origin(
+        *this, rhs, location,
+        [](const Value& new_value, const Value& old_lhs,
+           const Value& old_rhs) -> std::optional<SourceChangeTree> {
             // will not intentially change which side is returned from the expression
             if (!old_lhs) {
                 return old_lhs.force(new_value);
             } else {
                 return old_rhs.force(new_value);
             }
-        }});
+        });
 
     if (!*this) {
         return this->with_origin(origin);
@@ -1253,19 +1579,17 @@ auto Value::bit_not(std::optional<Range> location) const -> Value {
 }
 [[nodiscard]] auto Value::logic_or(const Value& rhs, std::optional<Range> location) const -> Value {
     // return lhs if it is truthy and rhs otherwise
-    auto origin = Origin(BinaryOrigin{
-        .lhs = std::make_shared<Value>(*this),
-        .rhs = std::make_shared<Value>(rhs),
-        .location = location,
-        .reverse = [](const Value& new_value, const Value& old_lhs,
-                      const Value& old_rhs) -> std::optional<SourceChangeTree> {
+    auto origin = make_binary_origin(
+        *this, rhs, location,
+        [](const Value& new_value, const Value& old_lhs,
+           const Value& old_rhs) -> std::optional<SourceChangeTree> {
             // will not intentially change which side is returned from the expression
             if (old_lhs) {
                 return old_lhs.force(new_value);
             } else {
                 return old_rhs.force(new_value);
             }
-        }});
+        });
 
     if (*this) {
         return this->with_origin(origin);
@@ -1274,11 +1598,9 @@ auto Value::bit_not(std::optional<Range> location) const -> Value {
     }
 }
 [[nodiscard]] auto Value::invert(std::optional<Range> location) const -> Value {
-    auto origin = Origin(UnaryOrigin{
-        .val = std::make_shared<Value>(*this),
-        .location = location,
-        .reverse = [](const Value& new_value,
-                      const Value& old_value) -> std::optional<SourceChangeTree> {
+    auto origin = make_unary_origin(
+        *this, location,
+        [](const Value& new_value, const Value& old_value) -> std::optional<SourceChangeTree> {
             const Value negated_new_value = !bool(new_value);
             if (!old_value.is_bool() || !new_value.is_bool() || negated_new_value == old_value) {
                 return std::nullopt;
@@ -1289,24 +1611,27 @@ auto Value::bit_not(std::optional<Range> location) const -> Value {
             } else { // false -> origin value was true
                 return old_value.force(negated_new_value);
             }
-        }});
+        });
 
     return Value(!bool(*this)).with_origin(origin);
 }
 [[nodiscard]] auto Value::len(std::optional<Range> location) const -> Value {
-    auto origin = Origin(UnaryOrigin{
-        .val = std::make_shared<Value>(*this),
-        .location = location,
-        .reverse = [](const Value& new_value,
-                      const Value& old_value) -> std::optional<SourceChangeTree> {
-            // can't reverse the operation in almost all cases
-            // TODO implement the few that could be reversed
-            return std::nullopt;
-        }});
+    // the origin can't produce a source change so it is only recorded with
+    // OriginTracking::FULL
+    auto origin = current_origin_tracking != OriginTracking::FULL
+                      ? Origin()
+                      : make_unary_origin(
+                            *this, location,
+                            [](const Value& new_value,
+                               const Value& old_value) -> std::optional<SourceChangeTree> {
+                                // can't reverse the operation in almost all cases
+                                // TODO implement the few that could be reversed
+                                return std::nullopt;
+                            });
 
     return std::visit(
                overloaded{
-                   [](const String& value) -> Value { return (int)value.value.size(); },
+                   [](const String& value) -> Value { return (int)value.view().size(); },
                    [](const Table& value) -> Value { return value.border(); },
                    [](const auto& value) -> Value {
                        throw std::runtime_error(
@@ -1316,51 +1641,24 @@ auto Value::bit_not(std::optional<Range> location) const -> Value {
         .with_origin(origin);
 }
 [[nodiscard]] auto Value::equals(const Value& rhs, std::optional<Range> location) const -> Value {
-    auto origin = Origin(BinaryOrigin{
-        .lhs = std::make_shared<Value>(*this),
-        .rhs = std::make_shared<Value>(rhs),
-        .location = location,
-        .reverse = [](const Value& new_value, const Value& old_lhs,
-                      const Value& old_rhs) -> std::optional<SourceChangeTree> {
-            // can't reverse the operation in almost all cases
-            // TODO implement the few that could be reversed
-            return std::nullopt;
-        }});
+    auto origin = make_irreversible_binary_origin(*this, rhs, location);
 
     return Value(*this == rhs).with_origin(origin);
 }
 [[nodiscard]] auto Value::unequals(const Value& rhs, std::optional<Range> location) const -> Value {
-    auto origin = Origin(BinaryOrigin{
-        .lhs = std::make_shared<Value>(*this),
-        .rhs = std::make_shared<Value>(rhs),
-        .location = location,
-        .reverse = [](const Value& new_value, const Value& old_lhs,
-                      const Value& old_rhs) -> std::optional<SourceChangeTree> {
-            // can't reverse the operation in almost all cases
-            // TODO implement the few that could be reversed
-            return std::nullopt;
-        }});
+    auto origin = make_irreversible_binary_origin(*this, rhs, location);
 
     return Value(*this != rhs).with_origin(origin);
 }
 [[nodiscard]] auto Value::less_than(const Value& rhs, std::optional<Range> location) const
     -> Value {
-    auto origin = Origin(BinaryOrigin{
-        .lhs = std::make_shared<Value>(*this),
-        .rhs = std::make_shared<Value>(rhs),
-        .location = location,
-        .reverse = [](const Value& new_value, const Value& old_lhs,
-                      const Value& old_rhs) -> std::optional<SourceChangeTree> {
-            // can't reverse the operation in almost all cases
-            // TODO implement the few that could be reversed
-            return std::nullopt;
-        }});
+    auto origin = make_irreversible_binary_origin(*this, rhs, location);
 
     return std::visit(
                overloaded{
                    [](const Number& lhs, const Number& rhs) -> Value { return lhs < rhs; },
                    [](const String& lhs, const String& rhs) -> Value {
-                       return lhs.value < rhs.value;
+                       return lhs.view() < rhs.view();
                    },
                    [](const auto& lhs, const auto& rhs) -> Value {
                        throw std::runtime_error(
@@ -1372,22 +1670,13 @@ auto Value::bit_not(std::optional<Range> location) const -> Value {
 }
 [[nodiscard]] auto Value::less_than_or_equal(const Value& rhs, std::optional<Range> location) const
     -> Value {
-    auto origin = Origin(BinaryOrigin{
-        .lhs = std::make_shared<Value>(*this),
-        .rhs = std::make_shared<Value>(rhs),
-        .location = location,
-        .reverse = [](const Value& new_value, const Value& old_lhs,
-                      const Value& old_rhs) -> std::optional<SourceChangeTree> {
-            // can't reverse the operation in almost all cases
-            // TODO implement the few that could be reversed
-            return std::nullopt;
-        }});
+    auto origin = make_irreversible_binary_origin(*this, rhs, location);
 
     return std::visit(
                overloaded{
                    [](const Number& lhs, const Number& rhs) -> Value { return lhs <= rhs; },
                    [](const String& lhs, const String& rhs) -> Value {
-                       return lhs.value <= rhs.value;
+                       return lhs.view() <= rhs.view();
                    },
                    [](const auto& lhs, const auto& rhs) -> Value {
                        throw std::runtime_error(
@@ -1399,22 +1688,13 @@ auto Value::bit_not(std::optional<Range> location) const -> Value {
 }
 [[nodiscard]] auto Value::greater_than(const Value& rhs, std::optional<Range> location) const
     -> Value {
-    auto origin = Origin(BinaryOrigin{
-        .lhs = std::make_shared<Value>(*this),
-        .rhs = std::make_shared<Value>(rhs),
-        .location = location,
-        .reverse = [](const Value& new_value, const Value& old_lhs,
-                      const Value& old_rhs) -> std::optional<SourceChangeTree> {
-            // can't reverse the operation in almost all cases
-            // TODO implement the few that could be reversed
-            return std::nullopt;
-        }});
+    auto origin = make_irreversible_binary_origin(*this, rhs, location);
 
     return std::visit(
                overloaded{
                    [](const Number& lhs, const Number& rhs) -> Value { return lhs > rhs; },
                    [](const String& lhs, const String& rhs) -> Value {
-                       return lhs.value > rhs.value;
+                       return lhs.view() > rhs.view();
                    },
                    [](const auto& lhs, const auto& rhs) -> Value {
                        throw std::runtime_error(
@@ -1426,22 +1706,13 @@ auto Value::bit_not(std::optional<Range> location) const -> Value {
 }
 [[nodiscard]] auto
 Value::greater_than_or_equal(const Value& rhs, std::optional<Range> location) const -> Value {
-    auto origin = Origin(BinaryOrigin{
-        .lhs = std::make_shared<Value>(*this),
-        .rhs = std::make_shared<Value>(rhs),
-        .location = location,
-        .reverse = [](const Value& new_value, const Value& old_lhs,
-                      const Value& old_rhs) -> std::optional<SourceChangeTree> {
-            // can't reverse the operation in almost all cases
-            // TODO implement the few that could be reversed
-            return std::nullopt;
-        }});
+    auto origin = make_irreversible_binary_origin(*this, rhs, location);
 
     return std::visit(
                overloaded{
                    [](const Number& lhs, const Number& rhs) -> Value { return lhs >= rhs; },
                    [](const String& lhs, const String& rhs) -> Value {
-                       return lhs.value >= rhs.value;
+                       return lhs.view() >= rhs.view();
                    },
                    [](const auto& lhs, const auto& rhs) -> Value {
                        throw std::runtime_error(
@@ -1452,35 +1723,26 @@ Value::greater_than_or_equal(const Value& rhs, std::optional<Range> location) co
         .with_origin(origin);
 }
 [[nodiscard]] auto Value::concat(const Value& rhs, std::optional<Range> location) const -> Value {
-    auto origin = Origin(BinaryOrigin{
-        .lhs = std::make_shared<Value>(*this),
-        .rhs = std::make_shared<Value>(rhs),
-        .location = location,
-        .reverse = [](const Value& new_value, const Value& old_lhs,
-                      const Value& old_rhs) -> std::optional<SourceChangeTree> {
-            // can't reverse the operation in almost all cases
-            // TODO implement the few that could be reversed
-            return std::nullopt;
-        }});
+    auto origin = make_irreversible_binary_origin(*this, rhs, location);
 
     return std::visit(
                overloaded{
                    [](const String& lhs, const String& rhs) -> Value {
-                       return lhs.value + rhs.value;
+                       std::string result;
+                       result.reserve(lhs.view().size() + rhs.view().size());
+                       result += lhs.view();
+                       result += rhs.view();
+                       return result;
                    },
                    [](const String& lhs, const Number& rhs) -> Value {
-                       Environment env;
                        // TODO use the original value to correctly track the origin
-                       return lhs.value + Value(rhs).to_string().remove_origin();
+                       return lhs.value + rhs.to_literal();
                    },
                    [](const Number& lhs, const String& rhs) -> Value {
-                       Environment env;
-                       return Value(lhs).to_string().remove_origin() + rhs.value;
+                       return lhs.to_literal() + rhs.value;
                    },
                    [](const Number& lhs, const Number& rhs) -> Value {
-                       Environment env;
-                       return Value(lhs).to_string().remove_origin() +
-                              Value(rhs).to_string().remove_origin();
+                       return lhs.to_literal() + rhs.to_literal();
                    },
                    [](const auto& lhs, const auto& rhs) -> Value {
                        throw std::runtime_error(
@@ -1507,19 +1769,37 @@ auto operator&&(const Value& lhs, const Value& rhs) -> Value { return lhs.logic_
 auto operator||(const Value& lhs, const Value& rhs) -> Value { return lhs.logic_or(rhs); }
 auto operator!(const Value& value) -> Value { return value.invert(); }
 
+// The finalizer of MurmurHash3. `std::hash` of integers and pointers is the
+// identity, so consecutive integers, integers with a common stride and
+// aligned pointers would all end up in predictable buckets.
+static auto mix_hash(std::uint64_t hash) -> std::size_t {
+    hash ^= hash >> 33U;           // NOLINT
+    hash *= 0xff51afd7ed558ccdULL; // NOLINT
+    hash ^= hash >> 33U;           // NOLINT
+    hash *= 0xc4ceb9fe1a85ec53ULL; // NOLINT
+    hash ^= hash >> 33U;           // NOLINT
+    return static_cast<std::size_t>(hash);
+}
+
 } // namespace minilua
 
 namespace std {
+
 auto std::hash<minilua::Value>::operator()(const minilua::Value& value) const -> size_t {
-    return std::hash<minilua::Value::Type>()(value.raw());
+    // hash the alternative directly (std::hash of the variant would also mix
+    // in the index)
+    return std::visit(
+        [](const auto& value) { return std::hash<std::decay_t<decltype(value)>>()(value); },
+        value.raw());
 }
 auto std::hash<minilua::Nil>::operator()(const minilua::Nil& /*value*/) const -> size_t {
     // lua does not allow using nil as a table key
     // but we are not allowed to throw inside of std::hash
     return 0;
 }
-auto std::hash<minilua::Bool>::operator()(const minilua::Bool& /*value*/) const -> size_t {
-    return 0;
+auto std::hash<minilua::Bool>::operator()(const minilua::Bool& value) const -> size_t {
+    // different from the hashes of the numbers 0 and 1
+    return minilua::mix_hash(value.value ? 0x9e3779b97f4a7c15ULL : 0x7f4a7c159e3779b9ULL); // NOLINT
 }
 auto std::hash<minilua::Number>::operator()(const minilua::Number& value) const -> size_t {
     // we treat whole floats like their integer equivalent
@@ -1528,15 +1808,17 @@ auto std::hash<minilua::Number>::operator()(const minilua::Number& value) const
     // to throw inside of std::hash
     return std::visit(
         minilua::overloaded{
-            [](minilua::Number::Int value) { return std::hash<minilua::Number::Int>()(value); },
+            [](minilua::Number::Int value) {
+                return minilua::mix_hash(static_cast<std::uint64_t>(value));
+            },
             [](minilua::Number::Float value) {
                 if (std::isnan(value) || std::isinf(value)) {
                     return std::numeric_limits<size_t>::max();
                 }
 
                 if (ceil(value) == value) {
-                    return std::hash<minilua::Number::Int>()(
-                        static_cast<minilua::Number::Int>(value));
+                    return minilua::mix_hash(
+                        static_cast<std::uint64_t>(static_cast<minilua::Number::Int>(value)));
                 }
 
                 return std::hash<minilua::Number::Float>()(value);
@@ -1544,14 +1826,14 @@ auto std::hash<minilua::Number>::operator()(const minilua::Number& value) const
         value.raw());
 }
 auto std::hash<minilua::String>::operator()(const minilua::String& value) const -> size_t {
-    return std::hash<std::string>()(value.value);
+    // computed once when the string is created
+    return value.hash();
 }
 auto std::hash<minilua::Table>::operator()(const minilua::Table& value) const -> size_t {
-    return std::hash<decltype(value.impl)>()(value.impl);
+    return minilua::mix_hash(reinterpret_cast<std::uintptr_t>(value.impl)); // NOLINT
 }
 auto std::hash<minilua::Function>::operator()(const minilua::Function& value) const -> size_t {
-    // TODO maybe use address of shared_ptr directly
-    return std::hash<decltype(value.func)>()(value.func);
+    return minilua::mix_hash(reinterpret_cast<std::uintptr_t>(value.func.get())); // NOLINT
 }
 } // namespace std
 
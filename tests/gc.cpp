@@ -2,8 +2,11 @@
 
 #include <MiniLua/allocator.hpp>
 #include <MiniLua/environment.hpp>
+#include <MiniLua/interpreter.hpp>
 #include <MiniLua/values.hpp>
 
+#include <string>
+
 namespace minilua {
 
 TEST_CASE("raw MemoryAllocator usage") {
@@ -21,6 +24,24 @@ TEST_CASE("raw MemoryAllocator usage") {
     REQUIRE(alloc.num_objects() == 0);
 }
 
+TEST_CASE("MemoryAllocator statistics") {
+    MemoryAllocator alloc;
+
+    alloc.allocate_table();
+    alloc.allocate_table();
+    CHECK(alloc.num_allocations() == 2);
+    CHECK(alloc.peak_objects() == 2);
+
+    alloc.free_all();
+    alloc.allocate_table();
+    CHECK(alloc.num_allocations() == 3);
+    CHECK(alloc.peak_objects() == 2);
+
+    alloc.reset_statistics();
+    CHECK(alloc.num_allocations() == 0);
+    CHECK(alloc.peak_objects() == 1);
+}
+
 TEST_CASE("using MemoryAllocator with Table") {
     MemoryAllocator alloc;
 
@@ -103,4 +124,205 @@ TEST_CASE("copy between allocators") {
     REQUIRE(alloc2.num_objects() == 0);
 }
 
+/**
+ * Sets a small garbage collection threshold and adds a function
+ * `num_tables()` that returns the number of allocated tables.
+ */
+static void setup_gc_test(Interpreter& interpreter) {
+    interpreter.config().gc_threshold = 100; // NOLINT
+    interpreter.environment().add("num_tables", [](const CallContext& ctx) -> Value {
+        return static_cast<int>(ctx.environment().allocator()->num_objects());
+    });
+}
+
+TEST_CASE("garbage collection of unreachable tables") {
+    SECTION("temporary tables") {
+        Interpreter interpreter(R"-(
+local max = 0
+for i = 1, 5000 do
+    local t = {i, {i}}
+    if num_tables() > max then
+        max = num_tables()
+    end
+end
+return max
+)-");
+        setup_gc_test(interpreter);
+        auto result = interpreter.evaluate();
+        CHECK(std::get<Number>(result.value) < 1000); // NOLINT
+    }
+
+    SECTION("cycles") {
+        Interpreter interpreter(R"-(
+local max = 0
+for i = 1, 5000 do
+    local a = {}
+    local b = {a = a}
+    a.b = b
+    setmetatable(a, b)
+    if num_tables() > max then
+        max = num_tables()
+    end
+end
+return max
+)-");
+        setup_gc_test(interpreter);
+        auto result = interpreter.evaluate();
+        CHECK(std::get<Number>(result.value) < 1000); // NOLINT
+    }
+
+    SECTION("inside pcall") {
+        Interpreter interpreter(R"-(
+local max = 0
+local ok = pcall(function()
+    for i = 1, 5000 do
+        local t = {i, {i}}
+        if num_tables() > max then
+            max = num_tables()
+        end
+    end
+end)
+assert(ok)
+return max
+)-");
+        setup_gc_test(interpreter);
+        auto result = interpreter.evaluate();
+        CHECK(std::get<Number>(result.value) < 1000); // NOLINT
+    }
+
+    SECTION("inside a sort comparator") {
+        Interpreter interpreter(R"-(
+local max = 0
+local list = {}
+for i = 1, 200 do
+    list[i] = 200 - i
+end
+table.sort(list, function(a, b)
+    local t = {a, {b}}
+    if num_tables() > max then
+        max = num_tables()
+    end
+    return a < b
+end)
+assert(list[1] == 0 and list[200] == 199)
+return max
+)-");
+        setup_gc_test(interpreter);
+        auto result = interpreter.evaluate();
+        CHECK(std::get<Number>(result.value) < 1000); // NOLINT
+    }
+
+    SECTION("after evaluating") {
+        Interpreter interpreter("local t = {{}, {}}");
+        setup_gc_test(interpreter);
+        interpreter.evaluate();
+        auto num_tables = interpreter.environment().allocator()->num_objects();
+        interpreter.evaluate();
+        interpreter.evaluate();
+        CHECK(interpreter.environment().allocator()->num_objects() == num_tables);
+    }
+}
+
+TEST_CASE("garbage collection keeps reachable tables") {
+    Interpreter interpreter(R"-(
+global = {value = "global"}
+local list = {}
+for i = 1, 10 do
+    list[i] = {i}
+end
+
+local function make_counter()
+    local state = {count = 0}
+    return function()
+        state.count = state.count + 1
+        return state.count
+    end
+end
+local counter = make_counter()
+
+local proxy = setmetatable({}, {__index = {value = "metatable"}})
+
+local cycle = {}
+cycle.self = cycle
+
+-- produce a lot of garbage
+for i = 1, 2000 do
+    local garbage = {i}
+    counter()
+end
+
+assert(global.value == "global")
+for i = 1, 10 do
+    assert(list[i][1] == i)
+end
+assert(counter() == 2001)
+assert(proxy.value == "metatable")
+assert(cycle.self.self == cycle)
+return true
+)-");
+    setup_gc_test(interpreter);
+    auto result = interpreter.evaluate();
+    CHECK(result.value == true);
+}
+
+TEST_CASE("garbage collection keeps the tables held by native functions") {
+    Interpreter interpreter(R"-(
+collected = 0
+local function make(value)
+    return setmetatable({value = value}, {__gc = function() collected = collected + 1 end})
+end
+local function churn(arg)
+    arg = nil
+    for i = 1, 2000 do
+        local garbage = {i}
+    end
+    return collected
+end
+local t, collected_while_churning = call_both(make, churn)
+return t.value == "result" and collected_while_churning == 0
+)-");
+    setup_gc_test(interpreter);
+    // the result of `make` and the argument of `churn` are only referenced
+    // from C++ while `churn` runs
+    interpreter.environment().add("call_both", [](const CallContext& ctx) -> CallResult {
+        const auto& make = ctx.arguments().get(0);
+        const auto& churn = ctx.arguments().get(1);
+        auto result = make.call(ctx.make_new({"result"})).values().get(0);
+        Table arg = ctx.make_table();
+        arg.set_metatable(std::get<Table>(result.raw()).get_metatable());
+        auto collected = churn.call(ctx.make_new({arg})).values().get(0);
+        return CallResult({result, collected});
+    });
+    auto result = interpreter.evaluate();
+    CHECK(result.value == true);
+}
+
+TEST_CASE("garbage collection keeps tables created before evaluating") {
+    Interpreter interpreter("for i = 1, 1000 do local t = {} end");
+    setup_gc_test(interpreter);
+
+    Table table(interpreter.environment().allocator());
+    table.set(1, Table(interpreter.environment().allocator()));
+
+    interpreter.evaluate();
+
+    CHECK(table.get(1).is_table());
+    CHECK(std::get<Table>(table.get(1)).size() == 0);
+}
+
+TEST_CASE("garbage collection calls __gc") {
+    Interpreter interpreter(R"-(
+collected = 0
+for i = 1, 2000 do
+    setmetatable({}, {__gc = function() collected = collected + 1 end})
+end
+return collected
+)-");
+    setup_gc_test(interpreter);
+    auto result = interpreter.evaluate();
+    // NOTE the last tables are only finalized at the end of the evaluation
+    CHECK(std::get<Number>(result.value) > 0);
+    CHECK(std::get<Number>(result.value) < 2000); // NOLINT
+}
+
 } // namespace minilua
@@ -6,6 +6,7 @@
 #include <fstream>
 #include <iostream>
 #include <regex>
+#include <sstream>
 #include <string>
 
 auto operator<<(std::ostream& o, const std::vector<minilua::SourceChange>& self) -> std::ostream& {
@@ -96,7 +97,7 @@ static auto change_extension(const std::string& path, const std::string& new_ext
     return path.substr(0, last_dot + 1) + new_ext;
 }
 
-void test_file(const std::string& file) {
+void test_file(const std::string& file, minilua::Engine engine) {
     std::string program = read_input_from_file(file);
 
     auto expect_strings = find_expect_strings(program);
@@ -112,6 +113,7 @@ void test_file(const std::string& file) {
 
     // parse
     minilua::Interpreter interpreter;
+    interpreter.config().engine = engine;
     auto parse_result = interpreter.parse(program);
     CAPTURE(parse_result.errors);
     REQUIRE(parse_result);
@@ -129,3 +131,60 @@ void test_file(const std::string& file) {
         // the lua tests directly
     }
 }
+
+// struct FileRun
+auto operator==(const FileRun& lhs, const FileRun& rhs) -> bool {
+    return lhs.out == rhs.out && lhs.err == rhs.err && lhs.value == rhs.value &&
+           lhs.source_changes == rhs.source_changes && lhs.failed == rhs.failed;
+}
+
+auto operator<<(std::ostream& o, const FileRun& self) -> std::ostream& {
+    return o << "FileRun{ .out = " << self.out << ", .err = " << self.err
+             << ", .value = " << self.value << ", .source_changes = " << self.source_changes
+             << ", .failed = " << self.failed << " }";
+}
+
+auto run_file(const std::string& file, minilua::Engine engine) -> FileRun {
+    std::string program = read_input_from_file(file);
+
+    std::stringstream in(read_optional_file(change_extension(file, "in")).value_or(""));
+    std::stringstream out;
+    std::stringstream err;
+
+    minilua::Interpreter interpreter;
+    interpreter.config().engine = engine;
+    interpreter.environment().set_stdin(&in);
+    interpreter.environment().set_stdout(&out);
+    interpreter.environment().set_stderr(&err);
+    // NOTE no Catch2 assertions because this is also called from multiple threads
+    if (!interpreter.parse(program)) {
+        throw std::runtime_error("failed to parse " + file);
+    }
+
+    FileRun run{.failed = false};
+    try {
+        auto result = interpreter.evaluate();
+
+        std::stringstream value;
+        value << result.value;
+        run.value = value.str();
+
+        if (result.source_change) {
+            std::vector<minilua::SourceChange> changes;
+            result.source_change->visit_all(
+                [&changes](const auto& change) { changes.push_back(change); });
+
+            std::stringstream source_changes;
+            source_changes << changes;
+            run.source_changes = source_changes.str();
+        }
+    } catch (const minilua::InterpreterException& e) {
+        // NOTE the messages of some errors contain the location in the
+        // interpreter so we can't compare them
+        run.failed = true;
+    }
+
+    run.out = out.str();
+    run.err = err.str();
+    return run;
+}
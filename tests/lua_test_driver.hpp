@@ -80,6 +80,30 @@ struct BaseTest {
 auto get_tests() -> std::vector<std::unique_ptr<BaseTest>>&;
 void register_test(BaseTest* test);
 
-void test_file(const std::string& file);
+void test_file(const std::string& file, minilua::Engine engine = minilua::Engine::BYTECODE);
+
+/**
+ * Everything observable from running a lua file.
+ *
+ * Used to check that all engines behave the same.
+ */
+struct FileRun {
+    std::string out;
+    std::string err;
+    std::string value;
+    std::string source_changes;
+    bool failed;
+};
+
+auto operator==(const FileRun& lhs, const FileRun& rhs) -> bool;
+auto operator<<(std::ostream& o, const FileRun& self) -> std::ostream&;
+
+/**
+ * Runs the file and records everything observable.
+ *
+ * This doesn't use any Catch2 assertions so it can be called from multiple
+ * threads at the same time.
+ */
+auto run_file(const std::string& file, minilua::Engine engine) -> FileRun;
 
 #endif
@@ -6,8 +6,11 @@
 #include <fstream>
 #include <ftw.h>
 #include <map>
+#include <optional>
 #include <string>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #include "lua_test_driver.hpp"
 
@@ -93,6 +96,78 @@ TEST_CASE("lua file tests") {
 
     // NOTE: expects to be run from build directory
     for (const auto& file : test_files) {
-        DYNAMIC_SECTION("File: " << file) { test_file(file); }
+        DYNAMIC_SECTION("File: " << file << " (bytecode)") {
+            test_file(file, minilua::Engine::BYTECODE);
+        }
+        DYNAMIC_SECTION("File: " << file << " (tree walker)") {
+            test_file(file, minilua::Engine::TREE_WALKER);
+        }
+    }
+}
+
+TEST_CASE("lua file tests behave the same on all engines") {
+    test_files.clear();
+    ftw(DIR, ftw_callback, 16); // NOLINT(readability-magic-numbers)
+
+    for (const auto& file : test_files) {
+        DYNAMIC_SECTION("File: " << file) {
+            auto bytecode_run = run_file(file, minilua::Engine::BYTECODE);
+            auto tree_walker_run = run_file(file, minilua::Engine::TREE_WALKER);
+            CHECK(bytecode_run == tree_walker_run);
+        }
+    }
+}
+
+// NOTE hidden because it runs all files again on many threads. It only runs in
+// the thread sanitizer CI job (select it with "[threads]").
+TEST_CASE("lua file tests on many threads", "[.threads]") {
+    test_files.clear();
+    ftw(DIR, ftw_callback, 16); // NOLINT(readability-magic-numbers)
+
+    // the io tests would write the same files on disk
+    std::vector<std::string> files;
+    std::copy_if(
+        test_files.begin(), test_files.end(), std::back_inserter(files),
+        [](const std::string& file) { return file.find("/io/") == std::string::npos; });
+
+    const std::vector<minilua::Engine> engines{
+        minilua::Engine::BYTECODE, minilua::Engine::TREE_WALKER};
+
+    std::vector<FileRun> expected;
+    for (const auto& file : files) {
+        for (auto engine : engines) {
+            expected.push_back(run_file(file, engine));
+        }
+    }
+
+    // every thread runs all files (starting at a different file) with its own
+    // interpreters
+    const std::size_t num_threads = std::max(8U, std::thread::hardware_concurrency());
+    std::vector<std::vector<std::optional<FileRun>>> results(
+        num_threads, std::vector<std::optional<FileRun>>(expected.size()));
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            for (std::size_t n = 0; n < expected.size(); ++n) {
+                auto i = (n + t) % expected.size();
+                const auto& file = files[i / engines.size()];
+                try {
+                    results[t][i] = run_file(file, engines[i % engines.size()]);
+                } catch (const std::exception&) {
+                    // leave the result empty
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // NOTE: no sections because they would run all threads again
+    for (std::size_t t = 0; t < num_threads; ++t) {
+        for (std::size_t i = 0; i < expected.size(); ++i) {
+            CAPTURE(t, files[i / engines.size()]);
+            CHECK(results[t][i] == std::optional<FileRun>(expected[i]));
+        }
     }
 }
@@ -1,7 +1,9 @@
 #include <catch2/catch.hpp>
 #include <cmath>
+#include <cstdint>
 #include <cstdlib>
 #include <iostream>
+#include <limits>
 #include <list>
 #include <random>
 #include <string>
@@ -1510,7 +1512,7 @@ TEST_CASE("math.randomseed(x)") {
         minilua::Vallist list({i});
         ctx = ctx.make_new(list);
         minilua::math::randomseed(ctx);
-        CHECK(minilua::math::get_random_seed() == std::default_random_engine((unsigned int)i));
+        CHECK(minilua::math::get_random_seed(ctx) == std::default_random_engine((unsigned int)i));
     }
 
     SECTION("Strings") {
@@ -1518,7 +1520,7 @@ TEST_CASE("math.randomseed(x)") {
         minilua::Vallist list({i});
         ctx = ctx.make_new(list);
         minilua::math::randomseed(ctx);
-        CHECK(minilua::math::get_random_seed() == std::default_random_engine((unsigned int)42));
+        CHECK(minilua::math::get_random_seed(ctx) == std::default_random_engine((unsigned int)42));
     }
 
     SECTION("invalid input") {
@@ -2105,6 +2107,20 @@ TEST_CASE("math.tointeger(x)") {
         ctx = ctx.make_new(list);
         CHECK(minilua::math::to_integer(ctx) == minilua::Value(10));
 
+        s = "-9.2233720368547758e18";
+        list = minilua::Vallist({s});
+        ctx = ctx.make_new(list);
+        CHECK(
+            minilua::math::to_integer(ctx) ==
+            minilua::Value(std::numeric_limits<std::int64_t>::min()));
+
+        for (const auto* out_of_range : {"1e300", "-1e300", "9.2233720368547758e18", "1e309"}) {
+            s = out_of_range;
+            list = minilua::Vallist({s});
+            ctx = ctx.make_new(list);
+            CHECK(minilua::math::to_integer(ctx) == minilua::Nil());
+        }
+
         s = "Minilua";
         list = minilua::Vallist({s});
         ctx = ctx.make_new(list);
@@ -91,6 +91,134 @@ TEST_CASE("Interpreter integration test") {
     }
 }
 
+TEST_CASE("Interpreter origin tracking") {
+    minilua::Interpreter interpreter("local x = 10 local y = x * 2 + 1 force(y, 31)");
+
+    SECTION("full") {
+        auto result = interpreter.evaluate();
+        CHECK(result.source_change.has_value());
+    }
+
+    SECTION("lazy") {
+        interpreter.config().origin_tracking = minilua::OriginTracking::LAZY;
+        auto result = interpreter.evaluate();
+        CHECK(result.source_change.has_value());
+    }
+
+    SECTION("off") {
+        interpreter.config().origin_tracking = minilua::OriginTracking::OFF;
+        auto result = interpreter.evaluate();
+        CHECK_FALSE(result.source_change.has_value());
+    }
+
+    CHECK(minilua::origin_tracking() == minilua::OriginTracking::FULL);
+}
+
+TEST_CASE("Interpreter max call depth") {
+    minilua::Interpreter interpreter(R"-(
+local function depth(n)
+    if n == 0 then
+        return 0
+    end
+    return 1 + depth(n - 1)
+end
+return depth(50)
+)-");
+    auto engine = GENERATE(minilua::Engine::BYTECODE, minilua::Engine::TREE_WALKER);
+    interpreter.config().engine = engine;
+
+    SECTION("within the limit") {
+        interpreter.config().max_call_depth = 51; // NOLINT
+        CHECK(interpreter.evaluate().value == minilua::Value(50));
+    }
+
+    SECTION("exceeding the limit") {
+        interpreter.config().max_call_depth = 50; // NOLINT
+        CHECK_THROWS_AS(interpreter.evaluate(), minilua::InterpreterException);
+    }
+
+    SECTION("unlimited") {
+        interpreter.config().max_call_depth = 0;
+        CHECK(interpreter.evaluate().value == minilua::Value(50));
+    }
+
+    SECTION("runaway recursion with the default config") {
+        // the native stack is almost full long before the interpreter crashes
+        REQUIRE(interpreter.config().max_call_depth == 0);
+        interpreter.parse(R"-(
+local function runaway(n)
+    return 1 + runaway(n + 1)
+end
+local ok, err = pcall(runaway, 0)
+assert(not ok)
+return err
+)-");
+        auto result = interpreter.evaluate();
+        REQUIRE(result.value.is_string());
+        CHECK_THAT(
+            std::get<minilua::String>(result.value).value,
+            Catch::Matchers::Contains("stack overflow"));
+
+        interpreter.parse(R"-(
+local function runaway(n)
+    return 1 + runaway(n + 1)
+end
+return runaway(0)
+)-");
+        CHECK_THROWS_WITH(interpreter.evaluate(), Catch::Matchers::Contains("stack overflow"));
+    }
+}
+
+TEST_CASE("Interpreter traces tail calls") {
+    minilua::Interpreter interpreter(R"-(
+local function f(x)
+    return x
+end
+local function g(x)
+    return f(x)
+end
+local result = g(1)
+return result
+)-");
+    auto engine = GENERATE(minilua::Engine::BYTECODE, minilua::Engine::TREE_WALKER);
+    interpreter.config().engine = engine;
+
+    std::stringstream trace;
+    interpreter.config().target = &trace;
+    interpreter.config().trace_calls = true;
+
+    CHECK(interpreter.evaluate().value == minilua::Value(1));
+
+    const auto output = trace.str();
+    const auto f_result = output.find("Function call to: f resulted in");
+    const auto g_result = output.find("Function call to: g resulted in");
+    REQUIRE(f_result != std::string::npos);
+    REQUIRE(g_result != std::string::npos);
+    CHECK(f_result < g_result);
+}
+
+TEST_CASE("Bytecode compiler rejects unsupported features") {
+    // the goto is never executed but the whole file is compiled up front
+    minilua::Interpreter interpreter("if false then goto skip end\n::skip::\nreturn 1");
+    interpreter.config().engine = minilua::Engine::BYTECODE;
+    CHECK_THROWS_WITH(
+        interpreter.evaluate(), Catch::Matchers::Contains("unsupported: \"goto\" in line 1"));
+}
+
+TEST_CASE("Interpreters don't share the state of the stdlib") {
+    const std::string program = "return math.random(1000000)";
+
+    minilua::Interpreter first(program);
+    auto expected = first.evaluate().value;
+
+    // seeding the generator of one interpreter doesn't affect other interpreters
+    minilua::Interpreter seeded("math.randomseed(42)");
+    seeded.evaluate();
+
+    minilua::Interpreter second(program);
+    CHECK(second.evaluate().value == expected);
+}
+
 TEST_CASE("minilua::Table") {
     minilua::Table table;
 
@@ -169,3 +169,73 @@ TEST_CASE("Simplify Origin") {
                 .simplify() == minilua::NoOrigin());
     }
 }
+
+TEST_CASE("OriginTracking") {
+    minilua::Value literal = minilua::Value(25) // NOLINT
+                                 .with_origin(minilua::LiteralOrigin{.location = minilua::Range()});
+    minilua::Value plain = minilua::Value(13); // NOLINT
+
+    REQUIRE(minilua::origin_tracking() == minilua::OriginTracking::FULL);
+
+    SECTION("FULL records all origins") {
+        CHECK((plain + plain).has_origin());
+        CHECK((literal + plain).has_origin());
+    }
+
+    SECTION("LAZY only records origins that can be forced") {
+        minilua::OriginTrackingScope scope(minilua::OriginTracking::LAZY);
+
+        CHECK_FALSE((plain + plain).has_origin());
+        CHECK_FALSE((-plain).has_origin());
+
+        auto result = (literal + plain) * plain;
+        REQUIRE(result.has_origin());
+        CHECK(result.force(38 * 13).has_value()); // NOLINT
+
+        CHECK_FALSE(literal.less_than(plain).has_origin());
+        CHECK_FALSE((literal % plain).has_origin());
+    }
+
+    SECTION("LAZY records arithmetic operations compactly") {
+        std::optional<minilua::SourceChangeTree> full_change;
+        {
+            auto result = (literal - plain) * plain;
+            REQUIRE(result.origin().is_binary());
+            full_change = result.force(26); // NOLINT
+        }
+
+        minilua::OriginTrackingScope scope(minilua::OriginTracking::LAZY);
+        auto result = (literal - plain) * plain;
+        REQUIRE(result.origin().is_arithmetic());
+
+        const auto& origin = std::get<minilua::ArithmeticOrigin>(result.origin().raw());
+        CHECK(origin.op == minilua::ArithmeticOrigin::Operator::MUL);
+        CHECK(origin.lhs == 12); // NOLINT
+        CHECK(origin.rhs == 13); // NOLINT
+        CHECK(origin.lhs_origin->is_arithmetic());
+        CHECK(origin.rhs_origin == nullptr);
+        CHECK(origin.simplify() == minilua::NoOrigin());
+
+        auto binary = origin.materialize();
+        CHECK(*binary.lhs == 12); // NOLINT
+        CHECK(binary.lhs->origin() == *origin.lhs_origin);
+        CHECK_FALSE(binary.rhs->has_origin());
+
+        CHECK(result.force(26) == full_change); // NOLINT
+    }
+
+    SECTION("OFF does not record origins") {
+        minilua::OriginTrackingScope scope(minilua::OriginTracking::OFF);
+
+        CHECK_FALSE((literal + plain).has_origin());
+        CHECK_FALSE((literal + plain).force(27).has_value()); // NOLINT
+    }
+
+    SECTION("the scope restores the previous value") {
+        {
+            minilua::OriginTrackingScope scope(minilua::OriginTracking::OFF);
+            CHECK(minilua::origin_tracking() == minilua::OriginTracking::OFF);
+        }
+        CHECK(minilua::origin_tracking() == minilua::OriginTracking::FULL);
+    }
+}
@@ -0,0 +1,150 @@
+#include <MiniLua/MiniLua.hpp>
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static auto stack_names(const minilua::Profile& profile, const minilua::Profile::Stack& stack)
+    -> std::vector<std::string> {
+    std::vector<std::string> names;
+    for (auto frame : stack) {
+        names.push_back(profile.frames()[frame].name);
+    }
+    return names;
+}
+
+static auto has_stack(const minilua::Profile& profile, const std::vector<std::string>& names)
+    -> bool {
+    const auto& samples = profile.samples();
+    return std::any_of(samples.begin(), samples.end(), [&](const auto& sample) {
+        return stack_names(profile, sample.first) == names;
+    });
+}
+
+TEST_CASE("Profile") {
+    minilua::Profile profile;
+    CHECK(profile.empty());
+
+    auto file = std::make_shared<std::string>("main.lua");
+    auto main = profile.add_frame({"main chunk", std::nullopt});
+    auto fib = profile.add_frame(
+        {"fib", minilua::Range{.start = {4, 0, 0}, .end = {4, 8, 0}, .file = file}});
+    auto weird = profile.add_frame({"a;b\nc", minilua::Range{.start = {0, 0, 0}}});
+
+    SECTION("frame labels") {
+        CHECK(profile.frame_label(main) == "main chunk");
+        CHECK(profile.frame_label(fib) == "fib (main.lua:5)");
+        CHECK(profile.frame_label(weird) == "a,b c (<unknown>:1)");
+    }
+
+    SECTION("collapsed stacks") {
+        profile.add_sample({main});
+        profile.add_sample({main, fib}, 2);
+        profile.add_sample({main, fib, fib});
+        profile.add_sample({main, fib});
+
+        CHECK(profile.num_samples() == 5);
+        CHECK(profile.samples().size() == 3);
+
+        std::stringstream ss;
+        profile.write_folded(ss);
+        CHECK(
+            ss.str() == "main chunk 1\n"
+                        "main chunk;fib (main.lua:5) 3\n"
+                        "main chunk;fib (main.lua:5);fib (main.lua:5) 1\n");
+
+        profile.clear();
+        CHECK(profile.empty());
+        CHECK(profile.frames().empty());
+    }
+}
+
+TEST_CASE("Interpreter profiling") {
+    minilua::Interpreter interpreter;
+    interpreter.parse(R"-(
+        local function inner(n)
+            local sum = 0
+            for i = 1, n do
+                sum = sum + i
+            end
+            return sum
+        end
+        local function outer()
+            local sum = inner(100)
+            return sum
+        end
+        return outer()
+    )-");
+
+    SECTION("disabled by default") {
+        interpreter.evaluate();
+        CHECK(interpreter.profile().empty());
+    }
+
+    SECTION("by steps") {
+        auto engine = GENERATE(minilua::Engine::BYTECODE, minilua::Engine::TREE_WALKER);
+        interpreter.config().engine = engine;
+        interpreter.config().profile_interval = 1;
+
+        auto result = interpreter.evaluate();
+        CHECK(result.value == minilua::Value(5050));
+
+        const auto& profile = interpreter.profile();
+        CHECK(profile.num_samples() > 100);
+        CHECK(has_stack(profile, {"main chunk"}));
+        CHECK(has_stack(profile, {"main chunk", "outer"}));
+        CHECK(has_stack(profile, {"main chunk", "outer", "inner"}));
+
+        // every evaluation starts a new profile
+        auto num_samples = profile.num_samples();
+        interpreter.evaluate();
+        CHECK(profile.num_samples() == num_samples);
+    }
+
+    SECTION("tail calls replace the frame of the caller") {
+        auto engine = GENERATE(minilua::Engine::BYTECODE, minilua::Engine::TREE_WALKER);
+        interpreter.config().engine = engine;
+        interpreter.config().profile_interval = 1;
+        interpreter.parse(R"-(
+            local function inner(n)
+                local sum = 0
+                for i = 1, n do
+                    sum = sum + i
+                end
+                return sum
+            end
+            local function middle(n)
+                return inner(n)
+            end
+            local function outer(n)
+                return middle(n)
+            end
+            local result = outer(100)
+            return result
+        )-");
+
+        auto result = interpreter.evaluate();
+        CHECK(result.value == minilua::Value(5050));
+
+        const auto& profile = interpreter.profile();
+        CHECK(has_stack(profile, {"main chunk", "outer", "inner"}));
+        CHECK_FALSE(has_stack(profile, {"main chunk", "outer", "middle", "inner"}));
+    }
+
+    SECTION("by time") {
+        interpreter.environment().add("sleep", [](const minilua::CallContext& /*unused*/) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20)); // NOLINT
+        });
+        interpreter.parse("local function wait() sleep() end\nwait()");
+        interpreter.config().profile_period = std::chrono::milliseconds(1);
+
+        interpreter.evaluate();
+
+        const auto& profile = interpreter.profile();
+        CHECK(profile.num_samples() > 0);
+        CHECK(has_stack(profile, {"main chunk", "wait", "sleep"}));
+    }
+}
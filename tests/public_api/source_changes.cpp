@@ -66,3 +66,40 @@ TEST_CASE("Simplify SourceChangeTree") {
             })) == minilua::SourceChangeCombination({item1, item2}));
     }
 }
+
+TEST_CASE("Append to SourceChangeTree") {
+    const auto item1 = minilua::SourceChange({{1, 2, 3}, {1, 2, 4}}, "1");
+    const auto item2 = minilua::SourceChange({{2, 2, 3}, {2, 2, 4}}, "2");
+    const auto item3 = minilua::SourceChange({{3, 2, 3}, {3, 2, 4}}, "3");
+
+    SECTION("empty changes") {
+        std::optional<minilua::SourceChangeTree> tree;
+        minilua::append_source_change(tree, std::nullopt);
+        REQUIRE(tree == std::nullopt);
+
+        minilua::append_source_change(tree, item1);
+        REQUIRE(tree == minilua::SourceChangeTree(item1));
+
+        minilua::append_source_change(tree, std::nullopt);
+        REQUIRE(tree == minilua::SourceChangeTree(item1));
+    }
+
+    SECTION("appends to the same combination") {
+        std::optional<minilua::SourceChangeTree> tree = item1;
+        minilua::append_source_change(tree, item2);
+        minilua::append_source_change(tree, item3);
+        REQUIRE(
+            tree ==
+            minilua::SourceChangeTree(minilua::SourceChangeCombination({item1, item2, item3})));
+    }
+
+    SECTION("does not append to labelled combinations") {
+        auto labelled = minilua::SourceChangeCombination({item1, item2});
+        labelled.hint = "labelled";
+
+        std::optional<minilua::SourceChangeTree> tree = labelled;
+        minilua::append_source_change(tree, item3);
+        REQUIRE(
+            tree == minilua::SourceChangeTree(minilua::SourceChangeCombination({labelled, item3})));
+    }
+}
@@ -4,6 +4,7 @@
 #include <catch2/catch.hpp>
 #include <iterator>
 #include <string>
+#include <unordered_set>
 
 // functions for use in testing NativeFunction
 auto fn(minilua::CallContext /*unused*/) -> minilua::CallResult { // NOLINT
@@ -135,6 +136,32 @@ TEST_CASE("number Value int and float equality") {
     CHECK(std::hash<minilua::Value>{}(10) != std::hash<minilua::Value>{}(10.1)); // NOLINT
 }
 
+TEST_CASE("Value hashes") {
+    std::hash<minilua::Value> hash;
+
+    SECTION("bools") {
+        CHECK(hash(true) != hash(false));
+        CHECK(hash(true) != hash(1));
+        CHECK(hash(false) != hash(0));
+    }
+
+    SECTION("integers with a common stride use different buckets") {
+        const std::size_t num_buckets = 1024;
+        std::unordered_set<std::size_t> buckets;
+        for (int i = 0; i < 1000; ++i) {                  // NOLINT
+            buckets.insert(hash(i * 1024) % num_buckets); // NOLINT
+        }
+        CHECK(buckets.size() > 500); // NOLINT
+    }
+
+    SECTION("strings") {
+        minilua::Value a = std::string("a key");
+        minilua::Value b = std::string("a key");
+        CHECK(hash(a) == hash(b));
+        CHECK(hash(a) == std::hash<minilua::String>()(std::get<minilua::String>(a.raw())));
+    }
+}
+
 TEST_CASE("string Value is constructable") {
     static_assert(std::is_nothrow_move_constructible<minilua::String>());
     static_assert(std::is_nothrow_move_assignable<minilua::String>());
@@ -304,6 +331,156 @@ TEST_CASE("table is iterable") {
     }
 }
 
+TEST_CASE("table border") {
+    minilua::Table table;
+    CHECK(table.border() == 0);
+
+    SECTION("appending") {
+        for (int i = 1; i <= 10; ++i) { // NOLINT
+            table.set(i, i);
+            CHECK(table.border() == i);
+        }
+        CHECK(table.size() == 10);
+    }
+
+    SECTION("filling in reverse order") {
+        for (int i = 10; i >= 2; --i) { // NOLINT
+            table.set(i, i);
+            CHECK(table.border() == 0);
+        }
+        table.set(1, 1);
+        CHECK(table.border() == 10);
+        CHECK(table.get(7) == 7);
+    }
+
+    SECTION("whole floats are integer keys") {
+        table.set(1.0, "a");
+        table.set(2, "b");
+        CHECK(table.border() == 2);
+        CHECK(table.get(1) == "a");
+    }
+
+    SECTION("setting values to nil") {
+        for (int i = 1; i <= 10; ++i) { // NOLINT
+            table.set(i, i);
+        }
+
+        table.set(10, minilua::Nil()); // NOLINT
+        CHECK(table.border() == 9);
+
+        table.set(5, minilua::Nil()); // NOLINT
+        int border = table.border();
+        CHECK((border == 4 || border == 9));
+        CHECK(table.get(border) != minilua::Nil());
+        CHECK(table.get(border + 1) == minilua::Nil());
+
+        // the entries still exist
+        CHECK(table.has(5));
+        CHECK(table.size() == 10);
+    }
+
+    SECTION("assigning through operator[]") {
+        table[1] = "a";
+        table[2] = "b";
+        CHECK(table.border() == 2);
+        table[2] = minilua::Nil();
+        CHECK(table.border() == 1);
+    }
+
+    SECTION("removing keys") {
+        for (int i = 1; i <= 10; ++i) { // NOLINT
+            table.set(i, i);
+        }
+
+        table.remove(10); // NOLINT
+        CHECK(table.border() == 9);
+        CHECK(!table.has(10));
+
+        table.remove(5); // NOLINT
+        CHECK(table.border() == 4);
+        CHECK(!table.has(5));
+        CHECK(table.get(6) == 6);
+        CHECK(table.size() == 8);
+
+        table.set(5, 5);
+        CHECK(table.border() == 9);
+    }
+}
+
+TEST_CASE("table iteration covers array and hash part") {
+    minilua::Table table;
+    for (int i = 1; i <= 5; ++i) { // NOLINT
+        table.set(i, i);
+    }
+    table.set(7, 7);
+    table.set("key", "value");
+    table.set(true, false);
+
+    std::vector<std::pair<minilua::Value, minilua::Value>> pairs{};
+    std::copy(table.begin(), table.end(), std::back_inserter(pairs));
+    std::vector<std::pair<minilua::Value, minilua::Value>> expected{
+        {1, 1}, {2, 2}, {3, 3}, {4, 4}, {5, 5}, {7, 7}, {"key", "value"}, {true, false}};
+    CHECK_THAT(pairs, Catch::Matchers::UnorderedEquals(expected));
+
+    std::vector<std::pair<minilua::Value, minilua::Value>> next_pairs{};
+    for (auto entry = table.next(minilua::Nil()); entry.size() != 0;
+         entry = table.next(entry.get(0))) {
+        next_pairs.emplace_back(entry.get(0), entry.get(1));
+    }
+    CHECK(next_pairs == pairs);
+}
+
+TEST_CASE("table traversal with next") {
+    minilua::Table table;
+    for (int i = 1; i <= 100; ++i) { // NOLINT
+        table.set("key" + std::to_string(i), i);
+    }
+
+    SECTION("keeps the insertion order of the hash part") {
+        int i = 0;
+        for (auto entry = table.next(minilua::Nil()); entry.size() != 0;
+             entry = table.next(entry.get(0))) {
+            ++i;
+            CHECK(entry.get(0) == minilua::Value("key" + std::to_string(i)));
+        }
+        CHECK(i == 100);
+    }
+
+    SECTION("existing keys can be changed and cleared during the traversal") {
+        int count = 0;
+        for (auto entry = table.next(minilua::Nil()); entry.size() != 0;
+             entry = table.next(entry.get(0))) {
+            ++count;
+            if (count % 2 == 0) {
+                table.set(entry.get(0), minilua::Nil());
+            } else {
+                table.set(entry.get(0), 42); // NOLINT
+            }
+        }
+        CHECK(count == 100);
+        CHECK(table.get("key1") == minilua::Value(42));
+        CHECK(table.get("key2") == minilua::Nil());
+    }
+
+    SECTION("removed keys are skipped") {
+        for (int i = 1; i <= 75; ++i) { // NOLINT
+            table.remove("key" + std::to_string(i));
+        }
+        CHECK(table.size() == 25);
+
+        std::vector<minilua::Value> keys;
+        for (auto entry = table.next(minilua::Nil()); entry.size() != 0;
+             entry = table.next(entry.get(0))) {
+            keys.push_back(entry.get(0));
+        }
+        REQUIRE(keys.size() == 25);
+        CHECK(keys.front() == minilua::Value("key76"));
+        CHECK(keys.back() == minilua::Value("key100"));
+        CHECK(std::distance(table.begin(), table.end()) == 25);
+        CHECK_THROWS(table.next("key1"));
+    }
+}
+
 TEST_CASE("nil keys are not allowed") {
     CHECK_THROWS(minilua::Table{{minilua::Nil(), 22}});
     CHECK_THROWS(minilua::Table({{minilua::Nil(), 22}}));
@@ -449,6 +626,13 @@ TEST_CASE("function Value is constructable") {
     }
 }
 
+TEST_CASE("function Values are only equal to themselves") {
+    minilua::Value value{fn};
+    minilua::Value value_copy = value; // NOLINT
+    CHECK(value == value_copy);
+    CHECK(value != minilua::Value{fn});
+}
+
 TEST_CASE("function Value to literal") {
     minilua::Value value{fn};
     CHECK_THROWS(value.to_literal());
@@ -478,6 +662,69 @@ TEST_CASE("calling a function from a function") {
     CHECK(res == minilua::CallResult({3}));
 }
 
+TEST_CASE("String") {
+    SECTION("copies share the buffer") {
+        minilua::String a{"hello"};
+        minilua::String b = a; // NOLINT
+        CHECK(a.value.data() == b.value.data());
+        CHECK(a.view() == "hello");
+    }
+    SECTION("assigning a string refers to the new content") {
+        minilua::String a{"hello"};
+        {
+            minilua::String b{std::string("a temporary string that is not interned ") + "!"};
+            a = b;
+        }
+        CHECK(a.value == "a temporary string that is not interned !");
+        CHECK(a.view() == a.value);
+
+        minilua::String c{"world"};
+        swap(a, c);
+        CHECK(a.value == "world");
+        CHECK(c.value == "a temporary string that is not interned !");
+    }
+    SECTION("short strings are compared by content outside of the interpreter") {
+        minilua::String a{"hello"};
+        minilua::String b{std::string("hel") + "lo"};
+        CHECK(a == b);
+        CHECK(a.hash() == b.hash());
+        CHECK(a != minilua::String("world"));
+    }
+    SECTION("long strings are compared by content") {
+        std::string content(minilua::String::MAX_INTERNED_LENGTH + 1, 'x');
+        minilua::String a{content};
+        minilua::String b{content};
+        CHECK(a.value.data() != b.value.data());
+        CHECK(a == b);
+        CHECK(std::hash<minilua::String>()(a) == std::hash<minilua::String>()(b));
+        CHECK(a != minilua::String(content + "y"));
+    }
+    SECTION("strings can be recreated after they were freed") {
+        { minilua::String a{"temporary"}; }
+        minilua::String b{"temporary"};
+        CHECK(b.value == "temporary");
+        CHECK(b == minilua::String("temporary"));
+    }
+}
+
+TEST_CASE("copies of Values have independent origins") {
+    auto range = minilua::Range{{0, 0, 0}, {0, 2, 2}}; // NOLINT
+    minilua::Value value = minilua::Value(42).with_origin(minilua::LiteralOrigin{range});
+    minilua::Value copy = value; // NOLINT
+
+    SECTION("changing the origin of the copy") {
+        copy.origin() = minilua::ExternalOrigin();
+        CHECK(value.origin() == minilua::LiteralOrigin{range});
+        CHECK(copy.origin() == minilua::ExternalOrigin());
+    }
+    SECTION("removing the origin of the copy") {
+        copy = copy.remove_origin();
+        CHECK(value.has_origin());
+        CHECK_FALSE(copy.has_origin());
+        CHECK(copy.origin() == minilua::NoOrigin());
+    }
+}
+
 TEST_CASE("addition of two Values") {
     SECTION("can add two numbers") {
         minilua::Value value1{4};
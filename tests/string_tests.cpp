@@ -1014,6 +1014,164 @@ TEST_CASE("string.format") {
     }
 }
 
+TEST_CASE("string.find") {
+    minilua::Environment env;
+    minilua::CallContext ctx(&env);
+    auto test_function = [&ctx](const minilua::Vallist& args, const minilua::Vallist& expected) {
+        ctx = ctx.make_new(args);
+        auto result = minilua::string::find(ctx);
+        CHECK(result == expected);
+    };
+
+    SECTION("plain") {
+        test_function({"hello world", "o w"}, {5, 7});
+        test_function({"hello world", "l"}, {3, 3});
+        test_function({"hello world", "l", 5}, {10, 10});
+        test_function({"hello world", "l", -2}, {10, 10});
+        test_function({"hello world", "xyz"}, {minilua::Nil()});
+        test_function({"a.b", ".", 1, true}, {2, 2});
+        test_function({"hello", "", 10}, {minilua::Nil()});
+        test_function({"hello", ""}, {1, 0});
+    }
+
+    SECTION("pattern") {
+        test_function({"hello world", "l+"}, {3, 4});
+        test_function({"hello world", "^h"}, {1, 1});
+        test_function({"hello world", "^e"}, {minilua::Nil()});
+        test_function({"hello world", "d$"}, {11, 11});
+        test_function({"hello world", "o", 6}, {8, 8});
+        test_function({"a.b", "."}, {1, 1});
+        test_function({"key = value", "(%w+)%s*=%s*(%w+)"}, {1, 11, "key", "value"});
+        test_function({"hello", "()ll()"}, {3, 4, 3, 5});
+    }
+
+    SECTION("special items") {
+        test_function({"f(a(b)c)d", "%b()"}, {2, 8});
+        test_function({"hello THE fox", "%f[%a]%u+%f[%A]"}, {7, 9});
+        test_function({"abcabc", "(abc)%1"}, {1, 6, "abc"});
+        test_function({"aaab", "a-b"}, {1, 4});
+        test_function({"ac", "ab?c"}, {1, 2});
+        test_function({"a]b", "[]]"}, {2, 2});
+        test_function({"a-b", "[%-]"}, {2, 2});
+        test_function({"x1y", "[^%a]"}, {2, 2});
+    }
+
+    SECTION("Invalid Input") {
+        ctx = ctx.make_new({"x", "%"});
+        CHECK_THROWS_WITH(minilua::string::find(ctx), Contains("malformed pattern"));
+
+        ctx = ctx.make_new({"x", "[x"});
+        CHECK_THROWS_WITH(minilua::string::find(ctx), Contains("missing ']'"));
+
+        // like in lua a pattern without special characters is searched as a
+        // plain string (a ')' alone is not special)
+        ctx = ctx.make_new({"x", "x)"});
+        CHECK(minilua::string::find(ctx) == minilua::Vallist({minilua::Nil()}));
+        CHECK_THROWS_WITH(minilua::string::match(ctx), Contains("invalid pattern capture"));
+
+        ctx = ctx.make_new({"x", "(x"});
+        CHECK_THROWS_WITH(minilua::string::find(ctx), Contains("unfinished capture"));
+
+        ctx = ctx.make_new({minilua::Nil(), "x"});
+        CHECK_THROWS_WITH(
+            minilua::string::find(ctx),
+            Contains("bad argument #1") && Contains("string expected, got nil"));
+    }
+}
+
+TEST_CASE("string.gmatch") {
+    minilua::Environment env;
+    minilua::CallContext ctx(&env);
+    auto collect = [&ctx](const minilua::Vallist& args) {
+        ctx = ctx.make_new(args);
+        auto iterator = std::get<minilua::Function>(minilua::string::gmatch(ctx));
+
+        std::vector<minilua::Vallist> results;
+        while (true) {
+            auto result = iterator.call(ctx.make_new({})).values();
+            if (result.get(0).is_nil()) {
+                return results;
+            }
+            results.push_back(result);
+        }
+    };
+
+    SECTION("without captures") {
+        auto results = collect({"hello world from lua", "%a+"});
+        REQUIRE(results.size() == 4);
+        CHECK(results[0] == minilua::Vallist{"hello"});
+        CHECK(results[3] == minilua::Vallist{"lua"});
+    }
+
+    SECTION("with captures") {
+        auto results = collect({"a=1, b=2", "(%w+)=(%w+)"});
+        REQUIRE(results.size() == 2);
+        CHECK(results[0] == minilua::Vallist{"a", "1"});
+        CHECK(results[1] == minilua::Vallist{"b", "2"});
+    }
+
+    SECTION("empty matches") {
+        auto results = collect({"abc", "x*"});
+        CHECK(results.size() == 4);
+    }
+
+    SECTION("^ is not an anchor") {
+        auto results = collect({"a^b^", "%^"});
+        CHECK(results.size() == 2);
+    }
+}
+
+TEST_CASE("string.gsub") {
+    minilua::Environment env;
+    minilua::CallContext ctx(&env);
+    auto test_function = [&ctx](const minilua::Vallist& args, const minilua::Vallist& expected) {
+        ctx = ctx.make_new(args);
+        auto result = minilua::string::gsub(ctx);
+        CHECK(result == expected);
+    };
+
+    SECTION("string replacement") {
+        test_function({"hello world", "o", "0"}, {"hell0 w0rld", 2});
+        test_function({"hello world", "o", "0", 1}, {"hell0 world", 1});
+        test_function({"hello world", "(%w+)", "<%1>"}, {"<hello> <world>", 2});
+        test_function({"hello world", "%w+", "%0 %0"}, {"hello hello world world", 2});
+        test_function({"hello world", "(%w+) (%w+)", "%2 %1"}, {"world hello", 1});
+        test_function({"abc", "", "-"}, {"-a-b-c-", 4});
+        test_function({"hello", "^h", "H"}, {"Hello", 1});
+        test_function({"100%", "%%", "%% "}, {"100% ", 1});
+    }
+
+    SECTION("table replacement") {
+        minilua::Table table;
+        table.set("name", "lua");
+        test_function({"hello $name $other", "%$(%w+)", table}, {"hello lua $other", 2});
+    }
+
+    SECTION("function replacement") {
+        minilua::Function upper = [](const minilua::CallContext& ctx) -> minilua::Value {
+            auto arg = std::get<minilua::String>(ctx.arguments().get(0)).value;
+            if (arg == "skip") {
+                return minilua::Nil();
+            }
+            return arg + "!";
+        };
+        test_function({"one skip two", "%a+", upper}, {"one! skip two!", 3});
+    }
+
+    SECTION("Invalid Input") {
+        ctx = ctx.make_new({"x", "x", minilua::Nil()});
+        CHECK_THROWS_WITH(
+            minilua::string::gsub(ctx),
+            Contains("bad argument #3") && Contains("string/function/table expected"));
+
+        ctx = ctx.make_new({"x", "x", "%2"});
+        CHECK_THROWS_WITH(minilua::string::gsub(ctx), Contains("invalid capture index"));
+
+        ctx = ctx.make_new({"x", "x", "%a"});
+        CHECK_THROWS_WITH(minilua::string::gsub(ctx), Contains("invalid use of '%'"));
+    }
+}
+
 TEST_CASE("string.len") {
     minilua::Environment env;
     minilua::CallContext ctx(&env);
@@ -1106,6 +1264,25 @@ TEST_CASE("string.lower") {
     }
 }
 
+TEST_CASE("string.match") {
+    minilua::Environment env;
+    minilua::CallContext ctx(&env);
+    auto test_function = [&ctx](const minilua::Vallist& args, const minilua::Vallist& expected) {
+        ctx = ctx.make_new(args);
+        auto result = minilua::string::match(ctx);
+        CHECK(result == expected);
+    };
+
+    test_function({"hello world", "%a+"}, {"hello"});
+    test_function({"hello world", "%a+", 6}, {"world"});
+    test_function({"hello world", "(h)(e)"}, {"h", "e"});
+    test_function({"hello world", "()o"}, {5});
+    test_function({"  trim  ", "^%s*(.-)%s*$"}, {"trim"});
+    test_function({"2024-10-16", "(%d+)-(%d+)-(%d+)"}, {"2024", "10", "16"});
+    test_function({"hello", "x"}, {minilua::Nil()});
+    test_function({"a.b", "."}, {"a"});
+}
+
 TEST_CASE("string.rep") {
     minilua::Environment env;
     minilua::CallContext ctx(&env);
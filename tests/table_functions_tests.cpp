@@ -1,7 +1,10 @@
+#include <algorithm>
 #include <catch2/catch.hpp>
 #include <cmath>
+#include <cstdint>
 #include <cstdlib>
 #include <iostream>
+#include <limits>
 #include <list>
 #include <random>
 #include <string>
@@ -160,6 +163,17 @@ TEST_CASE("table.concat(list [, sep [, i [, j]]])") {
                 Contains("bad argument #4 to 'concat'") && Contains("number expected"));
         }
 
+        SECTION("Valid table, start at the smallest integer") {
+            std::unordered_map<minilua::Value, minilua::Value> map = {
+                {1, "Hallo"}, {2, "Welt"}, {3, "!"}, {4, "Minilua"}, {5, "Universität"}};
+            minilua::Table table(map);
+
+            ctx = ctx.make_new({table, "", std::numeric_limits<std::int64_t>::min(), 5});
+            CHECK_THROWS_WITH(
+                minilua::table::concat(ctx),
+                Contains("invalid value (nil) at index -9223372036854775808 for 'concat'"));
+        }
+
         SECTION("Invalid table, valid input") {
             std::unordered_map<minilua::Value, minilua::Value> map = {
                 {1, "Hallo"}, {2, "Welt"}, {3, true}, {4, false}, {5, "Universität"}};
@@ -187,6 +201,24 @@ TEST_CASE("table.insert(list [,pos], value)") {
             CHECK(table.get(6) == 42);
         }
 
+        SECTION("Append without position") {
+            ctx = ctx.make_new({table, 42});
+
+            minilua::table::insert(ctx);
+            CHECK(table.has(6));
+            CHECK(table.get(6) == 42);
+            CHECK(table.get(5) == "Universität");
+        }
+
+        SECTION("Append a number without position") {
+            // the value must not be used as the position
+            ctx = ctx.make_new({table, 2});
+
+            minilua::table::insert(ctx);
+            CHECK(table.get(2) == "Welt");
+            CHECK(table.get(6) == 2);
+        }
+
         SECTION("Insert between the elements of table") {
             ctx = ctx.make_new({table, 3, "code"});
 
@@ -365,6 +397,21 @@ TEST_CASE("table.remove(list [, pos])") {
 
             CHECK(!table.has(5));
             CHECK(v == 97);
+            CHECK(table.get(3) == 96);
+            CHECK(table.get(4) == 95);
+            CHECK(table.border() == 4);
+        }
+
+        SECTION("remove the first element") {
+            ctx = ctx.make_new({table, 1});
+
+            minilua::Value v = minilua::table::remove(ctx);
+
+            CHECK(v == 99);
+            CHECK(table.get(1) == 98);
+            CHECK(table.get(4) == 95);
+            CHECK(!table.has(5));
+            CHECK(table.border() == 4);
         }
 
         SECTION("remove #table+1") {
@@ -471,6 +518,58 @@ TEST_CASE("table.sort(list [, comp])") {
         CHECK(sorted);
     }
 
+    SECTION("large lists") {
+        std::mt19937 rng(42); // NOLINT
+        std::vector<minilua::Number::Int> expected;
+        minilua::Table list;
+        for (int i = 1; i <= 1000; i++) {
+            // many duplicates
+            auto value = static_cast<minilua::Number::Int>(rng() % 100); // NOLINT
+            expected.push_back(value);
+            list.set(i, value);
+        }
+        std::sort(expected.begin(), expected.end());
+
+        SECTION("numbers") {
+            ctx = ctx.make_new({list});
+            minilua::table::sort(ctx);
+
+            for (int i = 1; i <= 1000; i++) {
+                REQUIRE(list.get(i) == minilua::Value(expected[i - 1]));
+            }
+        }
+
+        SECTION("comparision-function") {
+            minilua::Function f([](const minilua::CallContext& ctx) {
+                return ctx.arguments().get(1).less_than(ctx.arguments().get(0));
+            });
+            ctx = ctx.make_new({list, f});
+            minilua::table::sort(ctx);
+
+            for (int i = 1; i <= 1000; i++) {
+                REQUIRE(list.get(i) == minilua::Value(expected[1000 - i]));
+            }
+        }
+    }
+
+    SECTION("strings") {
+        minilua::Table list;
+        list.set(1, "pear");
+        list.set(2, "apple");
+        list.set(3, "Zebra");
+        list.set(4, "banana");
+        list.set(5, "apple");
+        ctx = ctx.make_new({list});
+
+        minilua::table::sort(ctx);
+
+        CHECK(list.get(1) == "Zebra");
+        CHECK(list.get(2) == "apple");
+        CHECK(list.get(3) == "apple");
+        CHECK(list.get(4) == "banana");
+        CHECK(list.get(5) == "pear");
+    }
+
     SECTION("invalid input") {
         SECTION("no table") {
             ctx = ctx.make_new({42});
@@ -493,6 +592,28 @@ TEST_CASE("table.sort(list [, comp])") {
                 minilua::table::sort(ctx), Contains("invalid order function for sorting"));
         }
 
+        SECTION("inconsistent comparision-function") {
+            minilua::Table list;
+            for (int i = 1; i <= 100; i++) {
+                list.set(i, i);
+            }
+            minilua::Function f([](const minilua::CallContext& /*unused*/) { return true; });
+
+            ctx = ctx.make_new({list, f});
+
+            CHECK_THROWS_WITH(
+                minilua::table::sort(ctx), Contains("invalid order function for sorting"));
+        }
+
+        SECTION("mixed types") {
+            minilua::Table list;
+            list.set(1, 1);
+            list.set(2, "a");
+            ctx = ctx.make_new({list});
+
+            CHECK_THROWS_WITH(minilua::table::sort(ctx), Contains("attempt to less than compare"));
+        }
+
         SECTION("wrong type for optional parameter") {
             ctx = ctx.make_new({t, 42});
 
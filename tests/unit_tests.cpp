@@ -1,6 +1,14 @@
 #include <catch2/catch.hpp>
+#include <memory>
+#include <string>
+#include <thread>
 #include <type_traits>
 
+#include "details/concat.hpp"
+#include "details/native_stack.hpp"
+#include "details/number_scanner.hpp"
+#include "details/pattern.hpp"
+#include "details/string_table.hpp"
 #include "internal_env.hpp"
 
 TEST_CASE("Internal Env is copyable") {
@@ -51,6 +59,28 @@ TEST_CASE("Internal Env get/set variables") {
     CHECK(env.get_var("var2") == 17);
 }
 
+TEST_CASE("Internal Env borrowed by an Environment") {
+    minilua::Env env;
+    env.set_local("local_var", 2);
+
+    minilua::BorrowedContext ctx(env);
+    auto call_ctx = ctx.make_new({});
+    REQUIRE(call_ctx.environment().get_raw_impl().env == &env);
+
+    SECTION("changes are visible in the original Env") {
+        call_ctx.environment().get_raw_impl().inner().set_local("local_var2", "hi");
+        CHECK(env.get_local("local_var2") == "hi");
+    }
+
+    SECTION("copies of a borrowed Environment own their Env") {
+        minilua::Environment copy = call_ctx.environment();
+        REQUIRE(copy.get_raw_impl().env != &env);
+        copy.get_raw_impl().inner().set_local("local_var2", "hi");
+        CHECK(copy.get_raw_impl().inner().get_local("local_var") == 2);
+        CHECK(env.get_local("local_var2") == std::nullopt);
+    }
+}
+
 TEST_CASE("to_string_with_base") {
     CHECK(minilua::to_string_with_base(15, 10) == "15");
     CHECK(minilua::to_string_with_base(15, 16) == "F");
@@ -61,3 +91,213 @@ TEST_CASE("to_string_with_base") {
     CHECK(minilua::to_string_with_base(1237817389, 35) == "NJUD64");
     CHECK(minilua::to_string_with_base(-88, 12) == "-74");
 }
+
+TEST_CASE("PatternCache") {
+    minilua::details::PatternCache cache(2);
+
+    auto pattern1 = cache.get("%d+");
+    CHECK(cache.get("%d+") == pattern1);
+    CHECK(cache.size() == 1);
+
+    SECTION("gmatch patterns are cached separately") {
+        auto gmatch_pattern = cache.get("^a", false);
+        CHECK(gmatch_pattern != cache.get("^a"));
+        CHECK(!gmatch_pattern->is_anchored());
+        CHECK(cache.get("^a")->is_anchored());
+    }
+
+    SECTION("the least recently used pattern is removed") {
+        auto pattern2 = cache.get("%a+");
+        CHECK(cache.get("%d+") == pattern1);
+        cache.get("%s+");
+        CHECK(cache.size() == 2);
+        CHECK(cache.get("%d+") == pattern1);
+        CHECK(cache.get("%a+") != pattern2);
+        // removed patterns can still be used
+        CHECK(pattern2->find("123 abc")->start == 4);
+    }
+
+    SECTION("malformed patterns are not cached") {
+        CHECK_THROWS(cache.get("[a"));
+        CHECK(cache.size() == 1);
+    }
+}
+
+TEST_CASE("StringTable") {
+    auto allocator = std::make_unique<minilua::MemoryAllocator>();
+    auto& table = allocator->string_table();
+
+    SECTION("short strings are interned") {
+        minilua::details::StringTableScope scope(allocator.get());
+        minilua::String a{"hello"};
+        minilua::String b{std::string("hel") + "lo"};
+        CHECK(a.view().data() == b.view().data());
+        CHECK(a == b);
+        CHECK(a != minilua::String("world"));
+        CHECK(table.size() == 1);
+    }
+    CHECK(table.size() == 0);
+
+    SECTION("long strings are not interned") {
+        minilua::details::StringTableScope scope(allocator.get());
+        minilua::String a{std::string(minilua::String::MAX_INTERNED_LENGTH + 1, 'x')};
+        CHECK(table.size() == 0);
+    }
+
+    SECTION("strings of different tables are compared by content") {
+        minilua::MemoryAllocator other;
+        minilua::String a = [&]() {
+            minilua::details::StringTableScope scope(allocator.get());
+            return minilua::String("hello");
+        }();
+        minilua::details::StringTableScope scope(&other);
+        minilua::String b{"hello"};
+        CHECK(a.view().data() != b.view().data());
+        CHECK(a == b);
+    }
+
+    SECTION("strings outlive their table") {
+        minilua::String a = [&]() {
+            minilua::details::StringTableScope scope(allocator.get());
+            return minilua::String("hello");
+        }();
+        allocator.reset();
+        CHECK(a == minilua::String("hello"));
+    }
+}
+
+TEST_CASE("scan_number") {
+    using minilua::Number;
+    using minilua::details::scan_number;
+
+    SECTION("integers") {
+        CHECK(scan_number("42") == Number(42));
+        CHECK(scan_number("  -42\n") == Number(-42));
+        CHECK(scan_number("+7") == Number(7));
+        CHECK(scan_number("0x1F") == Number(31));
+        CHECK(scan_number("0xffffffffffffff0c") == Number(-244));
+        CHECK(scan_number("-9223372036854775808")->is_int());
+        // too large decimal integers are converted to floats
+        CHECK(scan_number("9223372036854775808")->is_float());
+    }
+
+    SECTION("floats") {
+        CHECK(scan_number("2.5") == Number(2.5));
+        CHECK(scan_number(".5") == Number(0.5));
+        CHECK(scan_number("5.") == Number(5.0));
+        CHECK(scan_number("11230.e-2") == Number(112.3));
+        CHECK(scan_number("1E3") == Number(1000.0));
+        CHECK(scan_number("0x.4") == Number(0.25));
+        CHECK(scan_number("0x0.4p-1") == Number(0.125));
+        CHECK(scan_number("0X083ad.1") == Number(33709.0625));
+    }
+
+    SECTION("invalid numerals") {
+        for (const auto* str : {"", " ", ".", "0x", "1e", "1e+", "- 1", "1 2", "0x1.2.3", "inf"}) {
+            CAPTURE(str);
+            CHECK(scan_number(str) == std::nullopt);
+        }
+    }
+}
+
+TEST_CASE("scan_integer") {
+    using minilua::details::scan_integer;
+
+    CHECK(scan_integer("z", 36) == 35);
+    CHECK(scan_integer(" -ff ", 16) == -255);
+    CHECK(scan_integer(" +ff ", 16) == 255);
+    CHECK(scan_integer("+", 10) == std::nullopt);
+    CHECK(scan_integer("+-1", 10) == std::nullopt);
+    CHECK(scan_integer("101", 2) == 5);
+    CHECK(scan_integer("z", 30) == std::nullopt);
+    CHECK(scan_integer("42.5", 10) == std::nullopt);
+    CHECK(scan_integer("", 10) == std::nullopt);
+}
+
+TEST_CASE("concat_chain") {
+    using minilua::Value;
+
+    std::vector<std::size_t> pairs;
+    auto concat_pair = [&pairs](std::size_t i, const Value& lhs, const Value& rhs) -> Value {
+        pairs.push_back(i);
+        return lhs.is_table() ? rhs : lhs;
+    };
+    std::vector<std::size_t> runs;
+    auto concat_run = [&runs](std::size_t i, const Value* run, std::size_t length) -> Value {
+        runs.push_back(i);
+        return minilua::details::concat_flattened(run, length, std::nullopt);
+    };
+
+    SECTION("strings and numbers are concatenated at once") {
+        std::vector<Value> values{"a", 1, "b", 2.5, "c"}; // NOLINT
+        CHECK(
+            minilua::details::concat_chain(
+                values.data(), values.size(), true, concat_pair, concat_run) == "a1b2.5c");
+        CHECK(pairs.empty());
+        CHECK(runs == std::vector<std::size_t>{0});
+    }
+
+    SECTION("other values are concatenated from right to left") {
+        minilua::Table table;
+        std::vector<Value> values{"a", "b", table, "c", "d"};
+        CHECK(
+            minilua::details::concat_chain(
+                values.data(), values.size(), true, concat_pair, concat_run) == "abcd");
+        CHECK(pairs == std::vector<std::size_t>{2});
+        CHECK(runs == std::vector<std::size_t>{3, 0});
+    }
+
+    SECTION("every operator is evaluated if the chain is not flattened") {
+        std::vector<Value> values{"a", "b", "c"};
+        CHECK(
+            minilua::details::concat_chain(
+                values.data(), values.size(), false, concat_pair, concat_run) == "a");
+        CHECK(pairs == std::vector<std::size_t>{1, 0});
+        CHECK(runs.empty());
+    }
+
+    SECTION("separator") {
+        std::vector<Value> values{"x", 1, "z"};
+        CHECK(minilua::details::concat_strings(values.data(), values.size(), ", ") == "x, 1, z");
+        CHECK(minilua::details::concat_strings(values.data(), 0, ", ") == "");
+    }
+
+    SECTION("flattened strings get a single origin") {
+        std::vector<Value> values{"x", 1, "z"};
+        minilua::Range location{.start = {0, 0, 0}, .end = {0, 12, 12}}; // NOLINT
+
+        auto result = minilua::details::concat_flattened(values.data(), values.size(), location);
+        CHECK(result == "x1z");
+        const auto* origin = std::get_if<minilua::MultipleArgsOrigin>(&result.origin().raw());
+        REQUIRE(origin != nullptr);
+        CHECK(*origin->values == minilua::Vallist{"x", 1, "z"});
+        CHECK(origin->location == location);
+        CHECK_FALSE(result.force("abc").has_value());
+
+        minilua::OriginTrackingScope scope(minilua::OriginTracking::LAZY);
+        CHECK_FALSE(minilua::details::concat_flattened(values.data(), values.size(), location)
+                        .has_origin());
+    }
+}
+
+static auto remaining_native_stack_in_recursion(int depth) -> std::size_t {
+    if (depth == 0) {
+        return minilua::details::remaining_native_stack();
+    }
+    volatile char buffer[1024]; // NOLINT
+    buffer[0] = 0;
+    return remaining_native_stack_in_recursion(depth - 1) + buffer[0];
+}
+
+TEST_CASE("remaining_native_stack") {
+    using minilua::details::NATIVE_STACK_RESERVE;
+    using minilua::details::remaining_native_stack;
+
+    auto remaining = remaining_native_stack();
+    CHECK(remaining > NATIVE_STACK_RESERVE);
+    CHECK(remaining_native_stack_in_recursion(100) < remaining - 100 * 1024); // NOLINT
+
+    std::size_t in_thread = 0;
+    std::thread([&in_thread]() { in_thread = remaining_native_stack(); }).join();
+    CHECK(in_thread > NATIVE_STACK_RESERVE);
+}